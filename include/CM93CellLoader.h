@@ -0,0 +1,162 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Background reading and caching of cm93 cells
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+
+#ifndef __CM93CELLLOADER_H__
+#define __CM93CELLLOADER_H__
+
+#include <wx/event.h>
+#include <wx/thread.h>
+#include <wx/string.h>
+#include <wx/timer.h>
+
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+#include "cm93.h"
+
+#define CM93_CELL_CACHE_BYTES       (64 * 1024 * 1024)  // decoded cell files kept, all scales
+#define CM93_CELL_ABSENT_BYTES      128                 // accounted to a file known not to exist
+#define CM93_CELL_MAX_THREADS       2
+#define CM93_CELL_PREFETCH_SCALE    16                  // cells read ahead for each adjacent scale
+#define CM93_CELL_TICK_MS           100                 // repaints for cells read close together are merged
+
+class CM93CellThread;
+
+extern  const wxEventType wxEVT_OCPN_CM93CELL;
+
+//  One cell of one cm93 scale, with all its subcells
+struct CM93CellRequest
+{
+    wxString            prefix;
+    wxString            scalechar;
+    double              dval;
+    int                 cellindex;
+};
+
+/**
+ * Reads cm93 cell files for cm93chart away from the paint path.
+ *
+ * A small pool of worker threads finds, decompresses, reads and decodes
+ * the files of requested cells into memory images, kept in a cache of
+ * CM93_CELL_CACHE_BYTES shared by all scales and all charts, least recently
+ * used first out.  Files found not to exist are cached too, so that the
+ * file system is not asked again.
+ *
+ * The chart still builds its objects from an image on the GUI thread, which
+ * alone may touch the presentation library.  Requested cells, for the
+ * viewport, go before prefetches; once all the files of a requested cell
+ * are in the cache the canvases are reloaded, so the chart picks it up.
+ */
+class CM93CellLoader : public wxEvtHandler
+{
+public:
+    static CM93CellLoader *Get();
+    static void Shutdown();
+
+    /// The image of a subcell from the cache, else read here and cached.
+    CM93CellImagePtr GetSubcell(const CM93CellRequest &cell, wxChar sub_char);
+
+    /// True if the base cell and every subcell of {cell} are cached.
+    bool IsCellReady(const CM93CellRequest &cell);
+
+    /// True if {cell} is now being read; false if there is no worker, and
+    /// the caller must read it itself.
+    bool Request(const CM93CellRequest &cell, bool prefetch);
+
+    /// Drop the prefetches not yet started, before a new set is queued.
+    void ClearPrefetch();
+
+    void LogStats();
+
+    void OnEvtThread(wxThreadEvent &event);
+    void OnTimer(wxTimerEvent &event);
+
+private:
+    friend class CM93CellThread;
+
+    struct Job
+    {
+        CM93CellRequest     cell;
+        wxString            key;
+        bool                prefetch;
+    };
+
+    struct Entry
+    {
+        CM93CellImagePtr                    image;
+        size_t                              bytes;
+        std::list<wxString>::iterator       lru;
+    };
+
+    CM93CellLoader();
+    ~CM93CellLoader();
+
+    void StartWorkers();
+    void WorkerLoop();
+    void Read(const Job &job);
+
+    CM93CellImagePtr Find(const wxString &key, bool b_count);
+    void Insert(const wxString &key, CM93CellImagePtr image);
+
+    static CM93CellLoader               *s_loader;
+
+    std::vector<CM93CellThread *>       m_threads;
+
+    std::mutex                          m_mutex;
+    std::condition_variable             m_cond;
+    std::deque<Job>                     m_requested;    // for the workers
+    std::deque<Job>                     m_prefetch;
+    std::vector<Job>                    m_done;         // read, not yet announced
+    bool                                m_stop;
+
+    //  The cache, under its own lock
+    std::mutex                          m_cache_mutex;
+    std::map<wxString, Entry>           m_cache;
+    std::list<wxString>                 m_lru;          // most recently used first
+    size_t                              m_bytes;
+    unsigned long                       m_hits;
+    unsigned long                       m_misses;
+
+    //  GUI thread only
+    std::map<wxString, bool>            m_pending;      // queued or being read; true if wanted on screen
+    bool                                m_brepaint;
+    wxTimer                             m_timer;
+};
+
+class CM93CellThread : public wxThread
+{
+public:
+    CM93CellThread(CM93CellLoader *loader);
+    void *Entry();
+
+private:
+    CM93CellLoader      *m_loader;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Open chart cache
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __CHARTCACHE_H__
+#define __CHARTCACHE_H__
+
+#include <wx/string.h>
+
+#include <stddef.h>
+#include <vector>
+#include <unordered_map>
+
+//  Charged for a chart which cannot report its own footprint,
+//  so that such charts still count against the byte budget
+#define CHART_CACHE_MIN_BYTES       (1024 * 1024)
+
+class CacheEntry
+{
+public:
+      wxString    FullPath;
+      void        *pChart;
+      int         RecentTime;
+      int         dbIndex;
+      bool        b_in_use;
+      int         n_lock;
+
+      size_t      bytes;                  // footprint when last accounted
+      CacheEntry  *lru_newer;             // LRU list links, unpinned entries only
+      CacheEntry  *lru_older;
+};
+
+struct ChartCacheStats
+{
+      unsigned long   hits;
+      unsigned long   misses;
+      unsigned long   evictions;
+      int             count;
+      int             pinned;
+      size_t          bytes;
+      size_t          budget;
+};
+
+/**
+ * Index and LRU bookkeeping of the charts held open by ChartDB.
+ *
+ * Entries are found by database index.  Unpinned entries are kept on an
+ * intrusive list ordered by last use, so the eviction candidate is always
+ * the tail.  Pinned entries (n_lock > 0, e.g. the charts of the current
+ * quilt) are off the list and can not be evicted.
+ *
+ * The cache holds no lock of its own and never deletes a chart, ChartDB
+ * does both.
+ */
+class ChartCache
+{
+public:
+      ChartCache();
+
+      /// A byte budget of 0 falls back to a limit on the number of charts.
+      void SetBudget(size_t bytes, int max_charts);
+      size_t GetBudget() const { return m_budget; }
+      int GetMaxCharts() const { return m_max_charts; }
+
+      CacheEntry *Find(int dbIndex) const;
+      void Insert(CacheEntry *pce);
+      void Remove(CacheEntry *pce);
+      void Touch(CacheEntry *pce);
+
+      void Pin(CacheEntry *pce);
+      void Unpin(CacheEntry *pce);
+
+      void SetBytes(CacheEntry *pce, size_t bytes);
+
+      /// Least recently used unpinned entry, and walking from it towards newer ones.
+      CacheEntry *GetOldest() const { return m_lru_oldest; }
+      CacheEntry *GetNewer(const CacheEntry *pce) const { return pce->lru_newer; }
+
+      bool IsOverBudget(double factor = 1.0) const;
+
+      int GetCount() const { return (int)m_map.size(); }
+      size_t GetBytes() const { return m_bytes; }
+      void GetEntries(std::vector<CacheEntry *> &entries) const;
+
+      void CountHit() { m_hits++; }
+      void CountMiss() { m_misses++; }
+      void CountEviction() { m_evictions++; }
+      ChartCacheStats GetStats() const;
+      void LogStats() const;
+
+private:
+      void LinkNewest(CacheEntry *pce);
+      void Unlink(CacheEntry *pce);
+
+      std::unordered_map<int, CacheEntry *>   m_map;
+      CacheEntry      *m_lru_newest;
+      CacheEntry      *m_lru_oldest;
+
+      size_t          m_bytes;
+      size_t          m_budget;
+      int             m_max_charts;
+      int             m_npinned;
+
+      unsigned long   m_hits;
+      unsigned long   m_misses;
+      unsigned long   m_evictions;
+};
+
+#endif
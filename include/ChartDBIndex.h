@@ -0,0 +1,129 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Spatial index over the chart database
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __CHARTDBINDEX_H__
+#define __CHARTDBINDEX_H__
+
+#include <wx/string.h>
+
+#include <vector>
+
+#define CHART_RTREE_FANOUT      16
+
+class ChartDatabase;
+class LLBBox;
+
+struct ChartIndexRect
+{
+    double      minlat;
+    double      maxlat;
+    double      minlon;
+    double      maxlon;
+    int         id;                     // db index for leaves
+};
+
+/**
+ * Static R-tree, bulk loaded by Sort-Tile-Recursive packing.
+ *
+ * The chart database changes rarely and only as a whole, so the tree is
+ * rebuilt rather than updated in place.  Node k of a level covers the
+ * children [k * FANOUT, (k + 1) * FANOUT) of the level below, so no child
+ * pointers are stored and the packed leaf order is all that is persisted.
+ */
+class ChartRTree
+{
+public:
+    void Clear();
+
+    /// Pack the given leaves, the vector is consumed.
+    void Build(std::vector<ChartIndexRect> &items);
+
+    /// Adopt leaves that are already in packed order, as saved by GetItems().
+    void Load(std::vector<ChartIndexRect> &items);
+
+    /// Append the id of every leaf overlapping the query box.
+    void Query(double minlat, double maxlat, double minlon, double maxlon,
+               std::vector<int> &result) const;
+
+    const std::vector<ChartIndexRect> &GetItems() const { return m_leaves; }
+
+private:
+    void BuildNodes();
+
+    std::vector<ChartIndexRect>                 m_leaves;
+    std::vector<std::vector<ChartIndexRect> >   m_nodes;    // [0] covers the leaves, back() is the root
+};
+
+/**
+ * Candidate selection for ChartDB::BuildChartStack() and the quilt.
+ *
+ * Two trees are kept: one over the rough float extents used by
+ * ChartDB::CheckPositionWithinChart(), one over the LLBBox used by the
+ * quilt.  Queries return a sorted superset of the charts that can pass
+ * the exact tests, which the callers still apply.  Dateline handling is
+ * done by also querying the box shifted by 360 degrees.
+ */
+class ChartDBIndex
+{
+public:
+    ChartDBIndex();
+
+    void Invalidate() { m_bvalid = false; }
+    void InvalidateGroups() { m_bgroups_valid = false; }
+
+    /// Make the index current with the database, rebuilding if needed.
+    void Validate(const ChartDatabase &db);
+
+    void Build(const ChartDatabase &db);
+    bool Load(const wxString &path, const ChartDatabase &db);
+    bool Save(const wxString &path) const;
+
+    void QueryPosition(float lat, float lon, int group, std::vector<int> &result) const;
+    void QueryBox(const LLBBox &box, int group, std::vector<int> &result) const;
+
+    const std::vector<int> &GetPluginCharts() const { return m_plugin_charts; }
+
+    /// The index is kept next to the chart list, e.g. "chartlist.dat.idx"
+    static wxString GetIndexFileName(const wxString &db_path);
+
+private:
+    void BuildGroups(const ChartDatabase &db);
+    void FilterGroup(int group, std::vector<int> &result) const;
+    static unsigned int Fingerprint(const ChartDatabase &db);
+    static void GetPositionRect(const ChartDatabase &db, int index, ChartIndexRect &rect);
+
+    ChartRTree          m_position_tree;
+    ChartRTree          m_box_tree;
+    std::vector<int>    m_plugin_charts;
+
+    //  m_group_bits[g][i] is true if chart i is a member of group g
+    std::vector<std::vector<bool> > m_group_bits;
+
+    bool                m_bvalid;
+    bool                m_bgroups_valid;
+    int                 m_nentries;
+    unsigned int        m_fingerprint;
+};
+
+#endif
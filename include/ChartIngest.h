@@ -0,0 +1,129 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Parallel chart header parsing for the chart database scan
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __CHARTINGEST_H__
+#define __CHARTINGEST_H__
+
+#include <wx/thread.h>
+#include <wx/string.h>
+#include <wx/stopwatch.h>
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#define CHART_INGEST_MAX_THREADS    8
+#define CHART_INGEST_WINDOW         64      // jobs parsed ahead of the merger, at most
+
+class ChartDatabase;
+class ChartClassDescriptor;
+struct ChartTableEntry;
+class ChartIngestThread;
+
+/**
+ * Builds the ChartTableEntry of each file found by
+ * ChartDatabase::SearchDirAndAddCharts().
+ *
+ * The file list is a queue of jobs.  Worker threads parse chart headers
+ * (ChartDatabase::CreateChartTableEntry()) at most CHART_INGEST_WINDOW
+ * jobs ahead of the merger, which takes the entries strictly in list
+ * order and alone touches the chart table, so the resulting database
+ * does not depend on thread timing.
+ *
+ * Only chart classes known to parse without shared state are given to
+ * the workers, see IsParallelSafe(); the merger parses the others itself.
+ */
+class ChartIngest
+{
+public:
+    ChartIngest(ChartDatabase *db, ChartClassDescriptor &chart_desc);
+    ~ChartIngest();
+
+    static bool IsParallelSafe(const ChartClassDescriptor &chart_desc);
+
+    /// Queue a file, speculative jobs may be parsed by the workers before they are needed.
+    void AddJob(const wxString &full_name, const wxString &utf8_path, bool speculative);
+
+    const wxString &GetUTF8Path(size_t job) const { return m_jobs[job].utf8_path; }
+
+    /// Start the workers, once all jobs are queued.
+    void Start();
+
+    /// Merger side, in job order: the parsed entry (owned by the caller) or NULL.
+    ChartTableEntry *Take(size_t job);
+
+    /// Merger side, in job order: the entry of this job is not needed.
+    void Skip(size_t job);
+
+    void LogThroughput();
+
+private:
+    friend class ChartIngestThread;
+
+    enum {
+        JOB_PENDING = 0,
+        JOB_CLAIMED,                    // being parsed by a worker
+        JOB_DONE,
+        JOB_CONSUMED
+    };
+
+    struct Job
+    {
+        wxString            full_name;
+        wxString            utf8_path;
+        bool                speculative;
+        int                 state;
+        ChartTableEntry     *entry;
+    };
+
+    void WorkerLoop();
+    ChartTableEntry *Parse(Job &job);
+    void Consumed(size_t job);
+
+    ChartDatabase                       *m_db;
+    ChartClassDescriptor                &m_chart_desc;
+    std::vector<Job>                    m_jobs;
+    std::vector<ChartIngestThread *>    m_threads;
+
+    std::mutex                          m_mutex;
+    std::condition_variable             m_cond;
+    size_t                              m_next;         // first job a worker may claim
+    size_t                              m_consumed;     // jobs taken or skipped by the merger
+    bool                                m_stop;
+
+    int                                 m_nparsed;
+    wxStopWatch                         m_sw;
+};
+
+class ChartIngestThread : public wxThread
+{
+public:
+    ChartIngestThread(ChartIngest *ingest);
+    void *Entry();
+
+private:
+    ChartIngest     *m_ingest;
+};
+
+#endif
@@ -0,0 +1,127 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Background chart opening
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __CHARTOPENSERVICE_H__
+#define __CHARTOPENSERVICE_H__
+
+#include <wx/event.h>
+#include <wx/thread.h>
+#include <wx/string.h>
+#include <wx/timer.h>
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+#include "chartbase.h"
+
+#define CHART_OPEN_MAX_THREADS      4
+#define CHART_OPEN_TICK_MS          100     // repaints for charts opened close together are merged
+
+class ChartDB;
+class ChartOpenThread;
+
+extern  const wxEventType wxEVT_OCPN_CHARTOPEN;
+
+/**
+ * Opens charts for ChartDB away from the paint path.
+ *
+ * Raster charts (KAP, GEO, MBTiles) are constructed and fully initialized
+ * by a small pool of worker threads, then handed to ChartDB on the GUI
+ * thread, which alone touches the cache.  Charts whose Init() is not safe
+ * off the GUI thread (S57, cm93, plugins) are opened there, one per timer
+ * tick, so that the canvas is repainted in between.
+ *
+ * Requested opens, for the quilt on screen, go before prefetches.  Once a
+ * requested chart is in the cache the canvases are reloaded, so the quilt
+ * is composed again with it.
+ */
+class ChartOpenService : public wxEvtHandler
+{
+public:
+    ChartOpenService(ChartDB *db);
+    ~ChartOpenService();
+
+    static bool IsWorkerSafe(ChartTypeEnum chart_type);
+
+    /// True if the chart is now being opened; prefetches are only taken for worker safe types.
+    bool Request(int dbIndex, const wxString &full_path, ChartTypeEnum chart_type, bool prefetch);
+    bool IsPending(int dbIndex) const { return m_pending.count(dbIndex) != 0; }
+
+    /// Drop the prefetches not yet started, before a new set is queued.
+    void ClearPrefetch();
+
+    void OnEvtThread(wxThreadEvent &event);
+    void OnTimer(wxTimerEvent &event);
+
+private:
+    friend class ChartOpenThread;
+
+    struct Job
+    {
+        int                 dbIndex;
+        wxString            full_path;
+        ChartTypeEnum       chart_type;
+        bool                prefetch;
+        ChartBase           *chart;
+        InitReturn          ir;
+    };
+
+    void StartWorkers();
+    void WorkerLoop();
+    void Open(Job &job);
+    void Adopt(Job &job);
+    void ScheduleTick();
+
+    ChartDB                             *m_db;
+    std::vector<ChartOpenThread *>      m_threads;
+
+    std::mutex                          m_mutex;
+    std::condition_variable             m_cond;
+    std::deque<Job>                     m_requested;    // for the workers
+    std::deque<Job>                     m_prefetch;
+    std::vector<Job>                    m_done;         // opened, not yet adopted
+    bool                                m_stop;
+
+    //  GUI thread only
+    std::map<int, bool>                 m_pending;      // queued, opening, or not yet adopted;
+                                                        // true if wanted on screen
+    std::deque<Job>                     m_deferred;     // opened on the GUI thread
+    bool                                m_brepaint;
+    wxTimer                             m_timer;
+};
+
+class ChartOpenThread : public wxThread
+{
+public:
+    ChartOpenThread(ChartOpenService *service);
+    void *Entry();
+
+private:
+    ChartOpenService    *m_service;
+};
+
+#endif
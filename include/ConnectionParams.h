@@ -89,6 +89,8 @@ public:
     void CreateControls( void );
     void OnEnableCBClick(wxCommandEvent &event);
     void Update( ConnectionParams *ConnectionParams);
+    void UpdateOutputStats();
+    void OnStatsTimer( wxTimerEvent &event );
  
     bool GetSelected(){ return m_bSelected; }
     int GetUnselectedHeight(){ return m_unselectedHeight; }
@@ -110,6 +112,9 @@ private:
     wxStaticText *t18;
 
     wxStaticText *t21;
+    wxStaticText *t22;              // output queue statistics
+
+    wxTimer m_statsTimer;
 
     
     DECLARE_EVENT_TABLE()
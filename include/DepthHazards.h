@@ -0,0 +1,160 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Depth hazard queries over the loaded vector charts
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __DEPTHHAZARDS_H__
+#define __DEPTHHAZARDS_H__
+
+#include <stddef.h>
+#include <vector>
+
+#include "s52s57.h"
+
+#define S57_HAZARD_NODE_SIZE        16          // children per R-tree node
+
+class s57chart;
+
+//  A charted hazard met by a track segment
+struct DepthHazardHit
+{
+    S57Obj          *obj;
+    double          depth;          // least depth, meters; 0 if not charted
+    double          lat, lon;       // first contact with the track
+    double          distance;       // from the start of the track, NMi
+    double          offset;         // off the track line, meters; 0 if crossed
+    int             chart_scale;
+};
+
+//  Query and index build accounting, for all charts
+struct DepthHazardStats
+{
+    unsigned long   queries;
+    unsigned long   hits;
+    long            query_us;
+    unsigned long   builds;
+    long            build_us;
+};
+
+/**
+ * The depth hazards of one chart: depth areas and dredged areas, depth
+ * contours, obstructions, wrecks and underwater rocks, each with its least
+ * depth, in a packed R-tree whose nodes also carry the least depth beneath
+ * them.  A query for water shallower than some depth so skips every node
+ * that is deep enough, as well as those off the track.
+ *
+ * Geometry is kept in the SM coordinates of the chart, flattened to
+ * triangles for areas, to polylines for lines.  The index is static: a
+ * chart which adds objects must invalidate it, and build it again before
+ * the next query.
+ */
+class S57HazardIndex
+{
+public:
+    S57HazardIndex();
+
+    void Build(ObjRazRules *razRules[PRIO_NUM][LUPNAME_NUM], float *line_vertex_buffer);
+    void Clear();
+
+    void Invalidate() { m_valid = false; }
+    bool IsValid() const { return m_valid; }
+    size_t GetCount() const { return m_hazards.size(); }
+    size_t GetBytes() const
+        { return m_hazards.size() * sizeof(Hazard) + m_points.size() * sizeof(float) + m_nodes.size() * sizeof(Node); }
+
+    /// Add to {hits} the hazards shallower than {depth} within {half_width}
+    /// of the segment {x0,y0} - {x1,y1}, all in chart SM meters; the
+    /// position of each along the segment is set in {hit.distance}, 0 to 1.
+    /// With {hits} NULL, true at the first one found.
+    bool Query(double x0, double y0, double x1, double y1, double depth, double half_width,
+               std::vector<DepthHazardHit> *hits) const;
+
+private:
+    enum { HAZARD_AREA, HAZARD_LINE, HAZARD_POINT };
+
+    struct Node
+    {
+        float           minx, miny, maxx, maxy;
+        float           depth;          // least depth of the hazards beneath
+    };
+
+    struct Hazard
+    {
+        S57Obj          *obj;
+        int             kind;
+        float           depth;
+        unsigned int    first;          // in m_points: triangles, polyline, or the point
+        unsigned int    count;
+    };
+
+    void AddArea(S57Obj *obj, float depth);
+    void AddLine(S57Obj *obj, float depth, float *line_vertex_buffer);
+    void AddPoint(S57Obj *obj, float depth);
+    void AddHazard(S57Obj *obj, int kind, float depth, unsigned int first);
+    void Pack();
+
+    bool Test(const Hazard &hazard, double x0, double y0, double x1, double y1, double half_width,
+              double &t, double &offset) const;
+
+    bool                    m_valid;
+    std::vector<Hazard>     m_hazards;          // by leaf
+    std::vector<float>      m_points;           // x, y pairs
+    std::vector<Node>       m_nodes;            // leaves, then each level of nodes up to the root
+    std::vector<size_t>     m_level_end;        // end of each level in m_nodes
+};
+
+/**
+ * Grounding checks against the depth hazards of the vector charts held
+ * open by the chart database, cm93 included.
+ *
+ * Every open chart covering the track is consulted, so a small scale cell
+ * may report a hazard which a larger scale one charts in more detail; each
+ * hit carries the scale of its chart for callers which want only the best.
+ * Charts index their hazards on the first query that reaches them.  GUI
+ * thread only, as the charts may otherwise be closed meanwhile.
+ */
+class DepthHazards
+{
+public:
+    /// True if water shallower than {depth} meters, or an obstruction,
+    /// wreck or rock charted shallower, lies within {half_width} meters of
+    /// the track {lat0,lon0} - {lat1,lon1}.  With {hits}, all such hazards
+    /// are found, in order along the track; else the search stops at one.
+    static bool CheckSegment(double lat0, double lon0, double lat1, double lon1, double depth,
+                             double half_width, std::vector<DepthHazardHit> *hits = NULL);
+
+    /// As CheckSegment(), for the track made good at {cog}, {sog} knots over
+    /// the next {minutes}.
+    static bool CheckTrack(double lat, double lon, double cog, double sog, double minutes, double depth,
+                           double half_width, std::vector<DepthHazardHit> *hits = NULL);
+
+    static void CountBuild(long us);
+    static DepthHazardStats GetStats();
+    static void LogStats();
+
+private:
+    static void GetCharts(std::vector<s57chart *> &charts);
+
+    static DepthHazardStats     s_stats;
+};
+
+#endif
@@ -0,0 +1,184 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Background MBTiles tile fetch and decode
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __MBTILESLOADER_H__
+#define __MBTILESLOADER_H__
+
+#include <wx/event.h>
+#include <wx/thread.h>
+#include <wx/timer.h>
+#include <wx/bitmap.h>
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "ocpn_types.h"
+
+#define MBTILES_LOADER_MAX_THREADS  4
+#define MBTILES_REPAINT_MS          50      // repaints for tiles decoded close together are merged
+#define MBTILES_TILE_SIZE           256
+
+namespace SQLite {
+    class Database;
+    class Statement;
+}
+
+class MBTilesLoaderThread;
+
+extern  const wxEventType wxEVT_OCPN_MBTILE;
+
+//  A tile decoded to RGBA, dimmed for {scheme}, waiting for its texture upload
+struct MBTileImage
+{
+    int                         zoom, x, y;
+    ColorScheme                 scheme;
+    bool                        found;          // false if the tileset has no such tile
+    std::vector<unsigned char>  rgba;           // MBTILES_TILE_SIZE square
+};
+
+/**
+ * The tile store of one ChartMBTiles: its database connection, with one
+ * prepared tile query per zoom level, the tiles queued or being decoded,
+ * and the decoded tiles not yet taken by the chart.
+ *
+ * Shared by the chart and the loader jobs for it, so that a chart may be
+ * closed while its tiles are being decoded.
+ */
+class MBTilesSource
+{
+public:
+    MBTilesSource(SQLite::Database *db, int min_zoom, int max_zoom);
+    ~MBTilesSource();
+
+    void SetColorScheme(ColorScheme cs) { m_scheme = cs; }
+    ColorScheme GetColorScheme() const { return (ColorScheme)m_scheme.load(); }
+
+    /// Decoded tiles, in the order they were finished; the caller owns them.
+    void TakeReady(std::vector<MBTileImage *> &ready);
+
+    /// Drop the queued and decoded tiles, before the chart goes away.
+    void Close();
+    bool IsClosed() const { return m_closed; }
+
+private:
+    friend class MBTilesLoader;
+
+    static uint64_t Key(int zoom, int x, int y)
+        { return ((uint64_t)zoom << 48) | ((uint64_t)(uint32_t)x << 24) | (uint32_t)y; }
+
+    bool ReadTile(int zoom, int x, int y, std::vector<unsigned char> &blob);
+    void Decode(MBTileImage *tile, const std::vector<unsigned char> &blob);
+
+    //  The connection, for one job at a time
+    std::mutex                                  m_db_mutex;
+    SQLite::Database                            *m_db;
+    int                                         m_min_zoom;
+    std::vector<SQLite::Statement *>            m_statements;   // by zoom level, prepared on first use
+
+    std::atomic<int>                            m_scheme;
+    std::atomic<int>                            m_imageType;    // wxBitmapType, once known
+
+    std::atomic<bool>                           m_closed;
+
+    //  Under the loader lock
+    std::unordered_map<uint64_t, bool>          m_pending;      // queued or decoding; true if wanted on screen
+
+    std::mutex                                  m_ready_mutex;
+    std::vector<MBTileImage *>                  m_ready;
+};
+
+/**
+ * Fetches and decodes MBTiles tiles for all charts, on a small pool of
+ * worker threads: the blob read through the prepared query of its zoom
+ * level, the PNG/JPEG decode, and the dimming for the dusk and night
+ * color schemes.  The GL render pass only uploads the finished tiles.
+ *
+ * Tiles wanted on screen go before prefetches.  Once one is decoded the
+ * canvases are repainted.  GUI thread only, but for the workers.
+ */
+class MBTilesLoader : public wxEvtHandler
+{
+public:
+    static MBTilesLoader *Get();
+    static void Shutdown();
+
+    /// Queue a tile unless it is already queued; true if now queued or decoding.
+    bool Request(const std::shared_ptr<MBTilesSource> &source, int zoom, int x, int y, bool prefetch);
+
+    /// Drop the prefetches for {source} not yet started, before a new set is queued.
+    void ClearPrefetch(const std::shared_ptr<MBTilesSource> &source);
+
+    /// Drop all queued tiles of {source}, if the loader is running.
+    static void Cancel(MBTilesSource *source);
+
+    void OnEvtThread(wxThreadEvent &event);
+    void OnTimer(wxTimerEvent &event);
+
+private:
+    friend class MBTilesLoaderThread;
+
+    struct Job
+    {
+        std::shared_ptr<MBTilesSource>  source;
+        int                             zoom, x, y;
+    };
+
+    MBTilesLoader();
+    ~MBTilesLoader();
+
+    void StartWorkers();
+    void WorkerLoop();
+    void Run(Job &job);
+    void Finish(Job &job, MBTileImage *tile);
+
+    static MBTilesLoader                *s_loader;
+
+    std::vector<MBTilesLoaderThread *>  m_threads;
+
+    std::mutex                          m_mutex;
+    std::condition_variable             m_cond;
+    std::deque<Job>                     m_requested;
+    std::deque<Job>                     m_prefetch;
+    bool                                m_stop;
+
+    wxTimer                             m_timer;
+};
+
+class MBTilesLoaderThread : public wxThread
+{
+public:
+    MBTilesLoaderThread(MBTilesLoader *loader);
+    void *Entry();
+
+private:
+    MBTilesLoader   *m_loader;
+};
+
+#endif
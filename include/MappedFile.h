@@ -0,0 +1,69 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Read-only memory mapped file
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __MAPPEDFILE_H__
+#define __MAPPEDFILE_H__
+
+#include <wx/string.h>
+
+#include <stddef.h>
+
+/**
+ * A whole file mapped into memory, pages are read in on first access.
+ *
+ * The mapping is private: the pages may be written to, but changes are
+ * never carried back to the file.  Once mapped, the file on disk should
+ * be replaced (written to a new name and renamed) rather than rewritten
+ * in place; it may still be appended to, the mapping covers the file as
+ * it was when opened.
+ */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const wxString &path);
+    void Close();
+
+    bool IsOpen() const { return m_data != NULL; }
+    char *GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+    const wxString &GetPath() const { return m_path; }
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    char        *m_data;
+    size_t      m_size;
+    wxString    m_path;
+
+#ifdef __WXMSW__
+    void        *m_hfile;
+    void        *m_hmapping;
+#endif
+};
+
+#endif
@@ -65,9 +65,19 @@
 #include <initguid.h>
 #endif
 #include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
 #include "ConnectionParams.h"
 #include "dsPortType.h"
 #include "datastream.h"
+#include "OCP_NetworkInput_Thread.h"
+
+/**
+ * Move complete NMEA sentences from the front of buffer to sentences,
+ * each terminated with cr/lf. Any partial sentence is left in buffer.
+ */
+void ExtractNMEASentences(std::string &buffer, std::vector<std::string> &sentences);
 
 class NetworkDataStream : public DataStream {
 public:
@@ -80,7 +90,10 @@ public:
               m_tsock(NULL),
               m_socket_server(NULL),
               m_is_multicast(false),
-              m_txenter(0)
+              m_txenter(0),
+              m_rx_thread(NULL),
+              m_rx_wake_pending(false),
+              m_tx_sock(NULL)
     {
         m_addr.Hostname(params->NetworkAddress);
         m_addr.Service(params->NetworkPort);
@@ -101,6 +114,18 @@ public:
         return SendSentenceNetwork(payload);
     }
     virtual void Close();
+
+    bool SupportsOutputThread() const {
+        return m_net_protocol == TCP || m_net_protocol == UDP;
+    }
+    bool WriteSentence( const std::string &payload );
+
+    //  Called from OCP_NetworkInput_Thread
+    void QueueRxBatch(std::vector<std::string> &batch, const NetworkRxStats &stats);
+    void SetRxStats(const NetworkRxStats &stats);
+
+    NetworkRxStats GetRxStats();
+
 private:
     wxString            m_net_port;
     NetworkProtocol     m_net_protocol;
@@ -117,6 +142,21 @@ private:
     wxTimer             m_socketread_watchdog_timer;
     bool                m_brx_connect_event;
 
+    //  Threaded UDP receive path
+    OCP_NetworkInput_Thread     *m_rx_thread;
+    std::mutex                  m_rx_mutex;
+    std::vector<std::string>    m_rx_batch;
+    bool                        m_rx_wake_pending;
+    NetworkRxStats              m_rx_stats;
+
+    //  Held by the output thread while it picks the socket to write on, and
+    //  by the GUI thread wherever m_sock is connected, closed or replaced.
+    //  The write itself is done unlocked, with m_tx_sock set; the GUI thread
+    //  releases that socket by ReleaseTxSocket() before closing it.
+    std::mutex                  m_tx_mutex;
+    wxSocketBase                *m_tx_sock;
+    std::condition_variable     m_tx_done;
+
 
     void Open();
     void OpenNetworkGPSD();
@@ -126,6 +166,11 @@ private:
 
     void OnTimerSocket(wxTimerEvent& event);
     void OnSocketEvent(wxSocketEvent& event);
+    void OnRxBatch(wxThreadEvent& event);
+    void OnTxError(wxThreadEvent& event);
+    void HandleTCPWriteError();
+    void ReleaseTxSocket(std::unique_lock<std::mutex> &lock, wxSocketBase *sock);
+    bool StartUDPReceiveThread(unsigned int addr);
     //  TCP Server support
     void OnServerSocketEvent(wxSocketEvent& event);             // The listener
     // void OnActiveServerEvent(wxSocketEvent& event);             // The open connection
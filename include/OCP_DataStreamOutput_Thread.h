@@ -0,0 +1,109 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Per-connection NMEA output queue and writer thread
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __OCP_DATASTREAMOUTPUT_THREAD_H__
+#define __OCP_DATASTREAMOUTPUT_THREAD_H__
+
+#include <wx/thread.h>
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#define OUTPUT_QUEUE_DEFAULT_DEPTH      256
+
+class DataStream;
+
+//      What to discard when an output queue is full
+enum OutputOverflowPolicy {
+    OUTPUT_DROP_OLDEST = 0,
+    OUTPUT_DROP_AIS_FIRST = 1           // oldest AIS sentence, else oldest
+};
+
+struct OutputQueueStats
+{
+    OutputQueueStats()
+        : backlog(0), max_backlog(0), sent(0), dropped(0), failed(0) {}
+
+    size_t          backlog;
+    size_t          max_backlog;
+    unsigned long   sent;
+    unsigned long   dropped;            // discarded by the overflow policy
+    unsigned long   failed;             // write errors
+};
+
+/**
+ * Bounded sentence queue between the Multiplexer (producer, GUI thread)
+ * and one connection's writer thread (consumer).
+ *
+ * The overflow policies need to discard from the middle of the queue,
+ * so this is a short critical section around a deque rather than a
+ * lock-free ring; Push() never waits on the writer.
+ */
+class OutputQueue
+{
+public:
+    OutputQueue(size_t depth, OutputOverflowPolicy policy);
+
+    void Push(const std::string &sentence);
+    bool Pop(std::string &sentence, int timeout_ms);
+    void Wake();
+
+    void CountSent() { std::lock_guard<std::mutex> lock(m_mutex); m_stats.sent++; }
+    void CountFailed() { std::lock_guard<std::mutex> lock(m_mutex); m_stats.failed++; }
+    OutputQueueStats GetStats();
+
+private:
+    static bool IsAIS(const std::string &sentence);
+
+    std::deque<std::string>     m_queue;
+    size_t                      m_depth;
+    OutputOverflowPolicy        m_policy;
+    OutputQueueStats            m_stats;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_cond;
+};
+
+/**
+ * Drains an OutputQueue into its DataStream, so that a slow peer
+ * (4800 baud serial, congested TCP client) never blocks the GUI thread.
+ */
+class OCP_DataStreamOutput_Thread : public wxThread
+{
+public:
+    OCP_DataStreamOutput_Thread(DataStream *stream, OutputQueue *queue);
+    ~OCP_DataStreamOutput_Thread();
+    void *Entry();
+
+    void Stop();
+
+private:
+    DataStream      *m_stream;
+    OutputQueue     *m_queue;
+    std::atomic<bool> m_run;
+};
+
+#endif
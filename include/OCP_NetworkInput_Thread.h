@@ -0,0 +1,90 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  UDP NMEA receive thread
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __OCP_NETWORKINPUT_THREAD_H__
+#define __OCP_NETWORKINPUT_THREAD_H__
+
+#include <wx/thread.h>
+
+#include <string>
+#include <vector>
+
+//  Plain BSD sockets are used, the wxSocket path remains in use on Windows
+#if !defined(__WXMSW__)
+#define OCPN_USE_UDP_RX_THREAD
+#endif
+
+#define UDP_RX_SOCKET_BUFFER    (4 * 1024 * 1024)       // requested SO_RCVBUF
+#define UDP_RX_BATCH            32                      // datagrams per recvmmsg()
+#define UDP_RX_DATAGRAM_SIZE    2048
+
+class NetworkDataStream;
+
+/**
+ * Receive statistics of a network input connection.
+ */
+struct NetworkRxStats
+{
+    NetworkRxStats()
+        : datagrams(0), bytes(0), sentences(0), kernel_drops(0),
+          sentences_per_sec(0.) {}
+
+    unsigned long   datagrams;
+    unsigned long   bytes;
+    unsigned long   sentences;
+    unsigned long   kernel_drops;       // datagrams dropped by the kernel, Linux only
+    double          sentences_per_sec;  // over the last second
+};
+
+/**
+ * Reads UDP datagrams on its own socket, outside of the GUI event loop,
+ * frames them into NMEA sentences and hands them to the launching
+ * NetworkDataStream in batches, see NetworkDataStream::QueueRxBatch().
+ */
+class OCP_NetworkInput_Thread : public wxThread
+{
+public:
+    OCP_NetworkInput_Thread(NetworkDataStream *launcher, int fd);
+    ~OCP_NetworkInput_Thread();
+    void *Entry();
+
+    /**
+     * Create, configure and bind the receive socket.
+     * Returns the socket descriptor, or -1 on error.
+     */
+    static int OpenUDPSocket(unsigned short port, unsigned int mcast_addr);
+
+private:
+    int ReceiveBatch();
+    void AddDatagram(const char *data, size_t len);
+
+    NetworkDataStream           *m_launcher;
+    int                         m_fd;
+    std::string                 m_buffer;
+    std::vector<std::string>    m_batch;
+    NetworkRxStats              m_stats;
+    std::vector<char>           m_rx_buf;
+};
+
+#endif
@@ -34,15 +34,20 @@
 #endif //precompiled headers
 
 #include <wx/filename.h>
+#include <wx/thread.h>
 
 #include "gdal/cpl_csv.h"
 #include "ogr_s57.h"
+#include "MappedFile.h"
 #include "chartbase.h"
 
 #include <string.h>
 #include <stdint.h>
 #include <vector>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 
 WX_DEFINE_ARRAY_PTR(float *, SENCFloatPtrArray);
 
@@ -57,6 +62,8 @@ WX_DEFINE_ARRAY_PTR(float *, SENCFloatPtrArray);
 #define         ERROR_BASEFILE_ATTRIBUTES               7
 #define         ERROR_SENCFILE_ABORT                    8
 
+#define         OSENC_PIPELINE_DEPTH                    256     // features read ahead of the one being written
+
 
 //  OSENC V2 record definitions
 #define HEADER_SENC_VERSION             1
@@ -83,6 +90,12 @@ WX_DEFINE_ARRAY_PTR(float *, SENCFloatPtrArray);
 #define CELL_NOCOVR_RECORD                      99
 #define CELL_EXTENT_RECORD                      100
 
+//  From SENC version 201: filler, so that the points of the edge and connected
+//  node tables that follow are aligned to OSENC_TABLE_ALIGNMENT in the file
+#define SENC_PADDING_RECORD                     101
+
+#define OSENC_TABLE_ALIGNMENT                   8
+
 
 //--------------------------------------------------------------------------
 //      Utility Structures
@@ -326,11 +339,13 @@ const char *MyCSVGetField( const char * pszFilename,
 //      Fwd Definitions
 class wxGenericProgressDialog;
 class S57Obj;
+class S57AttrArena;
 class VE_Element;
 class VC_Element;
 class PolyTessGeo;
 class LineGeometryDescriptor;
 class wxFFileInputStream;
+class OsencTessThread;
 
 typedef std::vector<S57Obj *> S57ObjVector;
 typedef std::vector<VE_Element *> VE_ElementVector;
@@ -386,6 +401,42 @@ private:
 };
 
 
+//--------------------------------------------------------------------------
+//      Osenc_instreamMap definition
+//      A stream over the whole file mapped into memory, whose records may
+//      be used in place rather than read into a buffer
+//--------------------------------------------------------------------------
+class Osenc_instreamMap : public Osenc_instream
+{
+public:
+    Osenc_instreamMap();
+    ~Osenc_instreamMap();
+
+    bool Open( const wxString &senc_file_name );
+    void Close();
+
+    Osenc_instream &Read(void *buffer, size_t size);
+    bool IsOk();
+    bool isAvailable();
+    void Shutdown();
+
+    /// The next {size} bytes, in place, and step over them; NULL past the end.
+    /// Valid until Close().
+    unsigned char *Map(size_t size);
+
+    /// True if {p} points into the mapped file
+    bool Contains(const void *p) const
+        { return (const char *)p >= m_map.GetData() && (const char *)p < m_map.GetData() + m_map.GetSize(); }
+
+    size_t GetSize() const { return m_map.GetSize(); }
+
+private:
+    MappedFile          m_map;
+    size_t              m_pos;
+    bool                m_ok;
+};
+
+
 
 //--------------------------------------------------------------------------
 //      Osenc_outstream definition
@@ -401,6 +452,7 @@ public:
     virtual Osenc_outstream& Write(const void* buffer, size_t size) = 0;
     virtual void Close() = 0;
     virtual bool IsOk() = 0;
+    virtual size_t Tell() = 0;
     
     
 
@@ -422,6 +474,7 @@ public:
     Osenc_outstream& Write(const void* buffer, size_t size);
     void Close();
     bool IsOk();
+    size_t Tell();
     
 private:
     void Init();
@@ -432,6 +485,129 @@ private:
 };
 
 
+//--------------------------------------------------------------------------
+//      Osenc_outstreamMem definition
+//      The records of one feature, held in memory until their turn to be written
+//--------------------------------------------------------------------------
+class Osenc_outstreamMem : public Osenc_outstream
+{
+public:
+    Osenc_outstreamMem(){};
+    ~Osenc_outstreamMem(){};
+
+    bool Open(const wxString& ofileName){ m_data.clear(); return true; }
+
+    Osenc_outstream& Write(const void* buffer, size_t size);
+    void Close(){};
+    bool IsOk(){ return true; }
+    size_t Tell(){ return m_data.size(); }
+
+    const void *GetData(){ return m_data.size() ? &m_data[0] : NULL; }
+    size_t GetSize(){ return m_data.size(); }
+
+private:
+    std::vector<unsigned char> m_data;
+};
+
+
+//--------------------------------------------------------------------------
+//      Osenc feature pipeline
+//      One feature on its way through Osenc::createSenc200(): the records
+//      encoded while reading it, and the tessellation of its area, if any
+//--------------------------------------------------------------------------
+typedef enum
+{
+    OSENC_TESS_NONE = 0,                // no area geometry
+    OSENC_TESS_QUEUED,
+    OSENC_TESS_RUNNING,
+    OSENC_TESS_DONE
+} OsencTessState;
+
+class OsencFeatureJob
+{
+public:
+    OsencFeatureJob( OGRFeature *feature );
+    ~OsencFeatureJob();
+
+    void Tessellate();
+
+    OGRFeature                  *m_feature;
+    Osenc_outstreamMem          m_records;              // up to the area geometry record
+
+    OGRPolygon                  *m_poly;                // of m_feature
+    double                      m_ref_lat, m_ref_lon;
+    double                      m_LOD_meters;
+    unsigned char               *m_edge_table;
+    int                         m_nEdgeVectorRecords;
+
+    PolyTessGeo                 *m_ppg;
+    std::atomic<int>            m_state;
+};
+
+/**
+ * Worker threads tessellating the areas of all the SENCs being built.
+ *
+ * A build reads and encodes its features in order, under the Osenc lock,
+ * while the pool tessellates their areas; the records are then written in
+ * feature order.  A build waiting on one of its own areas not yet started
+ * runs it itself, so that no build depends on a free worker.
+ */
+class OsencTessPool
+{
+public:
+    static OsencTessPool *Get();
+    /// Stop and join the workers; queued jobs, and any submitted after,
+    /// are run by the threads that wait on them.
+    static void Stop();
+    /// Stop, and free the pool, once no build may use it.
+    static void Shutdown();
+
+    void Submit( OsencFeatureJob *job );
+
+    /// Wait until {job} is tessellated, tessellating it here if not yet started.
+    void Wait( OsencFeatureJob *job );
+    /// Drop {job} if not yet started, else wait for it.
+    void Cancel( OsencFeatureJob *job );
+
+    /// Total time spent tessellating, by all threads, in milliseconds
+    long GetTessTime(){ return (long)(m_tess_us.load() / 1000); }
+
+private:
+    friend class OsencTessThread;
+
+    OsencTessPool();
+    ~OsencTessPool();
+
+    void StopWorkers();
+    void WorkerLoop();
+    void Run( OsencFeatureJob *job );
+    bool Claim( OsencFeatureJob *job );
+
+    static OsencTessPool                *s_pool;
+    static std::once_flag               s_pool_once;
+
+    std::vector<OsencTessThread *>      m_threads;
+
+    std::mutex                          m_mutex;
+    std::condition_variable             m_cond;
+    std::condition_variable             m_done_cond;
+    std::deque<OsencFeatureJob *>       m_queue;            // not yet taken by a worker
+    bool                                m_stop;
+
+    std::atomic<long long>              m_tess_us;
+};
+
+class OsencTessThread : public wxThread
+{
+public:
+    OsencTessThread( OsencTessPool *pool );
+    void *Entry();
+
+private:
+    OsencTessPool       *m_pool;
+};
+
+
 
 
 
@@ -459,6 +635,12 @@ public:
                S57ObjVector *pObjectVector,
                VE_ElementVector *pVEArray,
                VC_ElementVector *pVCArray);
+
+    //  The edge and connected node points returned by ingest200() may lie in
+    //  the mapped SENC file rather than on the heap; those are not to be
+    //  freed, and are valid only as long as this Osenc.
+    bool IsMapped(const void *p) const { return m_senc_map.Contains(p); }
+    size_t GetMappedSize() const { return m_senc_map.GetSize(); }
     
     //  SENC creation, by Version desired...
     void SetLODMeters(double meters){ m_LOD_meters = meters;}
@@ -466,6 +648,7 @@ public:
     void setRefLocn( double lat, double lon){ m_ref_lat = lat; m_ref_lon = lon; }
     void setOutstream(Osenc_outstream *stream){ m_pauxOutstream = stream; }
     void setInstream(Osenc_instream *stream){ m_pauxInstream = stream; }
+    void setAttrArena(S57AttrArena *arena){ m_attr_arena = arena; }
     
     wxString getUpdateDate(){ return m_LastUpdateDate; }
     wxString getBaseDate(){ return m_sdate000; }
@@ -517,14 +700,17 @@ private:
     void  CreateSENCVectorEdgeTable(Osenc_outstream *stream, S57Reader *poReader);
     void  CreateSENCConnNodeTable(Osenc_outstream *stream, S57Reader *poReader);
 
-    bool CreateSENCRecord200( OGRFeature *pFeature, Osenc_outstream *stream, int mode, S57Reader *poReader );
+    bool CreateSENCRecord200( OsencFeatureJob *job, int mode, S57Reader *poReader );
     bool WriteFIDRecord200( Osenc_outstream *stream, int nOBJL, int featureID, int prim);
     bool WriteHeaderRecord200( Osenc_outstream *stream, int recordType, std::string payload);
     bool WriteHeaderRecord200( Osenc_outstream *stream, int recordType, uint16_t value);
     bool WriteHeaderRecord200( Osenc_outstream *stream, int recordType, uint32_t value);
-    bool CreateAreaFeatureGeometryRecord200( S57Reader *poReader, OGRFeature *pFeature, Osenc_outstream *stream );
+    bool QueueAreaFeatureGeometryRecord200( S57Reader *poReader, OsencFeatureJob *job );
+    bool WriteAreaFeatureGeometryRecord200( OsencFeatureJob *job, Osenc_outstream *stream );
+    bool WriteFeatureJob( OsencFeatureJob *job, Osenc_outstream *stream );
     bool CreateLineFeatureGeometryRecord200( S57Reader *poReader, OGRFeature *pFeature, Osenc_outstream *stream );
     bool CreateMultiPointFeatureGeometryRecord200( OGRFeature *pFeature, Osenc_outstream *stream);
+    bool WritePaddingRecord200( Osenc_outstream *stream, size_t table_offset );
     
     std::string GetFeatureAcronymFromTypecode( int typeCode );
     std::string GetAttributeAcronymFromTypecode( int typeCode );
@@ -559,6 +745,7 @@ private:
     wxString            m_readFileCreateDate;
     
     double              m_ref_lat, m_ref_lon;             // Common reference point, derived from FullExtent
+    S57AttrArena        *m_attr_arena;                    // of the chart ingesting, for the object attributes
     VectorHelperHash    m_vector_helper_hash;
     double              m_LOD_meters;
     S57ClassRegistrar   *m_poRegistrar;
@@ -569,6 +756,8 @@ private:
     
     unsigned char *     pBuffer;
     size_t              bufferSize;
+
+    Osenc_instreamMap   m_senc_map;                     // the SENC being ingested
     
 
     Extent              m_extent;
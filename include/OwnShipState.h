@@ -0,0 +1,102 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Own-ship navigation state publication
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __OWNSHIPSTATE_H__
+#define __OWNSHIPSTATE_H__
+
+#include <atomic>
+#include <time.h>
+
+//  OwnShipFix::flags
+#define OWNSHIP_POS_VALID       0x01            // bGPSValid
+#define OWNSHIP_COG_VALID       0x02
+#define OWNSHIP_SOG_VALID       0x04
+#define OWNSHIP_HDT_VALID       0x08
+#define OWNSHIP_HDM_VALID       0x10
+#define OWNSHIP_VAR_VALID       0x20
+
+/**
+ * A consistent copy of the own-ship navigation state, as it was when
+ * published. Invalid values are NaN, as in the gLat... globals.
+ */
+struct OwnShipFix
+{
+    OwnShipFix();
+
+    double          lat;
+    double          lon;
+    double          cog;
+    double          sog;
+    double          hdt;
+    double          hdm;
+    double          var;
+    int             n_sats;
+    time_t          fix_time;           // of the last position fix
+    long long       timestamp_ms;       // UTC, when published
+    unsigned int    flags;              // OWNSHIP_xxx_VALID
+    unsigned long   sequence;           // increases with each publication
+
+    bool IsPosValid() const { return (flags & OWNSHIP_POS_VALID) != 0; }
+};
+
+/**
+ * Own-ship state shared between the GUI thread, which publishes it after
+ * each navigation update, and readers on any thread.
+ *
+ * A seqlock: a single writer bumps the sequence counter to odd, stores the
+ * fields and bumps it to even again. Readers retry if the counter was odd
+ * or changed while they copied. Readers never block the writer, and take
+ * no lock.
+ */
+class OwnShipState
+{
+public:
+    OwnShipState();
+
+    //  GUI thread only
+    void Publish(const OwnShipFix &fix);
+
+    //  Any thread
+    OwnShipFix Get() const;
+    unsigned long GetSequence() const;
+
+private:
+    std::atomic<unsigned long>  m_seq;
+
+    //  Individually atomic, so that a torn read is well defined and caught
+    //  by the sequence check rather than being a data race
+    std::atomic<double>         m_lat;
+    std::atomic<double>         m_lon;
+    std::atomic<double>         m_cog;
+    std::atomic<double>         m_sog;
+    std::atomic<double>         m_hdt;
+    std::atomic<double>         m_hdm;
+    std::atomic<double>         m_var;
+    std::atomic<int>            m_n_sats;
+    std::atomic<long long>      m_fix_time;
+    std::atomic<long long>      m_timestamp_ms;
+    std::atomic<unsigned int>   m_flags;
+};
+
+#endif
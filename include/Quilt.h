@@ -60,6 +60,7 @@ public:
         b_include = false;
         b_eclipsed = false;
         b_locked = false;
+        b_pending = false;
         last_factor = -1;
     }
 
@@ -75,6 +76,7 @@ public:
     bool b_include;
     bool b_eclipsed;
     bool b_locked;
+    bool b_pending;             // being opened in the background, not drawn yet
 
 private:
     double last_factor;
@@ -247,6 +249,9 @@ private:
     void EmptyCandidateArray( void );
     void SubstituteClearDC( wxMemoryDC &dc, ViewPort &vp );
     int GetNewRefChart( void );
+    bool IsCandidatePending( QuiltCandidate *pqc );
+    void PrefetchCharts( ViewPort &vp );
+    void PrefetchChartsAt( double lat, double lon );
 
     
     bool IsChartS57Overlay( int db_index );
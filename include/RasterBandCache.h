@@ -0,0 +1,120 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Shared cache of decoded raster chart bands
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __RASTERBANDCACHE_H__
+#define __RASTERBANDCACHE_H__
+
+#include <wx/string.h>
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#define RASTER_BAND_ROWS        256         // chart rows per cached band
+
+struct RasterBandCacheStats
+{
+      unsigned long   hits;
+      unsigned long   misses;
+      unsigned long   evictions;
+      int             count;
+      size_t          bytes;              // compressed
+      size_t          raw_bytes;          // as decoded
+      size_t          budget;
+};
+
+/**
+ * Bands of RASTER_BAND_ROWS decoded chart rows, as palette indices, kept
+ * LZ4 compressed for all open and recently closed BSB charts under one
+ * byte budget, least recently used first out.
+ *
+ * Palette indices do not depend on the color scheme, so a band decoded
+ * once serves every scheme.  Bands are found by a chart id handed out per
+ * chart file; a file changed on disk is given a new id, which orphans its
+ * old bands to eviction.
+ *
+ * Thread safe.  Compression and decompression run outside the lock.
+ */
+class RasterBandCache
+{
+public:
+      RasterBandCache();
+
+      /// 0 disables the cache.
+      void SetBudget(size_t bytes);
+      bool IsEnabled() const { return m_budget != 0; }
+
+      int GetChartId(const wxString &path, uint64_t file_size, time_t mtime);
+
+      /// Decompress a band into {dest}, of exactly {size} bytes; false if not cached.
+      bool Fetch(int chart_id, int band, unsigned char *dest, int size);
+      void Store(int chart_id, int band, const unsigned char *src, int size);
+
+      RasterBandCacheStats GetStats();
+      void LogStats();
+
+private:
+      typedef std::shared_ptr< std::vector<char> > Block;
+
+      struct Entry
+      {
+            uint64_t        key;
+            Block           data;
+            int             raw_size;
+      };
+
+      struct ChartStamp
+      {
+            int             id;
+            uint64_t        file_size;
+            time_t          mtime;
+      };
+
+      static uint64_t Key(int chart_id, int band) { return ((uint64_t)chart_id << 32) | (uint32_t)band; }
+      void EvictToBudget();
+
+      std::mutex                                                      m_mutex;
+      std::list<Entry>                                                m_lru;          // most recent first
+      std::unordered_map<uint64_t, std::list<Entry>::iterator>        m_map;
+      std::map<wxString, ChartStamp>                                  m_charts;
+      int                                                             m_next_id;
+
+      size_t          m_bytes;
+      size_t          m_raw_bytes;
+      std::atomic<size_t> m_budget;       // also read unlocked, by IsEnabled() and Store()
+
+      unsigned long   m_hits;
+      unsigned long   m_misses;
+      unsigned long   m_evictions;
+};
+
+extern RasterBandCache g_RasterBandCache;
+
+#endif
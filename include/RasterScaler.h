@@ -0,0 +1,50 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Raster chart downsampling primitives
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __RASTERSCALER_H__
+#define __RASTERSCALER_H__
+
+#include <stddef.h>
+
+//  The box filter of ChartBaseBSB::GetAndScaleData() (RENDER_HIDEF), split
+//  in a vertical pass summing the rows of each byte column, and a horizontal
+//  pass which averages the column sums over each output pixel.
+//
+//  The vertical pass is the bulk of the work.  It uses AVX2 or SSE2 where the
+//  processor has them, chosen once at run time, else plain C.
+
+//  sums[i] = sum of src[r * stride + i] for r in [0, nrows), for i in [0, nbytes)
+void RasterSumRows(const unsigned char *src, size_t stride, int nrows, int nbytes, unsigned int *sums);
+
+//  Average {box} columns by {box} rows of the column sums of RasterSumRows():
+//  output pixel x covers the source pixels from (int)(x * factor).
+//  The first three bytes of each pixel are written, pixels are {pix_bytes} apart.
+//  The column sums are overwritten.
+void RasterBoxFilterRow(unsigned int *sums, int ncols, int pix_bytes, double factor, int box,
+                        int nout, unsigned char *dest);
+
+//  The instruction set in use by RasterSumRows(), for the log
+const char *RasterScalerISA();
+
+#endif
@@ -0,0 +1,109 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  DataStream replaying a capture log
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __REPLAYDATASTREAM_H__
+#define __REPLAYDATASTREAM_H__
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+  #include "wx/wx.h"
+#endif //precompiled header
+
+#include <wx/thread.h>
+
+#include <string>
+#include "datastream.h"
+#include "StreamCapture.h"
+
+class ReplayDataStream;
+
+/**
+ * Feeds the records of a capture log to the consumer, paced by the
+ * recorded receive timestamps scaled by the replay speed.
+ */
+class ReplayThread : public wxThread
+{
+public:
+    ReplayThread(ReplayDataStream *launcher, wxEvtHandler *target,
+                 const std::string &path);
+    ~ReplayThread();
+    void *Entry();
+
+private:
+    void Post(const CaptureRecord &rec);
+    bool WaitUntil(int64_t wall_us);
+
+    ReplayDataStream    *m_launcher;
+    wxEvtHandler        *m_pMessageTarget;
+    StreamCaptureReader m_reader;
+};
+
+
+/**
+ * Input-only DataStream re-injecting a capture log recorded by
+ * StreamCaptureWriter, see StreamCapture.h. NMEA records are posted as
+ * OCPN_DataStreamEvent from this stream, Signal K records as
+ * OCPN_SignalKEvent.
+ *
+ * Speed 1.0 replays in real time, N runs N times faster, and a speed
+ * of zero replays unthrottled (as fast as the consumer can drain).
+ */
+class ReplayDataStream : public DataStream
+{
+public:
+    ReplayDataStream(wxEvtHandler *input_consumer, const wxString &path,
+                     double speed = 1.0);
+    ~ReplayDataStream();
+
+    void Close();
+    bool SendSentence( const wxString &sentence ) { return false; }
+
+    void SetSpeed(double speed);
+    double GetSpeed();
+
+    /** Request a jump to the given log time, usec since epoch (UTC). */
+    void SeekTo(int64_t ts);
+    int64_t GetLogStartTime() const { return m_log_start; }
+    int64_t GetLogEndTime() const { return m_log_end; }
+
+    //  Accessed by ReplayThread
+    bool GetSeekRequest(int64_t &ts);
+    bool GetSpeedChanged(double &speed);
+    void SetLogTimes(int64_t start, int64_t end) { m_log_start = start; m_log_end = end; }
+
+private:
+    void Open(const wxString &path);
+
+    ReplayThread        *m_thread;
+    wxCriticalSection   m_ctlCritical;
+    double              m_speed;
+    bool                m_speed_changed;
+    bool                m_seek_pending;
+    int64_t             m_seek_ts;
+    int64_t             m_log_start;
+    int64_t             m_log_end;
+};
+
+#endif // __REPLAYDATASTREAM_H__
@@ -0,0 +1,81 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Spatial index of the S52 text labels drawn in a frame
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __S52LABELGRID_H__
+#define __S52LABELGRID_H__
+
+#include <stdint.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <wx/gdicmn.h>
+
+#define S52_LABEL_CELL_SHIFT        6           // 64 pixel cells
+#define S52_LABEL_MAX_CELLS         4096        // kept between frames
+
+class S52_TextC;
+
+/**
+ * The screen rectangles of the text labels drawn so far this frame, in a
+ * uniform grid of square cells, so that a new label is tested for overlap
+ * only against those in the cells it covers.
+ *
+ * A label is entered in each cell its rectangle touches.  The rectangle is
+ * copied when the label is added, and the label itself is only compared,
+ * never read, so a label freed before the next Clear() is harmless.
+ * Cells are hashed, so labels off the screen need no special case; emptied
+ * cells are kept for the next frame unless there are many.
+ */
+class S52LabelGrid
+{
+public:
+    void Clear();
+
+    /// True if {text} was added since the last Clear().
+    bool Contains(const S52_TextC *text) const { return m_texts.count(text) != 0; }
+    size_t GetCount() const { return m_entries.size(); }
+
+    void Add(S52_TextC *text, const wxRect &rect);
+
+    /// True if {rect} overlaps the rectangle of a label other than {except}.
+    bool Intersects(const wxRect &rect, const S52_TextC *except) const;
+
+private:
+    struct Entry
+    {
+        wxRect              rect;
+        const S52_TextC     *text;
+    };
+
+    static int CellOf(int v) { return v >> S52_LABEL_CELL_SHIFT; }
+    //  Unsigned, as cells left of or above the screen are negative
+    static uint64_t CellKey(int cx, int cy) { return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy; }
+
+    std::vector<Entry>                                      m_entries;
+    std::unordered_map<uint64_t, std::vector<unsigned int> >  m_cells;
+    std::unordered_set<const S52_TextC *>                   m_texts;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Scanline fill of S52 area triangles into a DC render buffer
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __S52SPANRASTER_H__
+#define __S52SPANRASTER_H__
+
+#include <vector>
+
+#include "s52s57.h"
+
+//  Fill accounting, since the last LogStats()
+struct S52SpanStats
+{
+    unsigned long   triangles;
+    unsigned long   rejected;       // wholly outside the buffer
+    unsigned long   spans;          // as rasterized
+    unsigned long   runs;           // as filled, once merged
+    unsigned long   pixels;
+};
+
+/**
+ * Solid color fill of the triangles of an area into the render buffer of
+ * the DC render path.
+ *
+ * The triangles of one area are first rasterized to spans, row by row, and
+ * the spans of each row merged, so that the pixels along the edges shared
+ * by neighbouring triangles are filled once, in one run with their
+ * neighbours.  Runs are filled with the widest stores the CPU has, chosen
+ * at run time.  A triangle is rasterized only if its bounding box meets the
+ * buffer clip.
+ *
+ * Edges follow the same 16.16 DDA as s52plib::dda_tri, so fills match.
+ */
+class S52SpanRaster
+{
+public:
+    S52SpanRaster();
+
+    /// Start an area in {pb_spec}, clipped to its rows and to lclip - rclip.
+    void Begin(render_canvas_parms *pb_spec);
+    /// Rasterize a triangle of the area; false if it is rejected.
+    bool AddTriangle(const wxPoint *ptp);
+    /// Fill all the triangles since Begin() in {c}.
+    void Fill(const S52color *c);
+
+    /// Set {count} pixels of {depth} bits at {dest} to {color}, packed as
+    /// for a 32 bit pixel.
+    static void FillSpan(unsigned char *dest, int depth, unsigned int color, int count);
+
+    static const char *GetFillName();
+    static void LogStats(const wxRect &rect, long ms);
+
+private:
+    struct Span
+    {
+        int             x1, x2;         // inclusive
+    };
+
+    render_canvas_parms                 *m_spec;
+    std::vector< std::vector<Span> >    m_rows;         // by row of the buffer
+    std::vector<int>                    m_used_rows;
+
+    static S52SpanStats                 s_stats;
+};
+
+#endif
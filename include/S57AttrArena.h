@@ -0,0 +1,119 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Shared storage of the S57 object attributes of a chart
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+
+#ifndef __S57ATTRARENA_H__
+#define __S57ATTRARENA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+#include "s52s57.h"
+
+#define S57_ATTR_BLOCK_BYTES        (64 * 1024)
+
+/**
+ * The attribute values of the objects of one chart, interned: every object
+ * with the same value of an attribute type, e.g. COLOUR "3,4" or CATLAM 1,
+ * shares one S57attVal record, held in a few large blocks rather than in
+ * two allocations per attribute.  The acronym arrays of the objects are
+ * kept in the blocks too.
+ *
+ * The records keep the layout the plugin API and the conditional
+ * symbology read, and are never changed once made.  Objects built on the
+ * arena only point into it; they must all be deleted before it is.  One
+ * thread at a time: the chart loading.
+ */
+class S57AttrArena
+{
+public:
+    S57AttrArena();
+    ~S57AttrArena();
+
+    S57attVal *GetInteger(int val);
+    S57attVal *GetDouble(double val);
+    S57attVal *GetString(const char *val);
+
+    /// Append {acronym} to {att_array}, of {n_attr} acronyms; the array of
+    /// the object built last grows in place.
+    char *AddAcronym(char *att_array, int n_attr, const char *acronym);
+
+    void Clear();
+
+    size_t GetBytes() const;
+    unsigned long GetValueCount() const { return m_nvalues; }
+    size_t GetRecordCount() const { return m_ints.size() + m_doubles.size() + m_strings.size(); }
+
+private:
+    struct StrHash
+    {
+        size_t operator()(const char *s) const
+        {
+            size_t h = 2166136261u;                     // FNV-1a
+            while(*s)
+                h = (h ^ (unsigned char)*s++) * 16777619u;
+            return h;
+        }
+    };
+
+    struct StrEqual
+    {
+        bool operator()(const char *a, const char *b) const { return !strcmp(a, b); }
+    };
+
+    //  Bump allocation from a list of blocks
+    class Pool
+    {
+    public:
+        Pool() : m_top(NULL), m_left(0), m_last(NULL), m_bytes(0) {}
+        ~Pool() { Clear(); }
+
+        void *Alloc(size_t bytes);
+        /// Grow the last allocation, {p}, to {bytes}, moving it if its block is full.
+        void *Extend(void *p, size_t old_bytes, size_t bytes);
+        void Clear();
+        size_t GetBytes() const { return m_bytes; }
+
+    private:
+        std::vector<char *>     m_blocks;
+        char                    *m_top;
+        size_t                  m_left;
+        char                    *m_last;
+        size_t                  m_bytes;
+    };
+
+    S57attVal *NewRecord(OGRatt_t type, size_t value_bytes);
+
+    Pool                                                        m_values;
+    Pool                                                        m_acronyms;
+    std::unordered_map<int, S57attVal *>                        m_ints;
+    std::unordered_map<uint64_t, S57attVal *>                   m_doubles;      // by bit pattern
+    std::unordered_map<const char *, S57attVal *, StrHash, StrEqual> m_strings; // keyed by the record's value
+    unsigned long                                               m_nvalues;
+};
+
+#endif
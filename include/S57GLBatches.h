@@ -0,0 +1,130 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Batched OpenGL rendering of S57 area fills and simple lines
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __S57GLBATCHES_H__
+#define __S57GLBATCHES_H__
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "s52s57.h"
+
+#define S57_GL_BATCH_STATS_FRAMES   300         // frames per batching report, with ShowFPS
+
+class ViewPort;
+
+/**
+ * The area fills and simple lines of one chart, merged by display priority
+ * and style into a few ranges of two buffers: a vertex buffer of fill
+ * triangles, and an index buffer of line pieces into the chart line VBO.
+ *
+ * Only objects that draw one AC rule in the area pass, or one LS rule in
+ * the object pass, are batched; all others are drawn on their own.  Fill
+ * and line colors are looked up when drawn, so a new color scheme needs no
+ * rebuild.  Conditional symbology does change the batches, which are no
+ * longer valid once the plib state changes.  Nor are they once the chart
+ * sets new line priorities or adds objects: it must invalidate them.
+ *
+ * Each frame the visible objects are queued, then each batch is drawn in
+ * as few calls as there are runs of queued objects in it.  Objects within
+ * a batch are laid out in spatial order, so that those in view make long
+ * runs.  GUI thread, with the GL context current.
+ */
+class S57GLBatches
+{
+public:
+    S57GLBatches();
+    ~S57GLBatches();
+
+    /// Batch the fills of list type {area_type}, and the lines of lists
+    /// {area_type} and LINES drawn from {line_vbo}.
+    void Build(ObjRazRules *razRules[PRIO_NUM][LUPNAME_NUM], int area_type, int line_vbo);
+    void Clear();
+
+    void Invalidate() { m_valid = false; }
+    bool IsValid(int area_type) const;
+
+    /// Queue the fill or the line of {rzRules} if batched and visible;
+    /// false if the object must be drawn on its own.
+    bool AddArea(ObjRazRules *rzRules, ViewPort *vp) { return Add(m_area_index, rzRules, vp); }
+    bool AddLine(ObjRazRules *rzRules, ViewPort *vp) { return Add(m_line_index, rzRules, vp); }
+
+    /// Draw and unqueue the batches of one list.
+    void DrawAreas(int prio, ViewPort *vp, const sm_parms &transform);
+    void DrawLines(int prio, int type, ViewPort *vp, const sm_parms &transform);
+
+    /// Per frame accounting, shared by all charts
+    static void CountSingle() { s_stats.singles++; }
+    static void CountRenderTime(long us) { s_stats.render_us += us; }
+    static void EndFrame(bool b_log, double frame_ms);
+
+private:
+    struct Entry
+    {
+        int             batch;
+        unsigned int    first;          // vertex of a fill, index of a line
+        unsigned int    count;
+    };
+
+    struct Batch
+    {
+        std::string                 rule;           // AC color or LS instruction
+        std::vector<int>            queued;         // entries in view this frame
+    };
+
+    struct Stats
+    {
+        unsigned long   frames;
+        unsigned long   objects;
+        unsigned long   draws;
+        unsigned long   singles;
+        long            render_us;
+    };
+
+    typedef std::unordered_map<ObjRazRules *, int> EntryIndex;
+
+    int AddBatch(int prio, int type, const char *rule);
+    void AddEntry(EntryIndex &index, ObjRazRules *rzRules, int batch, unsigned int first, unsigned int count);
+    bool Add(EntryIndex &index, ObjRazRules *rzRules, ViewPort *vp);
+    void DrawQueued(Batch &batch, unsigned int mode, bool b_indexed);
+
+    bool                                m_valid;
+    int                                 m_area_type;
+    long                                m_state_hash;       // of the plib, when built
+
+    std::vector<Entry>                  m_entries;          // by batch, in buffer order
+    EntryIndex                          m_area_index;
+    EntryIndex                          m_line_index;
+    std::vector<Batch>                  m_batches;
+    std::vector<int>                    m_list_batches[PRIO_NUM][LUPNAME_NUM];
+
+    unsigned int                        m_area_vbo;
+    unsigned int                        m_line_ibo;
+    unsigned int                        m_line_vbo;         // the chart's, not owned
+
+    static Stats                        s_stats;
+};
+
+#endif
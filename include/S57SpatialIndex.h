@@ -0,0 +1,95 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Spatial index of S57 chart objects
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifndef __S57SPATIALINDEX_H__
+#define __S57SPATIALINDEX_H__
+
+#include <stddef.h>
+#include <vector>
+
+#include "s52s57.h"
+
+#define S57_INDEX_NODE_SIZE         16          // children per R-tree node
+#define S57_INDEX_MARGIN_PIXELS     256         // reach of symbols and text beyond their object's extent
+
+class ViewPort;
+
+/**
+ * Packed R-trees over the bounding boxes of a chart's objects, one for each
+ * razRules[priority][type] list, so that render and pick passes visit only
+ * the objects near the view instead of walking whole lists.
+ *
+ * Objects are indexed by their extent when the index is built.  Symbols and
+ * text drawn later may reach further, which the caller accounts for with a
+ * margin on the query box.  Lights, whose sectors may be drawn out to their
+ * nominal range, are always visited.
+ *
+ * A query yields objects in list order, so display priority and the natural
+ * order within a priority are kept.  The trees are static: a list that
+ * changes must be invalidated, and its tree built again before the next
+ * query on it.
+ */
+class S57SpatialIndex
+{
+public:
+    S57SpatialIndex();
+
+    /// Build the trees of all the lists not yet indexed.
+    void Build(ObjRazRules *razRules[PRIO_NUM][LUPNAME_NUM]);
+    void Build(int prio, int type, ObjRazRules *top);
+    void Clear();
+
+    void Invalidate(int prio, int type) { m_lists[prio][type].valid = false; }
+    bool IsValid(int prio, int type) const { return m_lists[prio][type].valid; }
+
+    /// The objects of list {prio, type} that may meet {box}, in list order.
+    void Query(int prio, int type, const LLBBox &box, std::vector<ObjRazRules *> &rules) const;
+
+    /// {box} grown by S57_INDEX_MARGIN_PIXELS at the scale of {vp}.
+    static LLBBox GetQueryBox(const LLBBox &box, const ViewPort &vp);
+
+private:
+    struct Box
+    {
+        float   minlat, minlon, maxlat, maxlon;
+    };
+
+    struct List
+    {
+        List() : valid(false) {}
+
+        bool                        valid;
+        std::vector<ObjRazRules *>  rules;          // by position in the list
+        std::vector<Box>            boxes;          // leaves, then each level of nodes up to the root
+        std::vector<int>            leaf_ids;       // list position of each leaf
+        std::vector<size_t>         level_end;      // end of each level in boxes
+        std::vector<int>            always;         // list positions visited by every query
+    };
+
+    void Search(const List &list, const Box &box, std::vector<int> &ids) const;
+
+    List    m_lists[PRIO_NUM][LUPNAME_NUM];
+};
+
+#endif
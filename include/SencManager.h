@@ -26,6 +26,8 @@
 #ifndef __SENCMGR_H__
 #define __SENCMGR_H__
 
+#include <wx/stopwatch.h>
+
 // ----------------------------------------------------------------------------
 // Useful Prototypes
 // ----------------------------------------------------------------------------
@@ -75,6 +77,7 @@ public:
     wxString m_SENCFileName;
     double ref_lat, ref_lon;
     double m_LOD_meters;
+    wxULongLong m_cell_size;            // of the base cell and its updates, to schedule by
     
     SENCBuildThread *m_thread;
 
@@ -121,8 +124,16 @@ public:
     bool IsChartInTicketlist(s57chart *chart);
     bool SetChartPointer(s57chart *chart, void *new_ptr);
     int GetJobCount();
+    void CancelPendingJobs();
 
     int                 m_max_jobs;
+
+    //  The batch of builds in progress, logged once the list empties
+    wxStopWatch         m_batch_sw;
+    int                 m_batch_cells;
+    int                 m_batch_errors;
+    wxULongLong         m_batch_bytes;
+    long                m_batch_tess_ms;
     
     std::vector<SENCJobTicket *> ticket_list;
 };
@@ -98,12 +98,20 @@ public:
         Open();
     }
 
+    //  The output thread calls WriteSentence(), stop it while we are whole
+    ~SerialDataStream() {
+        StopOutputThread();
+    }
+
     bool SendSentence( const wxString &sentence ) {
         wxString payload = sentence;
         if( !sentence.EndsWith(_T("\r\n")) )
             payload += _T("\r\n");
         return SendSentenceSerial(payload);
     }
+
+    bool SupportsOutputThread() const { return !GetGarminMode(); }
+    bool WriteSentence( const std::string &payload );
 private:
     void Open();
     virtual bool SendSentenceSerial(const wxString &payload);
@@ -0,0 +1,154 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Data stream capture log, writer and reader
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+/**
+ * Capture of everything arriving at the Multiplexer, for later replay.
+ *
+ * File layout (all integers little endian):
+ *
+ *    file header    "OCPNCAP1"
+ *    block 0..n     block header + LZ4 compressed record payload
+ *    index          n x { uint64 file offset, int64 first timestamp }
+ *    trailer        { uint64 index offset, uint32 block count, "OCPNCIDX" }
+ *
+ * Each uncompressed block payload is a sequence of records:
+ *
+ *    { int64 timestamp (usec, UTC), uint8 kind, uint16 source length,
+ *      uint32 data length, source bytes, data bytes }
+ *
+ * A file without a valid trailer (e.g. after a crash) is still readable,
+ * the reader rebuilds the index by walking the block headers.
+ */
+
+#ifndef __STREAMCAPTURE_H__
+#define __STREAMCAPTURE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#define CAPTURE_BLOCK_SIZE         (64 * 1024)   // uncompressed payload
+#define CAPTURE_BLOCK_MAX_AGE_US   1000000       // flush at least every second
+
+enum CaptureRecordKind {
+    CAPTURE_NMEA0183 = 0,
+    CAPTURE_SIGNALK = 1
+};
+
+struct CaptureRecord
+{
+    int64_t     timestamp;      // usec since epoch, UTC, time of receipt
+    int         kind;           // CaptureRecordKind
+    std::string source;         // originating DataStream port, or "Virtual:"
+    std::string data;           // raw sentence or JSON message
+};
+
+struct CaptureBlockIndex
+{
+    uint64_t    offset;
+    int64_t     first_timestamp;
+};
+
+
+/**
+ * Append-only capture log. Records are buffered into a block which is
+ * LZ4 compressed and written when full, or when older than
+ * CAPTURE_BLOCK_MAX_AGE_US.  Close() writes the block index and trailer.
+ */
+class StreamCaptureWriter
+{
+public:
+    StreamCaptureWriter();
+    ~StreamCaptureWriter();
+
+    bool Open(const std::string &path);
+    void Close();
+    bool IsOpen() const { return m_file != NULL; }
+
+    void Append(int kind, const std::string &source, const std::string &data);
+    void Append(int64_t timestamp, int kind, const std::string &source,
+                const std::string &data);
+    void Flush();
+
+    size_t GetRecordCount() const { return m_n_records_total; }
+    const std::string &GetPath() const { return m_path; }
+
+private:
+    FILE                            *m_file;
+    std::string                     m_path;
+    std::vector<char>               m_block;
+    std::vector<char>               m_compressed;
+    std::vector<CaptureBlockIndex>  m_index;
+    int64_t                         m_block_first_ts;
+    int64_t                         m_block_last_ts;
+    unsigned int                    m_block_records;
+    size_t                          m_n_records_total;
+};
+
+
+/**
+ * Sequential reader of a capture log with block-granular seeking.
+ * Not thread safe, intended to be owned by a single replay thread.
+ */
+class StreamCaptureReader
+{
+public:
+    StreamCaptureReader();
+    ~StreamCaptureReader();
+
+    bool Open(const std::string &path);
+    void Close();
+    bool IsOpen() const { return m_file != NULL; }
+
+    /** Get next record, false at end of log or on a damaged block. */
+    bool Next(CaptureRecord &rec);
+
+    /**
+     * Position the reader on the first record with timestamp >= ts.
+     * Returns false if ts is beyond the end of the log.
+     */
+    bool Seek(int64_t ts);
+    void Rewind() { SeekBlock(0); }
+
+    int64_t GetStartTime() const;
+    int64_t GetEndTime() const { return m_end_ts; }
+    size_t GetBlockCount() const { return m_index.size(); }
+
+private:
+    bool ReadIndex();
+    bool RebuildIndex();
+    bool SeekBlock(size_t block);
+    bool LoadBlock(size_t block);
+
+    FILE                            *m_file;
+    std::vector<CaptureBlockIndex>  m_index;
+    int64_t                         m_end_ts;
+    std::vector<char>               m_block;
+    size_t                          m_block_pos;
+    size_t                          m_current_block;
+};
+
+#endif  // __STREAMCAPTURE_H__
@@ -26,6 +26,8 @@
 #ifndef __TEXFONT_H__
 #define __TEXFONT_H__
 
+#include <vector>
+
 /* support ascii plus degree symbol for now pack font in a single texture 16x8 */
 #define DEGREE_GLYPH 127
 #define MIN_GLYPH 32
@@ -56,6 +58,14 @@ public:
     bool IsBuilt(){ return m_built; }
     void SetColor(wxColor &color){ m_color = color;}
 
+    /* queue the glyphs of a UTF-8 string at x, y, turned by angle radians,
+       to be drawn with the others in one call by FlushBatch.  The caller
+       sets blending and texturing up for the flush, as for RenderString.
+       Not on GLES2 */
+    void AddString( const char *string, float x, float y, float angle, const wxColour &color );
+    void FlushBatch();
+    bool HasBatch(){ return !m_batch_coords.empty(); }
+
 private:
     void GetTextExtent( const char *string, int *width, int *height);
     void RenderGlyph( int c );
@@ -74,6 +84,10 @@ private:
     float m_dx;
     float m_dy;
     wxColor m_color;
+
+    std::vector<float> m_batch_coords;
+    std::vector<float> m_batch_uv;
+    std::vector<unsigned char> m_batch_colors;
 };
 
 TexFont *GetTexFont(wxFont *key);
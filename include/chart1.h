@@ -578,6 +578,7 @@ class MyFrame: public wxFrame
 
     void ApplyGlobalColorSchemetoStatusBar(void);
     void PostProcessNMEA(bool pos_valid, bool cog_sog_valid, const wxString &sfixtime);
+    void PublishOwnShipState(void);
 
     bool ScrubGroupArray();
     wxString GetGroupName(int igroup);
@@ -177,6 +177,10 @@ public:
       virtual ChartDepthUnitType GetDepthUnitType(void) { return m_depth_unit_id;}
 
       virtual bool IsReadyToRender(){ return bReadyToRender;}
+
+      //    Heap bytes held for rendering, as charged by the chart cache; 0 if unknown
+      virtual size_t GetMemoryFootprint(){ return 0; }
+
       virtual bool RenderRegionViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint,
                                         const OCPNRegion &Region) = 0;
 
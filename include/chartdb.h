@@ -35,6 +35,7 @@
 
 #include "chartbase.h"
 #include "chartdbs.h"
+#include "ChartCache.h"
 
 #define     MAXSTACK          100
 
@@ -54,6 +55,7 @@ typedef struct  {
 //    Fwd Declarations
 // ----------------------------------------------------------------------------
 class ChartBase;
+class ChartOpenService;
 
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
@@ -79,19 +81,6 @@ private:
 
 };
 
-class CacheEntry
-{
-public:
-      wxString    FullPath;
-      void        *pChart;
-      int         RecentTime;
-      int         dbIndex;
-      bool        b_in_use;
-      int         n_lock;
-};
-
-
-
 // ----------------------------------------------------------------------------
 // Chart Database
 // ----------------------------------------------------------------------------
@@ -119,7 +108,10 @@ public:
       bool SearchForChartDir(const wxString &dir);
       ChartBase *OpenStackChartConditional(ChartStack *ps, int start_index, bool bLargest, ChartTypeEnum New_Type, ChartFamilyEnum New_Family_Fallback);
 
-      wxArrayPtrVoid *GetChartCache(void) { return pChartCache; }
+      void GetCacheChartsByAge(std::vector<ChartBase *> &charts);
+      void GetCacheCharts(std::vector<ChartBase *> &charts);
+      ChartCacheStats GetCacheStats();
+      void SetCacheBudget(size_t bytes, int max_charts);
       std::vector<int> GetCSArray(ChartStack *ps);
 
       int GetStackEntry(ChartStack *ps, wxString fp);
@@ -133,6 +125,11 @@ public:
       ChartBase *OpenChartFromDBAndLock(int index, ChartInitFlag init_flag , bool lock = true);
       ChartBase *OpenChartFromDBAndLock(wxString chart_path, ChartInitFlag init_flag);
       ChartBase *OpenChartFromDB(wxString chart_path, ChartInitFlag init_flag);
+
+      //    Open a chart in the background; false if it is in the cache already,
+      //    or can not be opened so (the caller may then open it synchronously)
+      bool RequestChart(int index, bool prefetch = false);
+      void ClearChartPrefetch();
       
       void ApplyColorSchemeToCachedCharts(ColorScheme cs);
       void PurgeCache();
@@ -159,6 +156,8 @@ protected:
       virtual ChartBase *GetChart(const wxChar *theFilePath, ChartClassDescriptor &chart_desc) const;
 
 private:
+      friend class ChartOpenService;
+
       InitReturn CreateChartTableEntry(wxString full_name, ChartTableEntry *pEntry);
 
       int SearchDirAndAddSENC(wxString& dir, bool bshow_prog, bool bupdate);
@@ -166,11 +165,17 @@ private:
       bool CheckPositionWithinChart(int index, float lat, float lon);
       ChartBase *OpenChartUsingCache(int dbindex, ChartInitFlag init_flag);
       CacheEntry *FindOldestDeleteCandidate( bool blog );
-      void DeleteCacheEntry(int i, bool bDelTexture = false, const wxString &msg = wxEmptyString);
       void DeleteCacheEntry(CacheEntry *pce, bool bDelTexture = false, const wxString &msg = wxEmptyString);
+      size_t GetChartFootprint(ChartBase *pch);
+      void AccountCache();
+      void EvictToBudget(double factor, bool bDelTexture, const wxString &msg);
+      bool AddCacheEntry(int dbindex, const wxString &full_path, ChartBase *pch, int n_lock);
+      bool IsEntryCurrent(int dbindex, const wxString &full_path);
+      bool AdoptChart(int dbindex, const wxString &full_path, ChartBase *pch, InitReturn ir);
       
       
-      wxArrayPtrVoid    *pChartCache;
+      ChartCache        m_cache;
+      ChartOpenService  *m_open_service;
       int              m_ticks;
 
       bool              m_b_locked;
@@ -33,6 +33,7 @@
 #include "ocpn_types.h"
 #include "bbox.h"
 #include "LLRegion.h"
+#include "ChartDBIndex.h"
 
 class wxGenericProgressDialog;
 class ChartBase;
@@ -49,11 +50,63 @@ WX_DECLARE_OBJARRAY(ChartDirInfo, ArrayOfCDI);
 
 ///////////////////////////////////////////////////////////////////////
 
-static const int DB_VERSION_PREVIOUS = 17;
-static const int DB_VERSION_CURRENT = 18;
+static const int DB_VERSION_OLDEST = 17;
+static const int DB_VERSION_PREVIOUS = 18;
+static const int DB_VERSION_CURRENT = 19;
 
 class ChartDatabase;
 class ChartGroupArray;
+class MappedFile;
+
+//  Version 19 is laid out to be memory mapped rather than streamed:
+//
+//      ChartTableHeader
+//      ChartTableLayout_19
+//      chart directories               int length, UTF-8 bytes, as in 18
+//      ChartTableEntry_onDisk_19[]     fixed size, entry i at entryOffset + i * entrySize
+//      chart paths                     nul terminated UTF-8
+//      coverage polygons               lat/lon float pairs
+//
+//  All offsets are from the start of the file and 4 byte aligned.  The
+//  polygons are only paged in when a chart's coverage is actually used.
+
+struct ChartTableLayout_19
+{
+    int             entrySize;
+    unsigned int    dirOffset;
+    unsigned int    entryOffset;
+    unsigned int    stringOffset;
+    unsigned int    polyOffset;
+    unsigned int    fileSize;
+};
+
+struct ChartTableEntry_onDisk_19
+{
+    int             EntryOffset;
+    int             ChartType;
+    int             ChartFamily;
+    float           LatMax;
+    float           LatMin;
+    float           LonMax;
+    float           LonMin;
+
+    int             Scale;
+    int             edition_date;
+    int             file_date;
+
+    int             nPlyEntries;
+    int             nAuxPlyEntries;
+    int             nNoCovrPlyEntries;
+
+    float           skew;
+    int             ProjectionType;
+    int             bValid;
+
+    unsigned int    pathOffset;
+    unsigned int    plyOffset;          // nPlyEntries points
+    unsigned int    auxOffset;          // nAuxPlyEntries counts, then the points of each
+    unsigned int    noCovrOffset;       // nNoCovrPlyEntries counts, then the points of each
+};
 
 struct ChartTableEntry_onDisk_18
 {
@@ -172,7 +225,7 @@ struct ChartTableHeader
                 nTableEntries(tableEntries), nDirEntries(dirEntries) {}
 
     void Read(wxInputStream &is);
-    void Write(wxOutputStream &os);
+    void Write(wxOutputStream &os, int version = DB_VERSION_CURRENT);
     bool CheckValid();
     int GetDirEntries() const { return nDirEntries; }
     int GetTableEntries() const { return nTableEntries; }
@@ -195,6 +248,9 @@ struct ChartTableEntry
     bool IsEarlierThan(const ChartTableEntry &cte) const;
     bool Read(const ChartDatabase *pDb, wxInputStream &is);
     bool Write(const ChartDatabase *pDb, wxOutputStream &os);
+    bool Read(const std::shared_ptr<MappedFile> &map, const ChartTableEntry_onDisk_19 &cte);
+    void Transcribe(ChartTableEntry_onDisk_19 &cte) const;
+    void DetachFromMap();
     void Clear();
     void Disable();
     void ReEnable();
@@ -248,6 +304,8 @@ struct ChartTableEntry
     bool        Scale_gt( int b ) const { return  Scale > b && !Scale_eq( b ); }
 
   private:
+    void ResolveMappedTables();
+
     int         EntryOffset;
     int         ChartType;
     int         ChartFamily;
@@ -271,6 +329,10 @@ struct ChartTableEntry
     int         nNoCovrPlyEntries;
     int         *pNoCovrCntTable;
     float       **pNoCovrPlyTable;
+
+    //  Set when the path and tables point into a mapped version 19 file,
+    //  only the pointer arrays of the aux and NoCovr tables are then owned
+    std::shared_ptr<MappedFile> m_map;
     
     std::vector<int> m_GroupArray;
     wxString    *m_pfilename;             // a helper member, not on disk
@@ -323,7 +385,7 @@ public:
     bool Update(ArrayOfCDI& dir_array, bool bForce, wxGenericProgressDialog *pprog);
 
     bool Read(const wxString &filePath);
-    bool Write(const wxString &filePath);
+    bool Write(const wxString &filePath, int version = DB_VERSION_CURRENT);
 
     bool AddSingleChart( wxString &fullpath, bool b_force_full_search = true );
     bool RemoveSingleChart( wxString &ChartFullPath );
@@ -371,6 +433,12 @@ public:
 
     bool IsBusy(){ return m_b_busy; }
 
+    //  Spatial index queries, see ChartDBIndex.  Results are ascending db indices,
+    //  a superset of the charts passing the exact position or bounding box tests.
+    void GetChartsAtPosition(float lat, float lon, int groupIndex, std::vector<int> &result);
+    void GetChartsInBox(const LLBBox &box, int groupIndex, std::vector<int> &result);
+    const std::vector<int> &GetPluginCharts();
+
 protected:
     virtual ChartBase *GetChart(const wxChar *theFilePath, ChartClassDescriptor &chart_desc) const;
     int AddChartDirectory(const wxString &theDir, bool bshow_prog);
@@ -382,8 +450,14 @@ protected:
     bool              m_b_busy;
 
 private:
+    friend class ChartIngest;           // parses chart headers on its worker threads
+
     bool IsChartDirUsed(const wxString &theDir);
 
+    bool ReadMapped(const wxString &filePath, const ChartTableHeader &cth);
+    bool WriteMapped(wxOutputStream &os);
+    bool WriteStream(wxOutputStream &os);
+
     int SearchDirAndAddCharts(wxString& dir_name_base, ChartClassDescriptor &chart_desc, wxGenericProgressDialog *pprog);
 
     int TraverseDirAndAddCharts(ChartDirInfo& dir_info, wxGenericProgressDialog *pprog, wxString& dir_magic, bool bForce);
@@ -407,6 +481,8 @@ private:
     int         m_nentries;
 
     LLBBox m_dummy_bbox;
+
+    ChartDBIndex  m_spatial_index;
 };
 
 
@@ -210,10 +210,18 @@ protected:
 
       virtual void InvalidateLineCache();
       virtual bool CreateLineIndex(void);
+      wxString LineIndexSidecarPath();
+      bool LoadLineIndexSidecar(wxULongLong file_size, time_t mtime);
+      void SaveLineIndexSidecar(wxULongLong file_size, time_t mtime);
+      virtual size_t GetMemoryFootprint();
+      size_t LineCacheRowBytes(int row);
 
 
       virtual wxBitmap *CreateThumbnail(int tnx, int tny, ColorScheme cs);
       virtual int BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int xl, int sub_samp);
+      bool BSBDecodeIndexRow( int y, unsigned char *pIndex );
+      unsigned char *GetBandRow( int y );
+      int GetChartRow( unsigned char *pLineBuf, int y, int xs, int xl, int sub_samp );
 
 
       bool GetViewUsingCache( wxRect& source, wxRect& dest, const OCPNRegion& Region, ScaleTypeEnum scale_type );
@@ -273,6 +281,11 @@ protected:
       int         *pline_table;           // pointer to Line offset table
 
       CachedLine  *pLineCache;
+      size_t      m_line_cache_bytes;     // held by the valid rows of pLineCache
+
+      int         m_band_chart_id;        // in g_RasterBandCache, 0 if not used
+      int         m_band_index;           // band decoded in m_band_buf, or -1
+      unsigned char *m_band_buf;          // RASTER_BAND_ROWS rows of palette indices
 
       wxInputStream    *ifs_hdr;
       wxInputStream    *ifss_bitmap;
@@ -28,6 +28,9 @@
 
 #include <wx/listctrl.h>			// Somehow missing from wx build
 
+#include    <memory>
+#include    <vector>
+
 #include    "s57chart.h"
 #include    "cutil.h"               // for types
 
@@ -37,9 +40,21 @@
 #define CM93_ZOOM_FACTOR_MAX_RANGE 5
 
 //    Static functions
+int Get_CM93_Scale(int scale_index);
+int Get_CM93_CellDval(int scale);
 int Get_CM93_CellIndex(double lat, double lon, int scale);
 void Get_CM93_Cell_Origin(int cellindex, int scale, double *lat, double *lon);
 
+//    A cm93 (sub)cell file, read whole and decoded
+class CM93CellImage
+{
+   public:
+      wxString                      file;       // as found; empty if there is no such file
+      std::vector<unsigned char>    data;
+};
+
+typedef std::shared_ptr<const CM93CellImage> CM93CellImagePtr;
+
 //    Fwd definitions
 class covr_set;
 class wxSpinCtrl;
@@ -340,6 +355,18 @@ class cm93chart : public s57chart
             const wxString & GetLastFileName(void) const { return m_LastFileName; }
 
             std::vector<int> GetVPCellArray(const ViewPort &vpt);
+            static std::vector<int> GetVPCellArray(const ViewPort &vpt, int native_scale, double dval);
+
+            //    Cell files, by cell index and subcell character; any thread
+            static wxString GetSubcellKey(const wxString &prefix, const wxString &scalechar, double dval,
+                                          int cellindex, wxChar sub_char);
+            static CM93CellImagePtr ReadSubcell(const wxString &prefix, const wxString &scalechar, double dval,
+                                                int cellindex, wxChar sub_char);
+
+            //    Read the cells missing from the viewport by the cell loader, not here
+            void SetAsyncLoad(bool bAsync){ m_bAsyncLoad = bAsync; }
+            bool HasPendingCells() const { return m_bCellsPending; }
+            bool HasLoadedCells() const { return !m_cells_loaded_array.empty(); }
 
             Array_Of_M_COVR_Desc_Ptr    m_pcovr_array_loaded;
 
@@ -372,6 +399,7 @@ class cm93chart : public s57chart
 
             int loadcell_in_sequence(int, char);
             int loadsubcell(int, wxChar);
+            void PrefetchCells(const std::vector<int> &vpcells);
             void ProcessVectorEdges(void);
 
             wxPoint2DDouble FindM_COVROffset(double lat, double lon);
@@ -405,7 +433,9 @@ class cm93chart : public s57chart
             wxString          m_LastFileName;
 
             LLRegion            m_region;
-            wxArrayString       m_noFindArray;
+
+            bool              m_bAsyncLoad;
+            bool              m_bCellsPending;      // some viewport cells are still being read
 };
 
 //----------------------------------------------------------------------------
@@ -430,6 +460,7 @@ class cm93compchart : public s57chart
             int GetNativeScale(void);
 
             wxString GetPubDate();
+            size_t GetMemoryFootprint();
 
             void SetVPParms(const ViewPort &vpt);
             void GetValidCanvasRegion(const ViewPort& VPoint, OCPNRegion *pValidRegion);
@@ -464,6 +495,7 @@ class cm93compchart : public s57chart
             void ForceEdgePriorityEvaluate(void);
             ListOfS57Obj *GetAssociatedObjects(S57Obj *obj);
             cm93chart *GetCurrentSingleScaleChart(){ return m_pcm93chart_current; }
+            cm93chart *GetScaleChart(int cmscale){ return m_pcm93chart_array[cmscale]; }
 
             void SetSpecialOutlineCellIndex(int cell_index, int object_id, int subcell)
                   { m_cell_index_special_outline = cell_index;
@@ -484,6 +516,8 @@ class cm93compchart : public s57chart
             cm93_dictionary *FindAndLoadDictFromDir(const wxString &dir);
             void FillScaleArray(double lat, double lon);
             int PrepareChartScale(const ViewPort &vpt, int cmscale, bool bOZ_protect = true);
+            void PrefetchScale(const ViewPort &vpt, int cmscale);
+            bool HasLoadedCells();
             int GetCMScaleFromVP(const ViewPort &vpt);
             bool DoRenderRegionViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint, const OCPNRegion &Region);
 
@@ -503,6 +537,7 @@ class cm93compchart : public s57chart
             bool              m_bScale_Array[8];
             cm93chart         *m_pcm93chart_current;
             int               m_cmscale;
+            int               m_cmscale_shown;              // as last set by SetVPParms()
 
             wxString          m_prefixComposite;
 
@@ -73,6 +73,7 @@
 #include <string>
 #include "ConnectionParams.h"
 #include "dsPortType.h"
+#include "OCP_DataStreamOutput_Thread.h"
 
 //----------------------------------------------------------------------------
 //   constants
@@ -105,6 +106,8 @@ enum {
 #define DS_SOCKET_ID             5001
 #define DS_SERVERSOCKET_ID       5002
 #define DS_ACTIVESERVERSOCKET_ID 5003
+#define DS_RXBATCH_ID            5004
+#define DS_TXERROR_ID            5005
 
 #define     MAX_RX_MESSSAGE_SIZE  4096
 #define     RX_BUFFER_SIZE        4096
@@ -166,6 +169,17 @@ public:
 
     virtual bool SendSentence( const wxString &sentence );
 
+    //  Output through a per-connection queue and writer thread, if started
+    bool QueueSentence( const wxString &sentence );
+    void StartOutputThread( size_t depth, OutputOverflowPolicy policy );
+    void StopOutputThread();
+    bool GetOutputStats( OutputQueueStats &stats );
+
+    //  True if WriteSentence() may be called from the writer thread
+    virtual bool SupportsOutputThread() const { return false; }
+    //  Called on the writer thread, blocking is allowed here
+    virtual bool WriteSentence( const std::string &payload );
+
     int GetLastError() const { return m_last_error; }
 
  //    Secondary thread life toggle
@@ -230,6 +244,8 @@ private:
 
     OCP_DataStreamInput_Thread *m_pSecondary_Thread;
     bool                m_bsec_thread_active;
+    OutputQueue         *m_out_queue;
+    OCP_DataStreamOutput_Thread *m_out_thread;
     int                 m_last_error;
 
     ConnectionType      m_connection_type;
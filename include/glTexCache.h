@@ -32,6 +32,12 @@
 
 #include "ocpn_types.h"
 #include "bbox.h"
+#include "MappedFile.h"
+
+//  Compressed texture uploads through a pixel unpack buffer
+#if !defined(__OCPN__ANDROID__) && !defined(ocpnUSE_GLES)
+#define ocpnUSE_PBO
+#endif
 
 class glTextureDescriptor;
 
@@ -145,6 +151,10 @@ private:
     bool UpdateCachePrecomp(unsigned char *data, int data_size, const wxRect &rect, int level,
                                           ColorScheme color_scheme, bool write_catalog = true);
     bool UpdateCacheLevel( const wxRect &rect, int level, ColorScheme color_scheme, unsigned char *data, int size);
+
+    const char *GetMappedCacheData( CatalogEntryValue *p );
+    bool UploadCompressedLevel( glTextureDescriptor *ptd, const wxRect &rect, int level,
+                                ColorScheme color_scheme, int texture_level );
     
     void DeleteSingleTexture( glTextureDescriptor *ptd );
 
@@ -171,6 +181,8 @@ private:
     bool	m_catalogCorrupted;
     
     wxFFile     *m_fs;
+    MappedFile  m_map;                  // the cache file, for reading texture data
+    int         m_map_limit;            // texture data below this offset is in m_map
     uint32_t    m_chart_date_binary;
     uint32_t    m_chartfile_date_binary;
     uint32_t    m_chartfile_size;
@@ -27,6 +27,21 @@
 #ifndef __GLTEXTUREMANAGER_H__
 #define __GLTEXTUREMANAGER_H__
 
+#include <wx/stopwatch.h>
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+//  Order in which queued compression jobs are started
+#define GL_JOB_PRIORITY_VISIBLE     0       // requested by the latest render
+#define GL_JOB_PRIORITY_OFFSCREEN   1       // requested by an earlier render
+#define GL_JOB_PRIORITY_BULK        2       // BuildCompressedCache()
+
+#define GL_JOB_STALE_FRAMES         50      // renders without a request before a queued job is dropped
+#define GL_JOB_STATS_TICKS          120     // timer ticks between throughput reports
+
 const wxEventType wxEVT_OCPN_COMPRESSIONTHREAD = wxNewEventType();
 
 class JobTicket;
@@ -49,14 +64,21 @@ public:
 
 
 
+class glTextureManager;
+
+//  One of a fixed set of workers, running the tickets handed over by glTextureManager
 class CompressionPoolThread : public wxThread
 {
 public:
-    CompressionPoolThread(JobTicket *ticket, wxEvtHandler *message_target);
+    CompressionPoolThread(glTextureManager *manager);
     void *Entry();
     
     wxEvtHandler        *m_pMessageTarget;
-    JobTicket           *m_ticket;
+
+private:
+    void RunJob(JobTicket *ticket);
+
+    glTextureManager    *m_manager;
 };
 
 
@@ -108,6 +130,10 @@ public:
     unsigned char *compcomp_bits_array[10];
     int         compcomp_size_array[10];
     bool        b_inCompressAll;
+
+    unsigned int m_frame;           // glTextureManager render count when last requested
+    int         n_tiles;            // compressed by the job
+    double      job_ms;
 };
 
 
@@ -133,9 +159,13 @@ public:
     void ClearJobList();
     void ClearAllRasterTextures(void);
     bool PurgeChartTextures(ChartBase *pc, bool b_purge_factory = false);
+    size_t GetChartTextureBytes(ChartBase *pc);
     bool TextureCrunch(double factor);
     bool FactoryCrunch(double factor);
     void BuildCompressedCache();
+
+    /// A render begins: queued jobs not requested again for a while are dropped.
+    void BeginFrame();
     
     //    This is a hash table
     //    key is Chart full path
@@ -143,13 +173,37 @@ public:
     ChartPathHashTexfactType   m_chart_texfactory_hash;
 
 private:    
+    friend class CompressionPoolThread;
+
     bool DoJob( JobTicket *pticket );
     bool DoThreadJob(JobTicket* pticket);
     bool StartTopJob();
+    int JobPriority( JobTicket *ticket );
+    void StartWorkers();
+    void StopWorkers();
+    JobTicket *TakeWork();
+    void ReportStats();
     
     JobList             running_list;
     JobList             todo_list;
     int                 m_max_jobs;
+    unsigned int        m_frame;
+
+    //  The worker pool, and the started tickets not yet taken by a worker
+    std::vector<CompressionPoolThread *> m_workers;
+    std::mutex          m_work_mutex;
+    std::condition_variable m_work_cond;
+    std::deque<JobTicket *> m_work;
+    bool                m_bstop_workers;
+
+    //  Throughput since the last report
+    unsigned long       m_stat_jobs;
+    unsigned long       m_stat_tiles;
+    double              m_stat_job_ms;
+    double              m_stat_job_ms_max;
+    size_t              m_stat_depth_max;
+    unsigned long       m_stat_dropped;
+    wxStopWatch         m_stat_watch;
 
     int		m_prevMemUsed;
 
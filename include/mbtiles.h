@@ -36,6 +36,8 @@
 #include "OCPNRegion.h"
 #include "viewport.h"
 
+#include <memory>
+
 
 enum class MBTilesType : std::int8_t {BASE, OVERLAY};
 enum class MBTilesScheme : std::int8_t {XYZ, TMS};
@@ -46,6 +48,8 @@ class WXDLLEXPORT ChartMbTiles;
 //    Constants, etc.
 //-----------------------------------------------------------------------------
 
+#define MBTILES_PREFETCH_MAX    64          // tiles queued ahead of the view
+
 
 
 //-----------------------------------------------------------------------------
@@ -57,11 +61,8 @@ class PixelCache;
 class ocpnBitmap;
 class mbTileZoomDescriptor;
 class mbTileDescriptor;
+class MBTilesSource;
 
- namespace SQLite {
-   class Database;
- }
- 
 //-----------------------------------------------------------------------------
 //    Helper classes
 //-----------------------------------------------------------------------------
@@ -119,6 +120,10 @@ protected:
       void PrepareTiles();
       void PrepareTilesForZoom(int zoomFactor, bool bset_geom);
       bool getTileTexture( mbTileDescriptor *tile);
+      mbTileDescriptor *FindTile( int zoomFactor, int tile_x, int tile_y );
+      mbTileDescriptor *GetTile( int zoomFactor, int tile_x, int tile_y );
+      void UploadReadyTiles( void );
+      void PrefetchTiles( const LLBBox &box, int viewZoom );
       void FlushTiles( void );
       void FlushTextures( void );
       bool RenderTile( mbTileDescriptor *tile, int zoomLevel, const ViewPort& VPoint);
@@ -144,8 +149,11 @@ protected:
       MBTilesType m_Type;
       MBTilesScheme m_Scheme;
       
-      SQLite::Database  *m_pDB;
+      std::shared_ptr<MBTilesSource> m_tileSource;      // database, and tiles decoded in the background
       int       m_nTiles;
+
+      LLBBox    m_prefetch_box;
+      int       m_prefetch_zoom;
       
 private:
       void InitFromTiles( const wxString& name );
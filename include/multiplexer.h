@@ -37,6 +37,7 @@
 
 class RoutePoint;
 class Route;
+class StreamCaptureWriter;
 
 WX_DEFINE_ARRAY(DataStream *, wxArrayOfDataStreams);
 
@@ -73,12 +74,19 @@ class Multiplexer : public wxEvtHandler
         void LogOutputMessageColor(const wxString &msg, const wxString & stream_name, const wxString & color);
         void LogInputMessage(const wxString &msg, const wxString & stream_name, bool b_filter, bool b_error = false);
 
+        //  Capture of all received data, for replay by ReplayDataStream
+        bool StartCapture(const wxString &path);
+        void StopCapture();
+        bool IsCapturing() const { return m_capture != NULL; }
+
     private:
         wxArrayOfDataStreams *m_pdatastreams;
 
         wxEvtHandler        *m_aisconsumer;
         wxEvtHandler        *m_gpsconsumer;
 
+        StreamCaptureWriter *m_capture;
+
         //      A set of temporarily saved parameters for a DataStream
         const ConnectionParams* params_save;
 
@@ -1389,4 +1389,34 @@ extern DECL_EXP int GetLatLonFormat(void);
 // API 1.17
 extern "C"  DECL_EXP void ZeroXTE();
 
+// API 1.17
+//  Consistent snapshot of the own-ship navigation data, callable from any
+//  thread. Returns true if the position is valid.
+extern DECL_EXP bool GetOwnShipFix_Plugin( PlugIn_Position_Fix_Ex *pfix );
+
+// API 1.17
+//  A depth hazard charted on the loaded vector charts, met by a track
+class PlugIn_DepthHazard
+{
+public:
+      wxString ObjectClass;       // DEPARE, DRGARE, DEPCNT, OBSTRN, WRECKS or UWTROC
+      double   Depth;             // least depth, meters; 0 if not charted
+      double   Lat;               // first contact with the track
+      double   Lon;
+      double   Distance;          // from the start of the track, NMi
+      double   Offset;            // off the track line, meters; 0 if crossed
+      int      ChartScale;
+};
+
+//  True if water shallower than depth meters, or a hazard charted shallower,
+//  lies within half_width meters of the track. Found hazards are returned in
+//  order along the track if hazards is not NULL. GUI thread only.
+extern DECL_EXP bool CheckSegmentHazards_Plugin( double lat0, double lon0, double lat1, double lon1,
+                                                 double depth, double half_width,
+                                                 std::vector<PlugIn_DepthHazard> *hazards );
+//  As above, for the track made good at cog, sog knots over the next minutes
+extern DECL_EXP bool CheckTrackHazards_Plugin( double lat, double lon, double cog, double sog, double minutes,
+                                               double depth, double half_width,
+                                               std::vector<PlugIn_DepthHazard> *hazards );
+
 #endif //_PLUGIN_H_
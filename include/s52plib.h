@@ -26,6 +26,8 @@
 #ifndef _S52PLIB_H_
 #define _S52PLIB_H_
 
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "s52s57.h"                 //types
@@ -35,6 +37,8 @@ class wxGLContext;
 #include "LLRegion.h"
 #include "ocpn_types.h"
 #include "DepthFont.h"
+#include "S52LabelGrid.h"
+#include "S52SpanRaster.h"
 
 #include <wx/dcgraph.h>         // supplemental, for Mac
 
@@ -47,8 +51,6 @@ WX_DECLARE_HASH_MAP( int, wxString, wxIntegerHash, wxIntegerEqual, MyNatsurHash
 
 WX_DEFINE_SORTED_ARRAY( LUPrec *, wxArrayOfLUPrec );
 
-WX_DECLARE_LIST( S52_TextC, TextObjList );
-
 struct CARC_Buffer {
     unsigned char color[3][4];
     float line_width[3];
@@ -145,6 +147,7 @@ public:
     bool ObjectRenderCheckCS( ObjRazRules *rzRules, ViewPort *vp );
 
     static void DestroyLUP( LUPrec *pLUP );
+    static void CompileLUPAttributes( LUPrec *pLUP );
     static void ClearRulesCache( Rule *pR );
     DisCat findLUPDisCat(const char *objectName, LUPname TNAM);
     
@@ -158,6 +161,9 @@ public:
     void PrepareForRender( void );
     void AdjustTextList( int dx, int dy, int screenw, int screenh );
     void ClearTextList( void );
+    //  Between these, GL texture font labels are queued, then drawn by font
+    void BeginTextBatch( void );
+    void EndTextBatch( void );
     int SetLineFeaturePriority( ObjRazRules *rzRules, int npriority );
     void FlushSymbolCaches();
 
@@ -217,6 +223,13 @@ public:
     void RenderPolytessGL( ObjRazRules *rzRules, ViewPort *vp,double z_clip_geom, wxPoint *ptp );
     
     bool EnableGLLS(bool benable);
+    bool CanRenderGLLS( ViewPort *vp );
+
+    //    For charts that draw their fills and simple lines in batches
+    Rules *GetGLBatchAreaRule( ObjRazRules *rzRules );
+    Rules *GetGLBatchLineRule( ObjRazRules *rzRules );
+    S52color *SetGLLineStyle( const char *str );
+    void ResetGLLineStyle();
 
     bool IsObjNoshow( const char *objcl);
     void AddObjNoshow( const char *objcl);
@@ -347,6 +360,7 @@ private:
         wxRect *pRectDrawn, S57Obj *pobj, bool bCheckOverlap, ViewPort *vp );
 
     bool CheckTextRectList( const wxRect &test_rect, S52_TextC *ptext );
+    void FlushTexFontBatch( TexFont *txf );
     int RenderT_All( ObjRazRules *rzRules, Rules *rules, ViewPort *vp,	bool bTX );
 
     int PrioritizeLineFeature( ObjRazRules *rzRules, int npriority );
@@ -369,6 +383,8 @@ private:
     
     Rules *StringToRules( const wxString& str_in );
     void GetAndAddCSRules( ObjRazRules *rzRules, Rules *rules );
+    bool GetCSMemoKey( ObjRazRules *rzRules, Rules *rules, std::string &key );
+    Rules *GetSoleRule( ObjRazRules *rzRules, int rule_type, bool b_area );
 
     void DestroyPattRules( RuleHash *rh );
     void DestroyRules( RuleHash *rh );
@@ -406,7 +422,12 @@ private:
     int m_colortable_index;
     int m_colortable_index_save;
 
-    TextObjList m_textObjList;
+    //  The labels drawn this frame, for declutter
+    S52LabelGrid m_textGrid;
+    bool m_bTextBatch;
+
+    //  Solid area fills on the DC render buffer
+    S52SpanRaster m_span_raster;
 
     wxString m_ColorScheme;
 
@@ -416,6 +437,16 @@ private:
 
     long m_state_hash;
 
+    //  Conditional symbology LUPs in condSymbolLUPArray, by class, category
+    //  and CS string; and by the inputs of the CS procedures that depend on
+    //  nothing but the object attributes and the mariner parameters, so that
+    //  those are run once for all alike objects, in all charts
+    std::unordered_map<std::string, LUPrec *> m_cs_lup_index;
+    std::unordered_map<std::string, LUPrec *> m_cs_memo;
+
+    //  The attribute acronyms of the object being looked up, by S57AttCode()
+    std::vector<uint64_t> m_att_codes;
+
     bool m_txf_ready;
     int m_txf_avg_char_width;
     int m_txf_avg_char_height;
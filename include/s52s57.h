@@ -32,9 +32,11 @@
 #include "bbox.h"
 #include "ocpn_types.h"
 
+#include <stdint.h>
+#include <string>
 #include <vector>
 
-#define CURRENT_SENC_FORMAT_VERSION  200
+#define CURRENT_SENC_FORMAT_VERSION  201
 
 #define OBJL_NAME_LEN  6
 
@@ -184,6 +186,25 @@ typedef struct _Rules{
 
 // LOOKUP MODULE CLASS
 
+//  A six character attribute acronym as one integer, for compares; as strncmp(),
+//  no character after a '\0' counts
+inline uint64_t S57AttCode( const char *acronym )
+{
+   uint64_t code = 0;
+   for( int i = 0; i < 6 && acronym[i]; i++ )
+      code |= (uint64_t)(unsigned char)acronym[i] << (8 * i);
+   return code;
+}
+
+//  A LUP attribute, parsed once for s52plib::FindBestLUP()
+typedef struct _S52AttMatch{
+   uint64_t       code;             // the acronym, by S57AttCode()
+   char           kind;             // ' ' any value, '?' value undefined, 'v' the value below, 0 unusable
+   int            ival;             // the value as an integer,
+   float          fval;             //  as a real,
+   const char     *sval;            //  as text, in ATTArray
+}S52AttMatch;
+
 class LUPrec{
 public:
    int            RCID;             // record identifier
@@ -193,6 +214,7 @@ public:
    RadPrio        RPRI;             // 'O' or 'S', Radar Priority
    LUPname        TNAM;             // FTYP:  areas, points, lines
    std::vector<char *> ATTArray;    // Array of LUP Attributes
+   std::vector<S52AttMatch> ATTMatch;  // the same, compiled
    wxString       *INST;            // Instruction Field (rules)
    DisCat         DISC;             // Display Categorie: D/S/O, DisplayBase, Standard, Other
    int            LUCM;             // Look-Up Comment (PLib3.x put 'groupes' here,
@@ -241,7 +263,14 @@ public:
     int         texobj;
     int         text_width;
     int         text_height;
-    
+
+    //  Extent of frmtd as last measured, kept while it is drawn in the same font
+    wxFont      *layout_font;
+    bool        layout_txf;             // measured in the GL texture font, not on a DC
+    int         layout_width;
+    int         layout_height;
+    int         layout_descent;         // on a DC only
+    std::string layout_utf8;            // frmtd, for the texture font
 };
 
 
@@ -289,6 +318,7 @@ typedef struct _pt{
 //      Fwd References
 class s57chart;
 class S57Obj;
+class S57AttrArena;
 class OGRFeature;
 class PolyTessGeo;
 class line_segment_element;
@@ -359,6 +389,7 @@ public:
       // Private Methods
 private:
       void Init();
+      void AddAttributeAcronym( const char *acronym );
     
 public:
       // Instance Data
@@ -368,6 +399,7 @@ public:
       char                    *att_array;
       wxArrayOfS57attVal      *attVal;
       int                     n_attr;
+      S57AttrArena            *m_attr_arena;          // of the chart, holding att_array and the values; else owned
 
       int                     iOBJL;
       int                     Index;
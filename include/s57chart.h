@@ -28,6 +28,7 @@
 
 #include <wx/wx.h>
 #include <wx/progdlg.h>
+#include <wx/stopwatch.h>
 #include "bbox.h"
 #include "chartbase.h"
 #include "wx/dir.h"
@@ -49,6 +50,10 @@
 #include "ocpndc.h"
 #include "viewport.h"
 #include "SencManager.h"
+#include "S57SpatialIndex.h"
+#include "S57AttrArena.h"
+#include "S57GLBatches.h"
+#include "DepthHazards.h"
 #include <memory>
 
 class ChartCanvas;
@@ -93,6 +98,7 @@ class S57Obj;
 class VE_Element;
 class VC_Element;
 class connector_segment;
+class Osenc;
 
 #include <wx/dynarray.h>
 
@@ -147,6 +153,7 @@ public:
 //      virtual bool IsRenderDelta(ViewPort &vp_last, ViewPort &vp_proposed);
 
       virtual double GetNearestPreferredScalePPM(double target_scale_ppm){ return target_scale_ppm; }
+      virtual size_t GetMemoryFootprint();
 
       void SetFullExtent(Extent& ext);
       bool GetChartExtent(Extent *pext);
@@ -186,6 +193,9 @@ public:
       
       double GetCalculatedSafetyContour(void){ return m_next_safe_cnt; }
 
+      //    Depth hazards, indexed on first use
+      const S57HazardIndex &GetHazardIndex();
+
       virtual bool RenderRegionViewOnGL(const wxGLContext &glc, const ViewPort& VPoint,
                                         const OCPNRegion &RectRegion, const LLRegion &Region);
       virtual bool RenderOverlayRegionViewOnGL(const wxGLContext &glc, const ViewPort& VPoint,
@@ -245,7 +255,14 @@ public:
 protected:
       void AssembleLineGeometry( void );
 
+      //  The objects of razRules[prio][type] that may show within {box}, in list order
+      void GetRulesInBox( int prio, int type, const LLBBox &box, std::vector<ObjRazRules *> &rules );
+
       ObjRazRules *razRules[PRIO_NUM][LUPNAME_NUM];
+      S57SpatialIndex m_spatial_index;
+      S57GLBatches m_gl_batches;
+      S57HazardIndex m_hazard_index;
+      S57AttrArena m_attr_arena;          // the attribute values of the SENC objects
     
 private:
       int GetLineFeaturePointArray(S57Obj *obj, void **ret_array);
@@ -271,6 +288,7 @@ private:
       bool GetBaseFileAttr( const wxString& file000 );
       
       void ResetPointBBoxes(const ViewPort &vp_last, const ViewPort &vp_this);
+      void LogFirstFrame(void);
 
            //    Access to raw ENC DataSet
       bool InitENCMinimal( const wxString& FullPath );
@@ -282,6 +300,8 @@ private:
       const char *getName(OGRFeature *feature);
 
       bool DoRenderOnGL(const wxGLContext &glc, const ViewPort& VPoint);
+      void RenderLinesOnGL(const wxGLContext &glc, int prio, int type, const LLBBox &box, ViewPort &tvp,
+                           bool b_batch, std::vector<ObjRazRules *> &rules, std::vector<ObjRazRules *> &singles);
       bool DoRenderOnGLText(const wxGLContext &glc, const ViewPort& VPoint);
       bool DoRenderRegionViewOnGL(const wxGLContext &glc, const ViewPort& VPoint,
                                   const OCPNRegion &RectRegion, const LLRegion &Region, bool b_overlay);
@@ -329,6 +349,7 @@ private:
       
       float      *m_line_vertex_buffer;
       size_t      m_vbo_byte_length;
+      size_t      m_object_bytes;         // S57Obj and rule records, as inserted
       
       bool        m_blastS57TextRender;
       wxString    m_lastColorScheme;
@@ -343,6 +364,9 @@ private:
       
       VE_Hash     m_ve_hash;
       VC_Hash     m_vc_hash;
+      Osenc       *m_ingest_senc;         // while loading, owns the points it has mapped
+      wxStopWatch m_sw_open;              // since Init(), for the time to the first frame
+      bool        m_blog_first_frame;
       std::vector<connector_segment *> m_pcs_vector;
       std::vector<VE_Element *> m_pve_vector;
       
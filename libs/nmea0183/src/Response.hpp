@@ -63,6 +63,14 @@ class RESPONSE
       wxString Mnemonic;
       wxString Talker;
 
+      /*
+      ** Fields to convert when parsing, NMEA0183_FIELD( n ) bits,
+      ** 0 (the default) for all. Members for skipped fields are left
+      ** NaN or Unknown.
+      */
+
+      unsigned long FieldMask;
+
       /*
       ** Methods
       */
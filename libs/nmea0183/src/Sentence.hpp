@@ -78,6 +78,23 @@ class SENTENCE
       virtual TRANSDUCER_TYPE TransducerType( int field_number ) const;
       virtual SENTENCE& Add ( double value, int precision); // Added to allow precision to be changed
 
+      /*
+      ** Field index, makes Field() a lookup instead of a scan from the
+      ** start of the sentence. Dropped when the sentence is assigned.
+      */
+
+      void IndexFields( void );
+      bool IsFieldIndexed( void ) const;
+
+      /*
+      ** Fields outside of the mask read as empty through the typed
+      ** accessors (Double(), Integer(), ...), see RESPONSE::FieldMask.
+      ** Field() itself is not masked, parsers use it for checksum and
+      ** structure checks. 0 means all fields.
+      */
+
+      void SetFieldMask( unsigned long mask ) { field_mask = mask; }
+
       /*
       ** Operators
       */
@@ -94,6 +111,14 @@ class SENTENCE
       virtual const SENTENCE& operator += ( TRANSDUCER_TYPE transducer );
       virtual const SENTENCE& operator += ( NMEA0183_BOOLEAN boolean );
       virtual const SENTENCE& operator += ( LATLONG& source );
+
+   private:
+
+      bool IsFieldRequested( int field_number ) const;
+
+      std::vector<int> field_separators;  // positions of ',' and '*'
+      size_t           indexed_length;    // 0 if not indexed
+      unsigned long    field_mask;
 };
  
 #endif // SENTENCE_CLASS_HEADER
@@ -32,6 +32,8 @@
 
 #include "nmea0183.h"
 
+#include <string.h>
+
 /*
 ** Author: Samuel R. Blackburn
 ** CI$: 76300,326
@@ -118,6 +120,7 @@ NMEA0183::NMEA0183()
 */
    sort_response_table();
    set_container_pointers();
+   build_dispatch_table();
 }
 
 NMEA0183::~NMEA0183()
@@ -191,6 +194,133 @@ void NMEA0183::sort_response_table( void )
 */
 }
 
+/*
+** Sentence dispatch
+**
+** The mnemonics are packed into a 24 bit key, one ASCII character per
+** byte, and hashed multiplicatively into the dispatch table. The
+** multiplier is chosen here so that no two of our mnemonics share a
+** slot, which makes lookup a single probe and one integer compare.
+*/
+
+wxUint32 NMEA0183::mnemonic_key( const wxString& mnemonic )
+{
+   if ( mnemonic.Len() == 0 || mnemonic.Len() > 3 )
+   {
+      return( 0 );
+   }
+
+   wxUint32 key = 0;
+
+   for( size_t index = 0; index < mnemonic.Len(); index++ )
+   {
+      wxUint32 c = (wxUint32) mnemonic[ index ];
+
+      if ( c == 0 || c > 127 )
+      {
+         return( 0 );
+      }
+
+      key = ( key << 8 ) | c;
+   }
+
+   return( key );
+}
+
+unsigned int NMEA0183::dispatch_slot( wxUint32 key ) const
+{
+   return( ( ( key * dispatch_multiplier ) >> ( 32 - NMEA0183_DISPATCH_BITS ) ) & ( NMEA0183_DISPATCH_SIZE - 1 ) );
+}
+
+void NMEA0183::build_dispatch_table( void )
+{
+   dispatch_hashed = FALSE;
+   last_sentence_key = 0;
+
+   /*
+   ** Walk odd multipliers from the golden ratio until one separates all keys.
+   ** For a couple of dozen mnemonics in 64 slots this takes a few tries.
+   */
+
+   dispatch_multiplier = 0x9E3779B1;
+
+   for( int attempt = 0; attempt < 10000 && !dispatch_hashed; attempt++, dispatch_multiplier += 2 )
+   {
+      memset( dispatch_table, 0, sizeof( dispatch_table ) );
+
+      bool collision = FALSE;
+
+      wxMRLNode *node = response_table.GetFirst();
+
+      while( node && !collision )
+      {
+         RESPONSE *resp = node->GetData();
+         wxUint32 key = mnemonic_key( resp->Mnemonic );
+
+         /*
+         ** Mnemonics that can not be received (e.g. "GPwpl") are left out,
+         ** of duplicates the first in the list wins, as with the list search
+         */
+
+         if ( key != 0 )
+         {
+            DISPATCH_ENTRY& entry = dispatch_table[ dispatch_slot( key ) ];
+
+            if ( entry.key == 0 )
+            {
+               entry.key        = key;
+               entry.response_p = resp;
+            }
+            else if ( entry.key != key )
+            {
+               collision = TRUE;
+            }
+         }
+
+         node = node->GetNext();
+      }
+
+      if ( !collision )
+      {
+         dispatch_hashed = TRUE;
+         break;
+      }
+   }
+}
+
+RESPONSE *NMEA0183::find_response( wxUint32 key, const wxString& mnemonic )
+{
+   if ( dispatch_hashed )
+   {
+      if ( key == 0 )
+      {
+         return( (RESPONSE *) NULL );
+      }
+
+      const DISPATCH_ENTRY& entry = dispatch_table[ dispatch_slot( key ) ];
+
+      return( entry.key == key ? entry.response_p : (RESPONSE *) NULL );
+   }
+
+//          Traverse the response list to find a mnemonic match
+
+   wxMRLNode *node = response_table.GetFirst();
+
+   while( node )
+   {
+      RESPONSE *resp = node->GetData();
+
+      if ( mnemonic.Cmp( resp->Mnemonic ) == 0 )
+      {
+         return( resp );
+      }
+
+      node = node->GetNext();
+   }
+
+   return( (RESPONSE *) NULL );
+}
+
 /*
 ** Public Interface
 */
@@ -242,6 +372,12 @@ bool NMEA0183::PreParse( void )
     
       if ( IsGood() )
       {
+            /*
+            ** Index the fields once, the RESPONSE parsers then look them up
+            */
+
+            sentence.IndexFields();
+
             wxString mnemonic = sentence.Field( 0 );
 
       /*
@@ -256,6 +392,7 @@ bool NMEA0183::PreParse( void )
 
 
             LastSentenceIDReceived = mnemonic;
+            last_sentence_key = mnemonic_key( mnemonic );
 
             return true;
       }
@@ -268,75 +405,41 @@ bool NMEA0183::Parse( void )
 {
    bool return_value = FALSE;
 
-   if(PreParse())
+   /*
+   ** The fields are indexed if PreParse() has already been run on this sentence
+   */
+
+   if( sentence.IsFieldIndexed() || PreParse() )
    {
+      RESPONSE *response_p = find_response( last_sentence_key, LastSentenceIDReceived );
 
-      wxString mnemonic = sentence.Field( 0 );
+      if ( response_p != NULL )
+      {
+         sentence.SetFieldMask( response_p->FieldMask );
+         return_value = response_p->Parse( sentence );
+         sentence.SetFieldMask( 0 );
 
-      /*
-      ** See if this is a proprietary field
-      */
+         /*
+         ** Set your ErrorMessage
+         */
 
-      if ( mnemonic.Left( 1 ) == 'P' )
-      {
-          mnemonic = _T("P");
+         if ( return_value == TRUE )
+         {
+            ErrorMessage = _T("No Error");
+            LastSentenceIDParsed = response_p->Mnemonic;
+            TalkerID = talker_id( sentence );
+            ExpandedTalkerID = expand_talker_id( TalkerID );
+         }
+         else
+         {
+            ErrorMessage = response_p->ErrorMessage;
+         }
       }
       else
       {
-         mnemonic = mnemonic.Right( 3 );
+         ErrorMessage = LastSentenceIDReceived;
+         ErrorMessage += _T(" is an unknown type of sentence");
       }
-
-      /*
-      ** Set up our default error message
-      */
-
-      ErrorMessage = mnemonic;
-      ErrorMessage += _T(" is an unknown type of sentence");
-
-      LastSentenceIDReceived = mnemonic;
-
-      RESPONSE *response_p = (RESPONSE *) NULL;
-
-
-//          Traverse the response list to find a mnemonic match
-
-       wxMRLNode *node = response_table.GetFirst();
-
-       int comparison  = 0;
-
-        while(node)
-        {
-           RESPONSE *resp = node->GetData();
-
-            comparison = mnemonic.Cmp( resp->Mnemonic );
-
-            if ( comparison == 0 )
-            {
-                        response_p = (RESPONSE *) resp;
-                        return_value = response_p->Parse( sentence );
-
-                        /*
-                        ** Set your ErrorMessage
-                        */
-
-                        if ( return_value == TRUE )
-                        {
-                           ErrorMessage = _T("No Error");
-                           LastSentenceIDParsed = response_p->Mnemonic;
-                           TalkerID = talker_id( sentence );
-                           ExpandedTalkerID = expand_talker_id( TalkerID );
-                        }
-                        else
-                        {
-                           ErrorMessage = response_p->ErrorMessage;
-                        }
-
-                        break;
-                   }
-
-              node = node->GetNext();
-        }
-
    }
    else
    {
@@ -51,6 +51,7 @@
 #include "wx/list.h"
 #include "wx/arrstr.h"
 #include <wx/math.h>
+#include <vector>
 
 /*
 ** Turn off the warning about precompiled headers, it is rather annoying
@@ -63,6 +64,12 @@
 #define CARRIAGE_RETURN 0x0D
 #define LINE_FEED       0x0A
 
+/*
+** Bit for field n in RESPONSE::FieldMask, fields 1..31
+*/
+
+#define NMEA0183_FIELD( n ) ( 1UL << ( n ) )
+
 
 typedef enum _NMEA0183_BOOLEAN
 {
@@ -131,6 +131,14 @@
 
 WX_DECLARE_LIST(RESPONSE, MRL);
 
+/*
+** Sentence dispatch, a perfect hash of the formatter mnemonics
+** into NMEA0183_DISPATCH_SIZE slots
+*/
+
+#define NMEA0183_DISPATCH_BITS  6
+#define NMEA0183_DISPATCH_SIZE  ( 1 << NMEA0183_DISPATCH_BITS )
+
 class NMEA0183
 {
 
@@ -140,12 +148,28 @@ class NMEA0183
 
       void initialize( void );
 
+      struct DISPATCH_ENTRY
+      {
+         wxUint32    key;
+         RESPONSE    *response_p;
+      };
+
+      DISPATCH_ENTRY dispatch_table[ NMEA0183_DISPATCH_SIZE ];
+      wxUint32       dispatch_multiplier;
+      bool           dispatch_hashed;     // FALSE if no perfect hash was found, use the list
+      wxUint32       last_sentence_key;
+
+      static wxUint32 mnemonic_key( const wxString& mnemonic );
+      unsigned int dispatch_slot( wxUint32 key ) const;
+      RESPONSE *find_response( wxUint32 key, const wxString& mnemonic );
+
    protected:
 
       MRL response_table;
 
       void set_container_pointers( void );
       void sort_response_table( void );
+      void build_dispatch_table( void );
 
    public:
 
@@ -46,6 +46,7 @@ RESPONSE::RESPONSE()
 {
    Talker.Empty();
    ErrorMessage.Empty();
+   FieldMask = 0;
 }
 
 RESPONSE::~RESPONSE()
@@ -58,6 +58,8 @@ static const long long lNaN = 0xfff8000000000000;
 SENTENCE::SENTENCE()
 {
    Sentence.Empty();
+   indexed_length = 0;
+   field_mask = 0;
 }
 
 SENTENCE::~SENTENCE()
@@ -67,6 +69,11 @@ SENTENCE::~SENTENCE()
 
 NMEA0183_BOOLEAN SENTENCE::Boolean( int field_number ) const
 {
+   if ( !IsFieldRequested( field_number ) )
+   {
+      return( Unknown0183 );
+   }
+
 //   ASSERT_VALID( this );
 
    wxString field_data;
@@ -89,6 +96,11 @@ NMEA0183_BOOLEAN SENTENCE::Boolean( int field_number ) const
 
 COMMUNICATIONS_MODE SENTENCE::CommunicationsMode( int field_number ) const
 {
+   if ( !IsFieldRequested( field_number ) )
+   {
+      return( CommunicationsModeUnknown );
+   }
+
 //   ASSERT_VALID( this );
 
    wxString field_data;
@@ -162,6 +174,11 @@ unsigned char SENTENCE::ComputeChecksum( void ) const
 
 double SENTENCE::Double( int field_number ) const
 {
+   if ( !IsFieldRequested( field_number ) )
+   {
+      return( NAN );
+   }
+
  //  ASSERT_VALID( this );
       if(Field( field_number ).Len() == 0)
             return (NAN);
@@ -177,6 +194,11 @@ double SENTENCE::Double( int field_number ) const
 
 EASTWEST SENTENCE::EastOrWest( int field_number ) const
 {
+   if ( !IsFieldRequested( field_number ) )
+   {
+      return( EW_Unknown );
+   }
+
 //   ASSERT_VALID( this );
 
    wxString field_data;
@@ -210,6 +232,38 @@ const wxString& SENTENCE::Field( int desired_field_number ) const
 
    string_length = Sentence.Len();
 
+   if ( IsFieldIndexed() )
+   {
+      /*
+      ** Same result as the scan below: one '*' for each asterisk passed
+      ** on the way to the field, then the field text
+      */
+
+      int number_of_separators = field_separators.size();
+      int passed = desired_field_number < number_of_separators ? desired_field_number : number_of_separators;
+
+      for( int i = 0; i < passed; i++ )
+      {
+         if ( Sentence[ field_separators[ i ] ] == '*' )
+            return_string += '*';
+      }
+
+      if ( desired_field_number >= 0 && desired_field_number <= number_of_separators )
+      {
+         int start = desired_field_number == 0 ? 1 : field_separators[ desired_field_number - 1 ] + 1;
+         int end   = desired_field_number < number_of_separators ? field_separators[ desired_field_number ] : string_length;
+
+         index = start;
+         while( index < end && Sentence[ index ] != 0x00 )
+            index++;
+
+         if ( index > start )
+            return_string.append( Sentence, start, index - start );
+      }
+
+      return( return_string );
+   }
+
    while( current_field_number < desired_field_number && index < string_length )
    {
       if ( Sentence[ index ] == ',' || Sentence[ index ] == '*' )
@@ -238,6 +292,38 @@ const wxString& SENTENCE::Field( int desired_field_number ) const
    return( return_string );
 }
 
+void SENTENCE::IndexFields( void )
+{
+   field_separators.clear();
+
+   int string_length = Sentence.Len();
+
+   for( int index = 1; index < string_length; index++ ) // Skip over the $
+   {
+      if ( Sentence[ index ] == ',' || Sentence[ index ] == '*' )
+         field_separators.push_back( index );
+   }
+
+   indexed_length = string_length;
+}
+
+bool SENTENCE::IsFieldIndexed( void ) const
+{
+   /*
+   ** Anything appended since, e.g. through Sentence.Append(), drops the index
+   */
+
+   return( indexed_length != 0 && indexed_length == Sentence.Len() );
+}
+
+bool SENTENCE::IsFieldRequested( int field_number ) const
+{
+   if ( field_mask == 0 || field_number <= 0 || field_number > 31 )
+      return( true );
+
+   return( ( field_mask & NMEA0183_FIELD( field_number ) ) != 0 );
+}
+
 int SENTENCE::GetNumberOfDataFields( void ) const
 {
 //   ASSERT_VALID( this );
@@ -280,6 +366,11 @@ void SENTENCE::Finish( void )
 
 int SENTENCE::Integer( int field_number ) const
 {
+   if ( !IsFieldRequested( field_number ) )
+   {
+      return( 0 );
+   }
+
 //   ASSERT_VALID( this );
     wxCharBuffer abuf = Field( field_number).ToUTF8();
     if( !abuf.data() )                            // badly formed sentence?
@@ -314,6 +405,11 @@ NMEA0183_BOOLEAN SENTENCE::IsChecksumBad( int checksum_field_number ) const
 
 LEFTRIGHT SENTENCE::LeftOrRight( int field_number ) const
 {
+   if ( !IsFieldRequested( field_number ) )
+   {
+      return( LR_Unknown );
+   }
+
 //   ASSERT_VALID( this );
 
    wxString field_data;
@@ -336,6 +432,11 @@ LEFTRIGHT SENTENCE::LeftOrRight( int field_number ) const
 
 NORTHSOUTH SENTENCE::NorthOrSouth( int field_number ) const
 {
+   if ( !IsFieldRequested( field_number ) )
+   {
+      return( NS_Unknown );
+   }
+
 //   ASSERT_VALID( this );
 
    wxString field_data;
@@ -358,6 +459,11 @@ NORTHSOUTH SENTENCE::NorthOrSouth( int field_number ) const
 
 REFERENCE SENTENCE::Reference( int field_number ) const
 {
+   if ( !IsFieldRequested( field_number ) )
+   {
+      return( ReferenceUnknown );
+   }
+
 //   ASSERT_VALID( this );
 
    wxString field_data;
@@ -392,6 +498,11 @@ REFERENCE SENTENCE::Reference( int field_number ) const
 
 TRANSDUCER_TYPE SENTENCE::TransducerType( int field_number ) const
 {
+   if ( !IsFieldRequested( field_number ) )
+   {
+      return( TransducerUnknown );
+   }
+
 //   ASSERT_VALID( this );
 
    wxString field_data;
@@ -460,6 +571,7 @@ const SENTENCE& SENTENCE::operator = ( const SENTENCE& source )
 //   ASSERT_VALID( this );
 
    Sentence = source.Sentence;
+   indexed_length = 0;
 
    return( *this );
 }
@@ -469,6 +581,7 @@ const SENTENCE& SENTENCE::operator = ( const wxString& source )
 //   ASSERT_VALID( this );
 
    Sentence = source;
+   indexed_length = 0;
 
    return( *this );
 }
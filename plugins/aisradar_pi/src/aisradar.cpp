@@ -58,8 +58,6 @@
 
 using namespace std;
 
-extern double           gLat, gLon;
-extern double           gCog, gSog;
 extern double g_n_ownship_length_meters;
 extern double g_n_ownship_beam_meters;
 
@@ -994,11 +992,15 @@ void RadarFrame::SendData2Client(wxSocketBase *sock)
     // sock->Read(buf.data(), len);
     wxLogMessage("Got the data, sending it back");
 
+    //  This runs from a socket callback, take a consistent own-ship snapshot
+    PlugIn_Position_Fix_Ex own;
+    GetOwnShipFix_Plugin( &own );
+
     wxString data;
-    data += wxString::Format(wxT("$!NDOS:OwnShip,%f,"), gLon)
-            +wxString::Format(wxT("%f,"),gLat)
-            +wxString::Format(wxT("%f,"),((gSog)*1852/3600))
-            +wxString::Format(wxT("%f,"), gCog)
+    data += wxString::Format(wxT("$!NDOS:OwnShip,%f,"), own.Lon)
+            +wxString::Format(wxT("%f,"),own.Lat)
+            +wxString::Format(wxT("%f,"),((own.Sog)*1852/3600))
+            +wxString::Format(wxT("%f,"), own.Cog)
             +wxString::Format(wxT("%f,"), g_n_ownship_length_meters)
             +wxString::Format(wxT("%f\r\n"), g_n_ownship_beam_meters);
     
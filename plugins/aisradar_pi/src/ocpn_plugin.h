@@ -976,5 +976,9 @@ extern DECL_EXP void PlugInNormalizeViewport ( PlugIn_ViewPort *vp );
 class wxPoint2DDouble;
 extern "C"  DECL_EXP void GetDoubleCanvasPixLL(PlugIn_ViewPort *vp, wxPoint2DDouble *pp, double lat, double lon);
 
+//  Consistent snapshot of the own-ship navigation data, callable from any
+//  thread. Returns true if the position is valid.
+extern DECL_EXP bool GetOwnShipFix_Plugin( PlugIn_Position_Fix_Ex *pfix );
+
 
 #endif //_PLUGIN_H_
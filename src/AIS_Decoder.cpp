@@ -42,6 +42,7 @@
 #include "OCPNPlatform.h"
 #include "pluginmanager.h"
 #include "Track.h"
+#include "OwnShipState.h"
 #include <multiplexer.h>
 #include "config.h"
 #include <cstdio>
@@ -88,6 +89,7 @@ extern double gLon;
 extern double gCog;
 extern double gSog;
 extern double gHdt;
+extern OwnShipState g_OwnShipState;
 extern bool g_bAIS_CPA_Alert;
 extern bool g_bAIS_CPA_Alert_Audio;
 extern ArrayOfMMSIProperties   g_MMSI_Props_Array;
@@ -2459,18 +2461,21 @@ void AIS_Decoder::UpdateOneCPA( AIS_Target_Data *ptarget )
     ptarget->Range_NM = -1.;            // Defaults
     ptarget->Brg = -1.;
 
+    //    One consistent own-ship snapshot for the whole calculation
+    const OwnShipFix own = g_OwnShipState.Get();
+
     //    Compute the current Range/Brg to the target
     //    This should always be possible even if GPS data is not valid
     //    because O must always have a position for own-ship. Plugins need
     //    AIS target range and bearing from own-ship position even if GPS is not valid.
     double brg, dist;
-    DistanceBearingMercator( ptarget->Lat, ptarget->Lon, gLat, gLon, &brg, &dist );
+    DistanceBearingMercator( ptarget->Lat, ptarget->Lon, own.lat, own.lon, &brg, &dist );
     ptarget->Range_NM = dist;
     ptarget->Brg = brg;
 
     if( dist <= 1e-5 ) ptarget->Brg = -1.0;             // Brg is undefined if Range == 0.
 
-    if( !ptarget->b_positionOnceValid || !bGPSValid ) {
+    if( !ptarget->b_positionOnceValid || !own.IsPosValid() ) {
         ptarget->bCPA_Valid = false;
         return;
     }
@@ -2485,18 +2490,18 @@ void AIS_Decoder::UpdateOneCPA( AIS_Target_Data *ptarget )
         return;
     }
 
-    double cpa_calc_ownship_cog = gCog;
+    double cpa_calc_ownship_cog = own.cog;
     double cpa_calc_target_cog = ptarget->COG;
 
 //    Ownship is not reporting valid SOG, so no way to calculate CPA
-    if( std::isnan(gSog) || ( gSog > 102.2 ) ) {
+    if( std::isnan(own.sog) || ( own.sog > 102.2 ) ) {
         ptarget->bCPA_Valid = false;
         return;
     }
 
 //    Ownship is maybe anchored and not reporting COG
-    if( std::isnan(gCog) || gCog == 360.0 ) {
-        if( gSog < .01 ) cpa_calc_ownship_cog = 0.;          // substitute value
+    if( std::isnan(own.cog) || own.cog == 360.0 ) {
+        if( own.sog < .01 ) cpa_calc_ownship_cog = 0.;          // substitute value
                                                              // for the case where SOG ~= 0, and COG is unknown.
         else {
             ptarget->bCPA_Valid = false;
@@ -2518,7 +2523,7 @@ void AIS_Decoder::UpdateOneCPA( AIS_Target_Data *ptarget )
     }
 
     //    Express the SOGs as meters per hour
-    double v0 = gSog * 1852.;
+    double v0 = own.sog * 1852.;
     double v1 = ptarget->SOG * 1852.;
 
     if( ( v0 < 1e-6 ) && ( v1 < 1e-6 ) ) {
@@ -2532,10 +2537,10 @@ void AIS_Decoder::UpdateOneCPA( AIS_Target_Data *ptarget )
         //    Working on a Reduced Lat/Lon orthogonal plotting sheet....
         //    Get easting/northing to target,  in meters
 
-        double east1 = ( ptarget->Lon - gLon ) * 60 * 1852;
-        double north1 = ( ptarget->Lat - gLat ) * 60 * 1852;
+        double east1 = ( ptarget->Lon - own.lon ) * 60 * 1852;
+        double north1 = ( ptarget->Lat - own.lat ) * 60 * 1852;
 
-        double east = east1 * ( cos( gLat * PI / 180. ) );
+        double east = east1 * ( cos( own.lat * PI / 180. ) );
         
         double north = north1;
 
@@ -2566,7 +2571,7 @@ void AIS_Decoder::UpdateOneCPA( AIS_Target_Data *ptarget )
 
         double OwnshipLatCPA, OwnshipLonCPA, TargetLatCPA, TargetLonCPA;
 
-        ll_gc_ll( gLat, gLon, cpa_calc_ownship_cog, gSog * tcpa, &OwnshipLatCPA, &OwnshipLonCPA );
+        ll_gc_ll( own.lat, own.lon, cpa_calc_ownship_cog, own.sog * tcpa, &OwnshipLatCPA, &OwnshipLonCPA );
         ll_gc_ll( ptarget->Lat, ptarget->Lon, cpa_calc_target_cog, ptarget->SOG * tcpa,
                 &TargetLatCPA, &TargetLonCPA );
 
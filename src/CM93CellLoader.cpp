@@ -0,0 +1,346 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Background reading and caching of cm93 cells
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include "CM93CellLoader.h"
+#include "chart1.h"
+
+extern MyFrame          *gFrame;
+extern int              g_nCPUCount;
+extern bool             g_bDebugCM93;
+
+const wxEventType wxEVT_OCPN_CM93CELL = wxNewEventType();
+
+//-------------------------------------------------------------------------------------------
+//      CM93CellThread
+//-------------------------------------------------------------------------------------------
+
+CM93CellThread::CM93CellThread(CM93CellLoader *loader)
+    : wxThread(wxTHREAD_JOINABLE),
+      m_loader(loader)
+{
+    Create();
+}
+
+void *CM93CellThread::Entry()
+{
+    m_loader->WorkerLoop();
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------------
+//      CM93CellLoader
+//-------------------------------------------------------------------------------------------
+
+CM93CellLoader *CM93CellLoader::s_loader = NULL;
+
+//  Created by the first cm93 chart to load a cell, GUI thread
+CM93CellLoader *CM93CellLoader::Get()
+{
+    if(!s_loader)
+        s_loader = new CM93CellLoader();
+    return s_loader;
+}
+
+void CM93CellLoader::Shutdown()
+{
+    if(s_loader)
+        s_loader->LogStats();
+
+    delete s_loader;
+    s_loader = NULL;
+}
+
+CM93CellLoader::CM93CellLoader()
+    : m_stop(false),
+      m_bytes(0),
+      m_hits(0),
+      m_misses(0),
+      m_brepaint(false)
+{
+    Connect( wxEVT_OCPN_CM93CELL, (wxObjectEventFunction) (wxEventFunction) &CM93CellLoader::OnEvtThread );
+
+    m_timer.SetOwner(this);
+    Connect( wxEVT_TIMER, wxTimerEventHandler( CM93CellLoader::OnTimer ), NULL, this );
+}
+
+CM93CellLoader::~CM93CellLoader()
+{
+    m_timer.Stop();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+
+    for(size_t i = 0; i < m_threads.size(); i++) {
+        m_threads[i]->Wait();
+        delete m_threads[i];
+    }
+}
+
+void CM93CellLoader::StartWorkers()
+{
+    if(m_threads.size())
+        return;
+
+    int nCPU = wxMax(1, wxThread::GetCPUCount());
+    if(g_nCPUCount > 0)
+        nCPU = g_nCPUCount;
+
+    //  Leave a core to the GUI thread, which builds the objects of the cells read
+    int nthreads = wxMin(wxMax(nCPU - 1, 1), CM93_CELL_MAX_THREADS);
+
+    for(int i = 0; i < nthreads; i++) {
+        CM93CellThread *thread = new CM93CellThread(this);
+        if(thread->Run() != wxTHREAD_NO_ERROR) {
+            delete thread;
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+}
+
+//  Any thread
+CM93CellImagePtr CM93CellLoader::Find(const wxString &key, bool b_count)
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+
+    std::map<wxString, Entry>::iterator it = m_cache.find(key);
+    if(it == m_cache.end()) {
+        if(b_count)
+            m_misses++;
+        return CM93CellImagePtr();
+    }
+
+    if(b_count)
+        m_hits++;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return it->second.image;
+}
+
+//  Any thread
+void CM93CellLoader::Insert(const wxString &key, CM93CellImagePtr image)
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+
+    std::map<wxString, Entry>::iterator it = m_cache.find(key);
+    if(it != m_cache.end()) {
+        m_bytes -= it->second.bytes;
+        m_lru.erase(it->second.lru);
+        m_cache.erase(it);
+    }
+
+    Entry entry;
+    entry.image = image;
+    entry.bytes = image->data.size() ? image->data.size() : CM93_CELL_ABSENT_BYTES;
+    m_lru.push_front(key);
+    entry.lru = m_lru.begin();
+    m_cache[key] = entry;
+    m_bytes += entry.bytes;
+
+    //  Images handed out stay alive with their holders
+    while(m_bytes > CM93_CELL_CACHE_BYTES && m_lru.size() > 1) {
+        std::map<wxString, Entry>::iterator iold = m_cache.find(m_lru.back());
+        m_bytes -= iold->second.bytes;
+        m_cache.erase(iold);
+        m_lru.pop_back();
+    }
+}
+
+CM93CellImagePtr CM93CellLoader::GetSubcell(const CM93CellRequest &cell, wxChar sub_char)
+{
+    wxString key = cm93chart::GetSubcellKey(cell.prefix, cell.scalechar, cell.dval, cell.cellindex, sub_char);
+
+    CM93CellImagePtr image = Find(key, true);
+    if(!image) {
+        image = cm93chart::ReadSubcell(cell.prefix, cell.scalechar, cell.dval, cell.cellindex, sub_char);
+        Insert(key, image);
+    }
+    return image;
+}
+
+bool CM93CellLoader::IsCellReady(const CM93CellRequest &cell)
+{
+    if(!Find(cm93chart::GetSubcellKey(cell.prefix, cell.scalechar, cell.dval, cell.cellindex, '0'), false))
+        return false;
+
+    //  Subcells are read in sequence, up to the first one missing
+    for(wxChar sub_char = 'A'; sub_char <= 'Z'; sub_char++) {
+        CM93CellImagePtr image = Find(cm93chart::GetSubcellKey(cell.prefix, cell.scalechar, cell.dval,
+                                                                cell.cellindex, sub_char), false);
+        if(!image)
+            return false;
+        if(image->file.IsEmpty())
+            break;
+    }
+
+    return true;
+}
+
+bool CM93CellLoader::Request(const CM93CellRequest &cell, bool prefetch)
+{
+    wxString key = cm93chart::GetSubcellKey(cell.prefix, cell.scalechar, cell.dval, cell.cellindex, '0');
+
+    std::map<wxString, bool>::iterator it = m_pending.find(key);
+    if(it != m_pending.end()) {
+        if(!prefetch && !it->second) {
+            //  Prefetched, and now on screen: move it up if still queued
+            it->second = true;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for(std::deque<Job>::iterator ij = m_prefetch.begin(); ij != m_prefetch.end(); ++ij) {
+                if(ij->key == key) {
+                    ij->prefetch = false;
+                    m_requested.push_back(*ij);
+                    m_prefetch.erase(ij);
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    StartWorkers();
+    if(m_threads.empty())
+        return false;
+
+    Job job;
+    job.cell = cell;
+    job.key = key;
+    job.prefetch = prefetch;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(prefetch)
+            m_prefetch.push_back(job);
+        else
+            m_requested.push_back(job);
+    }
+    m_cond.notify_one();
+
+    m_pending[key] = !prefetch;
+    return true;
+}
+
+void CM93CellLoader::ClearPrefetch()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(size_t i = 0; i < m_prefetch.size(); i++)
+        m_pending.erase(m_prefetch[i].key);
+    m_prefetch.clear();
+}
+
+void CM93CellLoader::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(!m_stop) {
+        if(m_requested.empty() && m_prefetch.empty()) {
+            m_cond.wait(lock);
+            continue;
+        }
+
+        std::deque<Job> &queue = m_requested.size() ? m_requested : m_prefetch;
+        Job job = queue.front();
+        queue.pop_front();
+
+        lock.unlock();
+        Read(job);
+        lock.lock();
+
+        m_done.push_back(job);
+        wxQueueEvent(this, new wxThreadEvent(wxEVT_OCPN_CM93CELL));
+    }
+}
+
+//  Worker thread: the base cell, then the subcells in sequence, as cm93chart loads them
+void CM93CellLoader::Read(const Job &job)
+{
+    const CM93CellRequest &cell = job.cell;
+
+    if(!Find(job.key, false))
+        Insert(job.key, cm93chart::ReadSubcell(cell.prefix, cell.scalechar, cell.dval, cell.cellindex, '0'));
+
+    for(wxChar sub_char = 'A'; sub_char <= 'Z'; sub_char++) {
+        wxString key = cm93chart::GetSubcellKey(cell.prefix, cell.scalechar, cell.dval, cell.cellindex, sub_char);
+
+        CM93CellImagePtr image = Find(key, false);
+        if(!image) {
+            image = cm93chart::ReadSubcell(cell.prefix, cell.scalechar, cell.dval, cell.cellindex, sub_char);
+            Insert(key, image);
+        }
+        if(image->file.IsEmpty())
+            break;
+    }
+}
+
+void CM93CellLoader::OnEvtThread(wxThreadEvent &event)
+{
+    std::vector<Job> done;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        done.swap(m_done);
+    }
+
+    for(size_t i = 0; i < done.size(); i++) {
+        std::map<wxString, bool>::iterator it = m_pending.find(done[i].key);
+        if(it != m_pending.end()) {
+            if(it->second)
+                m_brepaint = true;
+            m_pending.erase(it);
+        }
+    }
+
+    if(m_brepaint && !m_timer.IsRunning())
+        m_timer.Start(CM93_CELL_TICK_MS, wxTIMER_ONE_SHOT);
+}
+
+void CM93CellLoader::OnTimer(wxTimerEvent &event)
+{
+    if(m_brepaint) {
+        m_brepaint = false;
+        if(gFrame)
+            gFrame->ReloadAllVP();
+    }
+
+    if(g_bDebugCM93)
+        LogStats();
+}
+
+void CM93CellLoader::LogStats()
+{
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+
+    wxString msg;
+    msg.Printf(_T("CM93 cell cache: %lu files, %lu KB, %lu hits, %lu misses"),
+               (unsigned long)m_cache.size(), (unsigned long)(m_bytes / 1024), m_hits, m_misses);
+    wxLogMessage(msg);
+}
@@ -0,0 +1,184 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Open chart cache
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include "ChartCache.h"
+
+ChartCache::ChartCache()
+    : m_lru_newest(NULL),
+      m_lru_oldest(NULL),
+      m_bytes(0),
+      m_budget(0),
+      m_max_charts(0),
+      m_npinned(0),
+      m_hits(0),
+      m_misses(0),
+      m_evictions(0)
+{
+}
+
+void ChartCache::SetBudget(size_t bytes, int max_charts)
+{
+    m_budget = bytes;
+    m_max_charts = max_charts;
+}
+
+CacheEntry *ChartCache::Find(int dbIndex) const
+{
+    std::unordered_map<int, CacheEntry *>::const_iterator it = m_map.find(dbIndex);
+    if(it == m_map.end())
+        return NULL;
+    return it->second;
+}
+
+void ChartCache::LinkNewest(CacheEntry *pce)
+{
+    pce->lru_newer = NULL;
+    pce->lru_older = m_lru_newest;
+    if(m_lru_newest)
+        m_lru_newest->lru_newer = pce;
+    m_lru_newest = pce;
+    if(!m_lru_oldest)
+        m_lru_oldest = pce;
+}
+
+void ChartCache::Unlink(CacheEntry *pce)
+{
+    if(pce->lru_newer)
+        pce->lru_newer->lru_older = pce->lru_older;
+    else
+        m_lru_newest = pce->lru_older;
+
+    if(pce->lru_older)
+        pce->lru_older->lru_newer = pce->lru_newer;
+    else
+        m_lru_oldest = pce->lru_newer;
+
+    pce->lru_newer = NULL;
+    pce->lru_older = NULL;
+}
+
+void ChartCache::Insert(CacheEntry *pce)
+{
+    pce->lru_newer = NULL;
+    pce->lru_older = NULL;
+    m_map[pce->dbIndex] = pce;
+    m_bytes += pce->bytes;
+
+    if(pce->n_lock > 0)
+        m_npinned++;
+    else
+        LinkNewest(pce);
+}
+
+void ChartCache::Remove(CacheEntry *pce)
+{
+    std::unordered_map<int, CacheEntry *>::iterator it = m_map.find(pce->dbIndex);
+    if(it == m_map.end() || it->second != pce)
+        return;
+    m_map.erase(it);
+    m_bytes -= pce->bytes;
+
+    if(pce->n_lock > 0)
+        m_npinned--;
+    else
+        Unlink(pce);
+}
+
+void ChartCache::Touch(CacheEntry *pce)
+{
+    if(pce->n_lock > 0 || m_lru_newest == pce)
+        return;
+    Unlink(pce);
+    LinkNewest(pce);
+}
+
+void ChartCache::Pin(CacheEntry *pce)
+{
+    if(pce->n_lock++ == 0) {
+        Unlink(pce);
+        m_npinned++;
+    }
+}
+
+void ChartCache::Unpin(CacheEntry *pce)
+{
+    if(pce->n_lock <= 0)
+        return;
+    if(--pce->n_lock == 0) {
+        m_npinned--;
+        LinkNewest(pce);
+    }
+}
+
+void ChartCache::SetBytes(CacheEntry *pce, size_t bytes)
+{
+    bytes = wxMax(bytes, (size_t)CHART_CACHE_MIN_BYTES);
+    m_bytes -= pce->bytes;
+    pce->bytes = bytes;
+    m_bytes += bytes;
+}
+
+bool ChartCache::IsOverBudget(double factor) const
+{
+    if(m_budget)
+        return m_bytes > m_budget * factor;
+    if(m_max_charts)
+        return m_map.size() > (size_t)(m_max_charts * factor);
+    return false;
+}
+
+void ChartCache::GetEntries(std::vector<CacheEntry *> &entries) const
+{
+    entries.clear();
+    entries.reserve(m_map.size());
+    for(std::unordered_map<int, CacheEntry *>::const_iterator it = m_map.begin(); it != m_map.end(); ++it)
+        entries.push_back(it->second);
+}
+
+ChartCacheStats ChartCache::GetStats() const
+{
+    ChartCacheStats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.evictions = m_evictions;
+    stats.count = (int)m_map.size();
+    stats.pinned = m_npinned;
+    stats.bytes = m_bytes;
+    stats.budget = m_budget;
+    return stats;
+}
+
+void ChartCache::LogStats() const
+{
+    wxLogMessage(_T("ChartDB Cache: %d charts (%d pinned), %lu kBytes of %lu, %lu hits, %lu misses, %lu evictions"),
+                 (int)m_map.size(), m_npinned,
+                 (unsigned long)(m_bytes / 1024), (unsigned long)(m_budget / 1024),
+                 m_hits, m_misses, m_evictions);
+}
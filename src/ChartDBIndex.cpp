@@ -0,0 +1,455 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Spatial index over the chart database
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include <wx/wfstream.h>
+#include <wx/filename.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#include "ChartDBIndex.h"
+#include "chartdbs.h"
+#include "bbox.h"
+
+//  Bump when the layout of the index file changes
+#define CHART_INDEX_MAGIC       "OCPNRTRE"
+#define CHART_INDEX_VERSION     1
+
+//  Matches the slack of LLBBox::IntersectOut()
+#define CHART_INDEX_BOX_EPS     1e-6
+
+namespace {
+
+struct ChartIndexFileHeader
+{
+    char            magic[8];
+    int             version;
+    int             nentries;
+    unsigned int    fingerprint;
+    int             nposition;
+    int             nbox;
+};
+
+bool LessCenterLon(const ChartIndexRect &a, const ChartIndexRect &b)
+{
+    return a.minlon + a.maxlon < b.minlon + b.maxlon;
+}
+
+bool LessCenterLat(const ChartIndexRect &a, const ChartIndexRect &b)
+{
+    return a.minlat + a.maxlat < b.minlat + b.maxlat;
+}
+
+inline bool Overlaps(const ChartIndexRect &r, double minlat, double maxlat,
+                     double minlon, double maxlon)
+{
+    return r.minlat <= maxlat && r.maxlat >= minlat &&
+           r.minlon <= maxlon && r.maxlon >= minlon;
+}
+
+inline void FNV(unsigned int &hash, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for(size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619U;
+    }
+}
+
+void SortUnique(std::vector<int> &result)
+{
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+}   // namespace
+
+//------------------------------------------------------------------------------
+//    ChartRTree Implementation
+//------------------------------------------------------------------------------
+
+void ChartRTree::Clear()
+{
+    m_leaves.clear();
+    m_nodes.clear();
+}
+
+void ChartRTree::Build(std::vector<ChartIndexRect> &items)
+{
+    //  Sort-Tile-Recursive: cut into vertical slices by longitude,
+    //  then pack each slice by latitude.
+    size_t n = items.size();
+    size_t nleaves = (n + CHART_RTREE_FANOUT - 1) / CHART_RTREE_FANOUT;
+    size_t nslices = (size_t)ceil(sqrt((double)nleaves));
+    size_t slice_size = nslices * CHART_RTREE_FANOUT;
+
+    std::sort(items.begin(), items.end(), LessCenterLon);
+    for(size_t first = 0; first < n; first += slice_size) {
+        size_t last = std::min(first + slice_size, n);
+        std::sort(items.begin() + first, items.begin() + last, LessCenterLat);
+    }
+
+    Load(items);
+}
+
+void ChartRTree::Load(std::vector<ChartIndexRect> &items)
+{
+    m_leaves.swap(items);
+    items.clear();
+    BuildNodes();
+}
+
+void ChartRTree::BuildNodes()
+{
+    m_nodes.clear();
+
+    const std::vector<ChartIndexRect> *below = &m_leaves;
+    while(below->size() > 1 || m_nodes.empty()) {
+        std::vector<ChartIndexRect> level;
+        level.reserve((below->size() + CHART_RTREE_FANOUT - 1) / CHART_RTREE_FANOUT);
+
+        for(size_t first = 0; first < below->size(); first += CHART_RTREE_FANOUT) {
+            size_t last = std::min(first + CHART_RTREE_FANOUT, below->size());
+            ChartIndexRect node = (*below)[first];
+            for(size_t i = first + 1; i < last; i++) {
+                const ChartIndexRect &r = (*below)[i];
+                node.minlat = std::min(node.minlat, r.minlat);
+                node.maxlat = std::max(node.maxlat, r.maxlat);
+                node.minlon = std::min(node.minlon, r.minlon);
+                node.maxlon = std::max(node.maxlon, r.maxlon);
+            }
+            node.id = -1;
+            level.push_back(node);
+        }
+
+        m_nodes.push_back(level);
+        below = &m_nodes.back();
+        if(below->empty())
+            break;
+    }
+}
+
+void ChartRTree::Query(double minlat, double maxlat, double minlon, double maxlon,
+                       std::vector<int> &result) const
+{
+    if(m_nodes.empty() || m_nodes.back().empty())
+        return;
+
+    //  (level, node) pairs still to visit, level 0 nodes cover the leaves
+    std::vector<std::pair<int, size_t> > stack;
+    stack.push_back(std::make_pair((int)m_nodes.size() - 1, (size_t)0));
+
+    while(!stack.empty()) {
+        int level = stack.back().first;
+        size_t k = stack.back().second;
+        stack.pop_back();
+
+        const ChartIndexRect &node = m_nodes[level][k];
+        if(!Overlaps(node, minlat, maxlat, minlon, maxlon))
+            continue;
+
+        size_t first = k * CHART_RTREE_FANOUT;
+        if(level == 0) {
+            size_t last = std::min(first + CHART_RTREE_FANOUT, m_leaves.size());
+            for(size_t i = first; i < last; i++) {
+                if(Overlaps(m_leaves[i], minlat, maxlat, minlon, maxlon))
+                    result.push_back(m_leaves[i].id);
+            }
+        }
+        else {
+            size_t last = std::min(first + CHART_RTREE_FANOUT, m_nodes[level - 1].size());
+            for(size_t i = first; i < last; i++)
+                stack.push_back(std::make_pair(level - 1, i));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//    ChartDBIndex Implementation
+//------------------------------------------------------------------------------
+
+ChartDBIndex::ChartDBIndex()
+    : m_bvalid(false),
+      m_bgroups_valid(false),
+      m_nentries(0),
+      m_fingerprint(0)
+{
+}
+
+wxString ChartDBIndex::GetIndexFileName(const wxString &db_path)
+{
+    return db_path + _T(".idx");
+}
+
+//  The rough float extent, as it was before any ChartTableEntry::Disable(),
+//  so that disabling and re-enabling a chart does not stale the index.
+void ChartDBIndex::GetPositionRect(const ChartDatabase &db, int index, ChartIndexRect &rect)
+{
+    const ChartTableEntry &cte = db.GetChartTableEntry(index);
+    float latmax = cte.GetLatMax();
+    float latmin = cte.GetLatMin();
+    if(latmax > 90.) {
+        latmax -= (float) 1000.;
+        latmin -= (float) 1000.;
+    }
+
+    rect.minlat = latmin;
+    rect.maxlat = latmax;
+    rect.minlon = cte.GetLonMin();
+    rect.maxlon = cte.GetLonMax();
+    rect.id = index;
+}
+
+unsigned int ChartDBIndex::Fingerprint(const ChartDatabase &db)
+{
+    unsigned int hash = 2166136261U;
+    int n = db.GetChartTableEntries();
+    FNV(hash, &n, sizeof(n));
+
+    for(int i = 0; i < n; i++) {
+        ChartIndexRect r;
+        GetPositionRect(db, i, r);
+        FNV(hash, &r.minlat, 4 * sizeof(double));
+
+        const ChartTableEntry &cte = db.GetChartTableEntry(i);
+        const LLBBox &box = cte.GetBBox();
+        double b[4] = { box.GetMinLat(), box.GetMaxLat(), box.GetMinLon(), box.GetMaxLon() };
+        FNV(hash, b, sizeof(b));
+
+        int type = box.GetValid() ? cte.GetChartType() : -1 - cte.GetChartType();
+        FNV(hash, &type, sizeof(type));
+    }
+    return hash;
+}
+
+void ChartDBIndex::Build(const ChartDatabase &db)
+{
+    wxStopWatch sw;
+
+    int n = db.GetChartTableEntries();
+    std::vector<ChartIndexRect> position;
+    std::vector<ChartIndexRect> boxes;
+    position.reserve(n);
+    boxes.reserve(n);
+    m_plugin_charts.clear();
+
+    for(int i = 0; i < n; i++) {
+        ChartIndexRect r;
+        GetPositionRect(db, i, r);
+        position.push_back(r);
+
+        const ChartTableEntry &cte = db.GetChartTableEntry(i);
+        const LLBBox &box = cte.GetBBox();
+        if(box.GetValid()) {                    // IntersectOut() rejects invalid boxes
+            r.minlat = box.GetMinLat();
+            r.maxlat = box.GetMaxLat();
+            r.minlon = box.GetMinLon();
+            r.maxlon = box.GetMaxLon();
+            boxes.push_back(r);
+        }
+
+        if(cte.GetChartType() == CHART_TYPE_PLUGIN)
+            m_plugin_charts.push_back(i);
+    }
+
+    m_position_tree.Build(position);
+    m_box_tree.Build(boxes);
+
+    m_nentries = n;
+    m_fingerprint = Fingerprint(db);
+    m_bvalid = true;
+    m_bgroups_valid = false;
+
+    wxLogMessage(wxString::Format(_T("Chartdb: spatial index of %d charts built in %ld ms"),
+                                  n, sw.Time()));
+}
+
+bool ChartDBIndex::Load(const wxString &path, const ChartDatabase &db)
+{
+    if(!wxFileName::FileExists(path))
+        return false;
+
+    wxFFileInputStream ifs(path);
+    if(!ifs.IsOk())
+        return false;
+
+    ChartIndexFileHeader hdr;
+    if(ifs.Read(&hdr, sizeof(hdr)).LastRead() != sizeof(hdr))
+        return false;
+
+    if(memcmp(hdr.magic, CHART_INDEX_MAGIC, sizeof(hdr.magic)) ||
+       hdr.version != CHART_INDEX_VERSION ||
+       hdr.nentries != db.GetChartTableEntries() ||
+       hdr.nposition != hdr.nentries ||
+       hdr.nbox < 0 || hdr.nbox > hdr.nentries)
+        return false;
+
+    unsigned int fingerprint = Fingerprint(db);
+    if(hdr.fingerprint != fingerprint)
+        return false;
+
+    std::vector<ChartIndexRect> position(hdr.nposition);
+    std::vector<ChartIndexRect> boxes(hdr.nbox);
+    size_t len = position.size() * sizeof(ChartIndexRect);
+    if(len && ifs.Read(&position[0], len).LastRead() != len)
+        return false;
+    len = boxes.size() * sizeof(ChartIndexRect);
+    if(len && ifs.Read(&boxes[0], len).LastRead() != len)
+        return false;
+
+    m_plugin_charts.clear();
+    for(int i = 0; i < hdr.nentries; i++) {
+        if(db.GetChartTableEntry(i).GetChartType() == CHART_TYPE_PLUGIN)
+            m_plugin_charts.push_back(i);
+    }
+
+    m_position_tree.Load(position);
+    m_box_tree.Load(boxes);
+
+    m_nentries = hdr.nentries;
+    m_fingerprint = fingerprint;
+    m_bvalid = true;
+    m_bgroups_valid = false;
+
+    return true;
+}
+
+bool ChartDBIndex::Save(const wxString &path) const
+{
+    if(!m_bvalid)
+        return false;
+
+    wxFFileOutputStream ofs(path);
+    if(!ofs.IsOk())
+        return false;
+
+    const std::vector<ChartIndexRect> &position = m_position_tree.GetItems();
+    const std::vector<ChartIndexRect> &boxes = m_box_tree.GetItems();
+
+    ChartIndexFileHeader hdr;
+    memcpy(hdr.magic, CHART_INDEX_MAGIC, sizeof(hdr.magic));
+    hdr.version = CHART_INDEX_VERSION;
+    hdr.nentries = m_nentries;
+    hdr.fingerprint = m_fingerprint;
+    hdr.nposition = position.size();
+    hdr.nbox = boxes.size();
+
+    ofs.Write(&hdr, sizeof(hdr));
+    if(position.size())
+        ofs.Write(&position[0], position.size() * sizeof(ChartIndexRect));
+    if(boxes.size())
+        ofs.Write(&boxes[0], boxes.size() * sizeof(ChartIndexRect));
+
+    return ofs.IsOk();
+}
+
+void ChartDBIndex::BuildGroups(const ChartDatabase &db)
+{
+    m_group_bits.clear();
+
+    int n = db.GetChartTableEntries();
+    for(int i = 0; i < n; i++) {
+        const std::vector<int> &groups = db.GetChartTableEntry(i).GetGroupArray();
+        for(size_t ig = 0; ig < groups.size(); ig++) {
+            int g = groups[ig];
+            if(g <= 0)
+                continue;
+            if(g >= (int)m_group_bits.size())
+                m_group_bits.resize(g + 1);
+            if(m_group_bits[g].empty())
+                m_group_bits[g].resize(n, false);
+            m_group_bits[g][i] = true;
+        }
+    }
+
+    m_bgroups_valid = true;
+}
+
+void ChartDBIndex::Validate(const ChartDatabase &db)
+{
+    //  Entry count is a cheap guard against a missed Invalidate()
+    if(!m_bvalid || m_nentries != db.GetChartTableEntries())
+        Build(db);
+    if(!m_bgroups_valid)
+        BuildGroups(db);
+}
+
+void ChartDBIndex::FilterGroup(int group, std::vector<int> &result) const
+{
+    if(group <= 0)
+        return;
+
+    if(group >= (int)m_group_bits.size() || m_group_bits[group].empty()) {
+        result.clear();
+        return;
+    }
+
+    const std::vector<bool> &bits = m_group_bits[group];
+    size_t keep = 0;
+    for(size_t i = 0; i < result.size(); i++) {
+        if(bits[result[i]])
+            result[keep++] = result[i];
+    }
+    result.resize(keep);
+}
+
+void ChartDBIndex::QueryPosition(float lat, float lon, int group, std::vector<int> &result) const
+{
+    result.clear();
+
+    //  Charts spanning the dateline are tested at lon + 360 as well
+    m_position_tree.Query(lat, lat, lon, lon, result);
+    float lon360 = lon + 360.;
+    m_position_tree.Query(lat, lat, lon360, lon360, result);
+
+    SortUnique(result);
+    FilterGroup(group, result);
+}
+
+void ChartDBIndex::QueryBox(const LLBBox &box, int group, std::vector<int> &result) const
+{
+    result.clear();
+    if(!box.GetValid())
+        return;
+
+    //  LLBBox::IntersectOut() allows either -180..180 or 0..360 longitudes
+    //  by shifting the box a full turn, so look there too.
+    double minlat = box.GetMinLat() - CHART_INDEX_BOX_EPS;
+    double maxlat = box.GetMaxLat() + CHART_INDEX_BOX_EPS;
+    for(int shift = -360; shift <= 360; shift += 360) {
+        m_box_tree.Query(minlat, maxlat,
+                         box.GetMinLon() + shift - CHART_INDEX_BOX_EPS,
+                         box.GetMaxLon() + shift + CHART_INDEX_BOX_EPS, result);
+    }
+
+    SortUnique(result);
+    FilterGroup(group, result);
+}
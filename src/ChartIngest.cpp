@@ -0,0 +1,236 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Parallel chart header parsing for the chart database scan
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include "ChartIngest.h"
+#include "chartdbs.h"
+
+//-------------------------------------------------------------------------------------------
+//      ChartIngestThread
+//-------------------------------------------------------------------------------------------
+
+ChartIngestThread::ChartIngestThread(ChartIngest *ingest)
+    : wxThread(wxTHREAD_JOINABLE),
+      m_ingest(ingest)
+{
+    Create();
+}
+
+void *ChartIngestThread::Entry()
+{
+    m_ingest->WorkerLoop();
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------------
+//      ChartIngest
+//-------------------------------------------------------------------------------------------
+
+ChartIngest::ChartIngest(ChartDatabase *db, ChartClassDescriptor &chart_desc)
+    : m_db(db),
+      m_chart_desc(chart_desc),
+      m_next(0),
+      m_consumed(0),
+      m_stop(false),
+      m_nparsed(0)
+{
+}
+
+ChartIngest::~ChartIngest()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+
+    for(size_t i = 0; i < m_threads.size(); i++) {
+        m_threads[i]->Wait();
+        delete m_threads[i];
+    }
+
+    //  Entries parsed ahead but never taken by the merger
+    for(size_t i = 0; i < m_jobs.size(); i++)
+        delete m_jobs[i].entry;
+}
+
+//  Raster headers are read with no state shared between chart objects: the
+//  constructors take their debug flags from globals read with the config,
+//  not from pConfig, which is not thread safe.  s57chart::Init() guards
+//  against reentry with a static and uses the process wide OGR registrar,
+//  cm93 shares its cell manager, and plugin charts may expect their host
+//  thread, so those are parsed by the merger.
+bool ChartIngest::IsParallelSafe(const ChartClassDescriptor &chart_desc)
+{
+    if(chart_desc.m_descriptor_type != BUILTIN_DESCRIPTOR)
+        return false;
+
+    wxString mask = chart_desc.m_search_mask.Upper();
+    return mask == _T("*.KAP") || mask == _T("*.GEO") || mask == _T("*.MBTILES");
+}
+
+void ChartIngest::AddJob(const wxString &full_name, const wxString &utf8_path, bool speculative)
+{
+    Job job;
+    job.full_name = full_name;
+    job.utf8_path = utf8_path;
+    job.speculative = speculative && IsParallelSafe(m_chart_desc);
+    job.state = JOB_PENDING;
+    job.entry = NULL;
+    m_jobs.push_back(job);
+}
+
+void ChartIngest::Start()
+{
+    m_sw.Start();
+
+    size_t nspeculative = 0;
+    for(size_t i = 0; i < m_jobs.size(); i++)
+        if(m_jobs[i].speculative)
+            nspeculative++;
+
+    //  A single job gains nothing from a worker
+    if(nspeculative < 2)
+        return;
+
+    int ncpu = wxThread::GetCPUCount();
+    size_t nthreads = wxMin(wxMax(ncpu, 1), CHART_INGEST_MAX_THREADS);
+    nthreads = wxMin(nthreads, nspeculative);
+
+    for(size_t i = 0; i < nthreads; i++) {
+        ChartIngestThread *thread = new ChartIngestThread(this);
+        if(thread->Run() != wxTHREAD_NO_ERROR) {
+            delete thread;
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+}
+
+ChartTableEntry *ChartIngest::Parse(Job &job)
+{
+    wxString full_name = job.full_name;
+    wxString utf8_path = job.utf8_path;
+    return m_db->CreateChartTableEntry(full_name, utf8_path, m_chart_desc);
+}
+
+void ChartIngest::Consumed(size_t job)
+{
+    m_jobs[job].state = JOB_CONSUMED;
+    m_consumed = job + 1;
+    m_cond.notify_all();                // the window has moved
+}
+
+void ChartIngest::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(!m_stop) {
+        while(m_next < m_jobs.size() &&
+              (!m_jobs[m_next].speculative || m_jobs[m_next].state != JOB_PENDING))
+            m_next++;
+
+        if(m_next >= m_jobs.size())
+            break;
+
+        if(m_next >= m_consumed + CHART_INGEST_WINDOW) {
+            m_cond.wait(lock);
+            continue;
+        }
+
+        Job &job = m_jobs[m_next++];
+        job.state = JOB_CLAIMED;
+
+        lock.unlock();
+        ChartTableEntry *entry = Parse(job);
+        lock.lock();
+
+        job.entry = entry;
+        job.state = JOB_DONE;
+        m_nparsed++;
+        m_cond.notify_all();
+    }
+}
+
+ChartTableEntry *ChartIngest::Take(size_t job)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Job &j = m_jobs[job];
+
+    if(j.state == JOB_PENDING) {
+        //  Not reached by the workers, or not theirs to parse
+        Consumed(job);
+        lock.unlock();
+
+        ChartTableEntry *entry = Parse(j);
+
+        lock.lock();
+        m_nparsed++;
+        return entry;
+    }
+
+    while(j.state == JOB_CLAIMED)
+        m_cond.wait(lock);
+
+    ChartTableEntry *entry = j.entry;
+    j.entry = NULL;
+    Consumed(job);
+    return entry;
+}
+
+void ChartIngest::Skip(size_t job)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Job &j = m_jobs[job];
+
+    if(j.state == JOB_CLAIMED) {
+        //  Still being parsed, the result is dropped by the destructor
+        m_consumed = job + 1;
+        m_cond.notify_all();
+        return;
+    }
+
+    delete j.entry;
+    j.entry = NULL;
+    Consumed(job);
+}
+
+void ChartIngest::LogThroughput()
+{
+    int nparsed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        nparsed = m_nparsed;
+    }
+
+    long ms = m_sw.Time();
+    double rate = nparsed * 1000.0 / wxMax(ms, 1L);
+    wxLogMessage(wxString::Format(_T("   %d chart headers parsed in %ld ms, %.1f charts/sec, %d worker threads"),
+                                  nparsed, ms, rate, (int)m_threads.size()));
+}
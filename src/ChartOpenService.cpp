@@ -0,0 +1,297 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Background chart opening
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include "ChartOpenService.h"
+#include "chartdb.h"
+#include "chartimg.h"
+#include "mbtiles.h"
+#include "chart1.h"
+
+extern MyFrame          *gFrame;
+extern int              g_nCPUCount;
+
+const wxEventType wxEVT_OCPN_CHARTOPEN = wxNewEventType();
+
+//-------------------------------------------------------------------------------------------
+//      ChartOpenThread
+//-------------------------------------------------------------------------------------------
+
+ChartOpenThread::ChartOpenThread(ChartOpenService *service)
+    : wxThread(wxTHREAD_JOINABLE),
+      m_service(service)
+{
+    Create();
+}
+
+void *ChartOpenThread::Entry()
+{
+    m_service->WorkerLoop();
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------------
+//      ChartOpenService
+//-------------------------------------------------------------------------------------------
+
+ChartOpenService::ChartOpenService(ChartDB *db)
+    : m_db(db),
+      m_stop(false),
+      m_brepaint(false)
+{
+    Connect( wxEVT_OCPN_CHARTOPEN, (wxObjectEventFunction) (wxEventFunction) &ChartOpenService::OnEvtThread );
+
+    m_timer.SetOwner(this);
+    Connect( wxEVT_TIMER, wxTimerEventHandler( ChartOpenService::OnTimer ), NULL, this );
+}
+
+ChartOpenService::~ChartOpenService()
+{
+    m_timer.Stop();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+
+    for(size_t i = 0; i < m_threads.size(); i++) {
+        m_threads[i]->Wait();
+        delete m_threads[i];
+    }
+
+    //  Opened, but the database is going away
+    for(size_t i = 0; i < m_done.size(); i++)
+        delete m_done[i].chart;
+}
+
+//  The raster chart classes initialize from their own file alone, see
+//  ChartIngest::IsParallelSafe(): their debug flags are read with the
+//  config at startup, before any chart opens, and pConfig is not touched.
+//  s57chart and cm93 need the shared presentation library, and plugin
+//  charts may expect their host thread.
+bool ChartOpenService::IsWorkerSafe(ChartTypeEnum chart_type)
+{
+    return chart_type == CHART_TYPE_KAP || chart_type == CHART_TYPE_GEO ||
+           chart_type == CHART_TYPE_MBTILES;
+}
+
+void ChartOpenService::StartWorkers()
+{
+    if(m_threads.size())
+        return;
+
+    int nCPU = wxMax(1, wxThread::GetCPUCount());
+    if(g_nCPUCount > 0)
+        nCPU = g_nCPUCount;
+
+    //  Leave a core to the GUI thread, which keeps painting meanwhile
+    int nthreads = wxMin(wxMax(nCPU - 1, 1), CHART_OPEN_MAX_THREADS);
+
+    for(int i = 0; i < nthreads; i++) {
+        ChartOpenThread *thread = new ChartOpenThread(this);
+        if(thread->Run() != wxTHREAD_NO_ERROR) {
+            delete thread;
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+}
+
+bool ChartOpenService::Request(int dbIndex, const wxString &full_path, ChartTypeEnum chart_type, bool prefetch)
+{
+    std::map<int, bool>::iterator it = m_pending.find(dbIndex);
+    if(it != m_pending.end()) {
+        if(!prefetch && !it->second) {
+            //  Prefetched, and now on screen: move it up if still queued
+            it->second = true;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for(std::deque<Job>::iterator ij = m_prefetch.begin(); ij != m_prefetch.end(); ++ij) {
+                if(ij->dbIndex == dbIndex) {
+                    ij->prefetch = false;
+                    m_requested.push_back(*ij);
+                    m_prefetch.erase(ij);
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    Job job;
+    job.dbIndex = dbIndex;
+    job.full_path = full_path;
+    job.chart_type = chart_type;
+    job.prefetch = prefetch;
+    job.chart = NULL;
+    job.ir = INIT_OK;
+
+    if(!IsWorkerSafe(chart_type)) {
+        if(prefetch)
+            return false;
+
+        m_deferred.push_back(job);
+        m_pending[dbIndex] = true;
+        ScheduleTick();
+        return true;
+    }
+
+    StartWorkers();
+    if(m_threads.empty())
+        return false;                   // the caller opens it synchronously
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(prefetch)
+            m_prefetch.push_back(job);
+        else
+            m_requested.push_back(job);
+    }
+    m_cond.notify_one();
+
+    m_pending[dbIndex] = !prefetch;
+    return true;
+}
+
+void ChartOpenService::ClearPrefetch()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(size_t i = 0; i < m_prefetch.size(); i++)
+        m_pending.erase(m_prefetch[i].dbIndex);
+    m_prefetch.clear();
+}
+
+void ChartOpenService::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(!m_stop) {
+        if(m_requested.empty() && m_prefetch.empty()) {
+            m_cond.wait(lock);
+            continue;
+        }
+
+        std::deque<Job> &queue = m_requested.size() ? m_requested : m_prefetch;
+        Job job = queue.front();
+        queue.pop_front();
+
+        lock.unlock();
+        Open(job);
+        lock.lock();
+
+        m_done.push_back(job);
+        wxQueueEvent(this, new wxThreadEvent(wxEVT_OCPN_CHARTOPEN));
+    }
+}
+
+//  Worker thread
+void ChartOpenService::Open(Job &job)
+{
+    ChartBase *pch = NULL;
+
+    if(job.chart_type == CHART_TYPE_KAP)
+        pch = new ChartKAP();
+    else if(job.chart_type == CHART_TYPE_GEO)
+        pch = new ChartGEO();
+    else if(job.chart_type == CHART_TYPE_MBTILES)
+        pch = new ChartMBTiles();
+
+    if(!pch) {
+        job.ir = INIT_FAIL_NOERROR;
+        return;
+    }
+
+    job.ir = pch->Init(job.full_path, FULL_INIT);
+    if(INIT_OK == job.ir)
+        job.chart = pch;
+    else
+        delete pch;
+}
+
+void ChartOpenService::Adopt(Job &job)
+{
+    bool bwanted = false;
+    std::map<int, bool>::iterator it = m_pending.find(job.dbIndex);
+    if(it != m_pending.end()) {
+        bwanted = it->second;
+        m_pending.erase(it);
+    }
+
+    bool badded = m_db->AdoptChart(job.dbIndex, job.full_path, job.chart, job.ir);
+    if(badded && bwanted) {
+        m_brepaint = true;
+        ScheduleTick();
+    }
+}
+
+void ChartOpenService::OnEvtThread(wxThreadEvent &event)
+{
+    std::vector<Job> done;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        done.swap(m_done);
+    }
+
+    for(size_t i = 0; i < done.size(); i++)
+        Adopt(done[i]);
+}
+
+void ChartOpenService::ScheduleTick()
+{
+    if(!m_timer.IsRunning())
+        m_timer.Start(CHART_OPEN_TICK_MS, wxTIMER_ONE_SHOT);
+}
+
+void ChartOpenService::OnTimer(wxTimerEvent &event)
+{
+    //  A synchronous chart load is yielding, come back later
+    if(m_db->IsBusy()) {
+        ScheduleTick();
+        return;
+    }
+
+    if(m_deferred.size()) {
+        Job job = m_deferred.front();
+        m_deferred.pop_front();
+        m_pending.erase(job.dbIndex);
+
+        if(m_db->IsEntryCurrent(job.dbIndex, job.full_path) &&
+           m_db->OpenChartFromDB(job.dbIndex, FULL_INIT))
+            m_brepaint = true;
+    }
+
+    if(m_brepaint) {
+        m_brepaint = false;
+        if(gFrame)
+            gFrame->ReloadAllVP();
+    }
+
+    if(m_deferred.size())
+        ScheduleTick();
+}
@@ -35,6 +35,11 @@
 #include "ocpn_plugin.h"
 #include "chart1.h"
 #include "options.h"
+#include "multiplexer.h"
+
+extern Multiplexer *g_pMUX;
+
+#define OUTPUT_STATS_TIMER_MS   2000
 
 #if !wxUSE_XLOCALE && wxCHECK_VERSION(3,0,0)
 #define wxAtoi(arg) atoi(arg)
@@ -317,6 +322,7 @@ extern "C"  bool GetGlobalColor(wxString colorName, wxColour *pcolour);
 BEGIN_EVENT_TABLE(ConnectionParamsPanel, wxPanel)
 EVT_PAINT ( ConnectionParamsPanel::OnPaint )
 EVT_ERASE_BACKGROUND(ConnectionParamsPanel::OnEraseBackground)
+EVT_TIMER(wxID_ANY, ConnectionParamsPanel::OnStatsTimer)
 END_EVENT_TABLE()
 
 ConnectionParamsPanel::ConnectionParamsPanel(wxWindow *parent, wxWindowID id, const wxPoint &pos, const wxSize &size,
@@ -326,6 +332,7 @@ ConnectionParamsPanel::ConnectionParamsPanel(wxWindow *parent, wxWindowID id, co
     m_pContainer = pContainer;
     m_pConnectionParams = p_itemConnectionParams;
     m_bSelected = false;
+    t22 = NULL;
 
     wxFont *dFont = GetOCPNScaledFont_PlugIn(_("Dialog"));
     SetFont( *dFont );
@@ -337,11 +344,16 @@ ConnectionParamsPanel::ConnectionParamsPanel(wxWindow *parent, wxWindowID id, co
     
     Connect(wxEVT_LEFT_DOWN, wxMouseEventHandler(ConnectionParamsPanel::OnSelected), NULL, this);
     CreateControls(); 
-    
+
+    if(t22) {
+        m_statsTimer.SetOwner(this);
+        m_statsTimer.Start(OUTPUT_STATS_TIMER_MS);
+    }
 }
 
 ConnectionParamsPanel::~ConnectionParamsPanel()
 {
+    m_statsTimer.Stop();
     if(m_pConnectionParams)
         m_pConnectionParams->m_optionsPanel = nullptr;
 }
@@ -533,6 +545,11 @@ void ConnectionParamsPanel::CreateControls( void ){
         parmSizer->Add(t21, 0);
         t21->Connect(wxEVT_LEFT_DOWN, wxMouseEventHandler(ConnectionParamsPanel::OnSelected), NULL, this);
 
+        t22 = new wxStaticText(this, wxID_ANY, wxEmptyString);
+        parmSizer->Add(t22, 0);
+        t22->Connect(wxEVT_LEFT_DOWN, wxMouseEventHandler(ConnectionParamsPanel::OnSelected), NULL, this);
+        UpdateOutputStats();
+
     }
  
     else if(m_pConnectionParams->Type == NETWORK){
@@ -629,6 +646,11 @@ void ConnectionParamsPanel::CreateControls( void ){
         t21 = new wxStaticText(this, wxID_ANY, _("Comment: ") + m_pConnectionParams->UserComment);
         parmSizer->Add(t21, 0);
         t21->Connect(wxEVT_LEFT_DOWN, wxMouseEventHandler(ConnectionParamsPanel::OnSelected), NULL, this);
+
+        t22 = new wxStaticText(this, wxID_ANY, wxEmptyString);
+        parmSizer->Add(t22, 0);
+        t22->Connect(wxEVT_LEFT_DOWN, wxMouseEventHandler(ConnectionParamsPanel::OnSelected), NULL, this);
+        UpdateOutputStats();
         }
         
     else if(m_pConnectionParams->Type == INTERNAL_GPS){
@@ -869,9 +891,34 @@ void ConnectionParamsPanel::Update( ConnectionParams *ConnectionParams)
         t21->SetLabel(_("Comment: ") + m_pConnectionParams->UserComment);
     }
 
+    UpdateOutputStats();
+
     GetSizer()->Layout();
 }
 
+//  Backlog and drop counts of the connection's output queue, see DataStream::QueueSentence()
+void ConnectionParamsPanel::UpdateOutputStats()
+{
+    if(!t22)
+        return;
+
+    wxString label;
+    DataStream *stream = g_pMUX ? g_pMUX->FindStream(m_pConnectionParams->GetDSPort()) : NULL;
+    OutputQueueStats stats;
+    if(stream && stream->GetOutputStats(stats)) {
+        label.Printf(_("Output backlog: %lu   dropped: %lu   failed: %lu"),
+                     (unsigned long)stats.backlog, stats.dropped, stats.failed);
+    }
+
+    if(label != t22->GetLabel())
+        t22->SetLabel(label);
+}
+
+void ConnectionParamsPanel::OnStatsTimer( wxTimerEvent &event )
+{
+    UpdateOutputStats();
+}
+
 
 void ConnectionParamsPanel::OnEraseBackground( wxEraseEvent &event )
 {
@@ -0,0 +1,616 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Depth hazard queries over the loaded vector charts
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include <wx/stopwatch.h>
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <unordered_set>
+
+#include "DepthHazards.h"
+#include "s57chart.h"
+#include "cm93.h"
+#include "chartdb.h"
+#include "mygeom.h"
+#include "georef.h"
+
+extern ChartDB *ChartData;
+extern bool GetDoubleAttr(S57Obj *obj, const char *AttrName, double &val);      // found in s52cnsy
+
+DepthHazardStats DepthHazards::s_stats;
+
+namespace {
+
+struct Leaf
+{
+    float   cx, cy;
+    int     id;
+};
+
+bool CompareX(const Leaf &a, const Leaf &b) { return a.cx < b.cx; }
+bool CompareY(const Leaf &a, const Leaf &b) { return a.cy < b.cy; }
+
+bool CompareDistance(const DepthHazardHit &a, const DepthHazardHit &b) { return a.distance < b.distance; }
+
+//  Vertex {k} of a triangle primitive, in SM
+inline void GetVertex(const TriPrim *p, const PolyTriGroup *ppg, const S57Obj *obj, int k, float &x, float &y)
+{
+    double vx, vy;
+    if(ppg->data_type == DATA_TYPE_DOUBLE) {
+        vx = p->p_vertex[k * 2];
+        vy = p->p_vertex[k * 2 + 1];
+    }
+    else {
+        vx = ((float *)p->p_vertex)[k * 2];
+        vy = ((float *)p->p_vertex)[k * 2 + 1];
+    }
+
+    //  As s57chart::IsPointInObjArea(), cm93 areas are not tessellated in SM
+    if(!ppg->m_bSMSENC) {
+        vx = vx * obj->x_rate + obj->x_origin;
+        vy = vy * obj->y_rate + obj->y_origin;
+    }
+    x = (float)vx;
+    y = (float)vy;
+}
+
+//  Squared distance from {px,py} to the segment {ax,ay} - {bx,by}, and where
+//  along it, 0 to 1, the nearest point lies
+double PointSegment2(double px, double py, double ax, double ay, double bx, double by, double &u)
+{
+    double dx = bx - ax;
+    double dy = by - ay;
+    double l2 = dx * dx + dy * dy;
+    u = l2 > 0 ? ((px - ax) * dx + (py - ay) * dy) / l2 : 0;
+    u = wxMax(0., wxMin(u, 1.));
+
+    double ex = ax + u * dx - px;
+    double ey = ay + u * dy - py;
+    return ex * ex + ey * ey;
+}
+
+//  Where along the track {x0,y0} - {x1,y1} it crosses {ax,ay} - {bx,by}, if it does
+bool Crosses(double x0, double y0, double x1, double y1, double ax, double ay, double bx, double by, double &t)
+{
+    double dx = x1 - x0, dy = y1 - y0;
+    double ex = bx - ax, ey = by - ay;
+    double den = dx * ey - dy * ex;
+    if(den == 0)
+        return false;
+
+    double tt = ((ax - x0) * ey - (ay - y0) * ex) / den;
+    double u = ((ax - x0) * dy - (ay - y0) * dx) / den;
+    if(tt < 0 || tt > 1 || u < 0 || u > 1)
+        return false;
+
+    t = tt;
+    return true;
+}
+
+//  Closest approach of the track to the segment {ax,ay} - {bx,by}: squared
+//  distance, and where along the track
+void Approach(double x0, double y0, double x1, double y1, double ax, double ay, double bx, double by,
+              double &t, double &d2)
+{
+    if(Crosses(x0, y0, x1, y1, ax, ay, bx, by, t)) {
+        d2 = 0;
+        return;
+    }
+
+    double u;
+    d2 = PointSegment2(ax, ay, x0, y0, x1, y1, t);
+    double d = PointSegment2(bx, by, x0, y0, x1, y1, u);
+    if(d < d2) { d2 = d; t = u; }
+    d = PointSegment2(x0, y0, ax, ay, bx, by, u);
+    if(d < d2) { d2 = d; t = 0; }
+    d = PointSegment2(x1, y1, ax, ay, bx, by, u);
+    if(d < d2) { d2 = d; t = 1; }
+}
+
+inline bool InTriangle(double px, double py, const float *v)
+{
+    double d0 = (v[2] - v[0]) * (py - v[1]) - (v[3] - v[1]) * (px - v[0]);
+    double d1 = (v[4] - v[2]) * (py - v[3]) - (v[5] - v[3]) * (px - v[2]);
+    double d2 = (v[0] - v[4]) * (py - v[5]) - (v[1] - v[5]) * (px - v[4]);
+    return (d0 >= 0 && d1 >= 0 && d2 >= 0) || (d0 <= 0 && d1 <= 0 && d2 <= 0);
+}
+
+//  Longitude {lon} taken within half a turn of {ref_lon}
+inline double NearLon(double lon, double ref_lon)
+{
+    while(lon - ref_lon > 180.)
+        lon -= 360.;
+    while(lon - ref_lon < -180.)
+        lon += 360.;
+    return lon;
+}
+
+}
+
+//----------------------------------------------------------------------------------
+//      S57HazardIndex
+//----------------------------------------------------------------------------------
+
+S57HazardIndex::S57HazardIndex()
+    : m_valid(false)
+{
+}
+
+void S57HazardIndex::Clear()
+{
+    m_valid = false;
+    m_hazards.clear();
+    m_points.clear();
+    m_nodes.clear();
+    m_level_end.clear();
+}
+
+void S57HazardIndex::Build(ObjRazRules *razRules[PRIO_NUM][LUPNAME_NUM], float *line_vertex_buffer)
+{
+    Clear();
+    m_valid = true;
+
+    //  Objects are listed once for each display style
+    std::unordered_set<S57Obj *> seen;
+
+    for(int i = 0; i < PRIO_NUM; i++) {
+        for(int j = 0; j < LUPNAME_NUM; j++) {
+            for(ObjRazRules *top = razRules[i][j]; top; top = top->next) {
+                S57Obj *obj = top->obj;
+                if(!obj || !seen.insert(obj).second)
+                    continue;
+
+                //  Least depth, taken as drying where not charted
+                const char *attr;
+                if(!strncmp(obj->FeatureName, "DEPARE", 6) || !strncmp(obj->FeatureName, "DRGARE", 6))
+                    attr = "DRVAL1";
+                else if(!strncmp(obj->FeatureName, "DEPCNT", 6))
+                    attr = "VALDCO";
+                else if(!strncmp(obj->FeatureName, "OBSTRN", 6) || !strncmp(obj->FeatureName, "WRECKS", 6) ||
+                        !strncmp(obj->FeatureName, "UWTROC", 6))
+                    attr = "VALSOU";
+                else
+                    continue;
+
+                double depth;
+                if(!GetDoubleAttr(obj, attr, depth))
+                    depth = 0;
+
+                switch(obj->Primitive_type) {
+                    case GEO_AREA:
+                        AddArea(obj, depth);
+                        break;
+                    case GEO_LINE:
+                        AddLine(obj, depth, line_vertex_buffer);
+                        break;
+                    case GEO_POINT:
+                        AddPoint(obj, depth);
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    Pack();
+}
+
+void S57HazardIndex::AddArea(S57Obj *obj, float depth)
+{
+    PolyTessGeo *ptg = obj->pPolyTessGeo;
+    if(!ptg)
+        return;
+    if(!ptg->IsOk())
+        ptg->BuildDeferredTess();
+
+    PolyTriGroup *ppg = ptg->Get_PolyTriGroup_head();
+    if(!ppg)
+        return;
+
+    unsigned int first = m_points.size() / 2;
+    float x, y;
+    for(TriPrim *p = ppg->tri_prim_head; p; p = p->p_next) {
+        for(int it = 0; it + 2 < p->nVert; it += (p->type == PTG_TRIANGLES ? 3 : 1)) {
+            int k0 = p->type == PTG_TRIANGLE_FAN ? 0 : it;
+            int k[3] = { k0, it + 1, it + 2 };
+            for(int v = 0; v < 3; v++) {
+                GetVertex(p, ppg, obj, k[v], x, y);
+                m_points.push_back(x);
+                m_points.push_back(y);
+            }
+        }
+    }
+
+    AddHazard(obj, HAZARD_AREA, depth, first);
+}
+
+void S57HazardIndex::AddLine(S57Obj *obj, float depth, float *line_vertex_buffer)
+{
+    unsigned int first = m_points.size() / 2;
+
+    if(obj->geoPt) {
+        //  cm93, in its own coordinates
+        for(int ip = 0; ip < obj->npt; ip++) {
+            m_points.push_back((float)(obj->geoPt[ip].x * obj->x_rate + obj->x_origin));
+            m_points.push_back((float)(obj->geoPt[ip].y * obj->y_rate + obj->y_origin));
+        }
+        AddHazard(obj, HAZARD_LINE, depth, first);
+        return;
+    }
+
+    //  As s57chart::DoesLatLonSelectObject(), edges are in the chart line vertex buffer.
+    //  Each makes a polyline of its own, the index keeps one hazard for each.
+    unsigned char *vbo_point = (unsigned char *)line_vertex_buffer;
+    for(line_segment_element *ls = obj->m_ls_list; ls && vbo_point; ls = ls->next) {
+        float *ppt;
+        int nPoints;
+        if((ls->ls_type == TYPE_EE) || (ls->ls_type == TYPE_EE_REV)) {
+            ppt = (float *)(vbo_point + ls->pedge->vbo_offset);
+            nPoints = ls->pedge->nCount;
+        }
+        else {
+            ppt = (float *)(vbo_point + ls->pcs->vbo_offset);
+            nPoints = 2;
+        }
+
+        first = m_points.size() / 2;
+        m_points.insert(m_points.end(), ppt, ppt + nPoints * 2);
+        AddHazard(obj, HAZARD_LINE, depth, first);
+    }
+}
+
+void S57HazardIndex::AddPoint(S57Obj *obj, float depth)
+{
+    unsigned int first = m_points.size() / 2;
+    m_points.push_back((float)(obj->x * obj->x_rate + obj->x_origin));
+    m_points.push_back((float)(obj->y * obj->y_rate + obj->y_origin));
+
+    AddHazard(obj, HAZARD_POINT, depth, first);
+}
+
+//  The points from {first} on make the geometry of a new hazard, and its leaf
+void S57HazardIndex::AddHazard(S57Obj *obj, int kind, float depth, unsigned int first)
+{
+    unsigned int count = m_points.size() / 2 - first;
+    if(!count || (kind == HAZARD_LINE && count < 2)) {
+        m_points.resize(first * 2);
+        return;
+    }
+
+    Hazard hazard = { obj, kind, depth, first, count };
+    m_hazards.push_back(hazard);
+
+    Node leaf = { m_points[first * 2], m_points[first * 2 + 1], m_points[first * 2], m_points[first * 2 + 1], depth };
+    for(unsigned int i = first + 1; i < first + count; i++) {
+        leaf.minx = wxMin(leaf.minx, m_points[i * 2]);
+        leaf.maxx = wxMax(leaf.maxx, m_points[i * 2]);
+        leaf.miny = wxMin(leaf.miny, m_points[i * 2 + 1]);
+        leaf.maxy = wxMax(leaf.maxy, m_points[i * 2 + 1]);
+    }
+    m_nodes.push_back(leaf);
+}
+
+//  Sort-tile-recursive packing of the leaves, as S57SpatialIndex
+void S57HazardIndex::Pack()
+{
+    size_t n = m_hazards.size();
+    if(!n)
+        return;
+
+    std::vector<Leaf> leaves(n);
+    for(size_t i = 0; i < n; i++) {
+        leaves[i].cx = (m_nodes[i].minx + m_nodes[i].maxx) / 2;
+        leaves[i].cy = (m_nodes[i].miny + m_nodes[i].maxy) / 2;
+        leaves[i].id = i;
+    }
+
+    size_t n_nodes = (n + S57_HAZARD_NODE_SIZE - 1) / S57_HAZARD_NODE_SIZE;
+    size_t n_slices = (size_t)ceil(sqrt((double)n_nodes));
+    size_t slice_size = n_slices * S57_HAZARD_NODE_SIZE;
+
+    std::sort(leaves.begin(), leaves.end(), CompareX);
+    for(size_t s = 0; s < n; s += slice_size)
+        std::sort(leaves.begin() + s, leaves.begin() + std::min(s + slice_size, n), CompareY);
+
+    std::vector<Hazard> hazards;
+    std::vector<Node> nodes;
+    hazards.reserve(n);
+    nodes.reserve(n + n_nodes + n_nodes / (S57_HAZARD_NODE_SIZE - 1) + 1);
+    for(size_t i = 0; i < n; i++) {
+        hazards.push_back(m_hazards[leaves[i].id]);
+        nodes.push_back(m_nodes[leaves[i].id]);
+    }
+    m_hazards.swap(hazards);
+    m_nodes.swap(nodes);
+    m_level_end.push_back(n);
+
+    //  Each level of nodes bounds consecutive runs of the level below, and
+    //  carries their least depth
+    size_t level_start = 0;
+    while(m_level_end.back() - level_start > 1) {
+        size_t level_end = m_level_end.back();
+        for(size_t i = level_start; i < level_end; i += S57_HAZARD_NODE_SIZE) {
+            Node node = m_nodes[i];
+            size_t end = std::min(i + S57_HAZARD_NODE_SIZE, level_end);
+            for(size_t c = i + 1; c < end; c++) {
+                const Node &child = m_nodes[c];
+                node.minx = std::min(node.minx, child.minx);
+                node.miny = std::min(node.miny, child.miny);
+                node.maxx = std::max(node.maxx, child.maxx);
+                node.maxy = std::max(node.maxy, child.maxy);
+                node.depth = std::min(node.depth, child.depth);
+            }
+            m_nodes.push_back(node);
+        }
+        level_start = level_end;
+        m_level_end.push_back(m_nodes.size());
+    }
+}
+
+bool S57HazardIndex::Query(double x0, double y0, double x1, double y1, double depth, double half_width,
+                           std::vector<DepthHazardHit> *hits) const
+{
+    if(m_nodes.empty())
+        return false;
+
+    double minx = wxMin(x0, x1) - half_width;
+    double maxx = wxMax(x0, x1) + half_width;
+    double miny = wxMin(y0, y1) - half_width;
+    double maxy = wxMax(y0, y1) + half_width;
+
+    bool found = false;
+
+    //  Node index, and its level
+    std::vector< std::pair<size_t, int> > stack;
+    stack.push_back(std::make_pair(m_nodes.size() - 1, (int)m_level_end.size() - 1));
+
+    while(stack.size()) {
+        size_t node = stack.back().first;
+        int level = stack.back().second;
+        stack.pop_back();
+
+        const Node &b = m_nodes[node];
+        if(b.depth >= depth)
+            continue;
+        if(b.maxx < minx || b.minx > maxx || b.maxy < miny || b.miny > maxy)
+            continue;
+
+        if(level == 0) {
+            const Hazard &hazard = m_hazards[node];
+            double t, offset;
+            if(!Test(hazard, x0, y0, x1, y1, half_width, t, offset))
+                continue;
+
+            found = true;
+            if(!hits)
+                return true;
+
+            DepthHazardHit hit = { hazard.obj, hazard.depth, 0., 0., t, offset, 0 };
+            hits->push_back(hit);
+            continue;
+        }
+
+        size_t level_start = level > 1 ? m_level_end[level - 2] : 0;
+        size_t first = level_start + (node - m_level_end[level - 1]) * S57_HAZARD_NODE_SIZE;
+        size_t end = std::min(first + S57_HAZARD_NODE_SIZE, m_level_end[level - 1]);
+        for(size_t c = first; c < end; c++)
+            stack.push_back(std::make_pair(c, level - 1));
+    }
+
+    return found;
+}
+
+//  Whether the track comes within {half_width} of {hazard}; if so, where along
+//  the track it first does, and how far off the track line
+bool S57HazardIndex::Test(const Hazard &hazard, double x0, double y0, double x1, double y1, double half_width,
+                          double &t, double &offset) const
+{
+    const float *v = &m_points[hazard.first * 2];
+    double w2 = half_width * half_width;
+    bool b_hit = false;
+    double best_t = 2, best_d2 = 0;
+    double tt, d2;
+
+    switch(hazard.kind) {
+        case HAZARD_POINT:
+            d2 = PointSegment2(v[0], v[1], x0, y0, x1, y1, tt);
+            if(d2 <= w2) {
+                b_hit = true;
+                best_t = tt;
+                best_d2 = d2;
+            }
+            break;
+
+        case HAZARD_LINE:
+            for(unsigned int i = 0; i + 1 < hazard.count; i++, v += 2) {
+                Approach(x0, y0, x1, y1, v[0], v[1], v[2], v[3], tt, d2);
+                if(d2 <= w2 && tt < best_t) {
+                    b_hit = true;
+                    best_t = tt;
+                    best_d2 = d2;
+                }
+            }
+            break;
+
+        case HAZARD_AREA:
+            for(unsigned int i = 0; i < hazard.count; i += 3, v += 6) {
+                if(InTriangle(x0, y0, v)) {
+                    t = 0;
+                    offset = 0;
+                    return true;
+                }
+                for(int e = 0; e < 3; e++) {
+                    int e1 = (e + 1) % 3;
+                    Approach(x0, y0, x1, y1, v[e * 2], v[e * 2 + 1], v[e1 * 2], v[e1 * 2 + 1], tt, d2);
+                    if(d2 <= w2 && tt < best_t) {
+                        b_hit = true;
+                        best_t = tt;
+                        best_d2 = d2;
+                    }
+                }
+            }
+            break;
+    }
+
+    if(b_hit) {
+        t = best_t;
+        offset = sqrt(best_d2);
+    }
+    return b_hit;
+}
+
+//----------------------------------------------------------------------------------
+//      DepthHazards
+//----------------------------------------------------------------------------------
+
+//  The vector charts open in the chart database, cm93 by its loaded scales
+void DepthHazards::GetCharts(std::vector<s57chart *> &charts)
+{
+    charts.clear();
+    if(!ChartData)
+        return;
+
+    std::vector<ChartBase *> open;
+    ChartData->GetCacheCharts(open);
+
+    for(size_t i = 0; i < open.size(); i++) {
+        ChartBase *chart = open[i];
+        if(!chart)
+            continue;
+
+        if(chart->GetChartType() == CHART_TYPE_CM93COMP) {
+            cm93compchart *comp = (cm93compchart *)chart;
+            for(int cmscale = 0; cmscale < 8; cmscale++)
+                if(comp->GetScaleChart(cmscale))
+                    charts.push_back(comp->GetScaleChart(cmscale));
+        }
+        else if(chart->GetChartType() == CHART_TYPE_S57 || chart->GetChartType() == CHART_TYPE_CM93) {
+            s57chart *s57 = dynamic_cast<s57chart *>(chart);
+            if(s57)
+                charts.push_back(s57);
+        }
+    }
+}
+
+bool DepthHazards::CheckSegment(double lat0, double lon0, double lat1, double lon1, double depth,
+                                double half_width, std::vector<DepthHazardHit> *hits)
+{
+    wxStopWatch sw;
+
+    double brg, dist;
+    DistanceBearingMercator(lat1, lon1, lat0, lon0, &brg, &dist);
+
+    //  SM meters are true meters over the cosine of the latitude
+    double sm_per_meter = 1. / cos(wxMin(fabs((lat0 + lat1) / 2), 85.) * PI / 180.);
+
+    std::vector<s57chart *> charts;
+    GetCharts(charts);
+
+    bool found = false;
+    for(size_t i = 0; i < charts.size(); i++) {
+        s57chart *chart = charts[i];
+
+        if(chart->m_bExtentSet) {
+            double lon_a = NearLon(lon0, (chart->m_FullExtent.WLON + chart->m_FullExtent.ELON) / 2);
+            double lon_b = lon_a + NearLon(lon1, lon0) - lon0;
+            double margin = half_width / 1852. / 60. * sm_per_meter;
+            if(wxMax(lat0, lat1) + margin < chart->m_FullExtent.SLAT ||
+               wxMin(lat0, lat1) - margin > chart->m_FullExtent.NLAT ||
+               wxMax(lon_a, lon_b) + margin < chart->m_FullExtent.WLON ||
+               wxMin(lon_a, lon_b) - margin > chart->m_FullExtent.ELON)
+                continue;
+        }
+
+        const S57HazardIndex &index = chart->GetHazardIndex();
+
+        double x0, y0, x1, y1;
+        toSM(lat0, NearLon(lon0, chart->ref_lon), chart->ref_lat, chart->ref_lon, &x0, &y0);
+        toSM(lat1, NearLon(lon1, chart->ref_lon), chart->ref_lat, chart->ref_lon, &x1, &y1);
+
+        size_t n = hits ? hits->size() : 0;
+        if(!index.Query(x0, y0, x1, y1, depth, half_width * sm_per_meter, hits))
+            continue;
+
+        found = true;
+        if(!hits)
+            break;
+
+        for(size_t h = n; h < hits->size(); h++) {
+            DepthHazardHit &hit = (*hits)[h];
+            double t = hit.distance;
+            fromSM(x0 + t * (x1 - x0), y0 + t * (y1 - y0), chart->ref_lat, chart->ref_lon, &hit.lat, &hit.lon);
+            hit.distance = t * dist;
+            hit.offset /= sm_per_meter;
+            hit.chart_scale = chart->GetNativeScale();
+        }
+    }
+
+    if(hits)
+        std::stable_sort(hits->begin(), hits->end(), CompareDistance);
+
+    s_stats.queries++;
+    if(found)
+        s_stats.hits++;
+    s_stats.query_us += sw.TimeInMicro().ToLong();
+
+    return found;
+}
+
+bool DepthHazards::CheckTrack(double lat, double lon, double cog, double sog, double minutes, double depth,
+                              double half_width, std::vector<DepthHazardHit> *hits)
+{
+    double lat1, lon1;
+    PositionBearingDistanceMercator(lat, lon, cog, sog * minutes / 60., &lat1, &lon1);
+
+    return CheckSegment(lat, lon, lat1, lon1, depth, half_width, hits);
+}
+
+void DepthHazards::CountBuild(long us)
+{
+    s_stats.builds++;
+    s_stats.build_us += us;
+}
+
+DepthHazardStats DepthHazards::GetStats()
+{
+    return s_stats;
+}
+
+void DepthHazards::LogStats()
+{
+    if(!s_stats.queries)
+        return;
+
+    double qps = s_stats.query_us > 0 ? s_stats.queries * 1e6 / s_stats.query_us : 0;
+    wxLogMessage(_T("DepthHazards: %lu queries, %lu with hazards, %.0f queries/s; %lu chart indexes built in %ld ms"),
+                 s_stats.queries, s_stats.hits, qps, s_stats.builds, s_stats.build_us / 1000);
+}
@@ -0,0 +1,442 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Background MBTiles tile fetch and decode
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include <wx/image.h>
+#include <wx/mstream.h>
+
+#include <sqlite3.h> //We need some defines
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "MBTilesLoader.h"
+#include "chcanv.h"
+
+WX_DEFINE_ARRAY_PTR(ChartCanvas*, arrayofCanvasPtr);
+
+extern arrayofCanvasPtr g_canvasArray;
+extern int              g_nCPUCount;
+
+const wxEventType wxEVT_OCPN_MBTILE = wxNewEventType();
+
+//-------------------------------------------------------------------------------------------
+//      MBTilesSource
+//-------------------------------------------------------------------------------------------
+
+MBTilesSource::MBTilesSource(SQLite::Database *db, int min_zoom, int max_zoom)
+    : m_db(db),
+      m_min_zoom(min_zoom),
+      m_statements(max_zoom - min_zoom + 1, (SQLite::Statement *)NULL),
+      m_scheme(GLOBAL_COLOR_SCHEME_RGB),
+      m_imageType(wxBITMAP_TYPE_ANY),
+      m_closed(false)
+{
+}
+
+MBTilesSource::~MBTilesSource()
+{
+    for(size_t i = 0; i < m_statements.size(); i++)
+        delete m_statements[i];
+    delete m_db;
+
+    for(size_t i = 0; i < m_ready.size(); i++)
+        delete m_ready[i];
+}
+
+void MBTilesSource::TakeReady(std::vector<MBTileImage *> &ready)
+{
+    std::lock_guard<std::mutex> lock(m_ready_mutex);
+    ready.swap(m_ready);
+}
+
+void MBTilesSource::Close()
+{
+    MBTilesLoader::Cancel(this);
+
+    std::lock_guard<std::mutex> lock(m_ready_mutex);
+    m_closed = true;
+    for(size_t i = 0; i < m_ready.size(); i++)
+        delete m_ready[i];
+    m_ready.clear();
+}
+
+//  Worker thread.  False if the tileset has no such tile, or it cannot be read.
+bool MBTilesSource::ReadTile(int zoom, int x, int y, std::vector<unsigned char> &blob)
+{
+    std::lock_guard<std::mutex> lock(m_db_mutex);
+
+    int iz = zoom - m_min_zoom;
+    if(iz < 0 || iz >= (int)m_statements.size())
+        return false;
+
+    try
+    {
+        SQLite::Statement *query = m_statements[iz];
+        if(!query) {
+            query = new SQLite::Statement(*m_db,
+                wxString::Format("select tile_data from tiles where zoom_level = %d AND tile_column=?1 AND tile_row=?2", zoom).c_str());
+            m_statements[iz] = query;
+        }
+
+        query->reset();
+        query->bind(1, x);
+        query->bind(2, y);
+
+        if(SQLITE_ROW != query->tryExecuteStep())
+            return false;                               // requested ROW not found
+
+        SQLite::Column blobColumn = query->getColumn(0);
+        const unsigned char *data = (const unsigned char *)blobColumn.getBlob();
+        int length = blobColumn.getBytes();
+        if(!data || length <= 0)
+            return false;
+
+        blob.assign(data, data + length);
+        return true;
+    }
+    catch (std::exception& e)
+    {
+        wxLogMessage("mbtiles exception: %s", e.what());
+    }
+
+    return false;
+}
+
+//  Worker thread
+void MBTilesSource::Decode(MBTileImage *tile, const std::vector<unsigned char> &blob)
+{
+    wxMemoryInputStream blobStream(&blob[0], blob.size());
+    wxImage blobImage(blobStream, (wxBitmapType)m_imageType.load());
+
+    if(!blobImage.IsOk()) {
+        tile->found = false;
+        return;
+    }
+    m_imageType = blobImage.GetType();
+
+    const int tex_w = MBTILES_TILE_SIZE;
+    const int tex_h = MBTILES_TILE_SIZE;
+    if(blobImage.GetWidth() != tex_w || blobImage.GetHeight() != tex_h)
+        blobImage.Rescale(tex_w, tex_h);
+
+    //  Scaling the HSV value scales each of R, G and B alike
+    unsigned char dim[256];
+    double dimLevel = 1.0;
+    switch( tile->scheme ){
+        case GLOBAL_COLOR_SCHEME_DUSK:
+            dimLevel = 0.8;
+            break;
+        case GLOBAL_COLOR_SCHEME_NIGHT:
+            dimLevel = 0.3;
+            break;
+        default:
+            break;
+    }
+    for(int i = 0; i < 256; i++)
+        dim[i] = (unsigned char)(i * dimLevel);
+
+    const unsigned char *imgdata = blobImage.GetData();
+    const unsigned char *alpha = blobImage.HasAlpha() ? blobImage.GetAlpha() : NULL;
+
+    tile->rgba.resize(4 * tex_w * tex_h);
+    unsigned char *teximage = &tile->rgba[0];
+
+    for( int j = 0; j < tex_w*tex_h; j++ ){
+        const unsigned char *d = &imgdata[3*j];
+        unsigned char *t = &teximage[4*j];
+        t[0] = dim[d[0]];
+        t[1] = dim[d[1]];
+        t[2] = dim[d[2]];
+
+        // Some NOAA Tilesets do not give transparent tiles, so we detect NOAA's idea of blank
+        // as RGB(1,0,0) and force  alpha = 0;
+        if( d[0] == 1 && d[1] == 0 && d[2] == 0 )
+            t[3] = 0;
+        else
+            t[3] = alpha ? alpha[j] : 255;
+    }
+}
+
+//-------------------------------------------------------------------------------------------
+//      MBTilesLoaderThread
+//-------------------------------------------------------------------------------------------
+
+MBTilesLoaderThread::MBTilesLoaderThread(MBTilesLoader *loader)
+    : wxThread(wxTHREAD_JOINABLE),
+      m_loader(loader)
+{
+    Create();
+}
+
+void *MBTilesLoaderThread::Entry()
+{
+    m_loader->WorkerLoop();
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------------
+//      MBTilesLoader
+//-------------------------------------------------------------------------------------------
+
+MBTilesLoader *MBTilesLoader::s_loader = NULL;
+
+MBTilesLoader *MBTilesLoader::Get()
+{
+    if(!s_loader)
+        s_loader = new MBTilesLoader();
+    return s_loader;
+}
+
+void MBTilesLoader::Shutdown()
+{
+    delete s_loader;
+    s_loader = NULL;
+}
+
+MBTilesLoader::MBTilesLoader()
+    : m_stop(false)
+{
+    Connect( wxEVT_OCPN_MBTILE, (wxObjectEventFunction) (wxEventFunction) &MBTilesLoader::OnEvtThread );
+
+    m_timer.SetOwner(this);
+    Connect( wxEVT_TIMER, wxTimerEventHandler( MBTilesLoader::OnTimer ), NULL, this );
+}
+
+MBTilesLoader::~MBTilesLoader()
+{
+    m_timer.Stop();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+
+    for(size_t i = 0; i < m_threads.size(); i++) {
+        m_threads[i]->Wait();
+        delete m_threads[i];
+    }
+}
+
+void MBTilesLoader::StartWorkers()
+{
+    if(m_threads.size())
+        return;
+
+    int nCPU = wxMax(1, wxThread::GetCPUCount());
+    if(g_nCPUCount > 0)
+        nCPU = g_nCPUCount;
+
+    //  Leave a core to the GUI thread, which keeps rendering meanwhile
+    int nthreads = wxMin(wxMax(nCPU - 1, 1), MBTILES_LOADER_MAX_THREADS);
+
+    for(int i = 0; i < nthreads; i++) {
+        MBTilesLoaderThread *thread = new MBTilesLoaderThread(this);
+        if(thread->Run() != wxTHREAD_NO_ERROR) {
+            delete thread;
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+}
+
+bool MBTilesLoader::Request(const std::shared_ptr<MBTilesSource> &source, int zoom, int x, int y, bool prefetch)
+{
+    StartWorkers();
+
+    uint64_t key = MBTilesSource::Key(zoom, x, y);
+
+    Job job;
+    job.source = source;
+    job.zoom = zoom;
+    job.x = x;
+    job.y = y;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        std::unordered_map<uint64_t, bool>::iterator it = source->m_pending.find(key);
+        if(it != source->m_pending.end()) {
+            if(!prefetch && !it->second) {
+                //  Prefetched, and now on screen: move it up if still queued
+                it->second = true;
+                for(std::deque<Job>::iterator ij = m_prefetch.begin(); ij != m_prefetch.end(); ++ij) {
+                    if(ij->source == source && ij->zoom == zoom && ij->x == x && ij->y == y) {
+                        m_requested.push_back(*ij);
+                        m_prefetch.erase(ij);
+                        break;
+                    }
+                }
+            }
+            return true;
+        }
+
+        source->m_pending[key] = !prefetch;
+
+        if(m_threads.size()) {
+            if(prefetch)
+                m_prefetch.push_back(job);
+            else
+                m_requested.push_back(job);
+        }
+    }
+
+    if(m_threads.empty())
+        Run(job);                       // no workers, the tile is ready for the next render
+    else
+        m_cond.notify_one();
+
+    return true;
+}
+
+void MBTilesLoader::ClearPrefetch(const std::shared_ptr<MBTilesSource> &source)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::deque<Job> keep;
+    for(size_t i = 0; i < m_prefetch.size(); i++) {
+        Job &job = m_prefetch[i];
+        if(job.source == source)
+            source->m_pending.erase(MBTilesSource::Key(job.zoom, job.x, job.y));
+        else
+            keep.push_back(job);
+    }
+    m_prefetch.swap(keep);
+}
+
+void MBTilesLoader::Cancel(MBTilesSource *source)
+{
+    if(!s_loader)
+        return;
+
+    std::lock_guard<std::mutex> lock(s_loader->m_mutex);
+
+    std::deque<Job> *queues[] = { &s_loader->m_requested, &s_loader->m_prefetch };
+    for(int q = 0; q < 2; q++) {
+        std::deque<Job> keep;
+        for(size_t i = 0; i < queues[q]->size(); i++) {
+            if((*queues[q])[i].source.get() != source)
+                keep.push_back((*queues[q])[i]);
+        }
+        queues[q]->swap(keep);
+    }
+    source->m_pending.clear();
+}
+
+void MBTilesLoader::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(!m_stop) {
+        if(m_requested.empty() && m_prefetch.empty()) {
+            m_cond.wait(lock);
+            continue;
+        }
+
+        std::deque<Job> &queue = m_requested.size() ? m_requested : m_prefetch;
+        Job job = queue.front();
+        queue.pop_front();
+
+        lock.unlock();
+        Run(job);
+        job.source.reset();             // the last reference may close the database, not under the lock
+        lock.lock();
+    }
+}
+
+//  Worker thread, or the GUI thread if there are no workers
+void MBTilesLoader::Run(Job &job)
+{
+    MBTilesSource *source = job.source.get();
+    MBTileImage *tile = NULL;
+
+    if(!source->IsClosed()) {
+        tile = new MBTileImage;
+        tile->zoom = job.zoom;
+        tile->x = job.x;
+        tile->y = job.y;
+        tile->scheme = source->GetColorScheme();
+
+        std::vector<unsigned char> blob;
+        tile->found = source->ReadTile(job.zoom, job.x, job.y, blob);
+        if(tile->found)
+            source->Decode(tile, blob);
+    }
+
+    Finish(job, tile);
+}
+
+void MBTilesLoader::Finish(Job &job, MBTileImage *tile)
+{
+    MBTilesSource *source = job.source.get();
+
+    bool bwanted = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::unordered_map<uint64_t, bool>::iterator it = source->m_pending.find(MBTilesSource::Key(job.zoom, job.x, job.y));
+        if(it != source->m_pending.end()) {
+            bwanted = it->second;
+            source->m_pending.erase(it);
+        }
+    }
+
+    if(!tile)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(source->m_ready_mutex);
+        if(source->m_closed) {
+            delete tile;
+            return;
+        }
+        source->m_ready.push_back(tile);
+    }
+
+    if(bwanted) {
+        wxThreadEvent *event = new wxThreadEvent(wxEVT_OCPN_MBTILE);
+        wxQueueEvent(this, event);
+    }
+}
+
+void MBTilesLoader::OnEvtThread(wxThreadEvent &event)
+{
+    if(!m_timer.IsRunning())
+        m_timer.Start(MBTILES_REPAINT_MS, wxTIMER_ONE_SHOT);
+}
+
+void MBTilesLoader::OnTimer(wxTimerEvent &event)
+{
+    //  The tiles are uploaded as the charts are rendered again
+    for(unsigned int i=0 ; i < g_canvasArray.GetCount() ; i++){
+        ChartCanvas *cc = g_canvasArray.Item(i);
+        if(cc){
+            cc->InvalidateGL();
+            cc->Refresh( false );
+        }
+    }
+}
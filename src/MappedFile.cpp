@@ -0,0 +1,150 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Read-only memory mapped file
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include "MappedFile.h"
+
+#ifdef __WXMSW__
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : m_data(NULL),
+      m_size(0)
+#ifdef __WXMSW__
+      , m_hfile(INVALID_HANDLE_VALUE),
+      m_hmapping(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef __WXMSW__
+
+bool MappedFile::Open(const wxString &path)
+{
+    Close();
+
+    HANDLE hfile = CreateFileW(path.wc_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(hfile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(hfile, &size) || size.QuadPart == 0 ||
+       (unsigned long long)size.QuadPart > (size_t)-1) {
+        CloseHandle(hfile);
+        return false;
+    }
+
+    HANDLE hmapping = CreateFileMapping(hfile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if(!hmapping) {
+        CloseHandle(hfile);
+        return false;
+    }
+
+    void *data = MapViewOfFile(hmapping, FILE_MAP_COPY, 0, 0, 0);
+    if(!data) {
+        CloseHandle(hmapping);
+        CloseHandle(hfile);
+        return false;
+    }
+
+    m_hfile = hfile;
+    m_hmapping = hmapping;
+    m_data = (char *)data;
+    m_size = (size_t)size.QuadPart;
+    m_path = path;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if(m_data)
+        UnmapViewOfFile(m_data);
+    if(m_hmapping)
+        CloseHandle(m_hmapping);
+    if(m_hfile != INVALID_HANDLE_VALUE)
+        CloseHandle(m_hfile);
+
+    m_data = NULL;
+    m_size = 0;
+    m_hmapping = NULL;
+    m_hfile = INVALID_HANDLE_VALUE;
+    m_path.Clear();
+}
+
+#else
+
+bool MappedFile::Open(const wxString &path)
+{
+    Close();
+
+    int fd = open(path.fn_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat st;
+    if(fstat(fd, &st) || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);                          // the mapping holds its own reference
+    if(data == MAP_FAILED)
+        return false;
+
+    m_data = (char *)data;
+    m_size = st.st_size;
+    m_path = path;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if(m_data)
+        munmap(m_data, m_size);
+
+    m_data = NULL;
+    m_size = 0;
+    m_path.Clear();
+}
+
+#endif
@@ -52,6 +52,7 @@
 #ifndef __WXMSW__
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
+#include <unistd.h>
 #endif
 
 #include <vector>
@@ -81,6 +82,10 @@ extern bool g_benableUDPNullHeader;
 
 #define N_DOG_TIMEOUT   5
 
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL    0
+#endif
+
 #ifdef __WXMSW__
 // {2C9C45C2-8E7D-4C08-A12D-816BBAE722C0}
 DEFINE_GUID(GARMIN_GUID1, 0x2c9c45c2L, 0x8e7d, 0x4c08, 0xa1, 0x2d, 0x81, 0x6b, 0xba, 0xe7, 0x22, 0xc0);
@@ -91,9 +96,55 @@ BEGIN_EVENT_TABLE(NetworkDataStream, wxEvtHandler)
                 EVT_SOCKET(DS_SOCKET_ID, NetworkDataStream::OnSocketEvent)
                 EVT_SOCKET(DS_SERVERSOCKET_ID, NetworkDataStream::OnServerSocketEvent)
                 EVT_TIMER(TIMER_SOCKET + 1, NetworkDataStream::OnSocketReadWatchdogTimer)
+                EVT_THREAD(DS_RXBATCH_ID, NetworkDataStream::OnRxBatch)
+                EVT_THREAD(DS_TXERROR_ID, NetworkDataStream::OnTxError)
 END_EVENT_TABLE()
 
 
+void ExtractNMEASentences(std::string &buffer, std::vector<std::string> &sentences)
+{
+    bool done = false;
+
+    while(!done){
+        int nmea_tail = 2;
+        size_t nmea_end = buffer.find_first_of("*\r\n"); // detect the potential end of a NMEA string by finding the checkum marker or EOL
+
+        if (nmea_end == wxString::npos) // No termination characters: continue reading
+            break;
+
+        if (buffer[nmea_end] != '*')
+            nmea_tail = -1;
+
+        if(nmea_end < buffer.size() - nmea_tail){
+            nmea_end += nmea_tail + 1; // move to the char after the 2 checksum digits, if present
+            if ( nmea_end == 0 ) //The first character in the buffer is a terminator, skip it to avoid infinite loop
+                nmea_end = 1;
+            std::string nmea_line = buffer.substr(0,nmea_end);
+
+            //  If, due to some logic error, the {nmea_end} parameter is larger than the length of the
+            //  socket buffer, then std::string::substr() will throw an exception.
+            //  We don't want that, so test for it.
+            //  If found, the simple solution is to clear the socket buffer, and carry on
+            //  This has been seen on high volume TCP feeds, Windows only.
+            //  Hard to catch.....
+            if(nmea_end > buffer.size())
+                buffer.clear();
+            else
+                buffer.erase(0, nmea_end);
+
+            size_t nmea_start = nmea_line.find_last_of("$!"); // detect the potential start of a NMEA string, skipping preceding chars that may look like the start of a string.
+            if(nmea_start != wxString::npos){
+                nmea_line = nmea_line.substr(nmea_start);
+                nmea_line += "\r\n";        // Add cr/lf, possibly superfluous
+                sentences.push_back(nmea_line);
+            }
+        }
+        else
+            done = true;
+    }
+}
+
+
 void NetworkDataStream::Open(void) {
 
 
@@ -127,9 +178,95 @@ void NetworkDataStream::Open(void) {
     SetOk(true);
 }
 
+bool NetworkDataStream::StartUDPReceiveThread(unsigned int addr)
+{
+#ifdef OCPN_USE_UDP_RX_THREAD
+    long port;
+    if(!GetNetPort().ToLong(&port))
+        return false;
+
+    int fd = OCP_NetworkInput_Thread::OpenUDPSocket((unsigned short)port, addr);
+    if(fd < 0)
+        return false;
+
+    m_rx_thread = new OCP_NetworkInput_Thread(this, fd);
+    SetThreadRunFlag(1);
+    SetSecThreadActive();       // before Run(), so that an early Close() waits for the thread
+    if(m_rx_thread->Run() != wxTHREAD_NO_ERROR) {
+        delete m_rx_thread;     // never ran, the socket is still ours
+        m_rx_thread = NULL;
+        close(fd);
+        SetSecThreadInActive();
+        SetThreadRunFlag(-1);
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+//  Called from the receive thread. Only one wake-up event is outstanding
+//  at any time, the GUI thread collects everything queued up to then.
+void NetworkDataStream::QueueRxBatch(std::vector<std::string> &batch, const NetworkRxStats &stats)
+{
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(m_rx_mutex);
+        if(m_rx_batch.empty())
+            m_rx_batch.swap(batch);
+        else
+            m_rx_batch.insert(m_rx_batch.end(), batch.begin(), batch.end());
+        batch.clear();
+        m_rx_stats = stats;
+        if(!m_rx_wake_pending) {
+            m_rx_wake_pending = true;
+            wake = true;
+        }
+    }
+    if(wake)
+        wxQueueEvent(this, new wxThreadEvent(wxEVT_THREAD, DS_RXBATCH_ID));
+}
+
+void NetworkDataStream::SetRxStats(const NetworkRxStats &stats)
+{
+    std::lock_guard<std::mutex> lock(m_rx_mutex);
+    m_rx_stats = stats;
+}
+
+NetworkRxStats NetworkDataStream::GetRxStats()
+{
+    std::lock_guard<std::mutex> lock(m_rx_mutex);
+    return m_rx_stats;
+}
+
+void NetworkDataStream::OnRxBatch(wxThreadEvent& event)
+{
+    std::vector<std::string> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_rx_mutex);
+        batch.swap(m_rx_batch);
+        m_rx_wake_pending = false;
+    }
+
+    //  Deliver synchronously, the batch already cost us one trip through the event queue
+    if( GetConsumer() ) {
+        for(size_t i = 0; i < batch.size(); i++) {
+            OCPN_DataStreamEvent Nevent(wxEVT_OCPN_DATASTREAM, 0);
+            Nevent.SetNMEAString( batch[i] );
+            Nevent.SetStream( this );
+            GetConsumer()->ProcessEvent(Nevent);
+        }
+    }
+}
+
 void NetworkDataStream::OpenNetworkUDP(unsigned int addr)
 {
-    if (GetPortType() != DS_TYPE_OUTPUT) {
+    if (GetPortType() != DS_TYPE_OUTPUT && StartUDPReceiveThread(addr)) {
+        wxLogMessage(wxString::Format(_T("UDP NetworkDataStream %s: using receive thread"),
+                                      GetPort().c_str()));
+    }
+    else if (GetPortType() != DS_TYPE_OUTPUT) {
         //  We need a local (bindable) address to create the Datagram receive socket
         // Set up the receive socket
         wxIPV4address conn_addr;
@@ -233,8 +370,10 @@ void NetworkDataStream::OnSocketReadWatchdogTimer(wxTimerEvent& event)
         wxLogMessage( wxString::Format(_T("    TCP NetworkDataStream watchdog timeout: %s"), GetPort().c_str()) );
 
         if(GetProtocol() == TCP ) {
+            std::unique_lock<std::mutex> lock(m_tx_mutex);
             wxSocketClient* tcp_socket = dynamic_cast<wxSocketClient*>(GetSock());
             if(tcp_socket) {
+                ReleaseTxSocket(lock, tcp_socket);
                 tcp_socket->Close();
             }
             GetSocketTimer()->Start(5000, wxTIMER_ONE_SHOT);    // schedule a reconnect
@@ -249,6 +388,7 @@ void NetworkDataStream::OnTimerSocket(wxTimerEvent& event)
     wxSocketClient* tcp_socket = dynamic_cast<wxSocketClient*>(GetSock());
     if(tcp_socket) {
         if(tcp_socket->IsDisconnected() ) {
+            std::lock_guard<std::mutex> lock(m_tx_mutex);
             SetBrxConnectEvent(false);
             tcp_socket->Connect(GetAddr(), FALSE);
             GetSocketTimer()->Start(5000, wxTIMER_ONE_SHOT);    // schedule another attempt
@@ -295,54 +435,18 @@ void NetworkDataStream::OnSocketEvent(wxSocketEvent& event)
                 }
             }
 
-            bool done = false;
-
-            while(!done){
-                int nmea_tail = 2;
-                size_t nmea_end = m_sock_buffer.find_first_of("*\r\n"); // detect the potential end of a NMEA string by finding the checkum marker or EOL
+            std::vector<std::string> sentences;
+            ExtractNMEASentences(m_sock_buffer, sentences);
 
-                if (nmea_end == wxString::npos) // No termination characters: continue reading
-                    break;
+            for(size_t i = 0; i < sentences.size(); i++) {
+                const std::string &nmea_line = sentences[i];
+                if( GetConsumer() && ChecksumOK(nmea_line)){
+                    OCPN_DataStreamEvent Nevent(wxEVT_OCPN_DATASTREAM, 0);
+                    Nevent.SetNMEAString( nmea_line );
+                    Nevent.SetStream( this );
 
-                if (m_sock_buffer[nmea_end] != '*')
-                    nmea_tail = -1;
-
-                if(nmea_end < m_sock_buffer.size() - nmea_tail){
-                    nmea_end += nmea_tail + 1; // move to the char after the 2 checksum digits, if present
-                    if ( nmea_end == 0 ) //The first character in the buffer is a terminator, skip it to avoid infinite loop
-                        nmea_end = 1;
-                    std::string nmea_line = m_sock_buffer.substr(0,nmea_end);
-
-                    //  If, due to some logic error, the {nmea_end} parameter is larger than the length of the
-                    //  socket buffer, then std::string::substr() will throw an exception.
-                    //  We don't want that, so test for it.
-                    //  If found, the simple solution is to clear the socket buffer, and carry on
-                    //  This has been seen on high volume TCP feeds, Windows only.
-                    //  Hard to catch.....
-                    if(nmea_end > m_sock_buffer.size())
-                        m_sock_buffer.clear();
-                    else
-                        m_sock_buffer = m_sock_buffer.substr(nmea_end);
-
-                    size_t nmea_start = nmea_line.find_last_of("$!"); // detect the potential start of a NMEA string, skipping preceding chars that may look like the start of a string.
-                    if(nmea_start != wxString::npos){
-                        nmea_line = nmea_line.substr(nmea_start);
-                        nmea_line += "\r\n";        // Add cr/lf, possibly superfluous
-                        if( GetConsumer() && ChecksumOK(nmea_line)){
-                            OCPN_DataStreamEvent Nevent(wxEVT_OCPN_DATASTREAM, 0);
-                            if(nmea_line.size()) {
-                                //wxLogMessage(wxString::Format(_T("NetworkDataStream send to: %p"),
-                                //                              GetConsumer()));
-                                Nevent.SetNMEAString( nmea_line );
-                                Nevent.SetStream( this );
-
-                                GetConsumer()->AddPendingEvent(Nevent);
-                            }
-                        }
-                    }
+                    GetConsumer()->AddPendingEvent(Nevent);
                 }
-                else
-                    done = true;
             }
 
             // Prevent non-nmea junk from consuming to much memory by limiting carry-over buffer size.
@@ -359,6 +463,8 @@ void NetworkDataStream::OnSocketEvent(wxSocketEvent& event)
                 if (GetBrxConnectEvent())
                     wxLogMessage(wxString::Format(_T("NetworkDataStream connection lost: %s"), GetPort().c_str()));
                 if (GetSockServer()) {
+                    std::unique_lock<std::mutex> lock(m_tx_mutex);
+                    ReleaseTxSocket(lock, GetSock());
                     GetSock()->Destroy();
                     SetSock(NULL);
                     break;
@@ -416,6 +522,7 @@ void NetworkDataStream::OnServerSocketEvent(wxSocketEvent& event)
     {
         case wxSOCKET_CONNECTION :
         {
+            std::lock_guard<std::mutex> lock(m_tx_mutex);
             SetSock(GetSockServer()->Accept(false));
 
             if( GetSock()) {
@@ -455,17 +562,7 @@ bool NetworkDataStream::SendSentenceNetwork(const wxString &payload)
             if( GetSock() && GetSock()->IsOk() ) {
                 GetSock()->Write( payload.mb_str(), strlen( payload.mb_str() ) );
                 if(GetSock()->Error()){
-                    if (GetSockServer()) {
-                        GetSock()->Destroy();
-                        SetSock(NULL);
-                    } else {
-                        wxSocketClient* tcp_socket = dynamic_cast<wxSocketClient*>(GetSock());
-                        if (tcp_socket)
-                            tcp_socket->Close();
-                        if(!GetSocketTimer()->IsRunning())
-                            GetSocketTimer()->Start(5000, wxTIMER_ONE_SHOT);    // schedule a reconnect
-                        GetSocketThreadWatchdogTimer()->Stop();
-                    }
+                    HandleTCPWriteError();
                     ret = false;
                 }
 
@@ -494,9 +591,138 @@ bool NetworkDataStream::SendSentenceNetwork(const wxString &payload)
 
 }
 
+void NetworkDataStream::HandleTCPWriteError()
+{
+    std::unique_lock<std::mutex> lock(m_tx_mutex);
+    if( !GetSock() )
+        return;
+
+    ReleaseTxSocket(lock, GetSock());
+    if (GetSockServer()) {
+        GetSock()->Destroy();
+        SetSock(NULL);
+    } else {
+        wxSocketClient* tcp_socket = dynamic_cast<wxSocketClient*>(GetSock());
+        if (tcp_socket)
+            tcp_socket->Close();
+        if(!GetSocketTimer()->IsRunning())
+            GetSocketTimer()->Start(5000, wxTIMER_ONE_SHOT);    // schedule a reconnect
+        GetSocketThreadWatchdogTimer()->Stop();
+    }
+}
+
+//  With m_tx_mutex held by {lock}: if the output thread is writing on {sock},
+//  shut the connection down to end its wait, and let it finish before the
+//  socket is closed, as the descriptor could otherwise be reused under it.
+void NetworkDataStream::ReleaseTxSocket(std::unique_lock<std::mutex> &lock, wxSocketBase *sock)
+{
+    if( !sock || m_tx_sock != sock )
+        return;
+
+#ifdef __WXMSW__
+    shutdown(sock->GetSocket(), SD_BOTH);
+#else
+    shutdown(sock->GetSocket(), SHUT_RDWR);
+#endif
+    m_tx_done.wait(lock, [this, sock]{ return m_tx_sock != sock; });
+}
+
+void NetworkDataStream::OnTxError(wxThreadEvent& event)
+{
+    if(GetProtocol() == TCP)
+        HandleTCPWriteError();
+}
+
+//  Runs on the output thread. wxSocket may only be driven from the GUI thread,
+//  so write on the native descriptor, and leave any error recovery to the GUI.
+bool NetworkDataStream::WriteSentence( const std::string &payload )
+{
+    wxSocketBase *sock;
+    wxSOCKET_T fd;
+    {
+        std::lock_guard<std::mutex> lock(m_tx_mutex);
+
+        sock = (GetProtocol() == UDP) ? GetTSock() : GetSock();
+        if( !sock || !sock->IsOk() )
+            return false;
+        if( GetProtocol() == TCP && !sock->IsConnected() )
+            return false;
+
+        fd = sock->GetSocket();
+        m_tx_sock = sock;
+    }
+
+    //  Unlocked, so a stalled peer cannot hold up the GUI thread
+    const char *p = payload.c_str();
+    size_t left = payload.size();
+
+    while( left ) {
+        //  Bound the wait, so that Close() need not wait long for this thread
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        FD_SET(fd, &wfds);
+        struct timeval tv;
+        tv.tv_sec = 1;
+        tv.tv_usec = 0;
+        if( select(fd + 1, NULL, &wfds, NULL, &tv) <= 0 )
+            break;
+
+        int n;
+        if( GetProtocol() == UDP ) {
+# if wxCHECK_VERSION(3,0,0)
+            const struct sockaddr *to = (const struct sockaddr *) m_addr.GetAddressData();
+            n = sendto(fd, p, left, 0, to, m_addr.GetAddressDataLen());
+# else
+            const struct sockaddr *to = (const struct sockaddr *) m_addr.GetAddress()->m_addr;
+            n = sendto(fd, p, left, 0, to, sizeof(struct sockaddr_in));
+# endif
+        }
+        else
+            n = send(fd, p, left, MSG_NOSIGNAL);
+
+        if( n <= 0 )
+            break;
+        p += n;
+        left -= n;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_tx_mutex);
+        m_tx_sock = NULL;
+    }
+    m_tx_done.notify_all();
+
+    if( left && GetProtocol() == TCP )
+        wxQueueEvent(this, new wxThreadEvent(wxEVT_THREAD, DS_TXERROR_ID));
+
+    return left == 0;
+}
+
 void NetworkDataStream::Close()
 {
     wxLogMessage( wxString::Format(_T("Closing NMEA NetworkDataStream %s"), GetPort().c_str()) );
+
+    //    The output thread writes on our sockets, stop it before they go away
+    StopOutputThread();
+
+    //    Stop the UDP receive thread, it closes its own socket
+    if(m_rx_thread)
+    {
+        if(IsSecThreadActive()) {
+            m_Thread_run_flag = 0;
+            int tms = 2000;
+            while((m_Thread_run_flag >= 0) && (tms > 0)) {
+                wxMilliSleep(10);
+                tms -= 10;
+            }
+        }
+        m_rx_thread = NULL;                     // detached, deletes itself
+
+        NetworkRxStats stats = GetRxStats();
+        wxLogMessage( wxString::Format(_T("    %lu datagrams, %lu sentences, %lu kernel drops"),
+                                       stats.datagrams, stats.sentences, stats.kernel_drops) );
+    }
+
     //    Kill off the TCP Socket if alive
     if(m_sock)
     {
@@ -0,0 +1,151 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Per-connection NMEA output queue and writer thread
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include <chrono>
+
+#include "OCP_DataStreamOutput_Thread.h"
+#include "datastream.h"
+
+#define OUTPUT_POP_TIMEOUT_MS   100
+
+//------------------------------------------------------------------------------
+//    OutputQueue Implementation
+//------------------------------------------------------------------------------
+
+OutputQueue::OutputQueue(size_t depth, OutputOverflowPolicy policy)
+    : m_depth(depth ? depth : OUTPUT_QUEUE_DEFAULT_DEPTH),
+      m_policy(policy)
+{
+}
+
+bool OutputQueue::IsAIS(const std::string &sentence)
+{
+    //  !AIVDM, !AIVDO, !BSVDM ...
+    return sentence.size() > 6 && sentence[0] == '!' &&
+           sentence[3] == 'V' && sentence[4] == 'D';
+}
+
+void OutputQueue::Push(const std::string &sentence)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(m_queue.size() >= m_depth) {
+            std::deque<std::string>::iterator victim = m_queue.begin();
+            if(m_policy == OUTPUT_DROP_AIS_FIRST) {
+                for(std::deque<std::string>::iterator it = m_queue.begin(); it != m_queue.end(); ++it) {
+                    if(IsAIS(*it)) {
+                        victim = it;
+                        break;
+                    }
+                }
+                //  Nothing queued is AIS, and this is: the newcomer goes
+                if(victim == m_queue.begin() && !IsAIS(*victim) && IsAIS(sentence)) {
+                    m_stats.dropped++;
+                    return;
+                }
+            }
+            m_queue.erase(victim);
+            m_stats.dropped++;
+        }
+
+        m_queue.push_back(sentence);
+        if(m_queue.size() > m_stats.max_backlog)
+            m_stats.max_backlog = m_queue.size();
+    }
+    m_cond.notify_one();
+}
+
+bool OutputQueue::Pop(std::string &sentence, int timeout_ms)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(m_queue.empty())
+        m_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms));
+    if(m_queue.empty())
+        return false;
+
+    sentence.swap(m_queue.front());
+    m_queue.pop_front();
+    return true;
+}
+
+void OutputQueue::Wake()
+{
+    m_cond.notify_all();
+}
+
+OutputQueueStats OutputQueue::GetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    OutputQueueStats stats = m_stats;
+    stats.backlog = m_queue.size();
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+//    OCP_DataStreamOutput_Thread Implementation
+//------------------------------------------------------------------------------
+
+OCP_DataStreamOutput_Thread::OCP_DataStreamOutput_Thread(DataStream *stream, OutputQueue *queue)
+    : wxThread(wxTHREAD_JOINABLE),
+      m_stream(stream),
+      m_queue(queue),
+      m_run(true)
+{
+    Create();
+}
+
+OCP_DataStreamOutput_Thread::~OCP_DataStreamOutput_Thread()
+{
+}
+
+void OCP_DataStreamOutput_Thread::Stop()
+{
+    m_run = false;
+    m_queue->Wake();
+    Wait();
+}
+
+void *OCP_DataStreamOutput_Thread::Entry()
+{
+    std::string sentence;
+
+    while(m_run) {
+        if(!m_queue->Pop(sentence, OUTPUT_POP_TIMEOUT_MS))
+            continue;
+
+        if(m_stream->WriteSentence(sentence))
+            m_queue->CountSent();
+        else
+            m_queue->CountFailed();
+    }
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  UDP NMEA receive thread
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             // recvmmsg()
+#endif
+#endif
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include "OCP_NetworkInput_Thread.h"
+#include "NetworkDataStream.h"
+
+#ifdef OCPN_USE_UDP_RX_THREAD
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+extern bool g_benableUDPNullHeader;
+
+#define RX_POLL_TIMEOUT_MS      100
+
+
+int OCP_NetworkInput_Thread::OpenUDPSocket(unsigned short port, unsigned int mcast_addr)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd < 0)
+        return -1;
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#ifdef SO_REUSEPORT
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+#endif
+
+    //  A large kernel buffer rides out bursts while the consumer is busy.
+    //  The kernel may clamp the value (net.core.rmem_max), report what we got.
+    int rcvbuf = UDP_RX_SOCKET_BUFFER;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    socklen_t optlen = sizeof(rcvbuf);
+    if(!getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &optlen))
+        wxLogMessage(wxString::Format(_T("   UDP port %d receive buffer: %d bytes"), port, rcvbuf));
+
+#ifdef SO_RXQ_OVFL
+    //  Ask for the kernel drop counter as ancillary data
+    setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+#endif
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        wxLogMessage(wxString::Format(_T("   UDP port %d bind failed: %s"), port,
+                                      wxString(strerror(errno), wxConvUTF8).c_str()));
+        close(fd);
+        return -1;
+    }
+
+    if((ntohl(mcast_addr) & 0xf0000000) == 0xe0000000) {
+        struct ip_mreq mrq;
+        mrq.imr_multiaddr.s_addr = mcast_addr;
+        mrq.imr_interface.s_addr = INADDR_ANY;
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mrq, sizeof(mrq));
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+
+OCP_NetworkInput_Thread::OCP_NetworkInput_Thread(NetworkDataStream *launcher, int fd)
+    : wxThread(wxTHREAD_DETACHED),
+      m_launcher(launcher),
+      m_fd(fd)
+{
+    m_rx_buf.resize(UDP_RX_BATCH * UDP_RX_DATAGRAM_SIZE);
+    Create();
+}
+
+OCP_NetworkInput_Thread::~OCP_NetworkInput_Thread()
+{
+}
+
+void OCP_NetworkInput_Thread::AddDatagram(const char *data, size_t len)
+{
+    m_stats.datagrams++;
+    m_stats.bytes += len;
+
+    if(!g_benableUDPNullHeader)
+        m_buffer.append(data, strnlen(data, len));
+    else
+        m_buffer.append(data, len);     // Furuno UDP tags carry a 0 before the sentence
+
+    size_t first = m_batch.size();
+    ExtractNMEASentences(m_buffer, m_batch);
+
+    //  Checksum screening as done on the wxSocket path
+    size_t keep = first;
+    for(size_t i = first; i < m_batch.size(); i++) {
+        if(m_launcher->ChecksumOK(m_batch[i])) {
+            if(keep != i)
+                m_batch[keep].swap(m_batch[i]);
+            keep++;
+        }
+    }
+    m_batch.resize(keep);
+}
+
+//  Drain the socket, returns number of datagrams read or -1 on error
+int OCP_NetworkInput_Thread::ReceiveBatch()
+{
+    int total = 0;
+
+#if defined(__linux__) && defined(SO_RXQ_OVFL)
+    struct mmsghdr msgs[UDP_RX_BATCH];
+    struct iovec iovecs[UDP_RX_BATCH];
+    char cbuf[UDP_RX_BATCH][CMSG_SPACE(sizeof(uint32_t))];
+
+    for(;;) {
+        memset(msgs, 0, sizeof(msgs));
+        for(int i = 0; i < UDP_RX_BATCH; i++) {
+            iovecs[i].iov_base = &m_rx_buf[i * UDP_RX_DATAGRAM_SIZE];
+            iovecs[i].iov_len = UDP_RX_DATAGRAM_SIZE - 1;
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = cbuf[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(cbuf[i]);
+        }
+
+        int n = recvmmsg(m_fd, msgs, UDP_RX_BATCH, MSG_DONTWAIT, NULL);
+        if(n < 0)
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? total : -1;
+
+        for(int i = 0; i < n; i++) {
+            AddDatagram(&m_rx_buf[i * UDP_RX_DATAGRAM_SIZE], msgs[i].msg_len);
+
+            //  Cumulative count of datagrams the kernel dropped on this socket
+            for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg;
+                cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+                if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+                    uint32_t drops;
+                    memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+                    m_stats.kernel_drops = drops;
+                }
+            }
+        }
+        total += n;
+        if(n < UDP_RX_BATCH)
+            return total;
+    }
+#else
+    for(int i = 0; i < UDP_RX_BATCH; i++) {
+        ssize_t n = recv(m_fd, &m_rx_buf[0], UDP_RX_DATAGRAM_SIZE - 1, MSG_DONTWAIT);
+        if(n < 0)
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? total : -1;
+        AddDatagram(&m_rx_buf[0], n);
+        total++;
+    }
+    return total;
+#endif
+}
+
+void *OCP_NetworkInput_Thread::Entry()
+{
+    wxStopWatch sw;
+    unsigned long rate_sentences = 0;
+    long rate_start = sw.Time();
+
+    while(m_launcher->m_Thread_run_flag > 0) {
+        if(TestDestroy())
+            break;
+
+        struct pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int pr = poll(&pfd, 1, RX_POLL_TIMEOUT_MS);
+        if(pr > 0 && (pfd.revents & POLLIN)) {
+            if(ReceiveBatch() < 0) {
+                wxLogMessage(wxString::Format(_T("   UDP receive error: %s"),
+                                              wxString(strerror(errno), wxConvUTF8).c_str()));
+                wxThread::Sleep(RX_POLL_TIMEOUT_MS);
+            }
+        }
+
+        //  Carry-over is only partial sentences, bound it against junk input
+        if(m_buffer.size() > RX_BUFFER_SIZE)
+            m_buffer = m_buffer.substr(m_buffer.size() - RX_BUFFER_SIZE);
+
+        m_stats.sentences += m_batch.size();
+
+        long now = sw.Time();
+        if(now - rate_start >= 1000) {
+            m_stats.sentences_per_sec =
+                (m_stats.sentences - rate_sentences) * 1000. / (now - rate_start);
+            rate_sentences = m_stats.sentences;
+            rate_start = now;
+        }
+
+        if(m_batch.size())
+            m_launcher->QueueRxBatch(m_batch, m_stats);     // swaps out m_batch
+        else if(pr == 0)
+            m_launcher->SetRxStats(m_stats);
+    }
+
+    close(m_fd);
+
+    m_launcher->SetSecThreadInActive();             // I am dead
+    m_launcher->m_Thread_run_flag = -1;
+
+    return 0;
+}
+
+#endif  // OCPN_USE_UDP_RX_THREAD
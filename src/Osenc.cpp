@@ -49,10 +49,12 @@
 #include "mygeom.h"
 #include "georef.h"
 #include <mutex>
+#include <algorithm>
 
 extern s57RegistrarMgr          *m_pRegistrarMan;
 extern wxString                 g_csv_locn;
 extern bool                     g_bGDAL_Debug;
+extern int                      g_nCPUCount;
 
 bool chain_broken_mssage_shown = false;
 
@@ -163,6 +165,70 @@ void Osenc_instreamFile::Init()
 }
 
 
+//--------------------------------------------------------------------------
+//      Osenc_instreamMap implementation
+//      A stream over the whole file mapped into memory
+//--------------------------------------------------------------------------
+Osenc_instreamMap::Osenc_instreamMap()
+    : m_pos(0),
+      m_ok(false)
+{
+}
+
+Osenc_instreamMap::~Osenc_instreamMap()
+{
+}
+
+bool Osenc_instreamMap::Open( const wxString &senc_file_name )
+{
+    m_pos = 0;
+    m_ok = m_map.Open(senc_file_name);
+    return m_ok;
+}
+
+void Osenc_instreamMap::Close()
+{
+    m_map.Close();
+    m_pos = 0;
+    m_ok = false;
+}
+
+Osenc_instream &Osenc_instreamMap::Read(void *buffer, size_t size)
+{
+    unsigned char *p = Map(size);
+    if(p)
+        memcpy(buffer, p, size);
+
+    return *this;
+}
+
+unsigned char *Osenc_instreamMap::Map(size_t size)
+{
+    if(!m_ok || size > m_map.GetSize() - m_pos) {
+        m_ok = false;
+        return NULL;
+    }
+
+    unsigned char *p = (unsigned char *)m_map.GetData() + m_pos;
+    m_pos += size;
+    return p;
+}
+
+bool Osenc_instreamMap::IsOk()
+{
+    return m_ok;
+}
+
+bool Osenc_instreamMap::isAvailable()
+{
+    return true;
+}
+
+void Osenc_instreamMap::Shutdown()
+{
+}
+
+
 //--------------------------------------------------------------------------
 //      Osenc_outstreamFile implementation
 //      A simple file stream implementation based on wxFFileOutStream
@@ -211,6 +277,14 @@ bool Osenc_outstreamFile::IsOk()
     return m_ok;
 }
 
+size_t Osenc_outstreamFile::Tell()
+{
+    if(m_outstream)
+        return m_outstream->TellO();
+
+    return 0;
+}
+
 void Osenc_outstreamFile::Init()
 {
     m_outstream = NULL;
@@ -218,6 +292,213 @@ void Osenc_outstreamFile::Init()
 }
 
 
+//--------------------------------------------------------------------------
+//      Osenc_outstreamMem implementation
+//--------------------------------------------------------------------------
+Osenc_outstream &Osenc_outstreamMem::Write(const void *buffer, size_t size)
+{
+    const unsigned char *p = (const unsigned char *)buffer;
+    m_data.insert(m_data.end(), p, p + size);
+
+    return *this;
+}
+
+
+//--------------------------------------------------------------------------
+//      OsencFeatureJob implementation
+//--------------------------------------------------------------------------
+OsencFeatureJob::OsencFeatureJob( OGRFeature *feature )
+    : m_feature(feature),
+      m_poly(NULL),
+      m_ref_lat(0),
+      m_ref_lon(0),
+      m_LOD_meters(0),
+      m_edge_table(NULL),
+      m_nEdgeVectorRecords(0),
+      m_ppg(NULL),
+      m_state(OSENC_TESS_NONE)
+{
+}
+
+OsencFeatureJob::~OsencFeatureJob()
+{
+    delete m_ppg;
+    free( m_edge_table );
+    delete m_feature;
+}
+
+//  Any thread; reads only the feature's polygon
+void OsencFeatureJob::Tessellate()
+{
+    m_ppg = new PolyTessGeo( m_poly, true, m_ref_lat, m_ref_lon, m_LOD_meters );
+}
+
+
+//--------------------------------------------------------------------------
+//      OsencTessPool implementation
+//--------------------------------------------------------------------------
+OsencTessThread::OsencTessThread( OsencTessPool *pool )
+    : wxThread(wxTHREAD_JOINABLE),
+      m_pool(pool)
+{
+    Create();
+}
+
+void *OsencTessThread::Entry()
+{
+    m_pool->WorkerLoop();
+    return 0;
+}
+
+OsencTessPool *OsencTessPool::s_pool = NULL;
+std::once_flag OsencTessPool::s_pool_once;
+
+//  Created on first use, by a build thread or by the SENC thread manager
+//  on the GUI thread, whichever comes first
+OsencTessPool *OsencTessPool::Get()
+{
+    std::call_once(s_pool_once, []{ s_pool = new OsencTessPool(); });
+    return s_pool;
+}
+
+void OsencTessPool::Stop()
+{
+    if(s_pool)
+        s_pool->StopWorkers();
+}
+
+void OsencTessPool::Shutdown()
+{
+    delete s_pool;
+    s_pool = NULL;
+}
+
+OsencTessPool::OsencTessPool()
+    : m_stop(false),
+      m_tess_us(0)
+{
+    int nCPU = wxMax(1, wxThread::GetCPUCount());
+    if(g_nCPUCount > 0)
+        nCPU = g_nCPUCount;
+
+    //  The builds themselves take a core each while reading
+    int nthreads = wxMax(nCPU - 1, 1);
+
+    for(int i = 0; i < nthreads; i++) {
+        OsencTessThread *thread = new OsencTessThread(this);
+        if(thread->Run() != wxTHREAD_NO_ERROR) {
+            delete thread;
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+}
+
+OsencTessPool::~OsencTessPool()
+{
+    StopWorkers();
+}
+
+//  The workers finish the job in hand; those still queued are left to Wait() and Cancel()
+void OsencTessPool::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+
+    for(size_t i = 0; i < m_threads.size(); i++) {
+        m_threads[i]->Wait();
+        delete m_threads[i];
+    }
+    m_threads.clear();
+}
+
+void OsencTessPool::Submit( OsencFeatureJob *job )
+{
+    job->m_state = OSENC_TESS_QUEUED;
+
+    bool b_queued;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        b_queued = !m_stop;
+        if(b_queued)
+            m_queue.push_back(job);
+    }
+
+    if(b_queued)
+        m_cond.notify_one();
+    else
+        Run(job);               // stopped, at exit: no worker will take it
+}
+
+//  Tessellate {job}, taken off the queue
+void OsencTessPool::Run( OsencFeatureJob *job )
+{
+    job->m_state = OSENC_TESS_RUNNING;
+
+    wxStopWatch sw;
+    job->Tessellate();
+    m_tess_us += sw.TimeInMicro().GetValue();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        job->m_state = OSENC_TESS_DONE;
+    }
+    m_done_cond.notify_all();
+}
+
+//  Take {job} off the queue if no worker has yet; else wait for the worker
+bool OsencTessPool::Claim( OsencFeatureJob *job )
+{
+    if(job->m_state == OSENC_TESS_NONE)
+        return false;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::deque<OsencFeatureJob *>::iterator it = std::find(m_queue.begin(), m_queue.end(), job);
+    if(it != m_queue.end()) {
+        m_queue.erase(it);
+        return true;
+    }
+
+    while(job->m_state != OSENC_TESS_DONE)
+        m_done_cond.wait(lock);
+    return false;
+}
+
+void OsencTessPool::Wait( OsencFeatureJob *job )
+{
+    if(Claim(job))
+        Run(job);
+}
+
+void OsencTessPool::Cancel( OsencFeatureJob *job )
+{
+    if(Claim(job))
+        job->m_state = OSENC_TESS_DONE;
+}
+
+void OsencTessPool::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(!m_stop) {
+        if(m_queue.empty()) {
+            m_cond.wait(lock);
+            continue;
+        }
+
+        OsencFeatureJob *job = m_queue.front();
+        m_queue.pop_front();
+
+        lock.unlock();
+        Run(job);
+        lock.lock();
+    }
+}
+
+
 //--------------------------------------------------------------------------
 //      Osenc implementation
 //--------------------------------------------------------------------------
@@ -277,6 +558,7 @@ void Osenc::init( void )
     
     m_ref_lat = 0;
     m_ref_lon = 0;
+    m_attr_arena = NULL;
     
     m_read_base_edtn = _T("-1");
     
@@ -578,7 +860,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
 //     wxBufferedInputStream fpx( fpx_u );
 
     //    Sanity check for existence of file
-    Osenc_instreamFile fpx;
+    //    The file stays mapped while this Osenc lives, for the tables used in place
+    Osenc_instreamMap &fpx = m_senc_map;
     fpx.Open( senc_file_name );
     if (!fpx.IsOk())
         return ERROR_SENCFILE_NOT_FOUND;
@@ -605,18 +888,19 @@ int Osenc::ingest200(const wxString &senc_file_name,
         switch( record.record_type){
             case HEADER_SENC_VERSION:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
-                uint16_t *pint = (uint16_t*)buf;
-                m_senc_file_read_version = *pint;
+                uint16_t val;
+                memcpy(&val, buf, sizeof(uint16_t));
+                m_senc_file_read_version = val;
                 break;
             }
             case HEADER_CELL_NAME:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 m_Name = wxString( buf, wxConvUTF8 );
@@ -624,8 +908,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
             }
             case HEADER_CELL_PUBLISHDATE:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 m_sdate000 = wxString( buf, wxConvUTF8 );
@@ -634,20 +918,21 @@ int Osenc::ingest200(const wxString &senc_file_name,
             
             case HEADER_CELL_EDITION:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
-                uint16_t *pint = (uint16_t*)buf;
-                m_read_base_edtn.Printf(_T("%d"), *pint);
+                uint16_t val;
+                memcpy(&val, buf, sizeof(uint16_t));
+                m_read_base_edtn.Printf(_T("%d"), val);
                 
                 break;
             }
             
             case HEADER_CELL_UPDATEDATE:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 m_LastUpdateDate = wxString( buf, wxConvUTF8 );
@@ -656,31 +941,33 @@ int Osenc::ingest200(const wxString &senc_file_name,
                 
             case HEADER_CELL_UPDATE:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
-                uint16_t *pint = (uint16_t*)buf;
-                m_read_last_applied_update = *pint;
+                uint16_t val;
+                memcpy(&val, buf, sizeof(uint16_t));
+                m_read_last_applied_update = val;
                 
                 break;
             }   
             
             case HEADER_CELL_NATIVESCALE:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
-                uint32_t *pint = (uint32_t*)buf;
-                m_Chart_Scale = *pint;
+                uint32_t val;
+                memcpy(&val, buf, sizeof(uint32_t));
+                m_Chart_Scale = val;
                 break;
             }   
             
             case HEADER_CELL_SENCCREATEDATE:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 break;
@@ -688,8 +975,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
             
             case CELL_EXTENT_RECORD:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 _OSENC_EXTENT_Record_Payload *pPayload = (_OSENC_EXTENT_Record_Payload *)buf;
@@ -708,8 +995,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
             
             case CELL_COVR_RECORD:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 
@@ -718,8 +1005,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
             
             case CELL_NOCOVR_RECORD:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 
@@ -728,8 +1015,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
             
             case FEATURE_ID_RECORD:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 
@@ -756,6 +1043,7 @@ int Osenc::ingest200(const wxString &senc_file_name,
                 if(acronym.length()){
                     obj = new S57Obj(acronym.c_str());
                     obj->Index = featureID;
+                    obj->m_attr_arena = m_attr_arena;
                     
                     pObjectVector->push_back(obj);
                 }
@@ -765,8 +1053,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
                 
             case FEATURE_ATTRIBUTE_RECORD:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 
@@ -840,8 +1128,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
             
             case FEATURE_GEOMETRY_RECORD_POINT:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 
@@ -857,8 +1145,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
 
             case FEATURE_GEOMETRY_RECORD_AREA:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
 
@@ -898,8 +1186,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
 
             case FEATURE_GEOMETRY_RECORD_LINE:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 
@@ -928,8 +1216,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
  
             case FEATURE_GEOMETRY_RECORD_MULTIPOINT:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
 
@@ -957,30 +1245,42 @@ int Osenc::ingest200(const wxString &senc_file_name,
             
             case VECTOR_EDGE_NODE_TABLE_RECORD:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 
                 //  Parse the buffer
                 uint8_t *pRun = (uint8_t *)buf;
                 
+                //  The mapping gives no alignment for the counts, so copy them out
+                
                 // The Feature(Object) count
-                int nCount = *(int *)pRun;
+                int nCount;
+                memcpy(&nCount, pRun, sizeof(int));
                 
                 pRun += sizeof(int);
                 
+                //  The points are used in place if aligned, as from SENC version 201
+                bool b_inplace = ( ((uintptr_t)pRun & (sizeof(float) - 1)) == 0 );
+                
                 for(int i=0 ; i < nCount ; i++ ) {
-                    int featureIndex = *(int*)pRun;
+                    int featureIndex;
+                    memcpy(&featureIndex, pRun, sizeof(int));
                     pRun += sizeof(int);
                     
-                    int pointCount = *(int*)pRun;
+                    int pointCount;
+                    memcpy(&pointCount, pRun, sizeof(int));
                     pRun += sizeof(int);
                     
                     float *pPoints = NULL;
                     if( pointCount ) {
-                        pPoints = (float *) malloc( pointCount * 2 * sizeof(float) );
-                        memcpy(pPoints, pRun, pointCount * 2 * sizeof(float));
+                        if( b_inplace )
+                            pPoints = (float *)pRun;
+                        else {
+                            pPoints = (float *) malloc( pointCount * 2 * sizeof(float) );
+                            memcpy(pPoints, pRun, pointCount * 2 * sizeof(float));
+                        }
                     }
                     pRun += pointCount * 2 * sizeof(float);
                     
@@ -1000,8 +1300,8 @@ int Osenc::ingest200(const wxString &senc_file_name,
 
             case VECTOR_CONNECTED_NODE_TABLE_RECORD:
             {
-                unsigned char *buf = getBuffer( record.record_length - sizeof(OSENC_Record_Base));
-                if(!fpx.Read(buf, record.record_length - sizeof(OSENC_Record_Base)).IsOk()){
+                unsigned char *buf = fpx.Map( record.record_length - sizeof(OSENC_Record_Base));
+                if(!buf){
                     dun = 1; break;
                 }
                 
@@ -1009,15 +1309,24 @@ int Osenc::ingest200(const wxString &senc_file_name,
                 uint8_t *pRun = (uint8_t *)buf;
                 
                 // The Feature(Object) count
-                int nCount = *(int *)pRun;
+                int nCount;
+                memcpy(&nCount, pRun, sizeof(int));
                 pRun += sizeof(int);
                 
+                bool b_inplace = ( ((uintptr_t)pRun & (sizeof(float) - 1)) == 0 );
+                
                 for(int i=0 ; i < nCount ; i++ ) {
-                    int featureIndex = *(int*)pRun;
+                    int featureIndex;
+                    memcpy(&featureIndex, pRun, sizeof(int));
                     pRun += sizeof(int);
                     
-                    float *pPoint = (float *) malloc( 2 * sizeof(float) );
-                    memcpy(pPoint, pRun, 2 * sizeof(float));
+                    float *pPoint;
+                    if( b_inplace )
+                        pPoint = (float *)pRun;
+                    else {
+                        pPoint = (float *) malloc( 2 * sizeof(float) );
+                        memcpy(pPoint, pRun, 2 * sizeof(float));
+                    }
                     pRun += 2 * sizeof(float);
                     
                     VC_Element *pvce = new VC_Element;
@@ -1031,8 +1340,15 @@ int Osenc::ingest200(const wxString &senc_file_name,
                 break;
             }
             
+            case SENC_PADDING_RECORD:
             default:
+            {
+                //  Step over the payload
+                if(!fpx.Map( record.record_length - sizeof(OSENC_Record_Base))){
+                    dun = 1; break;
+                }
                 break;
+            }
                 
         }       // switch
             
@@ -1457,7 +1773,7 @@ int Osenc::createSenc200(const wxString& FullPath000, const wxString& SENCFileNa
 
     m_FullPath000 = FullPath000;
     
-    m_senc_file_create_version = 200;
+    m_senc_file_create_version = 201;
     
     if(!m_poRegistrar){
         m_poRegistrar = new S57ClassRegistrar();
@@ -1668,7 +1984,11 @@ int Osenc::createSenc200(const wxString& FullPath000, const wxString& SENCFileNa
 #endif    
     
     
-    //  Loop in the S57 reader, extracting Features one-by-one
+    //  Loop in the S57 reader, extracting Features one-by-one.
+    //  Their records are encoded here, in order and under the lock, while the
+    //  pool tessellates their areas; each is written once those before it are.
+    OsencTessPool *pool = OsencTessPool::Get();
+    std::deque<OsencFeatureJob *> pipeline;
     OGRFeature *objectDef;
     
     int iObj = 0;
@@ -1712,15 +2032,39 @@ int Osenc::createSenc200(const wxString& FullPath000, const wxString& SENCFileNa
             
             //      n.b  This next line causes skip of C_AGGR features w/o geometry
                 if( geoType != wkbUnknown ){                             // Write only if has wkbGeometry
-                    CreateSENCRecord200( objectDef, stream, 1, poReader );
+                    OsencFeatureJob *job = new OsencFeatureJob( objectDef );
+                    CreateSENCRecord200( job, 1, poReader );
+                    if( job->m_poly )
+                        pool->Submit( job );
+                    pipeline.push_back( job );
+                }
+                else
+                    delete objectDef;
+
+                //  Write what is ready, waiting only when too far ahead
+                while( pipeline.size() ){
+                    int state = pipeline.front()->m_state;
+                    if( pipeline.size() < OSENC_PIPELINE_DEPTH && state != OSENC_TESS_NONE && state != OSENC_TESS_DONE )
+                        break;
+                    WriteFeatureJob( pipeline.front(), stream );
+                    delete pipeline.front();
+                    pipeline.pop_front();
                 }
-                
-                delete objectDef;
                 
         } else
             break;
         
     }
+
+    //  The features still on their way
+    while( pipeline.size() ){
+        if( bcont )
+            WriteFeatureJob( pipeline.front(), stream );
+        else
+            pool->Cancel( pipeline.front() );
+        delete pipeline.front();
+        pipeline.pop_front();
+    }
     
     if( bcont ) {
         //      Create and write the Vector Edge Table
@@ -2247,27 +2591,34 @@ bool Osenc::CreateLineFeatureGeometryRecord200( S57Reader *poReader, OGRFeature
 
 
 
-bool Osenc::CreateAreaFeatureGeometryRecord200(S57Reader *poReader, OGRFeature *pFeature, Osenc_outstream *stream)
+//      Prepare the area geometry of a feature for tessellation on the pool.
+//      The edge vector index table needs the reader, so is made now.
+bool Osenc::QueueAreaFeatureGeometryRecord200( S57Reader *poReader, OsencFeatureJob *job )
 {
-    int error_code;
-    
-    PolyTessGeo *ppg = NULL;
-    
-    OGRGeometry *pGeo = pFeature->GetGeometryRef();
+    OGRGeometry *pGeo = job->m_feature->GetGeometryRef();
     OGRPolygon *poly = (OGRPolygon *) ( pGeo );
     
     if( !poly->getExteriorRing() )
         return false;
     
-    lockCR.unlock();
-    ppg = new PolyTessGeo( poly, true, m_ref_lat, m_ref_lon, m_LOD_meters );
-    lockCR.lock();
+    job->m_edge_table = getObjectVectorIndexTable( poReader, job->m_feature, job->m_nEdgeVectorRecords );
+
+    job->m_poly = poly;
+    job->m_ref_lat = m_ref_lat;
+    job->m_ref_lon = m_ref_lon;
+    job->m_LOD_meters = m_LOD_meters;
+
+    return true;
+}
+
+bool Osenc::WriteAreaFeatureGeometryRecord200( OsencFeatureJob *job, Osenc_outstream *stream )
+{
+    PolyTessGeo *ppg = job->m_ppg;
    
-    error_code = ppg->ErrorCode;
+    int error_code = ppg->ErrorCode;
     
     if( error_code ){
         wxLogMessage( _T("   Warning: S57 SENC Geometry Error %d, Some Features ignored."), ppg->ErrorCode );
-        delete ppg;
         
         return false;
     }
@@ -2331,8 +2682,8 @@ bool Osenc::CreateAreaFeatureGeometryRecord200(S57Reader *poReader, OGRFeature *
     baseRecord.triprim_count = n_TriPrims;                            //  Set the number of TriPrims
     
  
-    int nEdgeVectorRecords = 0;
-    unsigned char *pvec_buffer = getObjectVectorIndexTable( poReader, pFeature, nEdgeVectorRecords );
+    int nEdgeVectorRecords = job->m_nEdgeVectorRecords;
+    unsigned char *pvec_buffer = job->m_edge_table;
     
 #if 0    
      //  Create the Vector Edge Index table into a memory buffer
@@ -2483,13 +2834,32 @@ bool Osenc::CreateAreaFeatureGeometryRecord200(S57Reader *poReader, OGRFeature *
         return false;
     
     
-    delete ppg;
     free(contourPointCountArray);
-    free( pvec_buffer );
     
     return true;
 }
 
+//      Write the records of a feature to the SENC, once its area is tessellated.
+//      While waiting on the pool the lock is released, for other builds to read.
+bool Osenc::WriteFeatureJob( OsencFeatureJob *job, Osenc_outstream *stream )
+{
+    if( job->m_state != OSENC_TESS_NONE && job->m_state != OSENC_TESS_DONE ){
+        lockCR.unlock();
+        OsencTessPool::Get()->Wait( job );
+        lockCR.lock();
+    }
+
+    if( job->m_records.GetSize() ){
+        if(!stream->Write(job->m_records.GetData(), job->m_records.GetSize()).IsOk())
+            return false;
+    }
+
+    if( job->m_ppg )
+        return WriteAreaFeatureGeometryRecord200( job, stream );
+
+    return true;
+}
+
 unsigned char *Osenc::getObjectVectorIndexTable( S57Reader *poReader, OGRFeature *pFeature, int &nEntries )
 {
     //  Create the Vector Edge Index table into a memory buffer
@@ -2711,6 +3081,9 @@ void Osenc::CreateSENCVectorEdgeTableRecord200( Osenc_outstream *stream, S57Read
         //  Now write the record out
         OSENC_VET_Record record;
         
+        //  Align the points, for the reader to use them in place
+        WritePaddingRecord200( stream, sizeof(OSENC_VET_Record_Base) + sizeof(uint32_t) );
+        
         record.record_type = VECTOR_EDGE_NODE_TABLE_RECORD;
         record.record_length = sizeof(OSENC_VET_Record_Base) + payloadSize + sizeof(uint32_t);
 
@@ -2736,6 +3109,27 @@ void Osenc::CreateSENCVectorEdgeTableRecord200( Osenc_outstream *stream, S57Read
 }
 
 
+//      Pad the stream so that a table record written next, its entries
+//      {table_offset} bytes into the record, has them aligned in the file
+bool Osenc::WritePaddingRecord200( Osenc_outstream *stream, size_t table_offset )
+{
+    size_t pos = stream->Tell() + sizeof(OSENC_Record_Base) + table_offset;
+    size_t pad = ( OSENC_TABLE_ALIGNMENT - pos % OSENC_TABLE_ALIGNMENT ) % OSENC_TABLE_ALIGNMENT;
+    
+    OSENC_Record_Base record;
+    record.record_type = SENC_PADDING_RECORD;
+    record.record_length = sizeof(OSENC_Record_Base) + pad;
+    if(!stream->Write(&record, sizeof(OSENC_Record_Base)).IsOk())
+        return false;
+    
+    unsigned char zero[OSENC_TABLE_ALIGNMENT] = { 0 };
+    if(pad && !stream->Write(zero, pad).IsOk())
+        return false;
+    
+    return true;
+}
+
+
 void Osenc::CreateSENCVectorConnectedTableRecord200( Osenc_outstream *stream, S57Reader *poReader )
 {
     //  We create the payload first, so we can calculate the total record length
@@ -2809,6 +3203,8 @@ void Osenc::CreateSENCVectorConnectedTableRecord200( Osenc_outstream *stream, S5
     if(featureCount){
         OSENC_VCT_Record record;
     
+        WritePaddingRecord200( stream, sizeof(OSENC_VCT_Record_Base) + sizeof(uint32_t) );
+        
         record.record_type = VECTOR_CONNECTED_NODE_TABLE_RECORD;
         record.record_length = sizeof(OSENC_VCT_Record_Base) + payloadSize + sizeof(int);
         
@@ -2835,8 +3231,13 @@ void Osenc::CreateSENCVectorConnectedTableRecord200( Osenc_outstream *stream, S5
 
 
 
-bool Osenc::CreateSENCRecord200( OGRFeature *pFeature, Osenc_outstream *stream, int mode, S57Reader *poReader )
+//      Encode the records of a feature, all but its area geometry record,
+//      which waits for the tessellation of the area
+bool Osenc::CreateSENCRecord200( OsencFeatureJob *job, int mode, S57Reader *poReader )
 {
+    OGRFeature *pFeature = job->m_feature;
+    Osenc_outstream *stream = &job->m_records;
+
     //TODO
 //    if(pFeature->GetFID() == 207)
 //        int yyp = 4;
@@ -3231,7 +3632,7 @@ bool Osenc::CreateSENCRecord200( OGRFeature *pFeature, Osenc_outstream *stream,
                 //      Special case, polygons are handled separately
                 case wkbPolygon: {
                     
-                     if( !CreateAreaFeatureGeometryRecord200(poReader, pFeature, stream) )
+                     if( !QueueAreaFeatureGeometryRecord200(poReader, job) )
                          return false;
                    
                     break;
@@ -3282,9 +3683,8 @@ PolyTessGeo *Osenc::BuildPolyTessGeo(_OSENC_AreaGeometry_Record_Payload *record,
     
     //  The point count array is the first element in the payload, length is known
     int *contour_pointcount_array_run = (int*)payLoad;
-    for(int i=0 ; i < nContours ; i++){
-        *pctr++ = *contour_pointcount_array_run++;
-    }
+    memcpy(pctr, contour_pointcount_array_run, nContours * sizeof(int));
+    contour_pointcount_array_run += nContours;
     
 
     //  Read Raw Geometry
@@ -3305,7 +3705,9 @@ PolyTessGeo *Osenc::BuildPolyTessGeo(_OSENC_AreaGeometry_Record_Payload *record,
         
     for(unsigned int i=0 ; i < n_TriPrim ; i++){
         tri_type = *pPayloadRun++;
-        nvert = *(uint32_t *)pPayloadRun;
+        uint32_t nvert_read;
+        memcpy(&nvert_read, pPayloadRun, sizeof(uint32_t));
+        nvert = nvert_read;
         pPayloadRun += sizeof(uint32_t);
         
   
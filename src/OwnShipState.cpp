@@ -0,0 +1,105 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Own-ship navigation state publication
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include <math.h>
+
+#include "OwnShipState.h"
+
+OwnShipFix::OwnShipFix()
+    : lat(NAN), lon(NAN), cog(NAN), sog(NAN), hdt(NAN), hdm(NAN), var(NAN),
+      n_sats(0), fix_time(0), timestamp_ms(0), flags(0), sequence(0)
+{
+}
+
+OwnShipState::OwnShipState()
+    : m_seq(0),
+      m_lat(NAN), m_lon(NAN), m_cog(NAN), m_sog(NAN),
+      m_hdt(NAN), m_hdm(NAN), m_var(NAN),
+      m_n_sats(0), m_fix_time(0), m_timestamp_ms(0), m_flags(0)
+{
+}
+
+void OwnShipState::Publish(const OwnShipFix &fix)
+{
+    unsigned long seq = m_seq.load(std::memory_order_relaxed);
+
+    m_seq.store(seq + 1, std::memory_order_relaxed);            // odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_lat.store(fix.lat, std::memory_order_relaxed);
+    m_lon.store(fix.lon, std::memory_order_relaxed);
+    m_cog.store(fix.cog, std::memory_order_relaxed);
+    m_sog.store(fix.sog, std::memory_order_relaxed);
+    m_hdt.store(fix.hdt, std::memory_order_relaxed);
+    m_hdm.store(fix.hdm, std::memory_order_relaxed);
+    m_var.store(fix.var, std::memory_order_relaxed);
+    m_n_sats.store(fix.n_sats, std::memory_order_relaxed);
+    m_fix_time.store(fix.fix_time, std::memory_order_relaxed);
+    m_timestamp_ms.store(wxGetUTCTimeMillis().GetValue(), std::memory_order_relaxed);
+    m_flags.store(fix.flags, std::memory_order_relaxed);
+
+    m_seq.store(seq + 2, std::memory_order_release);
+}
+
+OwnShipFix OwnShipState::Get() const
+{
+    OwnShipFix fix;
+
+    for(;;) {
+        unsigned long seq = m_seq.load(std::memory_order_acquire);
+        if(seq & 1) {
+            wxThread::Yield();                  // publisher is mid-write, a few stores at most
+            continue;
+        }
+
+        fix.lat = m_lat.load(std::memory_order_relaxed);
+        fix.lon = m_lon.load(std::memory_order_relaxed);
+        fix.cog = m_cog.load(std::memory_order_relaxed);
+        fix.sog = m_sog.load(std::memory_order_relaxed);
+        fix.hdt = m_hdt.load(std::memory_order_relaxed);
+        fix.hdm = m_hdm.load(std::memory_order_relaxed);
+        fix.var = m_var.load(std::memory_order_relaxed);
+        fix.n_sats = m_n_sats.load(std::memory_order_relaxed);
+        fix.fix_time = (time_t)m_fix_time.load(std::memory_order_relaxed);
+        fix.timestamp_ms = m_timestamp_ms.load(std::memory_order_relaxed);
+        fix.flags = m_flags.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(m_seq.load(std::memory_order_relaxed) == seq) {
+            fix.sequence = seq / 2;
+            return fix;
+        }
+    }
+}
+
+unsigned long OwnShipState::GetSequence() const
+{
+    return m_seq.load(std::memory_order_acquire) / 2;
+}
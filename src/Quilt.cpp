@@ -31,6 +31,8 @@
 #include "chcanv.h"
 #include "ocpn_pixel.h"                         // for ocpnUSE_DIBSECTION
 #include "chartimg.h"
+#include "georef.h"
+#include "OwnShipState.h"
 
 #include <algorithm>
 
@@ -48,6 +50,8 @@ extern int g_chart_zoom_modifier_vector;
 extern bool g_fog_overzoom;
 extern double  g_overzoom_emphasis_base;
 extern bool g_bopengl;
+extern bool g_bAsyncChartOpen;
+extern OwnShipState g_OwnShipState;
 
 //      We define and use this one Macro in this module
 //      Reason:  some compilers refuse to inline "GetChartTableEntry()"
@@ -67,6 +71,12 @@ extern bool g_bopengl;
 #define NOCOVR_PLY_PERF_LIMIT 500
 #define AUX_PLY_PERF_LIMIT 500
 
+//  Background prefetch of the charts ahead of the view
+#define QUILT_PREFETCH_CHARTS       2       // per look-ahead position
+#define QUILT_PREFETCH_SCALE_RANGE  4       // down to this many times smaller than the reference scale
+#define QUILT_PREFETCH_MINUTES      10.     // of own ship travel
+#define QUILT_PREFETCH_MIN_SOG      0.5     // knots
+
 
 static int CompareScales( int i1, int i2 )
 {
@@ -1250,18 +1260,19 @@ bool Quilt::BuildExtendedChartStackAndCandidateArray(int ref_db_index, ViewPort
     //    which intersect the ViewPort in any way
     //    .AND. other requirements.
     //    Again, skipping cm93 for now
-    int n_all_charts = ChartData->GetChartTableEntries();
-
     LLBBox viewbox = vp_local.GetBBox();
     int sure_index = -1;
     int sure_index_scale = 0;
 
-    for( int i = 0; i < n_all_charts; i++ ) {
+    //    The spatial index yields the charts of the group whose box may touch the viewport
+    std::vector<int> box_candidates;
+    ChartData->GetChartsInBox( viewbox, m_parent->m_groupIndex, box_candidates );
+
+    for( size_t ic = 0; ic < box_candidates.size(); ic++ ) {
         //    We can eliminate some charts immediately
         //    Try to make these tests in some sensible order....
 
-        int groupIndex = m_parent->m_groupIndex;
-        if( ( groupIndex > 0 ) && ( !ChartData->IsChartInGroup( i, groupIndex ) ) ) continue;
+        int i = box_candidates[ic];
         
         const ChartTableEntry &cte = ChartData->GetChartTableEntry( i );
 
@@ -1738,6 +1749,8 @@ bool Quilt::Compose( const ViewPort &vp_in )
 
                         if( vpu_region.Empty() )
                             pqc->b_include = false; // skip this chart, no true overlap
+                        else if( IsCandidatePending( pqc ) )
+                            pqc->b_include = false; // skip this chart until it is open, smaller scale charts fill in
                         else {
                             pqc->b_include = true;
                             vp_region.Subtract( chart_region );          // adding this chart
@@ -1817,7 +1830,7 @@ bool Quilt::Compose( const ViewPort &vp_in )
     for( ir = 0; ir < m_pcandidate_array->GetCount(); ir++ ) {
         QuiltCandidate *pqc = m_pcandidate_array->Item( ir );
 
-        if( !pqc->b_include ) {
+        if( !pqc->b_include && !pqc->b_pending ) {
             const ChartTableEntry &cte = ChartData->GetChartTableEntry( pqc->dbIndex );
             if( cte.Scale_ge( m_reference_scale) && (cte.GetChartType() != CHART_TYPE_MBTILES) ) {
                 m_eclipsed_stack_array.push_back( pqc->dbIndex );
@@ -2314,6 +2327,8 @@ bool Quilt::Compose( const ViewPort &vp_in )
 
     m_bcomposed = true;
 
+    PrefetchCharts( vp_local );
+
     m_vp_quilt = vp_in;                 // save the corresponding ViewPort locally
 
     ChartData->LockCache();
@@ -2333,6 +2348,80 @@ bool Quilt::Compose( const ViewPort &vp_in )
 
 
 
+//      A candidate chart not yet in the cache is handed to the background opener and
+//      left out of this composition, the quilt is composed again once it is open
+bool Quilt::IsCandidatePending( QuiltCandidate *pqc )
+{
+    pqc->b_pending = g_bAsyncChartOpen && ChartData->RequestChart( pqc->dbIndex );
+    return pqc->b_pending;
+}
+
+//      Queue background opens of the charts the view is likely to need next:
+//      a screen ahead in the pan direction, and ahead of own ship while it is in view
+void Quilt::PrefetchCharts( ViewPort &vp )
+{
+    if( !g_bAsyncChartOpen || ( m_refchart_dbIndex < 0 ) )
+        return;
+
+    ChartData->ClearChartPrefetch();
+
+    const LLBBox &box = vp.GetBBox();
+    double lat_span = box.GetMaxLat() - box.GetMinLat();
+    double lon_span = box.GetMaxLon() - box.GetMinLon();
+    if( ( lat_span <= 0. ) || ( lon_span <= 0. ) )
+        return;
+
+    //  Panning at a constant scale
+    if( m_vp_quilt.IsValid() && ( m_vp_quilt.view_scale_ppm == vp.view_scale_ppm ) ) {
+        double dlat = vp.clat - m_vp_quilt.clat;
+        double dlon = vp.clon - m_vp_quilt.clon;
+        if( dlon > 180. ) dlon -= 360.;
+        else if( dlon < -180. ) dlon += 360.;
+
+        //  Fraction of a screen moved, a jump of a screen or more is not a pan
+        double moved = wxMax( fabs( dlat ) / lat_span, fabs( dlon ) / lon_span );
+        if( ( moved > 0. ) && ( moved < 1. ) )
+            PrefetchChartsAt( vp.clat + dlat / moved, vp.clon + dlon / moved );
+    }
+
+    //  Underway, as far as the ship goes in QUILT_PREFETCH_MINUTES, but no more than a screen
+    OwnShipFix fix = g_OwnShipState.Get();
+    if( fix.IsPosValid() && ( fix.flags & OWNSHIP_COG_VALID ) && ( fix.flags & OWNSHIP_SOG_VALID ) &&
+        ( fix.sog > QUILT_PREFETCH_MIN_SOG ) && box.Contains( fix.lat, fix.lon ) ) {
+        double dist = wxMin( fix.sog * QUILT_PREFETCH_MINUTES / 60., lat_span * 60. );     // NMi
+        double lat, lon;
+        ll_gc_ll( fix.lat, fix.lon, fix.cog, dist, &lat, &lon );
+        PrefetchChartsAt( lat, lon );
+    }
+}
+
+void Quilt::PrefetchChartsAt( double lat, double lon )
+{
+    if( lon > 180. ) lon -= 360.;
+    else if( lon < -180. ) lon += 360.;
+
+    std::vector<int> charts;
+    ChartData->GetChartsAtPosition( lat, lon, m_parent->m_groupIndex, charts );
+
+    //  The charts a quilt there would draw: of the reference family,
+    //  from the reference scale to a few times smaller, largest scale first
+    std::vector< std::pair<int, int> > scale_index;
+    for( size_t i = 0; i < charts.size(); i++ ) {
+        const ChartTableEntry &cte = ChartData->GetChartTableEntry( charts[i] );
+        if( cte.GetChartFamily() != m_reference_family )
+            continue;
+        if( !cte.Scale_ge( m_reference_scale ) || ( cte.GetScale() > m_reference_scale * QUILT_PREFETCH_SCALE_RANGE ) )
+            continue;
+        scale_index.push_back( std::make_pair( cte.GetScale(), charts[i] ) );
+    }
+
+    std::sort( scale_index.begin(), scale_index.end() );
+
+    for( size_t i = 0; i < scale_index.size() && i < QUILT_PREFETCH_CHARTS; i++ )
+        ChartData->RequestChart( scale_index[i].second, true );
+}
+
+
 //      Compute and update the member quilt render region, considering all scale factors, group exclusions, etc.
 void Quilt::ComputeRenderRegion( ViewPort &vp, OCPNRegion &chart_region )
 {
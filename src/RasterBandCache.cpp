@@ -0,0 +1,166 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Shared cache of decoded raster chart bands
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include "RasterBandCache.h"
+#include "lz4.h"
+
+RasterBandCache::RasterBandCache()
+    : m_next_id(0),
+      m_bytes(0),
+      m_raw_bytes(0),
+      m_budget(0),
+      m_hits(0),
+      m_misses(0),
+      m_evictions(0)
+{
+}
+
+void RasterBandCache::SetBudget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    EvictToBudget();
+}
+
+int RasterBandCache::GetChartId(const wxString &path, uint64_t file_size, time_t mtime)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::map<wxString, ChartStamp>::iterator it = m_charts.find(path);
+    if(it != m_charts.end() && it->second.file_size == file_size && it->second.mtime == mtime)
+        return it->second.id;
+
+    ChartStamp stamp;
+    stamp.id = ++m_next_id;
+    stamp.file_size = file_size;
+    stamp.mtime = mtime;
+    m_charts[path] = stamp;
+
+    return stamp.id;
+}
+
+bool RasterBandCache::Fetch(int chart_id, int band, unsigned char *dest, int size)
+{
+    Block block;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_budget)
+            return false;
+
+        std::unordered_map<uint64_t, std::list<Entry>::iterator>::iterator it = m_map.find(Key(chart_id, band));
+        if(it == m_map.end() || it->second->raw_size != size) {
+            m_misses++;
+            return false;
+        }
+
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        block = it->second->data;
+        m_hits++;
+    }
+
+    //  The block stays alive while we hold it, even if evicted meanwhile
+    int n = LZ4_decompress_safe(&(*block)[0], (char *)dest, (int)block->size(), size);
+    return n == size;
+}
+
+void RasterBandCache::Store(int chart_id, int band, const unsigned char *src, int size)
+{
+    if(!m_budget || size <= 0)
+        return;
+
+    Block block = std::make_shared< std::vector<char> >(LZ4_compressBound(size));
+    int n = LZ4_compress((const char *)src, &(*block)[0], size);
+    if(n <= 0)
+        return;
+    block->resize(n);
+    block->shrink_to_fit();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint64_t key = Key(chart_id, band);
+    std::unordered_map<uint64_t, std::list<Entry>::iterator>::iterator it = m_map.find(key);
+    if(it != m_map.end()) {
+        //  Decoded twice, by two charts open on the same file
+        m_bytes -= it->second->data->size();
+        m_raw_bytes -= it->second->raw_size;
+        m_lru.erase(it->second);
+        m_map.erase(it);
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.data = block;
+    entry.raw_size = size;
+    m_lru.push_front(entry);
+    m_map[key] = m_lru.begin();
+
+    m_bytes += n;
+    m_raw_bytes += size;
+    EvictToBudget();
+}
+
+//  Under the lock
+void RasterBandCache::EvictToBudget()
+{
+    while(m_lru.size() && m_bytes > m_budget) {
+        Entry &entry = m_lru.back();
+        m_bytes -= entry.data->size();
+        m_raw_bytes -= entry.raw_size;
+        m_map.erase(entry.key);
+        m_lru.pop_back();
+        m_evictions++;
+    }
+}
+
+RasterBandCacheStats RasterBandCache::GetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    RasterBandCacheStats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.evictions = m_evictions;
+    stats.count = m_lru.size();
+    stats.bytes = m_bytes;
+    stats.raw_bytes = m_raw_bytes;
+    stats.budget = m_budget;
+    return stats;
+}
+
+void RasterBandCache::LogStats()
+{
+    RasterBandCacheStats stats = GetStats();
+    if(!stats.budget)
+        return;
+
+    wxLogMessage(_T("RasterBandCache: %d bands, %lu kB (%lu kB decoded) of %lu kB, hits %lu, misses %lu, evictions %lu"),
+                 stats.count, (unsigned long)(stats.bytes / 1024), (unsigned long)(stats.raw_bytes / 1024),
+                 (unsigned long)(stats.budget / 1024), stats.hits, stats.misses, stats.evictions);
+}
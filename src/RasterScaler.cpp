@@ -0,0 +1,222 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Raster chart downsampling primitives
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "RasterScaler.h"
+
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RASTER_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+//  Rows summed in 16 bit lanes before they are widened: 257 * 255 < 65536
+#define SUM16_MAX_ROWS      257
+
+typedef void (*SumRowsFn)(const unsigned char *, size_t, int, int, unsigned int *);
+
+static void SumRowsScalar(const unsigned char *src, size_t stride, int nrows, int nbytes, unsigned int *sums)
+{
+    for(int i = 0; i < nbytes; i++)
+        sums[i] = 0;
+
+    for(int r = 0; r < nrows; r++) {
+        const unsigned char *row = src + r * stride;
+        for(int i = 0; i < nbytes; i++)
+            sums[i] += row[i];
+    }
+}
+
+#ifdef RASTER_SSE2
+static void SumRowsSSE2(const unsigned char *src, size_t stride, int nrows, int nbytes, unsigned int *sums)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for( ; i + 16 <= nbytes; i += 16) {
+        __m128i s0 = zero, s1 = zero, s2 = zero, s3 = zero;
+
+        for(int r0 = 0; r0 < nrows; r0 += SUM16_MAX_ROWS) {
+            int r1 = r0 + SUM16_MAX_ROWS < nrows ? r0 + SUM16_MAX_ROWS : nrows;
+            __m128i lo = zero, hi = zero;
+
+            for(int r = r0; r < r1; r++) {
+                __m128i v = _mm_loadu_si128((const __m128i *)(src + r * stride + i));
+                lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(v, zero));
+                hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(v, zero));
+            }
+
+            s0 = _mm_add_epi32(s0, _mm_unpacklo_epi16(lo, zero));
+            s1 = _mm_add_epi32(s1, _mm_unpackhi_epi16(lo, zero));
+            s2 = _mm_add_epi32(s2, _mm_unpacklo_epi16(hi, zero));
+            s3 = _mm_add_epi32(s3, _mm_unpackhi_epi16(hi, zero));
+        }
+
+        _mm_storeu_si128((__m128i *)(sums + i), s0);
+        _mm_storeu_si128((__m128i *)(sums + i + 4), s1);
+        _mm_storeu_si128((__m128i *)(sums + i + 8), s2);
+        _mm_storeu_si128((__m128i *)(sums + i + 12), s3);
+    }
+
+    if(i < nbytes)
+        SumRowsScalar(src + i, stride, nrows, nbytes - i, sums + i);
+}
+#endif
+
+#ifdef RASTER_AVX2_DISPATCH
+__attribute__((target("avx2")))
+static void SumRowsAVX2(const unsigned char *src, size_t stride, int nrows, int nbytes, unsigned int *sums)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+
+    for( ; i + 32 <= nbytes; i += 32) {
+        __m256i s0 = zero, s1 = zero, s2 = zero, s3 = zero;
+
+        for(int r0 = 0; r0 < nrows; r0 += SUM16_MAX_ROWS) {
+            int r1 = r0 + SUM16_MAX_ROWS < nrows ? r0 + SUM16_MAX_ROWS : nrows;
+            __m256i lo = zero, hi = zero;
+
+            //  Widening loads keep the bytes in order, unlike the in-lane unpacks
+            for(int r = r0; r < r1; r++) {
+                const unsigned char *p = src + r * stride + i;
+                lo = _mm256_add_epi16(lo, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p)));
+                hi = _mm256_add_epi16(hi, _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p + 16))));
+            }
+
+            s0 = _mm256_add_epi32(s0, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(lo)));
+            s1 = _mm256_add_epi32(s1, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(lo, 1)));
+            s2 = _mm256_add_epi32(s2, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(hi)));
+            s3 = _mm256_add_epi32(s3, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(hi, 1)));
+        }
+
+        _mm256_storeu_si256((__m256i *)(sums + i), s0);
+        _mm256_storeu_si256((__m256i *)(sums + i + 8), s1);
+        _mm256_storeu_si256((__m256i *)(sums + i + 16), s2);
+        _mm256_storeu_si256((__m256i *)(sums + i + 24), s3);
+    }
+
+    if(i < nbytes) {
+#ifdef RASTER_SSE2
+        SumRowsSSE2(src + i, stride, nrows, nbytes - i, sums + i);
+#else
+        SumRowsScalar(src + i, stride, nrows, nbytes - i, sums + i);
+#endif
+    }
+}
+#endif
+
+static const char *s_isa = "C";
+
+static SumRowsFn SelectSumRows()
+{
+#ifdef RASTER_AVX2_DISPATCH
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        s_isa = "AVX2";
+        return SumRowsAVX2;
+    }
+#endif
+#ifdef RASTER_SSE2
+    s_isa = "SSE2";
+    return SumRowsSSE2;
+#else
+    return SumRowsScalar;
+#endif
+}
+
+static SumRowsFn GetSumRows()
+{
+    static SumRowsFn fn = SelectSumRows();
+    return fn;
+}
+
+void RasterSumRows(const unsigned char *src, size_t stride, int nrows, int nbytes, unsigned int *sums)
+{
+    GetSumRows()(src, stride, nrows, nbytes, sums);
+}
+
+const char *RasterScalerISA()
+{
+    GetSumRows();
+    return s_isa;
+}
+
+void RasterBoxFilterRow(unsigned int *sums, int ncols, int pix_bytes, double factor, int box,
+                        int nout, unsigned char *dest)
+{
+    if(ncols <= 0 || box <= 0)
+        return;
+
+    //  Running sums along the row, so that any run of columns costs one subtraction.
+    //  They may wrap, the difference over a box is still exact.
+    for(int c = 1; c < ncols; c++) {
+        unsigned int *p = sums + c * pix_bytes;
+        p[0] += p[0 - pix_bytes];
+        p[1] += p[1 - pix_bytes];
+        p[2] += p[2 - pix_bytes];
+    }
+
+    //  Division by the pixel count of a full box as a multiply:
+    //  exact for sums up to 255 * n while 255 * n * n < 2^40
+    const unsigned int n_full = (unsigned int)box * box;
+    const bool b_recip = box <= 256;
+    const uint64_t recip = b_recip ? (((uint64_t)1 << 40) + n_full - 1) / n_full : 0;
+
+    for(int x = 0; x < nout; x++) {
+        int c0 = (int)(x * factor);
+        if(c0 > ncols - 1)
+            c0 = ncols - 1;
+        int c1 = c0 + box;
+        if(c1 > ncols)
+            c1 = ncols;
+
+        const unsigned int *hi = sums + (c1 - 1) * pix_bytes;
+        unsigned int r = hi[0], g = hi[1], b = hi[2];
+        if(c0 > 0) {
+            const unsigned int *lo = sums + (c0 - 1) * pix_bytes;
+            r -= lo[0];
+            g -= lo[1];
+            b -= lo[2];
+        }
+
+        unsigned int n = (unsigned int)(c1 - c0) * box;
+        if(n == n_full && b_recip) {
+            dest[0] = (unsigned char)((r * recip) >> 40);
+            dest[1] = (unsigned char)((g * recip) >> 40);
+            dest[2] = (unsigned char)((b * recip) >> 40);
+        }
+        else {
+            dest[0] = (unsigned char)(r / n);
+            dest[1] = (unsigned char)(g / n);
+            dest[2] = (unsigned char)(b / n);
+        }
+        dest += pix_bytes;
+    }
+}
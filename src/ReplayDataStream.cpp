@@ -0,0 +1,276 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  DataStream replaying a capture log
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include <wx/time.h>
+
+#include "ReplayDataStream.h"
+#include "OCPN_DataStreamEvent.h"
+#include "OCPN_SignalKEvent.h"
+
+//  Longest single sleep, so that stop, seek and speed requests are honoured promptly
+#define REPLAY_MAX_SLEEP_MS     100
+
+//  In unthrottled mode, yield to the consumer after this many records
+#define REPLAY_UNTHROTTLED_BATCH 256
+
+//------------------------------------------------------------------------------
+//    ReplayDataStream Implementation
+//------------------------------------------------------------------------------
+
+ReplayDataStream::ReplayDataStream(wxEvtHandler *input_consumer, const wxString &path,
+                                   double speed)
+    : DataStream(input_consumer, NETWORK, _T("Replay:") + path, _T("0"),
+                 DS_TYPE_INPUT, 0, false, DS_EOS_CRLF, DS_HANDSHAKE_NONE),
+      m_thread(NULL),
+      m_speed(speed < 0. ? 0. : speed),
+      m_speed_changed(false),
+      m_seek_pending(false),
+      m_seek_ts(0),
+      m_log_start(0),
+      m_log_end(0)
+{
+    Open(path);
+}
+
+ReplayDataStream::~ReplayDataStream()
+{
+    Close();
+}
+
+void ReplayDataStream::Open(const wxString &path)
+{
+    m_thread = new ReplayThread(this, GetConsumer(), std::string(path.mb_str()));
+    SetThreadRunFlag(1);
+    SetSecThreadActive();       // before Run(), so that an early Close() waits for the thread
+    if(m_thread->Run() != wxTHREAD_NO_ERROR) {
+        wxLogMessage(_T("   Replay thread could not be started: ") + path);
+        delete m_thread;
+        m_thread = NULL;
+        SetSecThreadInActive();
+        SetThreadRunFlag(-1);
+        return;
+    }
+    SetOk(true);
+}
+
+void ReplayDataStream::Close()
+{
+    if(m_thread) {
+        if(IsSecThreadActive()) {
+            m_Thread_run_flag = 0;
+            int tms = 5000;
+            while((m_Thread_run_flag >= 0) && (tms > 0)) {
+                wxMilliSleep(10);
+                tms -= 10;
+            }
+            if(m_Thread_run_flag >= 0)
+                wxLogMessage(_T("   Replay thread not stopped after 5 sec."));
+        }
+        m_thread = NULL;                        // detached, deletes itself
+    }
+    SetOk(false);
+
+    DataStream::Close();
+}
+
+void ReplayDataStream::SetSpeed(double speed)
+{
+    wxCriticalSectionLocker locker(m_ctlCritical);
+    m_speed = speed < 0. ? 0. : speed;
+    m_speed_changed = true;
+}
+
+double ReplayDataStream::GetSpeed()
+{
+    wxCriticalSectionLocker locker(m_ctlCritical);
+    return m_speed;
+}
+
+void ReplayDataStream::SeekTo(int64_t ts)
+{
+    wxCriticalSectionLocker locker(m_ctlCritical);
+    m_seek_ts = ts;
+    m_seek_pending = true;
+}
+
+bool ReplayDataStream::GetSeekRequest(int64_t &ts)
+{
+    wxCriticalSectionLocker locker(m_ctlCritical);
+    if(!m_seek_pending)
+        return false;
+    ts = m_seek_ts;
+    m_seek_pending = false;
+    return true;
+}
+
+bool ReplayDataStream::GetSpeedChanged(double &speed)
+{
+    wxCriticalSectionLocker locker(m_ctlCritical);
+    speed = m_speed;
+    bool changed = m_speed_changed;
+    m_speed_changed = false;
+    return changed;
+}
+
+//------------------------------------------------------------------------------
+//    ReplayThread Implementation
+//------------------------------------------------------------------------------
+
+ReplayThread::ReplayThread(ReplayDataStream *launcher, wxEvtHandler *target,
+                           const std::string &path)
+    : wxThread(wxTHREAD_DETACHED),
+      m_launcher(launcher),
+      m_pMessageTarget(target)
+{
+    if(!m_reader.Open(path))
+        wxLogMessage(_T("   Replay: cannot open capture log ") + wxString(path.c_str(), wxConvUTF8));
+    else
+        m_launcher->SetLogTimes(m_reader.GetStartTime(), m_reader.GetEndTime());
+
+    Create();
+}
+
+ReplayThread::~ReplayThread()
+{
+}
+
+void ReplayThread::Post(const CaptureRecord &rec)
+{
+    if(!m_pMessageTarget)
+        return;
+
+    if(rec.kind == CAPTURE_SIGNALK) {
+        OCPN_SignalKEvent signalKEvent(0, EVT_OCPN_SIGNALKSTREAM, rec.data);
+        m_pMessageTarget->AddPendingEvent(signalKEvent);
+    }
+    else {
+        OCPN_DataStreamEvent Nevent(wxEVT_OCPN_DATASTREAM, 0);
+        Nevent.SetNMEAString(rec.data);
+        Nevent.SetStream(m_launcher);
+        m_pMessageTarget->AddPendingEvent(Nevent);
+    }
+}
+
+//  Sleep until the wall clock reaches wall_us, returns false if interrupted
+//  by a stop, seek or speed change request.
+bool ReplayThread::WaitUntil(int64_t wall_us)
+{
+    for(;;) {
+        if(TestDestroy() || m_launcher->m_Thread_run_flag <= 0)
+            return false;
+
+        int64_t now = wxGetUTCTimeUSec().GetValue();
+        if(now >= wall_us)
+            return true;
+
+        long ms = (long)((wall_us - now) / 1000);
+        if(ms > REPLAY_MAX_SLEEP_MS) {
+            wxThread::Sleep(REPLAY_MAX_SLEEP_MS);
+            return false;                       // re-check controls in the main loop
+        }
+        if(ms > 0)
+            wxThread::Sleep(ms);
+        else
+            return true;
+    }
+}
+
+void *ReplayThread::Entry()
+{
+    CaptureRecord rec;
+    bool have_rec = m_reader.IsOpen() && m_reader.Next(rec);
+    double speed;
+    m_launcher->GetSpeedChanged(speed);
+
+    //  Pacing reference: log time base_log is played at wall time base_wall
+    int64_t base_log = have_rec ? rec.timestamp : 0;
+    int64_t base_wall = wxGetUTCTimeUSec().GetValue();
+    unsigned long n_posted = 0;
+    unsigned int batch = 0;
+    bool b_end_reported = false;
+
+    wxStopWatch sw;
+
+    while(m_launcher->m_Thread_run_flag > 0) {
+        if(TestDestroy())
+            break;
+
+        int64_t seek_ts;
+        if(m_reader.IsOpen() && m_launcher->GetSeekRequest(seek_ts)) {
+            have_rec = m_reader.Seek(seek_ts) && m_reader.Next(rec);
+            if(have_rec) {
+                base_log = rec.timestamp;
+                base_wall = wxGetUTCTimeUSec().GetValue();
+                b_end_reported = false;
+            }
+        }
+
+        //  At the end of the log, idle until stopped or asked to seek back
+        if(!have_rec) {
+            if(!b_end_reported) {
+                wxLogMessage(wxString::Format(_T("   Replay: end of log, %lu records in %ld ms"),
+                                              n_posted, sw.Time()));
+                b_end_reported = true;
+            }
+            wxThread::Sleep(REPLAY_MAX_SLEEP_MS);
+            continue;
+        }
+
+        double new_speed;
+        if(m_launcher->GetSpeedChanged(new_speed)) {
+            //  Rebase so that the current record plays now
+            speed = new_speed;
+            base_log = rec.timestamp;
+            base_wall = wxGetUTCTimeUSec().GetValue();
+        }
+
+        if(speed > 0.) {
+            int64_t due = base_wall + (int64_t)((rec.timestamp - base_log) / speed);
+            if(!WaitUntil(due))
+                continue;
+        }
+        else if(++batch >= REPLAY_UNTHROTTLED_BATCH) {
+            batch = 0;
+            wxThread::Sleep(1);
+        }
+
+        Post(rec);
+        n_posted++;
+
+        have_rec = m_reader.Next(rec);
+    }
+
+    m_reader.Close();
+
+    m_launcher->SetSecThreadInActive();             // I am dead
+    m_launcher->m_Thread_run_flag = -1;
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Spatial index of the S52 text labels drawn in a frame
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include "S52LabelGrid.h"
+
+void S52LabelGrid::Clear()
+{
+    m_entries.clear();
+    m_texts.clear();
+
+    if(m_cells.size() > S52_LABEL_MAX_CELLS)
+        m_cells.clear();
+    else {
+        for(auto it = m_cells.begin(); it != m_cells.end(); ++it)
+            it->second.clear();
+    }
+}
+
+void S52LabelGrid::Add(S52_TextC *text, const wxRect &rect)
+{
+    unsigned int index = m_entries.size();
+    Entry entry = { rect, text };
+    m_entries.push_back(entry);
+    m_texts.insert(text);
+
+    int cx1 = CellOf(rect.x), cx2 = CellOf(rect.x + wxMax(rect.width - 1, 0));
+    int cy1 = CellOf(rect.y), cy2 = CellOf(rect.y + wxMax(rect.height - 1, 0));
+    for(int cy = cy1; cy <= cy2; cy++)
+        for(int cx = cx1; cx <= cx2; cx++)
+            m_cells[CellKey(cx, cy)].push_back(index);
+}
+
+bool S52LabelGrid::Intersects(const wxRect &rect, const S52_TextC *except) const
+{
+    if(m_entries.empty())
+        return false;
+
+    int cx1 = CellOf(rect.x), cx2 = CellOf(rect.x + wxMax(rect.width - 1, 0));
+    int cy1 = CellOf(rect.y), cy2 = CellOf(rect.y + wxMax(rect.height - 1, 0));
+    for(int cy = cy1; cy <= cy2; cy++) {
+        for(int cx = cx1; cx <= cx2; cx++) {
+            auto cell = m_cells.find(CellKey(cx, cy));
+            if(cell == m_cells.end())
+                continue;
+
+            const std::vector<unsigned int> &indices = cell->second;
+            for(size_t i = 0; i < indices.size(); i++) {
+                const Entry &entry = m_entries[indices[i]];
+                if(entry.text != except && entry.rect.Intersects(rect))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
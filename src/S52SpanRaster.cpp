@@ -0,0 +1,331 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Scanline fill of S52 area triangles into a DC render buffer
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include "S52SpanRaster.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+//  SIMD fills on x86, with the instruction set picked when first used
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define S52_SPAN_X86
+#include <immintrin.h>
+#define S52_TARGET_SSE2 __attribute__((target("sse2")))
+#define S52_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define S52_SPAN_X86
+#include <intrin.h>
+#include <immintrin.h>
+#define S52_TARGET_SSE2
+#define S52_TARGET_AVX2
+#endif
+
+typedef void (*FillSpanProc)(unsigned char *dest, unsigned int color, int count);
+
+static void FillSpan32(unsigned char *dest, unsigned int color, int count)
+{
+    uint32_t *p = (uint32_t *)dest;
+    for(int i = 0; i < count; i++)
+        p[i] = color;
+}
+
+static void FillSpan24(unsigned char *dest, unsigned int color, int count)
+{
+    unsigned char b0 = color, b1 = color >> 8, b2 = color >> 16;
+    for(int i = 0; i < count; i++) {
+        *dest++ = b0;
+        *dest++ = b1;
+        *dest++ = b2;
+    }
+}
+
+#ifdef S52_SPAN_X86
+//  {n} pixels of 24 bits in a row, for whole-register stores
+static void Pattern24(unsigned char *pattern, unsigned int color, int n)
+{
+    for(int i = 0; i < n; i++) {
+        pattern[3 * i] = color;
+        pattern[3 * i + 1] = color >> 8;
+        pattern[3 * i + 2] = color >> 16;
+    }
+}
+
+S52_TARGET_SSE2 static void FillSpan32_SSE2(unsigned char *dest, unsigned int color, int count)
+{
+    __m128i v = _mm_set1_epi32((int)color);
+    int i = 0;
+    for(; i + 4 <= count; i += 4, dest += 16)
+        _mm_storeu_si128((__m128i *)dest, v);
+    FillSpan32(dest, color, count - i);
+}
+
+S52_TARGET_SSE2 static void FillSpan24_SSE2(unsigned char *dest, unsigned int color, int count)
+{
+    unsigned char pattern[48];
+    Pattern24(pattern, color, 16);
+    __m128i v0 = _mm_loadu_si128((const __m128i *)pattern);
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(pattern + 16));
+    __m128i v2 = _mm_loadu_si128((const __m128i *)(pattern + 32));
+
+    int i = 0;
+    for(; i + 16 <= count; i += 16, dest += 48) {
+        _mm_storeu_si128((__m128i *)dest, v0);
+        _mm_storeu_si128((__m128i *)(dest + 16), v1);
+        _mm_storeu_si128((__m128i *)(dest + 32), v2);
+    }
+    FillSpan24(dest, color, count - i);
+}
+
+S52_TARGET_AVX2 static void FillSpan32_AVX2(unsigned char *dest, unsigned int color, int count)
+{
+    __m256i v = _mm256_set1_epi32((int)color);
+    int i = 0;
+    for(; i + 8 <= count; i += 8, dest += 32)
+        _mm256_storeu_si256((__m256i *)dest, v);
+    FillSpan32(dest, color, count - i);
+}
+
+S52_TARGET_AVX2 static void FillSpan24_AVX2(unsigned char *dest, unsigned int color, int count)
+{
+    unsigned char pattern[96];
+    Pattern24(pattern, color, 32);
+    __m256i v0 = _mm256_loadu_si256((const __m256i *)pattern);
+    __m256i v1 = _mm256_loadu_si256((const __m256i *)(pattern + 32));
+    __m256i v2 = _mm256_loadu_si256((const __m256i *)(pattern + 64));
+
+    int i = 0;
+    for(; i + 32 <= count; i += 32, dest += 96) {
+        _mm256_storeu_si256((__m256i *)dest, v0);
+        _mm256_storeu_si256((__m256i *)(dest + 32), v1);
+        _mm256_storeu_si256((__m256i *)(dest + 64), v2);
+    }
+    FillSpan24(dest, color, count - i);
+}
+
+static bool CPUHasSSE2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool CPUHasAVX2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7)
+        return false;
+
+    //  The OS must save the AVX registers too
+    __cpuid(info, 1);
+    bool b_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28));
+    if(!b_avx || (_xgetbv(0) & 6) != 6)
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+static FillSpanProc     s_fill32 = NULL;
+static FillSpanProc     s_fill24 = NULL;
+static const char       *s_fill_name = "C";
+
+static void SelectFillSpan()
+{
+    s_fill32 = FillSpan32;
+    s_fill24 = FillSpan24;
+
+#ifdef S52_SPAN_X86
+    if(CPUHasAVX2()) {
+        s_fill32 = FillSpan32_AVX2;
+        s_fill24 = FillSpan24_AVX2;
+        s_fill_name = "AVX2";
+    }
+    else if(CPUHasSSE2()) {
+        s_fill32 = FillSpan32_SSE2;
+        s_fill24 = FillSpan24_SSE2;
+        s_fill_name = "SSE2";
+    }
+#endif
+}
+
+S52SpanStats S52SpanRaster::s_stats;
+
+S52SpanRaster::S52SpanRaster()
+{
+    m_spec = NULL;
+
+    if(!s_fill32)
+        SelectFillSpan();
+}
+
+void S52SpanRaster::FillSpan(unsigned char *dest, int depth, unsigned int color, int count)
+{
+    if(count <= 0)
+        return;
+    if(!s_fill32)
+        SelectFillSpan();
+
+    if(depth == 32)
+        s_fill32(dest, color, count);
+    else if(depth == 24)
+        s_fill24(dest, color, count);
+}
+
+const char *S52SpanRaster::GetFillName()
+{
+    if(!s_fill32)
+        SelectFillSpan();
+    return s_fill_name;
+}
+
+void S52SpanRaster::Begin(render_canvas_parms *pb_spec)
+{
+    m_spec = pb_spec;
+    if((int)m_rows.size() < pb_spec->height)
+        m_rows.resize(pb_spec->height);
+}
+
+bool S52SpanRaster::AddTriangle(const wxPoint *ptp)
+{
+    s_stats.triangles++;
+
+    //  Whole triangles outside the buffer, by their bounding box
+    int minx = wxMin(ptp[0].x, wxMin(ptp[1].x, ptp[2].x));
+    int maxx = wxMax(ptp[0].x, wxMax(ptp[1].x, ptp[2].x));
+    int ytop = m_spec->y;
+    int ybot = m_spec->y + m_spec->height;
+
+    const wxPoint *p0 = &ptp[0], *p1 = &ptp[1], *p2 = &ptp[2];
+    if(p1->y < p0->y) std::swap(p0, p1);
+    if(p2->y < p1->y) std::swap(p1, p2);
+    if(p1->y < p0->y) std::swap(p0, p1);
+
+    if(maxx < m_spec->lclip || minx > m_spec->rclip || p2->y <= ytop || p0->y >= ybot
+       || p0->y == p2->y) {
+        s_stats.rejected++;
+        return false;
+    }
+
+    //  Rows p0->y up to p2->y, as dda_tri: the long edge p0 - p2 on one side,
+    //  p0 - p1 then p1 - p2 on the other
+    int64_t m02 = (int64_t)(p2->x - p0->x) * 65536 / (p2->y - p0->y);
+    int64_t m01 = (p1->y > p0->y) ? (int64_t)(p1->x - p0->x) * 65536 / (p1->y - p0->y) : 0;
+    int64_t m12 = (p2->y > p1->y) ? (int64_t)(p2->x - p1->x) * 65536 / (p2->y - p1->y) : 0;
+
+    int y1 = wxMax(p0->y, ytop);
+    int y2 = wxMin(p2->y, ybot);
+    for(int y = y1; y < y2; y++) {
+        int xa = (int)(((int64_t)p0->x * 65536 + m02 * (y - p0->y)) >> 16);
+        int xb;
+        if(y < p1->y)
+            xb = (int)(((int64_t)p0->x * 65536 + m01 * (y - p0->y)) >> 16);
+        else
+            xb = (int)(((int64_t)p1->x * 65536 + m12 * (y - p1->y)) >> 16);
+
+        Span span;
+        span.x1 = wxMax(wxMin(xa, xb), m_spec->lclip);
+        span.x2 = wxMin(wxMax(xa, xb), m_spec->rclip);
+        if(span.x1 > span.x2)
+            continue;
+
+        std::vector<Span> &row = m_rows[y - ytop];
+        if(row.empty())
+            m_used_rows.push_back(y - ytop);
+        row.push_back(span);
+        s_stats.spans++;
+    }
+    return true;
+}
+
+void S52SpanRaster::Fill(const S52color *c)
+{
+    unsigned char r, g, b;
+    if(m_spec->b_revrgb) {
+        r = c->R;
+        g = c->G;
+        b = c->B;
+    }
+    else {
+        b = c->R;
+        g = c->G;
+        r = c->B;
+    }
+    unsigned int color = (r << 16) + (g << 8) + b;
+    int bpp = m_spec->depth / 8;
+
+    for(size_t i = 0; i < m_used_rows.size(); i++) {
+        int iy = m_used_rows[i];
+        std::vector<Span> &row = m_rows[iy];
+        unsigned char *py = m_spec->pix_buff + iy * m_spec->pb_pitch;
+
+        if(row.size() > 1)
+            std::sort(row.begin(), row.end(), [](const Span &a, const Span &b) { return a.x1 < b.x1; });
+
+        //  Merge the spans that overlap or abut
+        Span run = row[0];
+        for(size_t k = 1; k <= row.size(); k++) {
+            if(k < row.size() && row[k].x1 <= run.x2 + 1) {
+                run.x2 = wxMax(run.x2, row[k].x2);
+                continue;
+            }
+
+            FillSpan(py + (run.x1 - m_spec->x) * bpp, m_spec->depth, color, run.x2 - run.x1 + 1);
+            s_stats.runs++;
+            s_stats.pixels += run.x2 - run.x1 + 1;
+
+            if(k < row.size())
+                run = row[k];
+        }
+        row.clear();
+    }
+    m_used_rows.clear();
+}
+
+void S52SpanRaster::LogStats(const wxRect &rect, long ms)
+{
+    wxLogMessage(_T("S57 DC areas %dx%d: %ld ms, %s fill, %lu triangles, %lu rejected, %lu spans in %lu runs, %lu pixels"),
+                 rect.width, rect.height, ms, wxString(GetFillName(), wxConvUTF8).c_str(),
+                 s_stats.triangles, s_stats.rejected, s_stats.spans, s_stats.runs, s_stats.pixels);
+
+    memset(&s_stats, 0, sizeof(s_stats));
+}
@@ -0,0 +1,185 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Shared storage of the S57 object attributes of a chart
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include <stdlib.h>
+
+#include "S57AttrArena.h"
+
+//----------------------------------------------------------------------------------
+//      S57AttrArena::Pool
+//----------------------------------------------------------------------------------
+
+void *S57AttrArena::Pool::Alloc(size_t bytes)
+{
+    size_t pad = (8 - ((uintptr_t)m_top & 7)) & 7;      // values are read as int and double
+
+    if(!m_top || pad + bytes > m_left) {
+        if(bytes > S57_ATTR_BLOCK_BYTES / 4) {
+            //  A long string: a block of its own, leaving the current one to fill
+            char *block = (char *)malloc(bytes);
+            m_blocks.push_back(block);
+            m_bytes += bytes;
+            m_last = block;
+            return block;
+        }
+
+        m_top = (char *)malloc(S57_ATTR_BLOCK_BYTES);
+        m_left = S57_ATTR_BLOCK_BYTES;
+        m_blocks.push_back(m_top);
+        m_bytes += S57_ATTR_BLOCK_BYTES;
+        pad = 0;
+    }
+
+    char *p = m_top + pad;
+    m_top = p + bytes;
+    m_left -= pad + bytes;
+    m_last = p;
+    return p;
+}
+
+void *S57AttrArena::Pool::Extend(void *p, size_t old_bytes, size_t bytes)
+{
+    if(p && p == m_last && (char *)p + old_bytes == m_top && bytes - old_bytes <= m_left) {
+        m_top += bytes - old_bytes;
+        m_left -= bytes - old_bytes;
+        return p;
+    }
+
+    void *q = Alloc(bytes);
+    if(p)
+        memcpy(q, p, old_bytes);
+    return q;
+}
+
+void S57AttrArena::Pool::Clear()
+{
+    for(size_t i = 0; i < m_blocks.size(); i++)
+        free(m_blocks[i]);
+    m_blocks.clear();
+
+    m_top = NULL;
+    m_left = 0;
+    m_last = NULL;
+    m_bytes = 0;
+}
+
+//----------------------------------------------------------------------------------
+//      S57AttrArena
+//----------------------------------------------------------------------------------
+
+S57AttrArena::S57AttrArena()
+    : m_nvalues(0)
+{
+}
+
+S57AttrArena::~S57AttrArena()
+{
+    Clear();
+}
+
+void S57AttrArena::Clear()
+{
+    m_ints.clear();
+    m_doubles.clear();
+    m_strings.clear();
+
+    m_values.Clear();
+    m_acronyms.Clear();
+    m_nvalues = 0;
+}
+
+//  The value follows the record, in the same allocation
+S57attVal *S57AttrArena::NewRecord(OGRatt_t type, size_t value_bytes)
+{
+    S57attVal *record = (S57attVal *)m_values.Alloc(sizeof(S57attVal) + value_bytes);
+    record->valType = type;
+    record->value = record + 1;
+    return record;
+}
+
+S57attVal *S57AttrArena::GetInteger(int val)
+{
+    m_nvalues++;
+
+    S57attVal *&record = m_ints[val];
+    if(!record) {
+        record = NewRecord(OGR_INT, sizeof(int));
+        *(int *)record->value = val;
+    }
+    return record;
+}
+
+S57attVal *S57AttrArena::GetDouble(double val)
+{
+    m_nvalues++;
+
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+
+    S57attVal *&record = m_doubles[bits];
+    if(!record) {
+        record = NewRecord(OGR_REAL, sizeof(double));
+        *(double *)record->value = val;
+    }
+    return record;
+}
+
+S57attVal *S57AttrArena::GetString(const char *val)
+{
+    m_nvalues++;
+
+    std::unordered_map<const char *, S57attVal *, StrHash, StrEqual>::iterator it = m_strings.find(val);
+    if(it != m_strings.end())
+        return it->second;
+
+    size_t len = strlen(val) + 1;
+    S57attVal *record = NewRecord(OGR_STR, len);
+    memcpy(record->value, val, len);
+
+    m_strings[(const char *)record->value] = record;
+    return record;
+}
+
+char *S57AttrArena::AddAcronym(char *att_array, int n_attr, const char *acronym)
+{
+    char *p = (char *)m_acronyms.Extend(att_array, 6 * n_attr, 6 * (n_attr + 1));
+    strncpy(p + 6 * n_attr, acronym, 6);
+    return p;
+}
+
+//  Blocks, and an estimate of the index tables
+size_t S57AttrArena::GetBytes() const
+{
+    size_t nodes = GetRecordCount() * (3 * sizeof(void *) + sizeof(uint64_t));
+    size_t buckets = (m_ints.bucket_count() + m_doubles.bucket_count() + m_strings.bucket_count()) * sizeof(void *);
+
+    return m_values.GetBytes() + m_acronyms.GetBytes() + nodes + buckets;
+}
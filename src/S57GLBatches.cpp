@@ -0,0 +1,473 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Batched OpenGL rendering of S57 area fills and simple lines
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include "dychart.h"
+
+#include "S57GLBatches.h"
+#include "s52plib.h"
+#include "mygeom.h"
+#include "viewport.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+//  Fixed function pipeline with 32 bit indices only
+#if defined(ocpnUSE_GL) && !defined(ocpnUSE_GLES) && !defined(USE_ANDROID_GLES2)
+#define S57_GL_BATCHING
+#endif
+
+#ifdef S57_GL_BATCHING
+extern PFNGLGENBUFFERSPROC                 s_glGenBuffers;
+extern PFNGLBINDBUFFERPROC                 s_glBindBuffer;
+extern PFNGLBUFFERDATAPROC                 s_glBufferData;
+extern PFNGLDELETEBUFFERSPROC              s_glDeleteBuffers;
+
+#define glGenBuffers(a,b) (s_glGenBuffers)(a,b);
+#define glBindBuffer(a,b) (s_glBindBuffer)(a,b);
+#define glBufferData(a,b,c,d) (s_glBufferData)(a,b,c,d);
+#define glDeleteBuffers(a,b) (s_glDeleteBuffers)(a,b);
+#endif
+
+extern s52plib          *ps52plib;
+
+S57GLBatches::Stats S57GLBatches::s_stats;
+
+//  Position of the center of {obj} along a Z-order curve
+static uint32_t SpatialKey(S57Obj *obj)
+{
+    if(!obj->BBObj.GetValid())
+        return 0;
+
+    double lat = (obj->BBObj.GetMinLat() + obj->BBObj.GetMaxLat()) / 2;
+    double lon = (obj->BBObj.GetMinLon() + obj->BBObj.GetMaxLon()) / 2;
+
+    uint32_t x = (uint32_t)wxMin(wxMax((lon + 180.) / 360. * 65535., 0.), 65535.);
+    uint32_t y = (uint32_t)wxMin(wxMax((lat + 90.) / 180. * 65535., 0.), 65535.);
+
+    uint32_t key = 0;
+    for(int i = 0; i < 16; i++)
+        key |= ((x >> i) & 1) << (2 * i) | ((y >> i) & 1) << (2 * i + 1);
+    return key;
+}
+
+#ifdef S57_GL_BATCHING
+//  The triangles of a tesselated area, as a triangle list in chart SM coordinates
+static void AppendTriangles(S57Obj *obj, PolyTriGroup *ppg, std::vector<float> &verts)
+{
+    bool b_float = (ppg->data_type == DATA_TYPE_FLOAT);
+
+    for(TriPrim *p_tp = ppg->tri_prim_head; p_tp; p_tp = p_tp->p_next) {
+        int n = p_tp->nVert;
+        if(n < 3)
+            continue;
+
+        size_t base = verts.size();
+        for(int i = 0; i < n; i++) {
+            double x, y;
+            if(b_float) {
+                x = ((float *)p_tp->p_vertex)[2 * i];
+                y = ((float *)p_tp->p_vertex)[2 * i + 1];
+            } else {
+                x = p_tp->p_vertex[2 * i];
+                y = p_tp->p_vertex[2 * i + 1];
+            }
+            verts.push_back((float)(x * obj->x_rate + obj->x_origin));
+            verts.push_back((float)(y * obj->y_rate + obj->y_origin));
+        }
+
+        if(p_tp->type == GL_TRIANGLES)
+            continue;
+
+        //  Unroll strips and fans into separate triangles
+        std::vector<float> prim(verts.begin() + base, verts.end());
+        verts.resize(base);
+
+        for(int i = 0; i < n - 2; i++) {
+            int tri[3];
+            if(p_tp->type == GL_TRIANGLE_FAN) {
+                tri[0] = 0;
+                tri[1] = i + 1;
+                tri[2] = i + 2;
+            } else {
+                tri[0] = i;
+                tri[1] = i + 1;
+                tri[2] = i + 2;
+            }
+            for(int k = 0; k < 3; k++) {
+                verts.push_back(prim[2 * tri[k]]);
+                verts.push_back(prim[2 * tri[k] + 1]);
+            }
+        }
+    }
+}
+
+//  The segments of a line object at its own display priority, as line pieces
+//  indexing the chart line VBO.  As RenderGLLS() draws them.
+static void AppendSegments(ObjRazRules *rzRules, std::vector<GLuint> &indices)
+{
+    int priority_current = rzRules->LUP->DPRI - '0';
+    if(rzRules->obj->m_DPRI >= 0)
+        priority_current = rzRules->obj->m_DPRI;
+
+    for(line_segment_element *ls = rzRules->obj->m_ls_list; ls; ls = ls->next) {
+        if(ls->priority != priority_current)
+            continue;
+
+        size_t offset;
+        unsigned int count;
+        if((ls->ls_type == TYPE_EE) || (ls->ls_type == TYPE_EE_REV)) {
+            offset = ls->pedge->vbo_offset;
+            count = ls->pedge->nCount;
+        } else {
+            offset = ls->pcs->vbo_offset;
+            count = 2;
+        }
+
+        GLuint first = (GLuint)(offset / (2 * sizeof(float)));
+        for(unsigned int i = 0; i + 1 < count; i++) {
+            indices.push_back(first + i);
+            indices.push_back(first + i + 1);
+        }
+    }
+}
+
+static void SetViewTransform(ViewPort *vp, const sm_parms &transform)
+{
+    //  From Simple Mercator, relative to the chart reference point, to screen
+    glPushMatrix();
+    glTranslatef( vp->pix_width / 2, vp->pix_height/2, 0 );
+    glScalef( vp->view_scale_ppm, -vp->view_scale_ppm, 0 );
+    glTranslatef( -transform.easting_vp_center, -transform.northing_vp_center, 0 );
+}
+#endif
+
+S57GLBatches::S57GLBatches()
+    : m_valid(false),
+      m_area_type(-1),
+      m_state_hash(0),
+      m_area_vbo(0),
+      m_line_ibo(0),
+      m_line_vbo(0)
+{
+}
+
+S57GLBatches::~S57GLBatches()
+{
+    Clear();
+}
+
+void S57GLBatches::Clear()
+{
+#ifdef S57_GL_BATCHING
+    if(s_glDeleteBuffers) {
+        if(m_area_vbo)
+            glDeleteBuffers(1, (GLuint *)&m_area_vbo);
+        if(m_line_ibo)
+            glDeleteBuffers(1, (GLuint *)&m_line_ibo);
+    }
+#endif
+    m_area_vbo = 0;
+    m_line_ibo = 0;
+    m_line_vbo = 0;
+
+    m_entries.clear();
+    m_area_index.clear();
+    m_line_index.clear();
+    m_batches.clear();
+    for(int i = 0; i < PRIO_NUM; i++)
+        for(int j = 0; j < LUPNAME_NUM; j++)
+            m_list_batches[i][j].clear();
+
+    m_valid = false;
+}
+
+bool S57GLBatches::IsValid(int area_type) const
+{
+    return m_valid && area_type == m_area_type && m_state_hash == ps52plib->GetStateHash();
+}
+
+int S57GLBatches::AddBatch(int prio, int type, const char *rule)
+{
+    std::vector<int> &list = m_list_batches[prio][type];
+    for(size_t i = 0; i < list.size(); i++)
+        if(m_batches[list[i]].rule == rule)
+            return list[i];
+
+    Batch batch;
+    batch.rule = rule;
+    m_batches.push_back(batch);
+    list.push_back(m_batches.size() - 1);
+    return m_batches.size() - 1;
+}
+
+void S57GLBatches::AddEntry(EntryIndex &index, ObjRazRules *rzRules, int batch,
+                            unsigned int first, unsigned int count)
+{
+    if(!count)
+        return;
+
+    Entry entry;
+    entry.batch = batch;
+    entry.first = first;
+    entry.count = count;
+    index[rzRules] = m_entries.size();
+    m_entries.push_back(entry);
+}
+
+void S57GLBatches::Build(ObjRazRules *razRules[PRIO_NUM][LUPNAME_NUM], int area_type, int line_vbo)
+{
+    Clear();
+    m_area_type = area_type;
+    m_state_hash = ps52plib->GetStateHash();
+    m_valid = true;
+
+#ifdef S57_GL_BATCHING
+    if(!s_glGenBuffers)
+        return;
+
+    struct Item
+    {
+        ObjRazRules     *rzRules;
+        int             batch;
+        uint32_t        key;
+
+        bool operator<(const Item &other) const
+            { return batch < other.batch || (batch == other.batch && key < other.key); }
+    };
+
+    //  Area fills
+    std::vector<Item> items;
+    for(int i = 0; i < PRIO_NUM; i++) {
+        for(ObjRazRules *top = razRules[i][area_type]; top; top = top->next) {
+            S57Obj *obj = top->obj;
+            if(!obj->m_chart_context || !obj->m_chart_context->chart || obj->auxParm1)
+                continue;
+            if(!obj->pPolyTessGeo || !obj->pPolyTessGeo->IsOk())
+                continue;
+
+            PolyTriGroup *ppg = obj->pPolyTessGeo->Get_PolyTriGroup_head();
+            if(!ppg || (ppg->data_type != DATA_TYPE_FLOAT && ppg->data_type != DATA_TYPE_DOUBLE))
+                continue;
+
+            Rules *rule = ps52plib->GetGLBatchAreaRule(top);
+            if(!rule)
+                continue;
+
+            Item item = { top, AddBatch(i, area_type, rule->INSTstr), SpatialKey(obj) };
+            items.push_back(item);
+        }
+    }
+    std::stable_sort(items.begin(), items.end());
+
+    std::vector<float> verts;
+    for(size_t k = 0; k < items.size(); k++) {
+        unsigned int first = verts.size() / 2;
+        AppendTriangles(items[k].rzRules->obj, items[k].rzRules->obj->pPolyTessGeo->Get_PolyTriGroup_head(), verts);
+        AddEntry(m_area_index, items[k].rzRules, items[k].batch, first, verts.size() / 2 - first);
+    }
+
+    if(verts.size()) {
+        GLuint vboId;
+        glGenBuffers(1, &vboId);
+        glBindBuffer(GL_ARRAY_BUFFER, vboId);
+        glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), &verts[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_area_vbo = vboId;
+    }
+
+    //  Solid simple lines.  Dash patterns would restart at every piece.
+    if(line_vbo <= 0)
+        return;
+    m_line_vbo = line_vbo;
+
+    items.clear();
+    const int line_types[2] = { area_type, 2 };
+    for(int t = 0; t < 2; t++) {
+        int type = line_types[t];
+        for(int i = 0; i < PRIO_NUM; i++) {
+            for(ObjRazRules *top = razRules[i][type]; top; top = top->next) {
+                S57Obj *obj = top->obj;
+                if(!obj->m_chart_context || !obj->m_chart_context->chart || !obj->m_ls_list)
+                    continue;
+                if(obj->x_origin != 0 || obj->y_origin != 0 || obj->x_rate != 1 || obj->y_rate != 1)
+                    continue;
+
+                Rules *rule = ps52plib->GetGLBatchLineRule(top);
+                if(!rule || strncmp(rule->INSTstr, "SOLD", 4))
+                    continue;
+
+                Item item = { top, AddBatch(i, type, rule->INSTstr), SpatialKey(obj) };
+                items.push_back(item);
+            }
+        }
+    }
+    std::stable_sort(items.begin(), items.end());
+
+    std::vector<GLuint> indices;
+    for(size_t k = 0; k < items.size(); k++) {
+        unsigned int first = indices.size();
+        AppendSegments(items[k].rzRules, indices);
+        AddEntry(m_line_index, items[k].rzRules, items[k].batch, first, indices.size() - first);
+    }
+
+    if(indices.size()) {
+        GLuint iboId;
+        glGenBuffers(1, &iboId);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboId);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        m_line_ibo = iboId;
+    }
+#endif
+}
+
+bool S57GLBatches::Add(EntryIndex &index, ObjRazRules *rzRules, ViewPort *vp)
+{
+    EntryIndex::iterator it = index.find(rzRules);
+    if(it == index.end())
+        return false;
+
+    if(ps52plib->ObjectRenderCheckRules(rzRules, vp, true))
+        m_batches[m_entries[it->second].batch].queued.push_back(it->second);
+    return true;
+}
+
+void S57GLBatches::DrawQueued(Batch &batch, unsigned int mode, bool b_indexed)
+{
+#ifdef S57_GL_BATCHING
+    std::vector<int> &queued = batch.queued;
+    std::sort(queued.begin(), queued.end());
+
+    //  Entries of a batch are consecutive in the buffer, in entry order
+    size_t k = 0;
+    while(k < queued.size()) {
+        const Entry &start = m_entries[queued[k++]];
+        unsigned int first = start.first;
+        unsigned int end = start.first + start.count;
+
+        while(k < queued.size() && m_entries[queued[k]].first == end)
+            end += m_entries[queued[k++]].count;
+
+        if(b_indexed)
+            glDrawElements(mode, end - first, GL_UNSIGNED_INT, (GLvoid *)(first * sizeof(GLuint)));
+        else
+            glDrawArrays(mode, first, end - first);
+        s_stats.draws++;
+    }
+
+    s_stats.objects += queued.size();
+#endif
+    batch.queued.clear();
+}
+
+void S57GLBatches::DrawAreas(int prio, ViewPort *vp, const sm_parms &transform)
+{
+#ifdef S57_GL_BATCHING
+    std::vector<int> &list = m_list_batches[prio][m_area_type];
+    bool b_setup = false;
+
+    for(size_t i = 0; i < list.size(); i++) {
+        Batch &batch = m_batches[list[i]];
+        if(batch.queued.empty())
+            continue;
+
+        if(!b_setup) {
+            SetViewTransform(vp, transform);
+            glBindBuffer(GL_ARRAY_BUFFER, m_area_vbo);
+            glEnableClientState(GL_VERTEX_ARRAY);
+            glVertexPointer(2, GL_FLOAT, 2 * sizeof(float), 0);
+            b_setup = true;
+        }
+
+        S52color *c = ps52plib->getColor(batch.rule.c_str());
+        glColor3ub( c->R, c->G, c->B );
+
+        DrawQueued(batch, GL_TRIANGLES, false);
+    }
+
+    if(b_setup) {
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glPopMatrix();
+    }
+#endif
+}
+
+void S57GLBatches::DrawLines(int prio, int type, ViewPort *vp, const sm_parms &transform)
+{
+#ifdef S57_GL_BATCHING
+    std::vector<int> &list = m_list_batches[prio][type];
+    bool b_setup = false;
+
+    for(size_t i = 0; i < list.size(); i++) {
+        Batch &batch = m_batches[list[i]];
+        if(batch.queued.empty())
+            continue;
+
+        if(!b_setup) {
+            SetViewTransform(vp, transform);
+            glBindBuffer(GL_ARRAY_BUFFER, m_line_vbo);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_line_ibo);
+            glEnableClientState(GL_VERTEX_ARRAY);
+            glVertexPointer(2, GL_FLOAT, 2 * sizeof(float), 0);
+            b_setup = true;
+        }
+
+        S52color *c = ps52plib->SetGLLineStyle(batch.rule.c_str());
+        glColor3ub( c->R, c->G, c->B );
+
+        DrawQueued(batch, GL_LINES, true);
+
+        ps52plib->ResetGLLineStyle();
+    }
+
+    if(b_setup) {
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glPopMatrix();
+    }
+#endif
+}
+
+void S57GLBatches::EndFrame(bool b_log, double frame_ms)
+{
+    if(++s_stats.frames < S57_GL_BATCH_STATS_FRAMES)
+        return;
+
+    if(b_log && (s_stats.objects || s_stats.singles)) {
+        double n = s_stats.frames;
+        wxLogMessage(_T("S57 GL batching, per frame: %.0f objects in %.0f batched draws, %.0f objects drawn singly, %.2f ms in S57 render, %.1f ms frame"),
+                     s_stats.objects / n, s_stats.draws / n, s_stats.singles / n, s_stats.render_us / n / 1000., frame_ms);
+    }
+
+    memset(&s_stats, 0, sizeof(s_stats));
+}
@@ -0,0 +1,233 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Spatial index of S57 chart objects
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#include "S57SpatialIndex.h"
+#include "viewport.h"
+
+namespace {
+
+struct Leaf
+{
+    float   minlat, minlon, maxlat, maxlon;
+    float   clat, clon;
+    int     id;
+};
+
+bool CompareLon(const Leaf &a, const Leaf &b) { return a.clon < b.clon; }
+bool CompareLat(const Leaf &a, const Leaf &b) { return a.clat < b.clat; }
+
+//  Float bounds never narrower than the double extent
+inline float FloorF(double v) { float f = (float)v; return f > v ? nextafterf(f, -HUGE_VALF) : f; }
+inline float CeilF(double v) { float f = (float)v; return f < v ? nextafterf(f, HUGE_VALF) : f; }
+
+}
+
+S57SpatialIndex::S57SpatialIndex()
+{
+}
+
+void S57SpatialIndex::Clear()
+{
+    for(int i = 0; i < PRIO_NUM; i++)
+        for(int j = 0; j < LUPNAME_NUM; j++)
+            m_lists[i][j] = List();
+}
+
+void S57SpatialIndex::Build(ObjRazRules *razRules[PRIO_NUM][LUPNAME_NUM])
+{
+    for(int i = 0; i < PRIO_NUM; i++)
+        for(int j = 0; j < LUPNAME_NUM; j++)
+            if(!m_lists[i][j].valid)
+                Build(i, j, razRules[i][j]);
+}
+
+void S57SpatialIndex::Build(int prio, int type, ObjRazRules *top)
+{
+    List &list = m_lists[prio][type];
+    list = List();
+    list.valid = true;
+
+    std::vector<Leaf> leaves;
+    for(int id = 0; top; top = top->next, id++) {
+        list.rules.push_back(top);
+
+        S57Obj *obj = top->obj;
+        Leaf leaf;
+        if(obj && obj->BBObj.GetValid()) {
+            leaf.minlat = FloorF(obj->BBObj.GetMinLat());
+            leaf.minlon = FloorF(obj->BBObj.GetMinLon());
+            leaf.maxlat = CeilF(obj->BBObj.GetMaxLat());
+            leaf.maxlon = CeilF(obj->BBObj.GetMaxLon());
+        }
+        else if(obj && obj->Primitive_type == GEO_POINT) {
+            leaf.minlat = FloorF(obj->m_lat);
+            leaf.minlon = FloorF(obj->m_lon);
+            leaf.maxlat = CeilF(obj->m_lat);
+            leaf.maxlon = CeilF(obj->m_lon);
+        }
+        else {
+            list.always.push_back(id);
+            continue;
+        }
+
+        if(!strncmp(obj->FeatureName, "LIGHTS", 6)) {
+            list.always.push_back(id);
+            continue;
+        }
+
+        leaf.clat = (leaf.minlat + leaf.maxlat) / 2;
+        leaf.clon = (leaf.minlon + leaf.maxlon) / 2;
+        leaf.id = id;
+        leaves.push_back(leaf);
+    }
+
+    size_t n = leaves.size();
+    if(!n)
+        return;
+
+    //  Sort-tile-recursive packing: slices by longitude, each sorted by latitude
+    size_t n_nodes = (n + S57_INDEX_NODE_SIZE - 1) / S57_INDEX_NODE_SIZE;
+    size_t n_slices = (size_t)ceil(sqrt((double)n_nodes));
+    size_t slice_size = n_slices * S57_INDEX_NODE_SIZE;
+
+    std::sort(leaves.begin(), leaves.end(), CompareLon);
+    for(size_t s = 0; s < n; s += slice_size)
+        std::sort(leaves.begin() + s, leaves.begin() + std::min(s + slice_size, n), CompareLat);
+
+    list.boxes.reserve(n + n_nodes + n_nodes / (S57_INDEX_NODE_SIZE - 1) + 1);
+    list.leaf_ids.reserve(n);
+    for(size_t i = 0; i < n; i++) {
+        Box box = { leaves[i].minlat, leaves[i].minlon, leaves[i].maxlat, leaves[i].maxlon };
+        list.boxes.push_back(box);
+        list.leaf_ids.push_back(leaves[i].id);
+    }
+    list.level_end.push_back(n);
+
+    //  Each level of nodes bounds consecutive runs of the level below
+    size_t level_start = 0;
+    while(list.level_end.back() - level_start > 1) {
+        size_t level_end = list.level_end.back();
+        for(size_t i = level_start; i < level_end; i += S57_INDEX_NODE_SIZE) {
+            Box node = list.boxes[i];
+            size_t end = std::min(i + S57_INDEX_NODE_SIZE, level_end);
+            for(size_t c = i + 1; c < end; c++) {
+                const Box &child = list.boxes[c];
+                node.minlat = std::min(node.minlat, child.minlat);
+                node.minlon = std::min(node.minlon, child.minlon);
+                node.maxlat = std::max(node.maxlat, child.maxlat);
+                node.maxlon = std::max(node.maxlon, child.maxlon);
+            }
+            list.boxes.push_back(node);
+        }
+        level_start = level_end;
+        list.level_end.push_back(list.boxes.size());
+    }
+}
+
+void S57SpatialIndex::Search(const List &list, const Box &box, std::vector<int> &ids) const
+{
+    if(list.boxes.empty())
+        return;
+
+    //  Node index, and its level
+    std::vector< std::pair<size_t, int> > stack;
+    stack.push_back(std::make_pair(list.boxes.size() - 1, (int)list.level_end.size() - 1));
+
+    while(stack.size()) {
+        size_t node = stack.back().first;
+        int level = stack.back().second;
+        stack.pop_back();
+
+        const Box &b = list.boxes[node];
+        if(b.maxlat < box.minlat || b.minlat > box.maxlat ||
+           b.maxlon < box.minlon || b.minlon > box.maxlon)
+            continue;
+
+        if(level == 0) {
+            ids.push_back(list.leaf_ids[node]);
+            continue;
+        }
+
+        size_t level_start = level > 1 ? list.level_end[level - 2] : 0;
+        size_t first = level_start + (node - list.level_end[level - 1]) * S57_INDEX_NODE_SIZE;
+        size_t end = std::min(first + S57_INDEX_NODE_SIZE, list.level_end[level - 1]);
+        for(size_t c = first; c < end; c++)
+            stack.push_back(std::make_pair(c, level - 1));
+    }
+}
+
+void S57SpatialIndex::Query(int prio, int type, const LLBBox &box, std::vector<ObjRazRules *> &rules) const
+{
+    rules.clear();
+
+    const List &list = m_lists[prio][type];
+    if(list.rules.empty())
+        return;
+
+    std::vector<int> ids(list.always);
+
+    //  As s52plib::ObjectRenderCheckPos(), objects may be a turn of the globe off
+    Box b = { FloorF(box.GetMinLat()), FloorF(box.GetMinLon()), CeilF(box.GetMaxLat()), CeilF(box.GetMaxLon()) };
+    Search(list, b, ids);
+    Box west = b;
+    west.minlon -= 360;
+    west.maxlon -= 360;
+    Search(list, west, ids);
+    Box east = b;
+    east.minlon += 360;
+    east.maxlon += 360;
+    Search(list, east, ids);
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    rules.reserve(ids.size());
+    for(size_t i = 0; i < ids.size(); i++)
+        rules.push_back(list.rules[ids[i]]);
+}
+
+LLBBox S57SpatialIndex::GetQueryBox(const LLBBox &box, const ViewPort &vp)
+{
+    if(vp.view_scale_ppm <= 0)
+        return box;
+
+    double margin_lat = S57_INDEX_MARGIN_PIXELS / vp.view_scale_ppm / 1852. / 60.;
+    double max_lat = wxMin(wxMax(fabs(box.GetMinLat()), fabs(box.GetMaxLat())), 85.);
+    double margin_lon = margin_lat / cos(max_lat * M_PI / 180.);
+
+    LLBBox query;
+    query.Set(box.GetMinLat() - margin_lat, box.GetMinLon() - margin_lon,
+              box.GetMaxLat() + margin_lat, box.GetMaxLon() + margin_lon);
+    return query;
+}
@@ -49,6 +49,7 @@ SENCJobTicket::SENCJobTicket()
 {
     m_SENCResult = SENC_BUILD_INACTIVE;
     m_status = THREAD_INACTIVE;
+    m_cell_size = 0;
 }
 
 const wxEventType wxEVT_OCPN_BUILDSENCTHREAD = wxNewEventType();
@@ -98,6 +99,11 @@ SENCThreadManager::SENCThreadManager()
 
 //    if(bthread_debug)
     printf(" SENC: nCPU: %d    m_max_jobs :%d\n", nCPU, m_max_jobs);
+
+    m_batch_cells = 0;
+    m_batch_errors = 0;
+    m_batch_bytes = 0;
+    m_batch_tess_ms = 0;
     
     
     //  Create/connect a dynamic event handler slot for messages from the worker threads
@@ -121,6 +127,30 @@ SENCThreadStatus SENCThreadManager::ScheduleJob(SENCJobTicket *ticket)
                 return THREAD_PENDING;
     }
     
+    //  A new batch?
+    if(ticket_list.empty()){
+        m_batch_sw.Start();
+        m_batch_cells = 0;
+        m_batch_errors = 0;
+        m_batch_bytes = 0;
+        m_batch_tess_ms = OsencTessPool::Get()->GetTessTime();
+    }
+
+    //  The base cell and its updates, .001, .002 ... in turn
+    wxFileName fn(ticket->m_FullPath000);
+    ticket->m_cell_size = fn.GetSize();
+    if(ticket->m_cell_size == wxInvalidSize)
+        ticket->m_cell_size = 0;
+    for(int iupd = 1 ; iupd < 1000 ; iupd++){
+        wxFileName ufn(fn);
+        ufn.SetExt(wxString::Format(_T("%03d"), iupd));
+        if(!ufn.FileExists())
+            break;
+        wxULongLong usize = ufn.GetSize();
+        if(usize != wxInvalidSize)
+            ticket->m_cell_size += usize;
+    }
+
     ticket->m_status = THREAD_PENDING;
     ticket_list.push_back(ticket);
 
@@ -143,12 +173,12 @@ void SENCThreadManager::StartTopJob()
     // OK to start one?
     if(nRunning < m_max_jobs){
 
-        // Find the first eligible
+        // Find the largest eligible, so that the longest builds do not come last
         startCandidate = NULL;    
         for(size_t i=0 ; i < ticket_list.size() ; i++){
             if(ticket_list[i]->m_status == THREAD_PENDING){
-                startCandidate = ticket_list[i];
-                break;
+                if(!startCandidate || ticket_list[i]->m_cell_size > startCandidate->m_cell_size)
+                    startCandidate = ticket_list[i];
             }
         }
         
@@ -184,6 +214,17 @@ void SENCThreadManager::FinishJob(SENCJobTicket *ticket)
             ticket_list.erase(ticket_list.begin() + i);
             //printf("Job count:  %d\n", ticket_list.size());
 
+            m_batch_cells++;
+            m_batch_bytes += ticket->m_cell_size;
+
+            //  Last of the batch?
+            if(ticket_list.empty()){
+                long tess_ms = OsencTessPool::Get()->GetTessTime() - m_batch_tess_ms;
+                wxLogMessage(_T("SENC: built %d cells (%d errors), %.1f MB in %.2f sec, tessellation %.2f sec on all threads"),
+                             m_batch_cells, m_batch_errors, m_batch_bytes.ToDouble() / (1024. * 1024.),
+                             m_batch_sw.Time() / 1000., tess_ms / 1000.);
+            }
+
             break;
         }
     }
@@ -213,6 +254,19 @@ int SENCThreadManager::GetJobCount()
     return ticket_list.size();
 }
 
+//  Drop the jobs not yet started, those running are left to finish
+void SENCThreadManager::CancelPendingJobs()
+{
+    for(size_t i=0 ; i < ticket_list.size() ; ){
+        if(ticket_list[i]->m_status == THREAD_PENDING){
+            delete ticket_list[i];
+            ticket_list.erase(ticket_list.begin() + i);
+        }
+        else
+            i++;
+    }
+}
+
 bool SENCThreadManager::IsChartInTicketlist(s57chart *chart)
 {
      for(size_t i=0 ; i < ticket_list.size() ; i++){
@@ -261,6 +315,7 @@ void SENCThreadManager::OnEvtThread( OCPN_BUILDSENC_ThreadEvent & event )
             //printf("SENC build done ERROR\n");
             Sevent.type = SENC_BUILD_DONE_ERROR;
             Sevent.m_ticket = event.m_ticket;
+            m_batch_errors++;
             FinishJob(event.m_ticket);
             StartTopJob();
 
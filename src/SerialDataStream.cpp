@@ -130,6 +130,22 @@ void SerialDataStream::Open(void)
 }
 
 
+//  Runs on the output thread. The RX thread owns the port and its out queue is
+//  short, so wait for room here rather than dropping; overflow is then handled
+//  by the policy of our own OutputQueue.
+bool SerialDataStream::WriteSentence(const std::string &payload)
+{
+    wxString msg(payload.c_str(), wxConvUTF8);
+    for(int i = 0; i < 100; i++) {
+        if( !GetSecondaryThread() || !IsSecThreadActive() )
+            return false;
+        if( GetSecondaryThread()->SetOutMsg( msg ))
+            return true;
+        wxMilliSleep(10);
+    }
+    return false;
+}
+
 bool SerialDataStream::SendSentenceSerial(const wxString &payload)
 {
     if( GetSecondaryThread() ) {
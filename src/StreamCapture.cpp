@@ -0,0 +1,451 @@
+/***************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Data stream capture log, writer and reader
+ *
+ ***************************************************************************
+ *   Copyright (C) 2020 by David S. Register                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301,  USA.         *
+ **************************************************************************/
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+#include "wx/wx.h"
+#endif //precompiled headers
+
+#include <wx/time.h>
+
+#include <string.h>
+#include <algorithm>
+
+#include "StreamCapture.h"
+#include "lz4.h"
+
+static const char CAPTURE_FILE_MAGIC[8] = { 'O', 'C', 'P', 'N', 'C', 'A', 'P', '1' };
+static const char CAPTURE_INDEX_MAGIC[8] = { 'O', 'C', 'P', 'N', 'C', 'I', 'D', 'X' };
+static const uint32_t CAPTURE_BLOCK_MAGIC = 0x4B4C4243;        // "CBLK"
+
+//  On disk block header
+struct CaptureBlockHeader
+{
+    uint32_t    magic;
+    uint32_t    raw_size;
+    uint32_t    comp_size;
+    uint32_t    n_records;
+    int64_t     first_timestamp;
+    int64_t     last_timestamp;
+};
+
+#define CAPTURE_RECORD_HEADER_SIZE  (8 + 1 + 2 + 4)
+#define CAPTURE_TRAILER_SIZE        (8 + 4 + 8)
+
+//  Little endian helpers, the log must be portable between hosts
+static void put_le(std::vector<char> &buf, uint64_t v, int n)
+{
+    for(int i = 0; i < n; i++)
+        buf.push_back((char)((v >> (8 * i)) & 0xff));
+}
+
+static uint64_t get_le(const char *p, int n)
+{
+    uint64_t v = 0;
+    for(int i = 0; i < n; i++)
+        v |= ((uint64_t)(unsigned char)p[i]) << (8 * i);
+    return v;
+}
+
+static bool write_block_header(FILE *f, const CaptureBlockHeader &h)
+{
+    std::vector<char> buf;
+    put_le(buf, h.magic, 4);
+    put_le(buf, h.raw_size, 4);
+    put_le(buf, h.comp_size, 4);
+    put_le(buf, h.n_records, 4);
+    put_le(buf, (uint64_t)h.first_timestamp, 8);
+    put_le(buf, (uint64_t)h.last_timestamp, 8);
+    return fwrite(&buf[0], 1, buf.size(), f) == buf.size();
+}
+
+#define CAPTURE_BLOCK_HEADER_SIZE   (4 * 4 + 2 * 8)
+
+static bool read_block_header(FILE *f, CaptureBlockHeader &h)
+{
+    char buf[CAPTURE_BLOCK_HEADER_SIZE];
+    if(fread(buf, 1, sizeof buf, f) != sizeof buf)
+        return false;
+    h.magic = (uint32_t)get_le(buf, 4);
+    h.raw_size = (uint32_t)get_le(buf + 4, 4);
+    h.comp_size = (uint32_t)get_le(buf + 8, 4);
+    h.n_records = (uint32_t)get_le(buf + 12, 4);
+    h.first_timestamp = (int64_t)get_le(buf + 16, 8);
+    h.last_timestamp = (int64_t)get_le(buf + 24, 8);
+    return h.magic == CAPTURE_BLOCK_MAGIC;
+}
+
+//------------------------------------------------------------------------------
+//    StreamCaptureWriter Implementation
+//------------------------------------------------------------------------------
+
+StreamCaptureWriter::StreamCaptureWriter()
+    : m_file(NULL),
+      m_block_first_ts(0),
+      m_block_last_ts(0),
+      m_block_records(0),
+      m_n_records_total(0)
+{
+}
+
+StreamCaptureWriter::~StreamCaptureWriter()
+{
+    Close();
+}
+
+bool StreamCaptureWriter::Open(const std::string &path)
+{
+    Close();
+
+    m_file = fopen(path.c_str(), "wb");
+    if(!m_file) {
+        wxLogMessage(_T("   StreamCapture: cannot create ") + wxString(path.c_str(), wxConvUTF8));
+        return false;
+    }
+    if(fwrite(CAPTURE_FILE_MAGIC, 1, sizeof CAPTURE_FILE_MAGIC, m_file) != sizeof CAPTURE_FILE_MAGIC) {
+        fclose(m_file);
+        m_file = NULL;
+        return false;
+    }
+
+    m_path = path;
+    m_block.clear();
+    m_block.reserve(CAPTURE_BLOCK_SIZE + 1024);
+    m_index.clear();
+    m_block_records = 0;
+    m_n_records_total = 0;
+
+    wxLogMessage(_T("   StreamCapture: recording to ") + wxString(path.c_str(), wxConvUTF8));
+    return true;
+}
+
+void StreamCaptureWriter::Close()
+{
+    if(!m_file)
+        return;
+
+    Flush();
+
+    //  Index and trailer
+    uint64_t index_offset = (uint64_t)ftell(m_file);
+    std::vector<char> buf;
+    for(size_t i = 0; i < m_index.size(); i++) {
+        put_le(buf, m_index[i].offset, 8);
+        put_le(buf, (uint64_t)m_index[i].first_timestamp, 8);
+    }
+    put_le(buf, index_offset, 8);
+    put_le(buf, (uint64_t)m_index.size(), 4);
+    buf.insert(buf.end(), CAPTURE_INDEX_MAGIC, CAPTURE_INDEX_MAGIC + sizeof CAPTURE_INDEX_MAGIC);
+    fwrite(&buf[0], 1, buf.size(), m_file);
+
+    fclose(m_file);
+    m_file = NULL;
+
+    wxLogMessage(wxString::Format(_T("   StreamCapture: closed, %lu records in %lu blocks"),
+                                  (unsigned long)m_n_records_total, (unsigned long)m_index.size()));
+}
+
+void StreamCaptureWriter::Append(int kind, const std::string &source, const std::string &data)
+{
+    Append((int64_t)wxGetUTCTimeUSec().GetValue(), kind, source, data);
+}
+
+void StreamCaptureWriter::Append(int64_t timestamp, int kind,
+                                 const std::string &source, const std::string &data)
+{
+    if(!m_file)
+        return;
+
+    if(m_block_records == 0)
+        m_block_first_ts = timestamp;
+    else if(timestamp < m_block_last_ts)
+        timestamp = m_block_last_ts;            // keep the log monotonic
+    m_block_last_ts = timestamp;
+
+    size_t source_len = std::min(source.size(), (size_t)0xffff);
+    put_le(m_block, (uint64_t)timestamp, 8);
+    put_le(m_block, (uint64_t)kind, 1);
+    put_le(m_block, source_len, 2);
+    put_le(m_block, data.size(), 4);
+    m_block.insert(m_block.end(), source.begin(), source.begin() + source_len);
+    m_block.insert(m_block.end(), data.begin(), data.end());
+    m_block_records++;
+    m_n_records_total++;
+
+    if(m_block.size() >= CAPTURE_BLOCK_SIZE ||
+       timestamp - m_block_first_ts >= CAPTURE_BLOCK_MAX_AGE_US)
+        Flush();
+}
+
+void StreamCaptureWriter::Flush()
+{
+    if(!m_file || !m_block_records)
+        return;
+
+    int bound = LZ4_COMPRESSBOUND(m_block.size());
+    if((int)m_compressed.size() < bound)
+        m_compressed.resize(bound);
+
+    int comp_size = LZ4_compress(&m_block[0], &m_compressed[0], m_block.size());
+
+    CaptureBlockIndex idx;
+    idx.offset = (uint64_t)ftell(m_file);
+    idx.first_timestamp = m_block_first_ts;
+
+    CaptureBlockHeader h;
+    h.magic = CAPTURE_BLOCK_MAGIC;
+    h.raw_size = m_block.size();
+    h.comp_size = comp_size;
+    h.n_records = m_block_records;
+    h.first_timestamp = m_block_first_ts;
+    h.last_timestamp = m_block_last_ts;
+
+    if(comp_size > 0 && write_block_header(m_file, h) &&
+       fwrite(&m_compressed[0], 1, comp_size, m_file) == (size_t)comp_size) {
+        m_index.push_back(idx);
+        fflush(m_file);
+    }
+    else
+        wxLogMessage(_T("   StreamCapture: block write failed"));
+
+    m_block.clear();
+    m_block_records = 0;
+}
+
+//------------------------------------------------------------------------------
+//    StreamCaptureReader Implementation
+//------------------------------------------------------------------------------
+
+StreamCaptureReader::StreamCaptureReader()
+    : m_file(NULL),
+      m_end_ts(0),
+      m_block_pos(0),
+      m_current_block(0)
+{
+}
+
+StreamCaptureReader::~StreamCaptureReader()
+{
+    Close();
+}
+
+bool StreamCaptureReader::Open(const std::string &path)
+{
+    Close();
+
+    m_file = fopen(path.c_str(), "rb");
+    if(!m_file)
+        return false;
+
+    char magic[sizeof CAPTURE_FILE_MAGIC];
+    if(fread(magic, 1, sizeof magic, m_file) != sizeof magic ||
+       memcmp(magic, CAPTURE_FILE_MAGIC, sizeof magic)) {
+        Close();
+        return false;
+    }
+
+    if(!ReadIndex()) {
+        wxLogMessage(_T("   StreamCapture: no index, rebuilding from block headers"));
+        if(!RebuildIndex()) {
+            Close();
+            return false;
+        }
+    }
+
+    return SeekBlock(0);
+}
+
+void StreamCaptureReader::Close()
+{
+    if(m_file)
+        fclose(m_file);
+    m_file = NULL;
+    m_index.clear();
+    m_block.clear();
+    m_block_pos = 0;
+    m_current_block = 0;
+    m_end_ts = 0;
+}
+
+bool StreamCaptureReader::ReadIndex()
+{
+    if(fseek(m_file, -CAPTURE_TRAILER_SIZE, SEEK_END))
+        return false;
+
+    char trailer[CAPTURE_TRAILER_SIZE];
+    if(fread(trailer, 1, sizeof trailer, m_file) != sizeof trailer)
+        return false;
+    if(memcmp(trailer + 12, CAPTURE_INDEX_MAGIC, sizeof CAPTURE_INDEX_MAGIC))
+        return false;
+
+    uint64_t index_offset = get_le(trailer, 8);
+    uint32_t n_blocks = (uint32_t)get_le(trailer + 8, 4);
+
+    std::vector<char> buf(n_blocks * 16 + 1);
+    if(fseek(m_file, index_offset, SEEK_SET) ||
+       fread(&buf[0], 1, n_blocks * 16, m_file) != n_blocks * 16)
+        return false;
+
+    m_index.resize(n_blocks);
+    for(uint32_t i = 0; i < n_blocks; i++) {
+        m_index[i].offset = get_le(&buf[i * 16], 8);
+        m_index[i].first_timestamp = (int64_t)get_le(&buf[i * 16 + 8], 8);
+    }
+
+    //  The last block header carries the end time
+    if(n_blocks) {
+        CaptureBlockHeader h;
+        if(fseek(m_file, m_index.back().offset, SEEK_SET) || !read_block_header(m_file, h))
+            return false;
+        m_end_ts = h.last_timestamp;
+    }
+    return true;
+}
+
+bool StreamCaptureReader::RebuildIndex()
+{
+    m_index.clear();
+    if(fseek(m_file, sizeof CAPTURE_FILE_MAGIC, SEEK_SET))
+        return false;
+
+    CaptureBlockHeader h;
+    for(;;) {
+        CaptureBlockIndex idx;
+        idx.offset = (uint64_t)ftell(m_file);
+        if(!read_block_header(m_file, h))
+            break;
+        if(fseek(m_file, h.comp_size, SEEK_CUR))
+            break;
+        idx.first_timestamp = h.first_timestamp;
+        m_index.push_back(idx);
+        m_end_ts = h.last_timestamp;
+    }
+    return true;
+}
+
+bool StreamCaptureReader::LoadBlock(size_t block)
+{
+    m_block.clear();
+    m_block_pos = 0;
+    m_current_block = block;
+    if(block >= m_index.size())
+        return false;
+
+    CaptureBlockHeader h;
+    if(fseek(m_file, m_index[block].offset, SEEK_SET) || !read_block_header(m_file, h))
+        return false;
+
+    std::vector<char> comp(h.comp_size);
+    if(fread(&comp[0], 1, h.comp_size, m_file) != h.comp_size)
+        return false;
+
+    m_block.resize(h.raw_size);
+    int n = LZ4_decompress_safe(&comp[0], &m_block[0], h.comp_size, h.raw_size);
+    if(n != (int)h.raw_size) {
+        wxLogMessage(wxString::Format(_T("   StreamCapture: damaged block %lu"), (unsigned long)block));
+        m_block.clear();
+        return false;
+    }
+    return true;
+}
+
+bool StreamCaptureReader::SeekBlock(size_t block)
+{
+    if(!m_file)
+        return false;
+    return LoadBlock(block);
+}
+
+bool StreamCaptureReader::Next(CaptureRecord &rec)
+{
+    while(m_block_pos >= m_block.size()) {
+        if(m_current_block + 1 >= m_index.size())
+            return false;
+        if(!LoadBlock(m_current_block + 1))
+            return false;
+    }
+
+    if(m_block_pos + CAPTURE_RECORD_HEADER_SIZE > m_block.size())
+        return false;
+
+    const char *p = &m_block[m_block_pos];
+    rec.timestamp = (int64_t)get_le(p, 8);
+    rec.kind = (int)get_le(p + 8, 1);
+    size_t source_len = get_le(p + 9, 2);
+    size_t data_len = get_le(p + 11, 4);
+    p += CAPTURE_RECORD_HEADER_SIZE;
+
+    if(m_block_pos + CAPTURE_RECORD_HEADER_SIZE + source_len + data_len > m_block.size())
+        return false;
+
+    rec.source.assign(p, source_len);
+    rec.data.assign(p + source_len, data_len);
+    m_block_pos += CAPTURE_RECORD_HEADER_SIZE + source_len + data_len;
+    return true;
+}
+
+bool StreamCaptureReader::Seek(int64_t ts)
+{
+    if(m_index.empty() || ts > m_end_ts)
+        return false;
+
+    //  Last block starting at or before ts
+    size_t block = 0;
+    size_t lo = 0, hi = m_index.size();
+    while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(m_index[mid].first_timestamp <= ts) {
+            block = mid;
+            lo = mid + 1;
+        }
+        else
+            hi = mid;
+    }
+
+    if(!SeekBlock(block))
+        return false;
+
+    //  Skip forward within the block
+    size_t pos;
+    CaptureRecord rec;
+    for(;;) {
+        pos = m_block_pos;
+        size_t cur = m_current_block;
+        if(!Next(rec))
+            return false;
+        if(rec.timestamp >= ts) {
+            if(cur != m_current_block)
+                LoadBlock(m_current_block);     // record was first of next block
+            else
+                m_block_pos = pos;
+            return true;
+        }
+    }
+}
+
+int64_t StreamCaptureReader::GetStartTime() const
+{
+    return m_index.size() ? m_index[0].first_timestamp : 0;
+}
@@ -25,6 +25,8 @@
 
 #include <wx/wx.h>
 
+#include <math.h>
+
 #include "TexFont.h"
 
 #ifdef USE_ANDROID_GLES2
@@ -213,6 +215,10 @@ void TexFont::Delete( )
         texobj = 0;
     }
     m_built = false;
+
+    m_batch_coords.clear();
+    m_batch_uv.clear();
+    m_batch_colors.clear();
 }
 
 void TexFont::GetTextExtent(const char *string, int *width, int *height)
@@ -438,4 +444,79 @@ void TexFont::RenderString( const wxString &string, int x, int y )
     RenderString((const char*)string.ToUTF8(), x, y);
 }
 
+void TexFont::AddString( const char *string, float x, float y, float angle, const wxColour &color )
+{
+    float c = cosf( angle );
+    float s = sinf( angle );
+    float w = m_maxglyphw, h = m_maxglyphh;
+    float px = 0, py = 0;
+
+    for( int i = 0; string[i]; i++ ) {
+        unsigned char ch = string[i];
+        if(ch == '\n') {
+            px = 0;
+            py += tgi[(int)'A'].height;
+            continue;
+        }
+        /* degree symbol */
+        if(ch == 0xc2 && (unsigned char)string[i+1] == 0xb0) {
+            ch = DEGREE_GLYPH;
+            i++;
+        }
+        if( ch < MIN_GLYPH || ch >= MAX_GLYPH)
+            continue;
+
+        TexGlyphInfo &tgic = tgi[ch];
+        float tx1 = (float)tgic.x / (float)tex_w;
+        float tx2 = (float)(tgic.x + w) / (float)tex_w;
+        float ty1 = (float)tgic.y / (float)tex_h;
+        float ty2 = (float)(tgic.y + h) / (float)tex_h;
+
+        float qx[4] = { px, px + w, px + w, px };
+        float qy[4] = { py, py, py + h, py + h };
+        float qu[4] = { tx1, tx2, tx2, tx1 };
+        float qv[4] = { ty1, ty1, ty2, ty2 };
+
+        for( int k = 0; k < 4; k++ ) {
+            m_batch_coords.push_back( x + qx[k] * c - qy[k] * s );
+            m_batch_coords.push_back( y + qx[k] * s + qy[k] * c );
+            m_batch_uv.push_back( qu[k] );
+            m_batch_uv.push_back( qv[k] );
+            m_batch_colors.push_back( color.Red() );
+            m_batch_colors.push_back( color.Green() );
+            m_batch_colors.push_back( color.Blue() );
+            m_batch_colors.push_back( 255 );
+        }
+
+        px += tgic.advance;
+    }
+}
+
+void TexFont::FlushBatch()
+{
+#ifndef USE_ANDROID_GLES2
+    if( !m_batch_coords.empty() && texobj ) {
+        glBindTexture( GL_TEXTURE_2D, texobj );
+
+        glEnableClientState( GL_VERTEX_ARRAY );
+        glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+        glEnableClientState( GL_COLOR_ARRAY );
+
+        glVertexPointer( 2, GL_FLOAT, 0, &m_batch_coords[0] );
+        glTexCoordPointer( 2, GL_FLOAT, 0, &m_batch_uv[0] );
+        glColorPointer( 4, GL_UNSIGNED_BYTE, 0, &m_batch_colors[0] );
+
+        glDrawArrays( GL_QUADS, 0, m_batch_coords.size() / 2 );
+
+        glDisableClientState( GL_COLOR_ARRAY );
+        glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+        glDisableClientState( GL_VERTEX_ARRAY );
+    }
+#endif
+
+    m_batch_coords.clear();
+    m_batch_uv.clear();
+    m_batch_colors.clear();
+}
+
 //#endif     //#ifdef ocpnUSE_GL
@@ -991,6 +991,7 @@ void CanvasMenuHandler::PopupMenuHandler( wxCommandEvent& event )
     case ID_DEF_MENU_MOVE_BOAT_HERE:
         gLat = zlat;
         gLon = zlon;
+        gFrame->PublishOwnShipState();
         break;
 
     case ID_DEF_MENU_GOTO_HERE: {
@@ -106,6 +106,7 @@
 #include "OCPN_DataStreamEvent.h"
 #include "OCPN_SignalKEvent.h"
 #include "multiplexer.h"
+#include "ReplayDataStream.h"
 #include "routeprintout.h"
 #include "Select.h"
 #include "FontMgr.h"
@@ -138,6 +139,8 @@
 #include "SoundFactory.h"
 #include "PluginHandler.h"
 #include "SignalKEventHandler.h"
+#include "OwnShipState.h"
+#include "RasterBandCache.h"
 
 #ifdef ocpnUSE_GL
 #include "glChartCanvas.h"
@@ -151,8 +154,10 @@
 #endif
 
 #include "cm93.h"
+#include "CM93CellLoader.h"
 #include "s52plib.h"
 #include "s57chart.h"
+#include "Osenc.h"
 #include "gdal/cpl_csv.h"
 #include "s52utils.h"
 
@@ -214,6 +219,9 @@ int                       g_unit_test_2;
 bool                      g_start_fullscreen;
 bool                      g_rebuild_gl_cache;
 bool                      g_parse_all_enc;
+wxString                  g_capture_file;
+wxString                  g_replay_file;
+double                    g_replay_speed = 1.0;
 
 // Files specified on the command line, if any.
 wxVector<wxString> g_params;
@@ -253,6 +261,7 @@ RouteManagerDialog        *pRouteManagerDialog;
 GoToPositionDialog        *pGoToPositionDialog;
 
 double                    gLat, gLon, gCog, gSog, gHdt, gHdm, gVar;
+OwnShipState              g_OwnShipState;               // snapshot of the above for other threads
 wxString                  gRmcDate, gRmcTime;
 double                    vLat, vLon;
 double                    initial_scale_ppm, initial_rotation;
@@ -489,6 +498,10 @@ bool                      g_bUseGLL = true;
 
 int                       g_nCacheLimit;
 int                       g_memCacheLimit;
+int                       g_chartCacheBudgetMB;
+bool                      g_bAsyncChartOpen = true;
+int                       g_rasterBandCacheMB = 64;
+RasterBandCache           g_RasterBandCache;            // decoded BSB bands, shared by all charts
 bool                      g_bGDAL_Debug;
 
 double                    g_VPRotate; // Viewport rotation angle, used on "Course Up" mode
@@ -695,6 +708,7 @@ bool                      g_bShowStatusBar;
 
 bool                      g_bquiting;
 int                       g_BSBImgDebug;
+int                       g_MBTilesDebug;
 
 AISTargetListDialog       *g_pAISTargetList;
 wxString                  g_AisTargetList_perspective;
@@ -759,6 +773,8 @@ int               g_sticky_chart;
 int               g_sticky_projection;
 
 bool              g_benableUDPNullHeader;
+int               g_OutputQueueDepth = OUTPUT_QUEUE_DEFAULT_DEPTH;
+int               g_OutputQueuePolicy = OUTPUT_DROP_OLDEST;
 
 extern options          *g_pOptions;
 
@@ -1113,6 +1129,9 @@ void MyApp::OnInitCmdLine( wxCmdLineParser& parser )
     parser.AddOption( _T("l"), _T("loglevel"), _("Amount of logging: error, warning, message, info, debug or trace"));
     parser.AddOption( _T("unit_test_1"), wxEmptyString, _("Display a slideshow of <num> charts and then exit. Zero or negative <num> specifies no limit."), wxCMD_LINE_VAL_NUMBER );
     parser.AddSwitch( _T("unit_test_2") );
+    parser.AddOption( _T("capture"), wxEmptyString, _T("Record all received data to a capture log <file>.") );
+    parser.AddOption( _T("replay"), wxEmptyString, _T("Replay a capture log <file> as an additional input connection.") );
+    parser.AddOption( _T("replay_speed"), wxEmptyString, _T("Replay speed factor, 1 is real time, 0 is unthrottled."), wxCMD_LINE_VAL_DOUBLE );
     parser.AddParam("import GPX files",
                         wxCMD_LINE_VAL_STRING,
                         wxCMD_LINE_PARAM_OPTIONAL | wxCMD_LINE_PARAM_MULTIPLE);
@@ -1150,6 +1169,9 @@ bool MyApp::OnCmdLineParsed( wxCmdLineParser& parser )
     g_bdisable_opengl = parser.Found( _T("no_opengl") );
     g_rebuild_gl_cache = parser.Found( _T("rebuild_gl_raster_cache") );
     g_parse_all_enc = parser.Found( _T("parse_all_enc") );
+    parser.Found( _T("capture"), &g_capture_file );
+    parser.Found( _T("replay"), &g_replay_file );
+    parser.Found( _T("replay_speed"), &g_replay_speed );
     if( parser.Found( _T("unit_test_1"), &number ) )
     {
         g_unit_test_1 = static_cast<int>( number );
@@ -2858,11 +2880,21 @@ MyFrame::MyFrame( wxFrame *frame, const wxString& title, const wxPoint& pos, con
     gSog = NAN;
     gCog = NAN;
 
+    //  Convert only the fields OnEvtOCPN_NMEA() uses
+    m_NMEA0183.Hdt.FieldMask = NMEA0183_FIELD( 1 );
+    m_NMEA0183.Hdm.FieldMask = NMEA0183_FIELD( 1 );
+    m_NMEA0183.Hdg.FieldMask = NMEA0183_FIELD( 1 ) | NMEA0183_FIELD( 4 ) | NMEA0183_FIELD( 5 );
+    m_NMEA0183.Vtg.FieldMask = NMEA0183_FIELD( 1 ) | NMEA0183_FIELD( 5 );
+    m_NMEA0183.Gsv.FieldMask = NMEA0183_FIELD( 3 );
+
     for (int i = 0; i < MAX_COG_AVERAGE_SECONDS; i++ )
         COGTable[i] = NAN;
 
     m_fixtime = 0;
 
+    //    Initial (configured) position, until the first fix
+    PublishOwnShipState();
+
     m_bpersistent_quilt = false;
 
     m_ChartUpdatePeriod = 1;                  // set the default (1 sec.) period
@@ -2926,6 +2958,16 @@ MyFrame::~MyFrame()
 {
     FrameTimer1.Stop();
     delete ChartData;
+
+    //  Start no more SENC builds, and stop the tessellation workers.  A build
+    //  still running tessellates on its own thread, and keeps the pool.
+    if( g_SencThreadManager )
+        g_SencThreadManager->CancelPendingJobs();
+    if( !g_SencThreadManager || !g_SencThreadManager->GetJobCount() )
+        OsencTessPool::Shutdown();
+    else
+        OsencTessPool::Stop();
+    CM93CellLoader::Shutdown();
     //delete pCurrentStack;
 
 //      Free the Route List
@@ -6941,6 +6983,12 @@ void MyFrame::OnInitTimer(wxTimerEvent& event)
                 }
             }
 
+            if( !g_replay_file.IsEmpty() )
+                g_pMUX->AddStream(new ReplayDataStream(g_pMUX, g_replay_file, g_replay_speed));
+
+            if( !g_capture_file.IsEmpty() )
+                g_pMUX->StartCapture(g_capture_file);
+
             console = new ConsoleCanvas( gFrame );                    // the console
             console->SetColorScheme( global_color_scheme );
             break;
@@ -7165,54 +7213,27 @@ void MyFrame::OnMemFootTimer( wxTimerEvent& event )
     if( memsize > ( g_MemFootMB * 1000 ) ) {
         ChartCanvas *cc = GetPrimaryCanvas();
         if( ChartData && cc ) {
-            //    Get a local copy of the cache info
-            wxArrayPtrVoid *pCache = ChartData->GetChartCache();
-            unsigned int nCache = pCache->GetCount();
-            CacheEntry *pcea = new CacheEntry[nCache];
-
-            for( unsigned int i = 0; i < nCache; i++ ) {
-                CacheEntry *pce = (CacheEntry *) ( pCache->Item( i ) );
-                pcea[i] = *pce;                  //ChartBase *Ch = (ChartBase *)pce->pChart;
-            }
+            //    Get the unlocked cached charts, oldest first
+            std::vector<ChartBase *> charts;
+            ChartData->GetCacheChartsByAge( charts );
 
-            if( nCache > 1 ) {
-                //    Bubble Sort the local cache entry array
-                bool b_cont = true;
-                while( b_cont ) {
-                    b_cont = false;
-                    for( unsigned int i = 0; i < nCache - 1; i++ ) {
-                        if( pcea[i].RecentTime > pcea[i + 1].RecentTime ) {
-                            CacheEntry tmp = pcea[i];
-                            pcea[i] = pcea[i + 1];
-                            pcea[i + 1] = tmp;
-                            b_cont = true;
-                            break;
-                        }
-                    }
-                }
+            //    Free up some chart cache entries until the memory footprint target is realized
 
-                //    Free up some chart cache entries until the memory footprint target is realized
+            unsigned int idelete = 0;                 // starting at top. which is oldest
 
-                unsigned int idelete = 0;                 // starting at top. which is oldest
-                unsigned int idelete_max = pCache->GetCount();
+            //    How many can be deleted?
+            unsigned int minimum_cache = 1;
+            if( cc->GetQuiltMode() ) minimum_cache = cc->GetQuiltChartCount();
 
-                //    How many can be deleted?
-                unsigned int minimum_cache = 1;
-                if( cc->GetQuiltMode() ) minimum_cache = cc->GetQuiltChartCount();
-
-                while( ( memsize > ( g_MemFootMB * 1000 ) )
-                        && ( pCache->GetCount() > minimum_cache ) && ( idelete < idelete_max ) ) {
-                    int memsizeb = memsize;
-
-                    ChartData->DeleteCacheChart( (ChartBase *) pcea[idelete].pChart );
-                    idelete++;
-                    memsize = GetApplicationMemoryUse();
-                    printf( "delete, before: %d  after: %d\n", memsizeb, memsize );
-                }
+            while( ( memsize > ( g_MemFootMB * 1000 ) )
+                    && ( ChartData->GetCacheStats().count > (int)minimum_cache ) && ( idelete < charts.size() ) ) {
+                int memsizeb = memsize;
 
+                ChartData->DeleteCacheChart( charts[idelete] );
+                idelete++;
+                memsize = GetApplicationMemoryUse();
+                printf( "delete, before: %d  after: %d\n", memsizeb, memsize );
             }
-
-            delete[] pcea;
         }
 
     }
@@ -7400,20 +7421,25 @@ void MyFrame::OnFrameTimer1( wxTimerEvent& event )
                 _T("   ***SAT Watchdog timeout...") );
     }
 
+    //    Watchdogs may have invalidated some of the own-ship data
+    PublishOwnShipState();
+
     //    Build and send a Position Fix event to PlugIns
     if( g_pi_manager )
     {
+        OwnShipFix fix = g_OwnShipState.Get();
+
         GenericPosDatEx GPSData;
-        GPSData.kLat = gLat;
-        GPSData.kLon = gLon;
-        GPSData.kCog = gCog;
-        GPSData.kSog = gSog;
-        GPSData.kVar = gVar;
-        GPSData.kHdm = gHdm;
-        GPSData.kHdt = gHdt;
-        GPSData.nSats = g_SatsInView;
+        GPSData.kLat = fix.lat;
+        GPSData.kLon = fix.lon;
+        GPSData.kCog = fix.cog;
+        GPSData.kSog = fix.sog;
+        GPSData.kVar = fix.var;
+        GPSData.kHdm = fix.hdm;
+        GPSData.kHdt = fix.hdt;
+        GPSData.nSats = fix.n_sats;
 
-        GPSData.FixTime = m_fixtime;
+        GPSData.FixTime = fix.fix_time;
 
         g_pi_manager->SendPositionFixToAllPlugIns( &GPSData );
     }
@@ -9329,6 +9355,8 @@ void MyFrame::PostProcessNMEA( bool pos_valid, bool cog_sog_valid, const wxStrin
         
     }
 
+    PublishOwnShipState();
+
 #ifdef ocpnUPDATE_SYSTEM_TIME
 //      Use the fix time to update the local system clock, only once per session
     if( ( sfixtime.Len() ) && s_bSetSystemTime && ( m_bTimeIsSet == false ) ) {
@@ -9421,6 +9449,30 @@ void MyFrame::PostProcessNMEA( bool pos_valid, bool cog_sog_valid, const wxStrin
 #endif            //ocpnUPDATE_SYSTEM_TIME
 }
 
+//    Publish the own-ship globals for readers outside of the GUI thread
+void MyFrame::PublishOwnShipState( void )
+{
+    OwnShipFix fix;
+    fix.lat = gLat;
+    fix.lon = gLon;
+    fix.cog = gCog;
+    fix.sog = gSog;
+    fix.hdt = gHdt;
+    fix.hdm = gHdm;
+    fix.var = gVar;
+    fix.n_sats = g_SatsInView;
+    fix.fix_time = m_fixtime;
+
+    if( bGPSValid ) fix.flags |= OWNSHIP_POS_VALID;
+    if( !std::isnan(gCog) ) fix.flags |= OWNSHIP_COG_VALID;
+    if( !std::isnan(gSog) ) fix.flags |= OWNSHIP_SOG_VALID;
+    if( !std::isnan(gHdt) ) fix.flags |= OWNSHIP_HDT_VALID;
+    if( !std::isnan(gHdm) ) fix.flags |= OWNSHIP_HDM_VALID;
+    if( !std::isnan(gVar) ) fix.flags |= OWNSHIP_VAR_VALID;
+
+    g_OwnShipState.Publish( fix );
+}
+
 void MyFrame::FilterCogSog( void )
 {            
     if( g_bfilter_cogsog && !g_own_ship_sog_cog_calc ) {
@@ -42,6 +42,11 @@
 #include "chart1.h"
 #include "thumbwin.h"
 #include "mbtiles.h"
+#include "ChartOpenService.h"
+#include "RasterScaler.h"
+#include "RasterBandCache.h"
+#include "MBTilesLoader.h"
+#include "DepthHazards.h"
 
 #ifdef ocpnUSE_GL
 #include "glChartCanvas.h"
@@ -64,6 +69,8 @@ class s52plib;
 extern ThumbWin     *pthumbwin;
 extern int          g_nCacheLimit;
 extern int          g_memCacheLimit;
+extern int          g_chartCacheBudgetMB;
+extern int          g_rasterBandCacheMB;
 extern s52plib      *ps52plib;
 extern ChartDB      *ChartData;
 extern std::vector<int>      g_quilt_noshow_index_array;
@@ -222,19 +229,26 @@ void ChartStack::AddChart( int db_add )
 
 ChartDB::ChartDB()
 {
-      pChartCache = new wxArrayPtrVoid;
-
       SetValid(false);                           // until loaded or created
       UnLockCache();
       
       m_b_busy = false;
       m_ticks = 0;
+      m_open_service = new ChartOpenService(this);
+
+      //    An explicit chart cache budget, else a share of the application memory target
+      size_t budget = 0;
+      if(g_chartCacheBudgetMB > 0)
+            budget = (size_t)g_chartCacheBudgetMB * 1024 * 1024;
+      else if(g_memCacheLimit)
+            budget = (size_t)g_memCacheLimit * 1024 * 8 / 10;         // g_memCacheLimit is in kBytes
+      SetCacheBudget(budget, g_nCacheLimit);
 
       //    Report cache policy
-      if(g_memCacheLimit)
+      if(budget)
       {
             wxString msg;
-            msg.Printf(_T("ChartDB Cache policy:  Application target is %d MBytes"), g_memCacheLimit / 1024);
+            msg.Printf(_T("ChartDB Cache policy:  Chart cache budget is %d MBytes"), (int)(budget / (1024 * 1024)));
             wxLogMessage(msg);
       }
       else
@@ -244,21 +258,43 @@ ChartDB::ChartDB()
             wxLogMessage(msg);
       }
 
+      wxLogMessage(wxString::Format(_T("ChartDB: raster downsampling uses %s"), RasterScalerISA()));
+
+      //    Decoded BSB bands, shared by all raster charts; 0 turns it off
+      g_RasterBandCache.SetBudget((size_t)wxMax(g_rasterBandCacheMB, 0) * 1024 * 1024);
+      wxLogMessage(wxString::Format(_T("ChartDB: raster band cache is %d MBytes"), wxMax(g_rasterBandCacheMB, 0)));
 }
 
 
 ChartDB::~ChartDB()
 {
+      //    Stop the background opens first, they hand their charts to the cache
+      delete m_open_service;
+
+      m_cache.LogStats();
+      g_RasterBandCache.LogStats();
+      DepthHazards::LogStats();
+
 //    Empty the cache
       PurgeCache();
 
-      delete pChartCache;
+//    and stop the MBTiles decoders, the charts they worked for are gone
+      MBTilesLoader::Shutdown();
 }
 
 bool ChartDB::LoadBinary(const wxString & filename, ArrayOfCDI& dir_array_check)
 {
       m_dir_array = dir_array_check;
-      return ChartDatabase::Read(filename);
+      if(!ChartDatabase::Read(filename))
+            return false;
+
+      //  Version 18 entries are current, only the file layout changed.
+      //  Rewrite once so that following starts can map the file.
+      if(GetVersion() == DB_VERSION_PREVIOUS) {
+            wxLogMessage(_T("Chartdb: upgrading chart list file layout to current version"));
+            ChartDatabase::Write(filename);
+      }
+      return true;
 
       // Check chartDirs against dir_array_check
 }
@@ -284,16 +320,83 @@ void ChartDB::DeleteCacheEntry(CacheEntry *pce, bool bDelTexture, const wxString
          g_glTextureManager->PurgeChartTextures(ch, bDelTexture);
 #endif
 
-     pChartCache->Remove(pce);
+     m_cache.Remove(pce);
      delete ch;
      delete pce;
 }
 
-void ChartDB::DeleteCacheEntry(int i, bool bDelTexture, const wxString &msg)
+//      Bytes held by a cached chart, including its texture cache
+size_t ChartDB::GetChartFootprint(ChartBase *pch)
+{
+    size_t bytes = pch->GetMemoryFootprint();
+
+#ifdef ocpnUSE_GL
+    if (g_glTextureManager)
+        bytes += g_glTextureManager->GetChartTextureBytes(pch);
+#endif
+
+    return bytes;
+}
+
+//      Charts grow as they are rendered, so bring the byte count up to date
+//      before any decision is taken on it
+void ChartDB::AccountCache()
+{
+    std::vector<CacheEntry *> entries;
+    m_cache.GetEntries(entries);
+    for(unsigned int i=0 ; i<entries.size() ; i++)
+        m_cache.SetBytes(entries[i], GetChartFootprint((ChartBase *)entries[i]->pChart));
+}
+
+//      Evict least recently used charts until the cache is within {factor * budget}.
+//      At least two charts are always kept.  Called with m_cache_mutex held.
+void ChartDB::EvictToBudget(double factor, bool bDelTexture, const wxString &msg)
+{
+    AccountCache();
+
+    while( m_cache.IsOverBudget(factor) && (m_cache.GetCount() > 2) )
+    {
+        CacheEntry *pce = FindOldestDeleteCandidate( false );
+        if(!pce)
+            break;                      // no possible delete candidate
+
+        DeleteCacheEntry(pce, bDelTexture, msg);
+        m_cache.CountEviction();
+    }
+}
+
+void ChartDB::SetCacheBudget(size_t bytes, int max_charts)
+{
+    wxMutexLocker lock(m_cache_mutex);
+    m_cache.SetBudget(bytes, max_charts);
+}
+
+ChartCacheStats ChartDB::GetCacheStats()
+{
+    wxMutexLocker lock(m_cache_mutex);
+    return m_cache.GetStats();
+}
+
+//      Unpinned cached charts, least recently used first
+void ChartDB::GetCacheChartsByAge(std::vector<ChartBase *> &charts)
+{
+    charts.clear();
+
+    wxMutexLocker lock(m_cache_mutex);
+    for(CacheEntry *pce = m_cache.GetOldest() ; pce ; pce = m_cache.GetNewer(pce))
+        charts.push_back((ChartBase *)pce->pChart);
+}
+
+//      All cached charts, pinned or not
+void ChartDB::GetCacheCharts(std::vector<ChartBase *> &charts)
 {
-     CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-     if (pce)
-         DeleteCacheEntry(pce, bDelTexture, msg);
+    charts.clear();
+
+    wxMutexLocker lock(m_cache_mutex);
+    std::vector<CacheEntry *> entries;
+    m_cache.GetEntries(entries);
+    for(unsigned int i=0 ; i<entries.size() ; i++)
+        charts.push_back((ChartBase *)entries[i]->pChart);
 }
 
 void ChartDB::PurgeCache()
@@ -302,12 +405,12 @@ void ChartDB::PurgeCache()
       //wxLogMessage(_T("Chart cache purge"));
 
       if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
-        unsigned int nCache = pChartCache->GetCount();
-        for(unsigned int i=0 ; i<nCache ; i++)
+        std::vector<CacheEntry *> entries;
+        m_cache.GetEntries(entries);
+        for(unsigned int i=0 ; i<entries.size() ; i++)
         {
-               DeleteCacheEntry(0, true);
+               DeleteCacheEntry(entries[i], true);
         }
-        pChartCache->Clear();
         
         m_cache_mutex.Unlock();
       }
@@ -320,21 +423,15 @@ void ChartDB::PurgeCachePlugins()
     wxLogMessage(_T("Chart cache PlugIn purge"));
     
     if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
-        unsigned int nCache = pChartCache->GetCount();
-        unsigned int i = 0;
-        while(i < nCache){
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
+        std::vector<CacheEntry *> entries;
+        m_cache.GetEntries(entries);
+        for(unsigned int i=0 ; i<entries.size() ; i++)
+        {
+            CacheEntry *pce = entries[i];
             ChartBase *Ch = (ChartBase *)pce->pChart;
 
-            if(CHART_TYPE_PLUGIN == Ch->GetChartType()){
+            if(CHART_TYPE_PLUGIN == Ch->GetChartType())
                 DeleteCacheEntry(pce, true);
-            
-                nCache = pChartCache->GetCount();       // restart the while loop
-                i = 0;
-                
-            }
-            else
-                i++;
         }
        
         m_cache_mutex.Unlock();
@@ -345,95 +442,31 @@ void ChartDB::PurgeCachePlugins()
 void ChartDB::ClearCacheInUseFlags(void)
 {
     if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
-        unsigned int nCache = pChartCache->GetCount();
-        for(unsigned int i=0 ; i<nCache ; i++)
+        std::vector<CacheEntry *> entries;
+        m_cache.GetEntries(entries);
+        for(unsigned int i=0 ; i<entries.size() ; i++)
         {
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-            pce->b_in_use = false;
+            entries[i]->b_in_use = false;
         }
         m_cache_mutex.Unlock();
     }
 }
 
 
-//      Try to purge and delete charts from the cache until the application memory used is
-//      until the application memory used is less than {factor * Limit}
+//      Try to purge and delete charts from the cache until the bytes held
+//      are less than {factor * budget}, or the chart count is less than
+//      {factor * limit} if no byte budget is set.
 //      Purge charts on LRU policy
 void ChartDB::PurgeCacheUnusedCharts( double factor)
 {
-      //    Use memory limited cache policy, if defined....
-      if(g_memCacheLimit)
-      {
-          if( wxMUTEX_NO_ERROR == m_cache_mutex.TryLock() ){
-              
-            //    Check memory status to see if above limit
-                int mem_used;
-                GetMemoryStatus(0, &mem_used);
-                int mem_limit = g_memCacheLimit * factor;
-
-                int nl = pChartCache->GetCount();       // max loop count, by definition
-                    
-                wxString msg(_T("Purging unused chart from cache: "));
-                //printf("Try Purge count:  %d\n", nl);
-                while( (mem_used > mem_limit) && (nl>0) )
-                {
-                    if( pChartCache->GetCount() < 2 ){
-                        nl = 0;
-                        break;
-                    }
-                    
-                    CacheEntry *pce = FindOldestDeleteCandidate( false );
-                    if(pce){
-                        // don't purge background spooler
-                        DeleteCacheEntry(pce, false /*true*/, msg);
-                        //printf("DCE, new count is:  %d\n", pChartCache->GetCount()); 
-                    }
-                    else {
-                        break;
-                    }
-                    
-                    GetMemoryStatus(0, &mem_used);
-                    
-                    nl--;
-                }
-        }
-        m_cache_mutex.Unlock();
-      }
-      
-      //    Else use chart count cache policy, if defined....
-      else if(g_nCacheLimit)
-      {
-          if( wxMUTEX_NO_ERROR == m_cache_mutex.TryLock() ){
-              
-            //    Check chart count to see if above limit
-                double fac10 = factor * 10;
-                int chart_limit = g_nCacheLimit * fac10 / 10;
+      if( wxMUTEX_NO_ERROR == m_cache_mutex.TryLock() ){
+            wxString msg(_T("Purging unused chart from cache: "));
 
-                int nl = pChartCache->GetCount();       // max loop count, by definition
-                    
-                wxString msg(_T("Purging unused chart from cache: "));
-                while( (nl > chart_limit) && (nl>0) )
-                {
-                    if( pChartCache->GetCount() < 2 ){
-                        nl = 0;
-                        break;
-                    }
-                    
-                    CacheEntry *pce = FindOldestDeleteCandidate( false );
-                    if(pce){
-                        // don't purge background spooler
-                        DeleteCacheEntry(pce, false /*true*/, msg);
-                    }
-                    else {
-                        break;
-                    }
-                    
-                    nl = pChartCache->GetCount();
-                }
-        }
-        m_cache_mutex.Unlock();
-      }
+            // don't purge background spooler
+            EvictToBudget(factor, false, msg);
 
+            m_cache_mutex.Unlock();
+      }
 }
 
 
@@ -527,63 +560,45 @@ int ChartDB::BuildChartStack(ChartStack * cstk, float lat, float lon, int groupI
       if(!cstk)
             return 0;                           // Chartstack not ready yet
 
-      int nEntry = GetChartTableEntries();
-
-      for(int db_index=0 ; db_index<nEntry ; db_index++)
+      //  Plugin loading is deferred, so the chart may have been disabled elsewhere.
+      //  Tentatively reenable the group's plugin charts so that they appear in the piano.
+      //  They will get disabled later if really not useable
+      const std::vector<int> &plugin_charts = GetPluginCharts();
+      for(size_t ip = 0 ; ip < plugin_charts.size() ; ip++)
       {
+            if(IsChartInGroup(plugin_charts[ip], groupIndex))
+                  GetpChartTableEntry(plugin_charts[ip])->ReEnable();
+      }
+
+      //  Only the charts whose rough extent covers the position, in db_index order
+      std::vector<int> candidates;
+      GetChartsAtPosition(lat, lon, groupIndex, candidates);
 
+      for(size_t ic=0 ; ic<candidates.size() ; ic++)
+      {
+            int db_index = candidates[ic];
             const ChartTableEntry &cte = GetChartTableEntry(db_index);
-            
-            //    Check to see if the candidate chart is in the currently active group
-            bool b_group_add = false;
-            if(groupIndex > 0)
-            {
-                  const int ng = cte.GetGroupArray().size();
-                  for(int ig=0 ; ig < ng; ig++)
-                  {
-                      if(groupIndex == cte.GetGroupArray()[ig])
-                        {
-                              b_group_add = true;
-                              break;
-                        }
-                  }
-            }
-            else
-                  b_group_add = true;
 
             bool b_pos_add = false;
-            if(b_group_add)
+            if(CheckPositionWithinChart(db_index, lat, lon)  &&  (j < MAXSTACK) )
+                b_pos_add = true;
+
+            //    Check the special case where chart spans the international dateline
+            else if( (cte.GetLonMax() > 180.) && (cte.GetLonMin() < 180.) )
             {
-                //  Plugin loading is deferred, so the chart may have been disabled elsewhere.
-                //  Tentatively reenable the chart so that it appears in the piano.
-                //  It will get disabled later if really not useable
-                  if(cte.GetChartType() == CHART_TYPE_PLUGIN){
-                      ChartTableEntry *pcte = (ChartTableEntry*)&cte;
-                      pcte->ReEnable();
-                  }
-                  
-                  if(CheckPositionWithinChart(db_index, lat, lon)  &&  (j < MAXSTACK) )
+                  if(CheckPositionWithinChart(db_index, lat, lon + 360.)  &&  (j < MAXSTACK) )
                       b_pos_add = true;
-
-                  //    Check the special case where chart spans the international dateline
-                  else if( (cte.GetLonMax() > 180.) && (cte.GetLonMin() < 180.) )
-                  {
-                        if(CheckPositionWithinChart(db_index, lat, lon + 360.)  &&  (j < MAXSTACK) )
-                            b_pos_add = true;
-                  }
-                  //    Western hemisphere, some type of charts
-                  else if( (cte.GetLonMax() > 180.) && (cte.GetLonMin() > 180.) )       
-                  {
-                      if(CheckPositionWithinChart(db_index, lat, lon + 360.)  &&  (j < MAXSTACK) )
-                          b_pos_add = true;
-                  }
-                  
-                  
+            }
+            //    Western hemisphere, some type of charts
+            else if( (cte.GetLonMax() > 180.) && (cte.GetLonMin() > 180.) )       
+            {
+                if(CheckPositionWithinChart(db_index, lat, lon + 360.)  &&  (j < MAXSTACK) )
+                    b_pos_add = true;
             }
             
             bool b_available = true;
             //  Verify PlugIn charts are actually available
-            if(b_group_add && b_pos_add && (cte.GetChartType() == CHART_TYPE_PLUGIN)){
+            if(b_pos_add && (cte.GetChartType() == CHART_TYPE_PLUGIN)){
                 
                 ChartTableEntry *pcte = (ChartTableEntry*)&cte;
                 if( !IsChartAvailable(db_index) ){
@@ -596,7 +611,7 @@ int ChartDB::BuildChartStack(ChartStack * cstk, float lat, float lon, int groupI
                 }
             }
             
-            if(b_group_add && b_pos_add && b_available){                // add it
+            if(b_pos_add && b_available){                // add it
                 j++;
                 cstk->nEntry = j;
                 cstk->SetDBIndex(j-1, db_index);
@@ -959,17 +974,10 @@ bool ChartDB::IsChartInCache(int dbindex)
 //    Search the cache
       if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
           
-        unsigned int nCache = pChartCache->GetCount();
-        for(unsigned int i=0 ; i<nCache ; i++)
-        {
-                CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-                if(pce->dbIndex == dbindex)
-                {
-                    if (pce->pChart != 0 && ((ChartBase *)pce->pChart)->IsReadyToRender())
-                        bInCache = true;
-                    break;
-                }
-        }
+        CacheEntry *pce = m_cache.Find(dbindex);
+        if(pce && pce->pChart != 0 && ((ChartBase *)pce->pChart)->IsReadyToRender())
+            bInCache = true;
+
         m_cache_mutex.Unlock();
       }
       
@@ -979,20 +987,19 @@ bool ChartDB::IsChartInCache(int dbindex)
 
 bool ChartDB::IsChartInCache(wxString path)
 {
+    int dbindex = FinddbIndex( path );
+    if(dbindex < 0)
+        return false;
+
     bool bInCache = false;
     if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
         
         //    Search the cache
-        unsigned int nCache = pChartCache->GetCount();
-        for(unsigned int i=0 ; i<nCache ; i++)
+        CacheEntry *pce = m_cache.Find(dbindex);
+        if(pce && pce->FullPath == path)
         {
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-            if(pce->FullPath == path)
-            {
-                if (pce->pChart != 0 && ((ChartBase *)pce->pChart)->IsReadyToRender())
-                    bInCache = true;
-                break;
-            }
+            if (pce->pChart != 0 && ((ChartBase *)pce->pChart)->IsReadyToRender())
+                bInCache = true;
         }
         
         m_cache_mutex.Unlock();
@@ -1002,41 +1009,29 @@ bool ChartDB::IsChartInCache(wxString path)
 
 bool ChartDB::IsChartLocked( int index )
 {
-    
+    bool ret = false;
     if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
-        unsigned int nCache = pChartCache->GetCount();
-        for(unsigned int i=0 ; i<nCache ; i++)
-        {
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-            if(pce->dbIndex == index)
-            {
-                bool ret = pce->n_lock > 0;
-                m_cache_mutex.Unlock();
-                return ret;
-            }
-        }
+        CacheEntry *pce = m_cache.Find(index);
+        if(pce)
+            ret = pce->n_lock > 0;
         m_cache_mutex.Unlock();
     }
     
-    return false;
+    return ret;
 }
     
+//      Pin the chart in the cache, a locked chart is never evicted
 bool ChartDB::LockCacheChart( int index )
 {
     //    Search the cache
     bool ret = false;
     if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
         
-        unsigned int nCache = pChartCache->GetCount();
-        for(unsigned int i=0 ; i<nCache ; i++)
+        CacheEntry *pce = m_cache.Find(index);
+        if(pce)
         {
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-            if(pce->dbIndex == index )
-            {
-                pce->n_lock++;
-                ret = true;
-                break;
-            }
+            m_cache.Pin(pce);
+            ret = true;
         }
         m_cache_mutex.Unlock();
     }
@@ -1047,17 +1042,9 @@ void ChartDB::UnLockCacheChart( int index )
 {
     //    Search the cache
     if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
-        unsigned int nCache = pChartCache->GetCount();
-        for(unsigned int i=0 ; i<nCache ; i++)
-        {
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-            if(pce->dbIndex == index)
-            {
-                if(pce->n_lock > 0)
-                    pce->n_lock--;
-                break;
-            }
-        }
+        CacheEntry *pce = m_cache.Find(index);
+        if(pce)
+            m_cache.Unpin(pce);
         m_cache_mutex.Unlock();
     }
 }
@@ -1067,12 +1054,11 @@ void ChartDB::UnLockAllCacheCharts()
     //    Walk the cache
     if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
         
-        unsigned int nCache = pChartCache->GetCount();
-        for(unsigned int i=0 ; i<nCache ; i++)
+        std::vector<CacheEntry *> entries;
+        m_cache.GetEntries(entries);
+        for(unsigned int i=0 ; i<entries.size() ; i++)
         {
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-                if(pce->n_lock > 0)
-                    pce->n_lock--;
+            m_cache.Unpin(entries[i]);
         }
         m_cache_mutex.Unlock();
     }
@@ -1114,46 +1100,27 @@ ChartBase *ChartDB::OpenChartFromDBAndLock(wxString chart_path, ChartInitFlag in
     return OpenChartFromDBAndLock(dbii, init_flag);
 }
 
+//      The least recently used unpinned chart, unless it is a canvas single chart.
+//      Called with m_cache_mutex held.
 CacheEntry *ChartDB::FindOldestDeleteCandidate( bool blog)
 {
-    CacheEntry *pret = 0;
-    
-         
-        unsigned int nCache = pChartCache->GetCount();
-        if(nCache > 1)
-        {
-            if(blog)
-                wxLogMessage(_T("Searching chart cache for oldest entry"));
-            int LRUTime = m_ticks;
-            int iOldest = 0;
-            for(unsigned int i=0 ; i<nCache ; i++)
-            {
-                CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-                if(pce->RecentTime < LRUTime && !pce->n_lock){
-                    if (!isSingleChart((ChartBase *)(pce->pChart))) {
-                       LRUTime = pce->RecentTime;
-                       iOldest = i;
-                    }
-                }
-            }
-            int dt = m_ticks - LRUTime;
+    if(m_cache.GetCount() < 2)
+        return NULL;
 
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(iOldest));
-            ChartBase *pDeleteCandidate =  (ChartBase *)(pce->pChart);
-                
-            if( !pce->n_lock &&  !isSingleChart(pDeleteCandidate)){
-                if(blog)
-                    wxLogMessage(_T("Oldest unlocked cache index is %d, delta t is %d"), iOldest, dt);
-                
-                pret = pce;
-            }
-            else
-                wxLogMessage(_T("All chart in cache locked, size: %d"), nCache);
- 
+    if(blog)
+        wxLogMessage(_T("Searching chart cache for oldest entry"));
+
+    for(CacheEntry *pce = m_cache.GetOldest() ; pce ; pce = m_cache.GetNewer(pce))
+    {
+        if( !isSingleChart((ChartBase *)(pce->pChart)) ){
+            if(blog)
+                wxLogMessage(_T("Oldest unlocked cache index is %d, delta t is %d"), pce->dbIndex, m_ticks - pce->RecentTime);
+            return pce;
         }
-        
-    
-    return pret;
+    }
+
+    wxLogMessage(_T("All chart in cache locked, size: %d"), m_cache.GetCount());
+    return NULL;
 }
 
 
@@ -1187,32 +1154,35 @@ ChartBase *ChartDB::OpenChartUsingCache(int dbindex, ChartInitFlag init_flag)
       {
         wxMutexLocker lock(m_cache_mutex);
 
-        unsigned int nCache = pChartCache->GetCount();
         m_ticks++;
-        for(unsigned int i=0 ; i<nCache ; i++)
+        pce = m_cache.Find(dbindex);
+        if(pce && pce->FullPath != ChartFullPath)
         {
-                pce = (CacheEntry *)(pChartCache->Item(i));
-                if(pce->FullPath == ChartFullPath)
-                {
-                    Ch = (ChartBase *)pce->pChart;
-                    bInCache = true;
-                    break;
-                }
+            //  The database has changed under this entry.  A pinned chart is
+            //  still held, e.g. by a quilt: leave it be, it goes once unpinned
+            if(pce->n_lock > 0)
+                return NULL;
+
+            DeleteCacheEntry(pce, true);
+            pce = NULL;
+        }
+
+        if(pce)
+        {
+            Ch = (ChartBase *)pce->pChart;
+            bInCache = true;
         }
 
         if(bInCache)
         {
-          wxString msg;
-          msg.Printf(_T("OpenChartUsingCache, IN cache: cache size: %d\n"), (int)pChartCache->GetCount());
-//          wxLogMessage(msg);
           if(FULL_INIT == init_flag)                            // asking for full init?
           {
               if(Ch->IsReadyToRender())
               {
-                    if(pce){
-                        pce->RecentTime = m_ticks;           // chart is OK
-                        pce->b_in_use = true;
-                    }
+                    pce->RecentTime = m_ticks;           // chart is OK
+                    pce->b_in_use = true;
+                    m_cache.Touch(pce);
+                    m_cache.CountHit();
                     return Ch;
               }
               else
@@ -1221,7 +1191,7 @@ ChartBase *ChartDB::OpenChartUsingCache(int dbindex, ChartInitFlag init_flag)
                        pthumbwin->pThumbChart = NULL;
                     delete Ch;                                  // chart is not useable
                     old_lock = pce->n_lock;
-                    pChartCache->Remove(pce);                   // so remove it
+                    m_cache.Remove(pce);                        // so remove it
                     delete pce;
                         
                     bInCache = false;
@@ -1229,71 +1199,29 @@ ChartBase *ChartDB::OpenChartUsingCache(int dbindex, ChartInitFlag init_flag)
           }
           else                                                  // assume if in cache, the chart can do thumbnails
           {
-               if(pce){
-                   pce->RecentTime = m_ticks;
-                   pce->b_in_use = true;
-               }
+               pce->RecentTime = m_ticks;
+               pce->b_in_use = true;
+               m_cache.Touch(pce);
+               m_cache.CountHit();
                return Ch;
           }
         }
 
         if(!bInCache)                    // not in cache
         {
+            m_cache.CountMiss();
             m_b_busy = true;
-            if( !m_b_locked ) {
-                //    Use memory limited cache policy, if defined....
-                if(g_memCacheLimit)
-                {
-            //    Check memory status to see if enough room to open another chart
-                    int mem_used;
-                    GetMemoryStatus(0, &mem_used);
-
-                    wxString msg;
-                    msg.Printf(_T("OpenChartUsingCache, NOT in cache:   cache size: %d\n"),  (int)pChartCache->GetCount());
-                    wxLogMessage(msg);
-                    wxString msg1;
-                    msg1.Printf(_T("   OpenChartUsingCache:  type %d  "), chart_type);
-                    wxLogMessage(msg1 + ChartFullPath);
 
+            //    Make room for the new chart, tossing out the least recently used
+            if( !m_b_locked && m_cache.IsOverBudget() ) {
+                wxString msg;
+                msg.Printf(_T("OpenChartUsingCache, NOT in cache:   cache size: %d, %d kBytes"),
+                           m_cache.GetCount(), (int)(m_cache.GetBytes() / 1024));
+                wxLogMessage(msg);
 
-                    if((mem_used > g_memCacheLimit * 8 / 10) && (pChartCache->GetCount() > 2)) {
-                        wxString msg(_T("Removing oldest chart from cache: "));
-                        while (1)
-                        {
-                          CacheEntry *pce = FindOldestDeleteCandidate(true);
-                          if (pce == 0)
-                              break;                      // no possible delete candidate
-                          
-                          // purge texture cache, really need memory here
-                          DeleteCacheEntry(pce, true, msg);
-
-                          GetMemoryStatus(0, &mem_used);
-                          if((mem_used < g_memCacheLimit * 8 / 10) || (pChartCache->GetCount() <= 2)) 
-                              break;
-                                
-                        }  // while
-                    }
-                }
-
-                else        // Use n chart cache policy, if memory-limit  policy is not used
-                {
-    //      Limit cache to n charts, tossing out the oldest when space is needed
-                    unsigned int nCache = pChartCache->GetCount();
-                    if (nCache > (unsigned int)g_nCacheLimit && nCache > 2)
-                    {
-                        wxString msg(_T("Removing oldest chart from cache: "));
-                        while (nCache > (unsigned int)g_nCacheLimit)
-                        {
-                            CacheEntry *pce = FindOldestDeleteCandidate( true );
-                            if (pce == 0)
-                                break;
-                            
-                            DeleteCacheEntry(pce, true, msg);
-                            nCache--;
-                        }
-                    }
-                    
-                }
+                msg = _T("Removing oldest chart from cache: ");
+                // purge texture cache, really need memory here
+                EvictToBudget(1.0, true, msg);
             }
         }
       } // unlock
@@ -1444,37 +1372,9 @@ ChartBase *ChartDB::OpenChartUsingCache(int dbindex, ChartInitFlag init_flag)
 
                   if(INIT_OK == ir)
                   {
-
 //    always cache after a new chart has been created
 //    or it may leak CacheEntry in createthumbnail
-//                        if(FULL_INIT == init_flag)
-                        {
-                              pce = new CacheEntry;
-                              pce->FullPath = ChartFullPath;
-                              pce->pChart = Ch;
-                              pce->dbIndex = dbindex;
-//                              printf("    Adding chart %d\n", dbindex);
-                              pce->RecentTime = m_ticks;
-                              pce->n_lock = old_lock;
-
-                              if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
-                                pChartCache->Add((void *)pce);
-                                m_cache_mutex.Unlock();
-                              }
-                              else {
-                                delete pce;
-                              }
-                        }
-                        
-                        //  A performance optimization.
-                        //  Hide this chart's MBTiles overlay on initial MBTile chart load, or reload after cache purge.
-                        //  This can help avoid excessively long startup and group switch time when large tilesets are in use.
-                        //  See FS#2601
-                        if(chart_type == CHART_TYPE_MBTILES){
-                            if(std::find(g_quilt_noshow_index_array.begin(), g_quilt_noshow_index_array.end(), dbindex) == g_quilt_noshow_index_array.end()) {
-                                g_quilt_noshow_index_array.push_back( dbindex );
-                            }
-                        }
+                        AddCacheEntry(dbindex, ChartFullPath, Ch, old_lock);
                   }
                   else if(INIT_FAIL_REMOVE == ir)                 // some problem in chart Init()
                   {
@@ -1513,6 +1413,134 @@ ChartBase *ChartDB::OpenChartUsingCache(int dbindex, ChartInitFlag init_flag)
       return NULL;
 }
 
+//      False if the cache could not be locked, the chart is then not cached
+bool ChartDB::AddCacheEntry(int dbindex, const wxString &full_path, ChartBase *pch, int n_lock)
+{
+      CacheEntry *pce = new CacheEntry;
+      pce->FullPath = full_path;
+      pce->pChart = pch;
+      pce->dbIndex = dbindex;
+      pce->RecentTime = m_ticks;
+      pce->b_in_use = true;
+      pce->n_lock = n_lock;
+      pce->bytes = 0;
+
+      if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
+        m_cache.Insert(pce);
+        m_cache.SetBytes(pce, GetChartFootprint(pch));
+        m_cache_mutex.Unlock();
+      }
+      else {
+        delete pce;
+        return false;
+      }
+
+      //  A performance optimization.
+      //  Hide this chart's MBTiles overlay on initial MBTile chart load, or reload after cache purge.
+      //  This can help avoid excessively long startup and group switch time when large tilesets are in use.
+      //  See FS#2601
+      if(pch->GetChartType() == CHART_TYPE_MBTILES){
+          if(std::find(g_quilt_noshow_index_array.begin(), g_quilt_noshow_index_array.end(), dbindex) == g_quilt_noshow_index_array.end()) {
+              g_quilt_noshow_index_array.push_back( dbindex );
+          }
+      }
+
+      return true;
+}
+
+//      False if the database has been changed since a background open of this entry was queued
+bool ChartDB::IsEntryCurrent(int dbindex, const wxString &full_path)
+{
+      if((dbindex < 0) || (dbindex > GetChartTableEntries()-1))
+            return false;
+
+      const ChartTableEntry &cte = GetChartTableEntry(dbindex);
+      return (cte.GetLatMax() <= 90.0) && (cte.GetFullSystemPath() == full_path);
+}
+
+bool ChartDB::RequestChart(int dbindex, bool prefetch)
+{
+      if((dbindex < 0) || (dbindex > GetChartTableEntries()-1))
+            return false;
+
+      const ChartTableEntry &cte = GetChartTableEntry(dbindex);
+      if(cte.GetLatMax() > 90.0)          // Chart has been disabled...
+            return false;
+
+      //    A cached chart not yet ready to render (e.g. SENC being built)
+      //    is left to the synchronous path, which knows how to wait for it
+      {
+            wxMutexLocker lock(m_cache_mutex);
+            if(m_cache.Find(dbindex))
+                  return false;
+      }
+
+      return m_open_service->Request(dbindex, cte.GetFullSystemPath(),
+                                     (ChartTypeEnum)cte.GetChartType(), prefetch);
+}
+
+void ChartDB::ClearChartPrefetch()
+{
+      m_open_service->ClearPrefetch();
+}
+
+//      Take a chart opened by the ChartOpenService into the cache.
+//      On the GUI thread; true if the chart was added, and so stays cached.
+bool ChartDB::AdoptChart(int dbindex, const wxString &full_path, ChartBase *pch, InitReturn ir)
+{
+      wxString msg_fn(full_path);
+      msg_fn.Replace(_T("%"), _T("%%"));
+
+      if(!IsEntryCurrent(dbindex, full_path))
+      {
+            delete pch;
+            return false;
+      }
+
+      if(!pch)
+      {
+            wxLogMessage(wxString::Format(_T("   Background open... Error opening chart %s ... return code %d"), msg_fn.c_str(), ir));
+
+//          Mark this chart in the database, so that it will not be seen during this run, but will stay in the database
+            if(INIT_FAIL_REMOVE == ir)
+            {
+                  wxString path(full_path);
+                  DisableChart(path);
+            }
+            return false;
+      }
+
+      //    Opened synchronously meanwhile
+      {
+            wxMutexLocker lock(m_cache_mutex);
+            if(m_cache.Find(dbindex))
+            {
+                  delete pch;
+                  return false;
+            }
+      }
+
+      pch->SetColorScheme(GetColorScheme());
+
+      //    Make room first, as the synchronous path does: evicting after the
+      //    insert could pick this very chart when all others are pinned
+      if( !m_b_locked && (wxMUTEX_NO_ERROR == m_cache_mutex.TryLock()) )
+      {
+            if(m_cache.IsOverBudget())
+                  EvictToBudget(1.0, true, _T("Removing oldest chart from cache: "));
+            m_cache_mutex.Unlock();
+      }
+
+      m_ticks++;
+      if(!AddCacheEntry(dbindex, full_path, pch, 0))
+      {
+            delete pch;
+            return false;
+      }
+
+      return true;
+}
+
 // 
 bool ChartDB::DeleteCacheChart(ChartBase *pDeleteCandidate)
 {
@@ -1523,19 +1551,20 @@ bool ChartDB::DeleteCacheChart(ChartBase *pDeleteCandidate)
        {
             // Find the chart in the cache
             CacheEntry *pce = NULL;
-            for(unsigned int i=0 ; i< pChartCache->GetCount() ; i++)
+            std::vector<CacheEntry *> entries;
+            m_cache.GetEntries(entries);
+            for(unsigned int i=0 ; i< entries.size() ; i++)
             {
-                  pce = (CacheEntry *)(pChartCache->Item(i));
-                  if((ChartBase *)(pce->pChart) == pDeleteCandidate)
+                  if((ChartBase *)(entries[i]->pChart) == pDeleteCandidate)
                   {
+                        pce = entries[i];
                         break;
                   }
             }
 
             if(pce)
             {
-                  if(pce->n_lock > 0)
-                    pce->n_lock--;
+                  m_cache.Unpin(pce);
 
                   if( pce->n_lock == 0) {
                       DeleteCacheEntry( pce);
@@ -1554,16 +1583,15 @@ bool ChartDB::DeleteCacheChart(ChartBase *pDeleteCandidate)
 void ChartDB::ApplyColorSchemeToCachedCharts(ColorScheme cs)
 {
       ChartBase *Ch;
-      CacheEntry *pce;
      //    Search the cache
 
       if( wxMUTEX_NO_ERROR == m_cache_mutex.Lock() ){
           
-        unsigned int nCache = pChartCache->GetCount();
-        for(unsigned int i=0 ; i<nCache ; i++)
+        std::vector<CacheEntry *> entries;
+        m_cache.GetEntries(entries);
+        for(unsigned int i=0 ; i<entries.size() ; i++)
         {
-                pce = (CacheEntry *)(pChartCache->Item(i));
-                Ch = (ChartBase *)pce->pChart;
+                Ch = (ChartBase *)entries[i]->pChart;
                 if(Ch)
                     Ch->SetColorScheme(cs, true);
 
@@ -42,6 +42,8 @@
 #include "mbtiles.h"
 #include "mygeom.h"                     // For DouglasPeucker();
 #include "FlexHash.h"
+#include "MappedFile.h"
+#include "ChartIngest.h"
 #ifndef UINT32
 #define UINT32 unsigned int
 #endif
@@ -96,10 +98,10 @@ void ChartTableHeader::Read(wxInputStream &is)
     is.Read(this, sizeof(ChartTableHeader));
 }
 
-void ChartTableHeader::Write(wxOutputStream &os)
+void ChartTableHeader::Write(wxOutputStream &os, int version)
 {
     char vb[5];
-    sprintf(vb, "V%03d", DB_VERSION_CURRENT);
+    sprintf(vb, "V%03d", version);
 
     memcpy(dbVersion, vb, 4);
     os.Write(this, sizeof(ChartTableHeader));
@@ -122,15 +124,17 @@ bool ChartTableHeader::CheckValid()
 //          return false;       // no match....
 
 
-          // Try previous version....
-          sprintf(vb, "V%03d", DB_VERSION_PREVIOUS);
-          if (strncmp(vb, dbVersion, sizeof(dbVersion)))
-                return false;
-          else
+          // Try previous versions....
+          for(int version = DB_VERSION_PREVIOUS; version >= DB_VERSION_OLDEST; version--)
           {
-                wxLogMessage(_T("   Scheduling db upgrade to current db version on Options->Charts page visit..."));
-                return true;
+                sprintf(vb, "V%03d", version);
+                if (!strncmp(vb, dbVersion, sizeof(dbVersion)))
+                {
+                      wxLogMessage(_T("   Scheduling db upgrade to current db version..."));
+                      return true;
+                }
           }
+          return false;
 
 
     }
@@ -380,19 +384,26 @@ ChartTableEntry::ChartTableEntry(ChartBase &theChart, wxString& utf8Path)
 
 ChartTableEntry::~ChartTableEntry()
 {
-    free(pFullPath);
-    free(pPlyTable);
-    
-    for (int i = 0; i < nAuxPlyEntries; i++)
-        free(pAuxPlyTable[i]);
-    free(pAuxPlyTable);
-    free(pAuxCntTable);
-
-    if (nNoCovrPlyEntries) {
-        for (int i = 0; i < nNoCovrPlyEntries; i++) 
-            free( pNoCovrPlyTable[i] );
-        free( pNoCovrPlyTable );
-        free( pNoCovrCntTable );
+    if (m_map) {
+        //  Everything else lives in the mapped file
+        free(pAuxPlyTable);
+        free(pNoCovrPlyTable);
+    }
+    else {
+        free(pFullPath);
+        free(pPlyTable);
+        
+        for (int i = 0; i < nAuxPlyEntries; i++)
+            free(pAuxPlyTable[i]);
+        free(pAuxPlyTable);
+        free(pAuxCntTable);
+
+        if (nNoCovrPlyEntries) {
+            for (int i = 0; i < nNoCovrPlyEntries; i++) 
+                free( pNoCovrPlyTable[i] );
+            free( pNoCovrPlyTable );
+            free( pNoCovrCntTable );
+        }
     }
     
     delete m_pfilename;
@@ -814,7 +825,7 @@ bool ChartTableEntry::Write(const ChartDatabase *pDb, wxOutputStream &os)
 {
     os.Write(pFullPath, strlen(pFullPath) + 1);
 
-    //      Write the current version type only
+    //      Write the streamed version 18 layout
     //      Create an on_disk table entry
     ChartTableEntry_onDisk_18 cte;
 
@@ -893,7 +904,176 @@ void ChartTableEntry::Clear()
     
     m_pfilename = NULL;             // a helper member, not on disk
     m_psFullPath = NULL;
-    
+
+    m_map.reset();
+}
+
+///////////////////////////////////////////////////////////////////////
+
+//  Check that [offset, offset + len) lies within the mapped file, 4 byte aligned
+static bool IsInMap(const MappedFile &map, unsigned int offset, size_t len)
+{
+    return !(offset & 3) && offset <= map.GetSize() && len <= map.GetSize() - offset;
+}
+
+//  Build the pointer array for a table of polygons stored as
+//  n counts followed by the points of each polygon
+static float **MapPolygonTable(const MappedFile &map, int *counts, int n)
+{
+    float **table = (float **)malloc(n * sizeof(float *));
+    size_t pos = (char *)(counts + n) - map.GetData();
+
+    for (int i = 0; i < n; i++) {
+        size_t len = counts[i] * 2 * sizeof(float);
+        if (counts[i] < 0 || len > map.GetSize() - pos) {
+            counts[i] = 0;              // damaged file, drop the polygon (the mapping is private)
+            len = 0;
+        }
+        table[i] = (float *)(map.GetData() + pos);
+        pos += len;
+    }
+    return table;
+}
+
+static void *CopyBlock(const void *src, size_t len)
+{
+    if (!src || !len)
+        return NULL;
+    void *dst = malloc(len);
+    memcpy(dst, src, len);
+    return dst;
+}
+
+bool ChartTableEntry::Read(const std::shared_ptr<MappedFile> &map, const ChartTableEntry_onDisk_19 &cte)
+{
+    Clear();
+
+    char *base = map->GetData();
+    size_t size = map->GetSize();
+
+    //  Validate the references before anything is taken from them.
+    //  The polygons themselves are checked by ResolveMappedTables(), below.
+    if (cte.pathOffset >= size || !memchr(base + cte.pathOffset, 0, size - cte.pathOffset))
+        return false;
+    if (cte.nPlyEntries < 0 || cte.nAuxPlyEntries < 0 || cte.nNoCovrPlyEntries < 0)
+        return false;
+    if (!IsInMap(*map, cte.plyOffset, (size_t)cte.nPlyEntries * 2 * sizeof(float)) ||
+        !IsInMap(*map, cte.auxOffset, (size_t)cte.nAuxPlyEntries * sizeof(int)) ||
+        !IsInMap(*map, cte.noCovrOffset, (size_t)cte.nNoCovrPlyEntries * sizeof(int)))
+        return false;
+
+    m_map = map;
+
+    pFullPath = base + cte.pathOffset;
+    wxLogVerbose(_T("  Chart %s"), pFullPath);
+
+    //  Create and populate the helper members
+    m_pfilename = new wxString;
+    wxString fullfilename(pFullPath, wxConvUTF8);
+    wxFileName fn(fullfilename);
+    *m_pfilename = fn.GetFullName();
+    m_psFullPath = new wxString;
+    *m_psFullPath = fullfilename;
+    m_fullSystemPath = fullfilename;
+
+#ifdef __OCPN__ANDROID__
+    m_fullSystemPath = wxString(fullfilename.mb_str(wxConvUTF8));
+#endif
+
+    //    Transcribe the elements....
+    EntryOffset = cte.EntryOffset;
+    ChartType = cte.ChartType;
+    ChartFamily = cte.ChartFamily;
+    LatMax = cte.LatMax;
+    LatMin = cte.LatMin;
+    LonMax = cte.LonMax;
+    LonMin = cte.LonMin;
+
+    m_bbox.Set(LatMin, LonMin, LatMax, LonMax);
+
+    Skew = cte.skew;
+    ProjectionType = cte.ProjectionType;
+
+    SetScale(cte.Scale);
+    edition_date = cte.edition_date;
+    file_date = cte.file_date;
+
+    nPlyEntries = cte.nPlyEntries;
+    nAuxPlyEntries = cte.nAuxPlyEntries;
+    nNoCovrPlyEntries = cte.nNoCovrPlyEntries;
+
+    bValid = cte.bValid != 0;
+
+    //  Only pointers are set up here, the pages of points are read in on first use
+    if (nPlyEntries)
+        pPlyTable = (float *)(base + cte.plyOffset);
+    if (nAuxPlyEntries)
+        pAuxCntTable = (int *)(base + cte.auxOffset);
+    if (nNoCovrPlyEntries)
+        pNoCovrCntTable = (int *)(base + cte.noCovrOffset);
+
+    //  The pointer arrays are built now, while the database is read on one
+    //  thread: entries are shared with the chart ingest and open workers
+    ResolveMappedTables();
+
+    return true;
+}
+
+//  Reads the polygon counts only, not the points
+void ChartTableEntry::ResolveMappedTables()
+{
+    if (!m_map)
+        return;
+
+    if (nAuxPlyEntries && !pAuxPlyTable)
+        pAuxPlyTable = MapPolygonTable(*m_map, pAuxCntTable, nAuxPlyEntries);
+    if (nNoCovrPlyEntries && !pNoCovrPlyTable)
+        pNoCovrPlyTable = MapPolygonTable(*m_map, pNoCovrCntTable, nNoCovrPlyEntries);
+}
+
+//  Take private copies of everything that points into the mapped file
+void ChartTableEntry::DetachFromMap()
+{
+    if (!m_map)
+        return;
+
+    pFullPath = (char *)CopyBlock(pFullPath, strlen(pFullPath) + 1);
+    pPlyTable = (float *)CopyBlock(pPlyTable, nPlyEntries * 2 * sizeof(float));
+
+    for (int i = 0; i < nAuxPlyEntries; i++)
+        pAuxPlyTable[i] = (float *)CopyBlock(pAuxPlyTable[i], pAuxCntTable[i] * 2 * sizeof(float));
+    pAuxCntTable = (int *)CopyBlock(pAuxCntTable, nAuxPlyEntries * sizeof(int));
+
+    for (int i = 0; i < nNoCovrPlyEntries; i++)
+        pNoCovrPlyTable[i] = (float *)CopyBlock(pNoCovrPlyTable[i], pNoCovrCntTable[i] * 2 * sizeof(float));
+    pNoCovrCntTable = (int *)CopyBlock(pNoCovrCntTable, nNoCovrPlyEntries * sizeof(int));
+
+    m_map.reset();
+}
+
+void ChartTableEntry::Transcribe(ChartTableEntry_onDisk_19 &cte) const
+{
+    memset(&cte, 0, sizeof(cte));
+
+    cte.EntryOffset = EntryOffset;
+    cte.ChartType = ChartType;
+    cte.ChartFamily = ChartFamily;
+    cte.LatMax = LatMax;
+    cte.LatMin = LatMin;
+    cte.LonMax = LonMax;
+    cte.LonMin = LonMin;
+
+    cte.Scale = Scale;
+    cte.edition_date = edition_date;
+    cte.file_date = file_date;
+
+    cte.nPlyEntries = nPlyEntries;
+    cte.nAuxPlyEntries = nAuxPlyEntries;
+    cte.nNoCovrPlyEntries = nNoCovrPlyEntries;
+
+    cte.skew = Skew;
+    cte.ProjectionType = ProjectionType;
+    cte.bValid = bValid;
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -1201,6 +1381,7 @@ bool ChartDatabase::Read(const wxString &filePath)
 {
     ChartTableEntry entry;
     int entries;
+    wxStopWatch sw;
 
     bValid = false;
 
@@ -1209,11 +1390,12 @@ bool ChartDatabase::Read(const wxString &filePath)
 
     m_DBFileName = filePath;
 
-    wxFFileInputStream ifs(filePath);
-    if(!ifs.Ok()) return false;
-
     ChartTableHeader cth;
-    cth.Read(ifs);
+    {
+        wxFFileInputStream ifs(filePath);
+        if(!ifs.Ok()) return false;
+        cth.Read(ifs);
+    }
     if (!cth.CheckValid()) return false;
 
     //      Capture the version number
@@ -1228,62 +1410,193 @@ bool ChartDatabase::Read(const wxString &filePath)
     if(0 == cth.GetDirEntries())
           wxLogMessage(_T("  Nil"));
 
-    int ind = 0;
-    for (int iDir = 0; iDir < cth.GetDirEntries(); iDir++) {
-        wxString dir;
-        int dirlen;
-        ifs.Read(&dirlen, sizeof(int));
-        while (dirlen > 0) {
-            char dirbuf[1024];
-            int alen = dirlen > 1023 ? 1023 : dirlen;
-            if(ifs.Read(&dirbuf, alen).Eof())
-                goto read_error;
-            dirbuf[alen] = 0;
-            dirlen -= alen;
-            dir.Append(wxString(dirbuf, wxConvUTF8));
-        }
-        wxString msg;
-        msg.Printf(wxT("  Chart directory #%d: "), iDir);
-        msg.Append(dir);
-        wxLogMessage(msg);
-        m_chartDirs.Add(dir);
+    if(m_dbversion == DB_VERSION_CURRENT) {
+        if(!ReadMapped(filePath, cth))
+            goto read_error;
     }
+    else {
+        wxFFileInputStream ifs(filePath);
+        if(!ifs.Ok()) return false;
+        cth.Read(ifs);
+
+        int ind = 0;
+        for (int iDir = 0; iDir < cth.GetDirEntries(); iDir++) {
+            wxString dir;
+            int dirlen;
+            ifs.Read(&dirlen, sizeof(int));
+            while (dirlen > 0) {
+                char dirbuf[1024];
+                int alen = dirlen > 1023 ? 1023 : dirlen;
+                if(ifs.Read(&dirbuf, alen).Eof())
+                    goto read_error;
+                dirbuf[alen] = 0;
+                dirlen -= alen;
+                dir.Append(wxString(dirbuf, wxConvUTF8));
+            }
+            wxString msg;
+            msg.Printf(wxT("  Chart directory #%d: "), iDir);
+            msg.Append(dir);
+            wxLogMessage(msg);
+            m_chartDirs.Add(dir);
+        }
 
-    entries = cth.GetTableEntries();
-    active_chartTable.Alloc(entries);
-    active_chartTable_pathindex.clear();
-    while (entries-- && entry.Read(this, ifs)) {
-        active_chartTable_pathindex[entry.GetFullSystemPath()] = ind++;
-        active_chartTable.Add(entry);
+        entries = cth.GetTableEntries();
+        active_chartTable.Alloc(entries);
+        active_chartTable_pathindex.clear();
+        while (entries-- && entry.Read(this, ifs)) {
+            active_chartTable_pathindex[entry.GetFullSystemPath()] = ind++;
+            active_chartTable.Add(entry);
+        }
+
+        entry.Clear();
     }
 
-    entry.Clear();
     bValid = true;
     entry.SetAvailable(true);
     
     m_nentries = active_chartTable.GetCount();
+
+    wxLogMessage(wxString::Format(_T("Chartdb: version %d, %d entries read in %ld ms"),
+                                  m_dbversion, m_nentries, sw.Time()));
+
+    if(!m_spatial_index.Load(ChartDBIndex::GetIndexFileName(filePath), *this))
+        m_spatial_index.Build(*this);
+
     return true;
 
 read_error:
+    entry.Clear();
     bValid = false;
     m_nentries = active_chartTable.GetCount();
     return false;
 }
 
+bool ChartDatabase::ReadMapped(const wxString &filePath, const ChartTableHeader &cth)
+{
+    std::shared_ptr<MappedFile> map = std::make_shared<MappedFile>();
+    if(!map->Open(filePath)) {
+        wxLogMessage(_T("Chartdb: unable to map ") + filePath);
+        return false;
+    }
+
+    const char *base = map->GetData();
+    size_t size = map->GetSize();
+
+    ChartTableLayout_19 layout;
+    if(size < sizeof(ChartTableHeader) + sizeof(layout))
+        return false;
+    memcpy(&layout, base + sizeof(ChartTableHeader), sizeof(layout));
+
+    size_t nentries = cth.GetTableEntries();
+    if(layout.fileSize != size ||
+       layout.entrySize != (int)sizeof(ChartTableEntry_onDisk_19) ||
+       layout.dirOffset > layout.entryOffset ||
+       layout.entryOffset > size || (layout.entryOffset & 3) ||
+       nentries > (size - layout.entryOffset) / sizeof(ChartTableEntry_onDisk_19)) {
+        wxLogMessage(_T("Chartdb: inconsistent layout in ") + filePath);
+        return false;
+    }
+
+    size_t pos = layout.dirOffset;
+    for (int iDir = 0; iDir < cth.GetDirEntries(); iDir++) {
+        int dirlen;
+        if(pos + sizeof(int) > layout.entryOffset)
+            return false;
+        memcpy(&dirlen, base + pos, sizeof(int));
+        pos += sizeof(int);
+        if(dirlen < 0 || (size_t)dirlen > layout.entryOffset - pos)
+            return false;
+
+        wxString dir(base + pos, wxConvUTF8, dirlen);
+        pos += dirlen;
+
+        wxString msg;
+        msg.Printf(wxT("  Chart directory #%d: "), iDir);
+        msg.Append(dir);
+        wxLogMessage(msg);
+        m_chartDirs.Add(dir);
+    }
+
+    //  The entry headers are used in place, the coverage polygons they
+    //  reference stay on disk until needed
+    const ChartTableEntry_onDisk_19 *pcte =
+        (const ChartTableEntry_onDisk_19 *)(base + layout.entryOffset);
+
+    active_chartTable.Alloc(nentries);
+    active_chartTable_pathindex.clear();
+
+    ChartTableEntry entry;
+    bool ok = true;
+    for (size_t i = 0; i < nentries; i++) {
+        if(!entry.Read(map, pcte[i])) {
+            wxLogMessage(wxString::Format(_T("Chartdb: bad entry %d in "), (int)i) + filePath);
+            ok = false;
+            break;
+        }
+        active_chartTable_pathindex[entry.GetFullSystemPath()] = i;
+        active_chartTable.Add(entry);
+    }
+    entry.Clear();
+
+    return ok;
+}
+
 ///////////////////////////////////////////////////////////////////////
 
-bool ChartDatabase::Write(const wxString &filePath)
+bool ChartDatabase::Write(const wxString &filePath, int version)
 {
     wxFileName file(filePath);
     wxFileName dir(file.GetPath(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME, wxPATH_NATIVE));
 
     if (!dir.DirExists() && !dir.Mkdir()) return false;
 
-    wxFFileOutputStream ofs(filePath);
-    if(!ofs.Ok()) return false;
+    //  Entries may still point into the current file, so it is not
+    //  rewritten in place: a new file is written and swapped in.
+    wxString tmpPath = filePath + _T(".tmp");
+    bool ok;
+    {
+        wxFFileOutputStream ofs(tmpPath);
+        if(!ofs.Ok()) return false;
+
+        if(version == DB_VERSION_CURRENT)
+            ok = WriteMapped(ofs);
+        else
+            ok = WriteStream(ofs);
+        ok = ok && ofs.Close();
+    }
+
+    if(!ok) {
+        wxRemoveFile(tmpPath);
+        return false;
+    }
+
+#ifdef __WXMSW__
+    //  A mapped file cannot be replaced on Windows, take private copies first
+    for (unsigned int i = 0; i < active_chartTable.GetCount(); i++)
+        active_chartTable[i].DetachFromMap();
+#endif
+
+    if(!wxRenameFile(tmpPath, filePath, true)) {
+        wxRemoveFile(tmpPath);
+        return false;
+    }
+
+    //      Explicitly set the version
+    m_dbversion = DB_VERSION_CURRENT;
+
+    //      Persist the spatial index, it is validated against the table when read back
+    m_spatial_index.Validate(*this);
+    if(!m_spatial_index.Save(ChartDBIndex::GetIndexFileName(filePath)))
+        wxLogMessage(_T("Chartdb: unable to write spatial index"));
 
+    return true;
+}
+
+//  Version 18 and earlier: each entry is streamed with its path and tables inline
+bool ChartDatabase::WriteStream(wxOutputStream &os)
+{
     ChartTableHeader cth(m_chartDirs.GetCount(), active_chartTable.GetCount());
-    cth.Write(ofs);
+    cth.Write(os, DB_VERSION_PREVIOUS);
 
     for (int iDir = 0; iDir < cth.GetDirEntries(); iDir++) {
         wxString &dir = m_chartDirs[iDir];
@@ -1292,18 +1605,130 @@ bool ChartDatabase::Write(const wxString &filePath)
         strncpy(s, dir.mb_str(wxConvUTF8), 199);
         s[199] = 0;
         dirlen = strlen(s);
-        ofs.Write(&dirlen, sizeof(int));
-//        ofs.Write(dir.fn_str(), dirlen);
-        ofs.Write(s, dirlen);
+        os.Write(&dirlen, sizeof(int));
+//        os.Write(dir.fn_str(), dirlen);
+        os.Write(s, dirlen);
     }
 
     for (UINT32 iTable = 0; iTable < active_chartTable.size(); iTable++)
-        active_chartTable[iTable].Write(this, ofs);
+        active_chartTable[iTable].Write(this, os);
 
-    //      Explicitly set the version
-    m_dbversion = DB_VERSION_CURRENT;
+    return os.IsOk();
+}
 
-    return true;
+static void WritePadding(wxOutputStream &os, size_t &pos)
+{
+    static const char zeros[4] = { 0, 0, 0, 0 };
+    size_t pad = (4 - (pos & 3)) & 3;
+    os.Write(zeros, pad);
+    pos += pad;
+}
+
+
+bool ChartDatabase::WriteMapped(wxOutputStream &os)
+{
+    size_t nentries = active_chartTable.GetCount();
+
+    //  Lay the file out first, see ChartTableLayout_19
+    std::vector<std::string> dirs;
+    for (unsigned int iDir = 0; iDir < m_chartDirs.GetCount(); iDir++)
+        dirs.push_back(std::string(m_chartDirs[iDir].mb_str(wxConvUTF8)));
+
+    ChartTableLayout_19 layout;
+    layout.entrySize = sizeof(ChartTableEntry_onDisk_19);
+
+    unsigned long long pos = sizeof(ChartTableHeader) + sizeof(ChartTableLayout_19);
+    layout.dirOffset = pos;
+    for (size_t iDir = 0; iDir < dirs.size(); iDir++)
+        pos += sizeof(int) + dirs[iDir].size();
+    pos = (pos + 3) & ~3ULL;
+
+    layout.entryOffset = pos;
+    pos += nentries * sizeof(ChartTableEntry_onDisk_19);
+
+    std::vector<ChartTableEntry_onDisk_19> records(nentries);
+    layout.stringOffset = pos;
+    for (size_t i = 0; i < nentries; i++) {
+        const ChartTableEntry &cte = active_chartTable[i];
+        cte.Transcribe(records[i]);
+        records[i].pathOffset = pos;
+        pos += strlen(cte.GetpFullPath()) + 1;
+    }
+    pos = (pos + 3) & ~3ULL;
+
+    layout.polyOffset = pos;
+    for (size_t i = 0; i < nentries; i++) {
+        const ChartTableEntry &cte = active_chartTable[i];
+        records[i].plyOffset = pos;
+        pos += cte.GetnPlyEntries() * 2 * sizeof(float);
+
+        //  Polygon tables are stored as the counts, then the points of each
+        records[i].auxOffset = pos;
+        pos += cte.GetnAuxPlyEntries() * sizeof(int);
+        for (int k = 0; k < cte.GetnAuxPlyEntries(); k++)
+            pos += cte.GetAuxCntTableEntry(k) * 2 * sizeof(float);
+
+        records[i].noCovrOffset = pos;
+        pos += cte.GetnNoCovrPlyEntries() * sizeof(int);
+        for (int k = 0; k < cte.GetnNoCovrPlyEntries(); k++)
+            pos += cte.GetNoCovrCntTableEntry(k) * 2 * sizeof(float);
+    }
+
+    if (pos > 0xffffffffULL) {
+        wxLogMessage(_T("Chartdb: table too large for version 19 layout"));
+        return false;
+    }
+    layout.fileSize = pos;
+
+    //  Now write it out in the same order
+    ChartTableHeader cth(dirs.size(), nentries);
+    cth.Write(os, DB_VERSION_CURRENT);
+    os.Write(&layout, sizeof(layout));
+
+    size_t wpos = layout.dirOffset;
+    for (size_t iDir = 0; iDir < dirs.size(); iDir++) {
+        int dirlen = dirs[iDir].size();
+        os.Write(&dirlen, sizeof(int));
+        os.Write(dirs[iDir].data(), dirlen);
+        wpos += sizeof(int) + dirlen;
+    }
+    WritePadding(os, wpos);
+
+    if (nentries)
+        os.Write(&records[0], nentries * sizeof(ChartTableEntry_onDisk_19));
+    wpos += nentries * sizeof(ChartTableEntry_onDisk_19);
+
+    for (size_t i = 0; i < nentries; i++) {
+        const char *path = active_chartTable[i].GetpFullPath();
+        size_t len = strlen(path) + 1;
+        os.Write(path, len);
+        wpos += len;
+    }
+    WritePadding(os, wpos);
+
+    for (size_t i = 0; i < nentries; i++) {
+        const ChartTableEntry &cte = active_chartTable[i];
+        if (cte.GetnPlyEntries())
+            os.Write(cte.GetpPlyTable(), cte.GetnPlyEntries() * 2 * sizeof(float));
+
+        int nAux = cte.GetnAuxPlyEntries();
+        for (int k = 0; k < nAux; k++) {
+            int count = cte.GetAuxCntTableEntry(k);
+            os.Write(&count, sizeof(int));
+        }
+        for (int k = 0; k < nAux; k++)
+            os.Write(cte.GetpAuxPlyTableEntry(k), cte.GetAuxCntTableEntry(k) * 2 * sizeof(float));
+
+        int nNoCovr = cte.GetnNoCovrPlyEntries();
+        for (int k = 0; k < nNoCovr; k++) {
+            int count = cte.GetNoCovrCntTableEntry(k);
+            os.Write(&count, sizeof(int));
+        }
+        for (int k = 0; k < nNoCovr; k++)
+            os.Write(cte.GetpNoCovrPlyTableEntry(k), cte.GetNoCovrCntTableEntry(k) * 2 * sizeof(float));
+    }
+
+    return os.IsOk();
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -1558,11 +1983,14 @@ bool ChartDatabase::Update(ArrayOfCDI& dir_array, bool bForce, wxGenericProgress
       bool lbForce = bForce;
 
       //    Do a dB Version upgrade if the current one is obsolete
+      //    Version 19 changed only the file layout, version 18 entries are kept
       if(s_dbVersion != DB_VERSION_CURRENT)
       {
-
-          active_chartTable.Clear();
-            lbForce = true;
+            if(s_dbVersion < DB_VERSION_PREVIOUS)
+            {
+                  active_chartTable.Clear();
+                  lbForce = true;
+            }
             s_dbVersion = DB_VERSION_CURRENT;         // Update the static indicator
             m_dbversion = DB_VERSION_CURRENT;         // and the member
 
@@ -1613,6 +2041,8 @@ bool ChartDatabase::Update(ArrayOfCDI& dir_array, bool bForce, wxGenericProgress
       }
 
       m_nentries = active_chartTable.GetCount();
+
+      m_spatial_index.Build(*this);
       
       bValid = true;
       m_b_busy = false;
@@ -1644,6 +2074,28 @@ int ChartDatabase::FinddbIndex(wxString PathToFind)
 
 
 
+//-------------------------------------------------------------------
+//    Spatial index queries
+//-------------------------------------------------------------------
+
+void ChartDatabase::GetChartsAtPosition(float lat, float lon, int groupIndex, std::vector<int> &result)
+{
+    m_spatial_index.Validate(*this);
+    m_spatial_index.QueryPosition(lat, lon, groupIndex, result);
+}
+
+void ChartDatabase::GetChartsInBox(const LLBBox &box, int groupIndex, std::vector<int> &result)
+{
+    m_spatial_index.Validate(*this);
+    m_spatial_index.QueryBox(box, groupIndex, result);
+}
+
+const std::vector<int> &ChartDatabase::GetPluginCharts()
+{
+    m_spatial_index.Validate(*this);
+    return m_spatial_index.GetPluginCharts();
+}
+
 //-------------------------------------------------------------------
 //    Disable Chart
 //-------------------------------------------------------------------
@@ -2144,13 +2596,16 @@ int ChartDatabase::SearchDirAndAddCharts(wxString& dir_name_base,
       int nFileProgressQuantum = wxMax( nFile / 100, 2 );
       double rFileProgressRatio = 100.0 / wxMax( nFile, 1 );
 
+      //  Queue every file for header parsing.  Files already in the table with an
+      //  unchanged time stamp will not need an entry, so are not parsed ahead.
+      ChartIngest ingest(this, chart_desc);
+
       for(int ifile=0 ; ifile < nFile ; ifile++)
       {
             wxFileName file(FileList[ifile]);
             wxString full_name = file.GetFullPath();
-            wxString file_name = file.GetFullName();
             wxString utf8_path = full_name;
-            
+
 #ifdef __OCPN__ANDROID__
             // The full path (full_name) is the broken Android files system interpretation, which does not display well onscreen.
             // So, here we reconstruct a full path spec in UTF-8 encoding for later use in string displays.
@@ -2167,6 +2622,28 @@ int ChartDatabase::SearchDirAndAddCharts(wxString& dir_name_base,
             utf8_path = dir_name_base + leftover_path;  // reconstruct a fully utf-8 version
 #endif            
 
+            bool speculative = true;
+            if( bthis_dir_in_dB ) {
+                ChartCollisionsHashMap::const_iterator collision_ptr = collision_map.find( file.GetFullName() );
+                if( collision_ptr != collision_map.end() ) {
+                    ChartTableEntry *pEntry = &active_chartTable[collision_ptr->second];
+                    if( full_name.IsSameAs(pEntry->GetFullSystemPath()) &&
+                        file.GetModificationTime().GetTicks() <= pEntry->GetFileTime() )
+                        speculative = false;
+                }
+            }
+
+            ingest.AddJob(full_name, utf8_path, speculative);
+      }
+
+      ingest.Start();
+
+      for(int ifile=0 ; ifile < nFile ; ifile++)
+      {
+            wxFileName file(FileList[ifile]);
+            wxString full_name = file.GetFullPath();
+            wxString file_name = file.GetFullName();
+            const wxString &utf8_path = ingest.GetUTF8Path(ifile);
 
             //    Validate the file name again, considering MSW's semi-random treatment of case....
             // TODO...something fishy here - may need to normalize saved name?
@@ -2174,6 +2651,7 @@ int ChartDatabase::SearchDirAndAddCharts(wxString& dir_name_base,
                !file_name.Matches(lowerFileSpecXZ) && !file_name.Matches(filespecXZ) &&
                !b_found_cm93) {
                 wxLogMessage(_T("FileSpec test failed for:") + file_name);
+                ingest.Skip(ifile);
                 continue;
             }
 
@@ -2224,8 +2702,9 @@ int ChartDatabase::SearchDirAndAddCharts(wxString& dir_name_base,
             if( file_time_is_same ) {
                 // Produce the same output without actually calling `CreateChartTableEntry()`.
                 wxLogMessage(wxString::Format(_T("Loading chart data for %s"), msg_fn.c_str()));
+                ingest.Skip(ifile);
             } else {
-                pnewChart = CreateChartTableEntry(full_name, utf8_path, chart_desc);
+                pnewChart = ingest.Take(ifile);
                 if(!pnewChart)
                 {
                     bAddFinal = false;
@@ -2296,6 +2775,8 @@ int ChartDatabase::SearchDirAndAddCharts(wxString& dir_name_base,
             }
       }
 
+      ingest.LogThroughput();
+
       m_nentries = active_chartTable.GetCount();
       
       return nDirEntry;
@@ -2490,6 +2971,8 @@ bool ChartDatabase::AddSingleChart( wxString &ChartFullPath, bool b_force_full_s
     //    Update the Entry index fields
     for(unsigned int i=0 ; i<active_chartTable.GetCount() ; i++)
         active_chartTable[i].SetEntryOffset( i );
+
+    m_spatial_index.Invalidate();
  
     //  Get a new magic number
     wxString new_magic;
@@ -2555,6 +3038,7 @@ bool ChartDatabase::RemoveSingleChart( wxString &ChartFullPath )
         }
     }
 
+    m_spatial_index.Invalidate();
     
     //    Update the EntryOffset fields for the array
     ChartTableEntry *pcte;
@@ -2960,4 +3444,5 @@ void ChartDatabase::ApplyGroupArray(ChartGroupArray *pGroupArray)
             }
       }
 
+      m_spatial_index.InvalidateGroups();
 }
@@ -53,12 +53,18 @@
 #include "wx/filename.h"
 #include <wx/image.h>
 #include <wx/fileconf.h>
+#include <wx/file.h>
 #include <sys/stat.h>
 
 #include "config.h"
 #include "chartimg.h"
 #include "ocpn_pixel.h"
 #include "ChartDataInputStream.h"
+#include "RasterScaler.h"
+#include "RasterBandCache.h"
+#include "OCPNPlatform.h"
+#include "lz4.h"
+#include "ssl/sha1.h"
 
 #ifndef __WXMSW__
 #include <signal.h>
@@ -99,10 +105,11 @@ typedef unsigned __int64 uint64_t;
 // ----------------------------------------------------------------------------
 
 #ifdef OCPN_USE_CONFIG
-class MyConfig;
-extern MyConfig        *pConfig;
+extern int             g_BSBImgDebug;          // read with the config, charts may open on worker threads
 #endif
 
+extern OCPNPlatform    *g_Platform;
+
 typedef struct  {
       float y;
       float x;
@@ -1736,6 +1743,11 @@ ChartBaseBSB::ChartBaseBSB()
       pPixCache = NULL;
 
       pLineCache = NULL;
+      m_line_cache_bytes = 0;
+
+      m_band_chart_id = 0;
+      m_band_index = -1;
+      m_band_buf = NULL;
 
       m_bilinear_limit = 8;         // bilinear scaling only up to n
 
@@ -1768,9 +1780,7 @@ ChartBaseBSB::ChartBaseBSB()
       m_b_cdebug = 0;
 
 #ifdef OCPN_USE_CONFIG
-      wxFileConfig *pfc = (wxFileConfig *)pConfig;
-      pfc->SetPath ( _T ( "/Settings" ) );
-      pfc->Read ( _T ( "DebugBSBImg" ),  &m_b_cdebug, 0 );
+      m_b_cdebug = g_BSBImgDebug;
 #endif
 
 }
@@ -1811,6 +1821,8 @@ ChartBaseBSB::~ChartBaseBSB()
       FreeLineCacheRows();
       free (pLineCache);
 
+      free(m_band_buf);
+
       delete pPixCache;
 
 
@@ -1833,6 +1845,7 @@ void ChartBaseBSB::FreeLineCacheRows(int start, int end)
                 free (pt->pTileOffset);
                 free (pt->pPix);
                 pt->bValid = false;
+                m_line_cache_bytes -= LineCacheRowBytes(ylc);
             }
         }
     }
@@ -2146,8 +2159,15 @@ InitReturn ChartBaseBSB::PostInit(void)
         }
       }
       
-        // Recreate the scan line index if the embedded version seems corrupt
-      if(!bline_index_ok)
+      //  The bitmap file as of now, to tell a sidecar index or cached bands made from an older copy
+      wxString bitmap_path = m_FullPath;
+      if( (m_ChartType == CHART_TYPE_GEO) && pBitmapFilePath )
+          bitmap_path = *pBitmapFilePath;
+      time_t bitmap_mtime = wxFileModificationTime( bitmap_path );
+
+        // Recreate the scan line index if the embedded version seems corrupt,
+        // unless a sidecar saved from an earlier recreation is still good
+      if(!bline_index_ok && !LoadLineIndexSidecar(bitmap_filesize, bitmap_mtime))
       {
           wxString msg(_T("   Line Index corrupt, recreating Index for chart "));
           msg.Append(m_FullPath);
@@ -2159,8 +2179,12 @@ InitReturn ChartBaseBSB::PostInit(void)
                 wxLogMessage(msg);
                 return INIT_FAIL_REMOVE;
           }
+          SaveLineIndexSidecar(bitmap_filesize, bitmap_mtime);
       }
 
+      if(g_RasterBandCache.IsEnabled())
+          m_band_chart_id = g_RasterBandCache.GetChartId(m_FullPath, bitmap_filesize.GetValue(), bitmap_mtime);
+
 
 
       //    Allocate the Line Cache
@@ -2253,6 +2277,158 @@ bool ChartBaseBSB::CreateLineIndex()
     return true;
 }
 
+//-----------------------------------------------------------------------------------------------
+//    Line index sidecar
+//
+//    A chart whose embedded line index is bad has it rebuilt by CreateLineIndex(), a scan
+//    of the whole file.  The result is kept in a file of its own, named for the chart path,
+//    and used again while the bitmap file keeps its size and modification time.
+//    The table is stored as line lengths, LZ4 compressed.
+//-----------------------------------------------------------------------------------------------
+
+#define LINE_INDEX_MAGIC        0x58444c4f      // "OLDX"
+#define LINE_INDEX_VERSION      1
+
+struct LineIndexSidecarHeader
+{
+      uint32_t    magic;
+      uint32_t    version;
+      int32_t     size_y;
+      uint32_t    data_size;                // compressed
+      uint64_t    file_size;
+      int64_t     mtime;
+      uint32_t    hash;                     // FNV-1a of the uncompressed line lengths
+      uint32_t    reserved;
+};
+
+static uint32_t LineIndexHash(const uint32_t *lengths, int count)
+{
+      uint32_t hash = 2166136261u;
+      const unsigned char *p = (const unsigned char *)lengths;
+      for(size_t i = 0 ; i < count * sizeof(uint32_t) ; i++)
+      {
+            hash ^= p[i];
+            hash *= 16777619u;
+      }
+      return hash;
+}
+
+wxString ChartBaseBSB::LineIndexSidecarPath()
+{
+      if(!g_Platform)
+            return wxEmptyString;
+
+      wxCharBuffer buf = m_FullPath.ToUTF8();
+      unsigned char sha1_out[20];
+      sha1( (unsigned char *) buf.data(), strlen(buf.data()), sha1_out );
+
+      wxString name;
+      for (unsigned int i=0 ; i < 20 ; i++)
+            name += wxString::Format(_T("%02X"), sha1_out[i]);
+
+      wxChar separator = wxFileName::GetPathSeparator();
+      return g_Platform->GetPrivateDataDir() + separator + _T("raster_line_index") + separator + name;
+}
+
+bool ChartBaseBSB::LoadLineIndexSidecar(wxULongLong file_size, time_t mtime)
+{
+      wxString path = LineIndexSidecarPath();
+      if(path.IsEmpty() || mtime == (time_t)-1 || !wxFileName::FileExists(path))
+            return false;
+
+      wxFile file(path);
+      if(!file.IsOpened())
+            return false;
+
+      LineIndexSidecarHeader hdr;
+      if(file.Read(&hdr, sizeof(hdr)) != sizeof(hdr))
+            return false;
+
+      if(hdr.magic != LINE_INDEX_MAGIC || hdr.version != LINE_INDEX_VERSION || hdr.size_y != Size_Y ||
+         hdr.file_size != file_size.GetValue() || hdr.mtime != (int64_t)mtime ||
+         hdr.data_size > (uint32_t)LZ4_compressBound(Size_Y * sizeof(uint32_t)))
+            return false;
+
+      std::vector<char> data(hdr.data_size + 1);
+      if(file.Read(&data[0], hdr.data_size) != (ssize_t)hdr.data_size)
+            return false;
+
+      std::vector<uint32_t> lengths(Size_Y);
+      int table_size = Size_Y * sizeof(uint32_t);
+      if(LZ4_decompress_safe(&data[0], (char *)&lengths[0], hdr.data_size, table_size) != table_size)
+            return false;
+
+      if(LineIndexHash(&lengths[0], Size_Y) != hdr.hash)
+            return false;
+
+      //  Offsets must stay within the bitmap data, before the embedded table
+      std::vector<int> offsets(Size_Y);
+      uint64_t offset = 0;
+      for(int iplt=0 ; iplt < Size_Y ; iplt++)
+      {
+            offset += lengths[iplt];
+            if(offset > (uint64_t)pline_table[Size_Y])
+                  return false;
+            offsets[iplt] = (int)offset;
+      }
+
+      memcpy(pline_table, &offsets[0], Size_Y * sizeof(int));
+      return true;
+}
+
+void ChartBaseBSB::SaveLineIndexSidecar(wxULongLong file_size, time_t mtime)
+{
+      wxString path = LineIndexSidecarPath();
+      if(path.IsEmpty() || mtime == (time_t)-1)
+            return;
+
+      wxFileName fn(path);
+      if(!fn.DirExists() && !wxFileName::Mkdir(fn.GetPath(), 0755, wxPATH_MKDIR_FULL))
+            return;
+
+      std::vector<uint32_t> lengths(Size_Y);
+      uint32_t prev = 0;
+      for(int iplt=0 ; iplt < Size_Y ; iplt++)
+      {
+            lengths[iplt] = (uint32_t)pline_table[iplt] - prev;
+            prev = (uint32_t)pline_table[iplt];
+      }
+
+      int table_size = Size_Y * sizeof(uint32_t);
+      std::vector<char> data(LZ4_compressBound(table_size));
+      int data_size = LZ4_compress((const char *)&lengths[0], &data[0], table_size);
+      if(data_size <= 0)
+            return;
+
+      LineIndexSidecarHeader hdr;
+      memset(&hdr, 0, sizeof(hdr));
+      hdr.magic = LINE_INDEX_MAGIC;
+      hdr.version = LINE_INDEX_VERSION;
+      hdr.size_y = Size_Y;
+      hdr.data_size = data_size;
+      hdr.file_size = file_size.GetValue();
+      hdr.mtime = mtime;
+      hdr.hash = LineIndexHash(&lengths[0], Size_Y);
+
+      //  Written aside and renamed, a partial file is never read back
+      wxString tmp_path = path + _T(".tmp");
+      {
+            wxFile file;
+            if(!file.Create(tmp_path, true))
+                  return;
+            bool bok = file.Write(&hdr, sizeof(hdr)) == sizeof(hdr) &&
+                       file.Write(&data[0], data_size) == (size_t)data_size;
+            file.Close();
+            if(!bok)
+            {
+                  wxRemoveFile(tmp_path);
+                  return;
+            }
+      }
+
+      wxRenameFile(tmp_path, path, true);
+}
+
 
 //    Invalidate and Free the line cache contents
 void ChartBaseBSB::InvalidateLineCache(void)
@@ -2273,6 +2449,23 @@ void ChartBaseBSB::InvalidateLineCache(void)
                   }
             }
       }
+      m_line_cache_bytes = 0;
+}
+
+size_t ChartBaseBSB::GetMemoryFootprint()
+{
+      size_t bytes = m_line_cache_bytes;
+
+      if(pline_table)
+            bytes += (Size_Y + 1) * sizeof(int);
+      if(pLineCache)
+            bytes += Size_Y * sizeof(CachedLine);
+      if(m_band_buf)
+            bytes += (size_t)RASTER_BAND_ROWS * Size_X;
+      if(pPixCache)
+            bytes += (size_t)pPixCache->GetLinePitch() * pPixCache->GetHeight();
+
+      return bytes;
 }
 
 bool ChartBaseBSB::GetChartExtent(Extent *pext)
@@ -3821,10 +4014,16 @@ bool ChartBaseBSB::GetAndScaleData(unsigned char *ppn, size_t data_size, wxRect&
             {
 //    Allocate a working buffer based on scale factor
                   int blur_factor = wxMax(2, Factor);
+                  int pix_bytes = BPP/8;
+                  int line_bytes = source.width * pix_bytes;
                   int wb_size = (source.width) * (blur_factor * 2) * BPP/8 ;
                   s_data = (unsigned char *) malloc( wb_size ); // work buffer
-                  unsigned char *pixel;
-                  int y_offset;
+                  unsigned int *col_sum = (unsigned int *) malloc( line_bytes * sizeof(unsigned int) );
+
+                  //    Output pixels with some source under them, the rest are black
+                  int n_valid = 0;
+                  if(Size_X - source.x > 0)
+                        n_valid = wxMin(target_width, (Size_X - source.x + Factor - 1) / Factor);
 
                   for (int y = dest.y; y < (dest.y + dest.height); y++)
                   {
@@ -3839,54 +4038,24 @@ bool ChartBaseBSB::GetAndScaleData(unsigned char *ppn, size_t data_size, wxRect&
 
                         target_data = data + (y * dest_line_length/*dest_stride * BPP/8*/);
 
-                        for (int x = 0; x < target_width; x++)
-                        {
-                              unsigned int avgRed = 0 ;
-                              unsigned int avgGreen = 0;
-                              unsigned int avgBlue = 0;
-                              unsigned int pixel_count = 0;
-                              unsigned char *pix0 = s_data +  BPP/8 * ((int)( x * factor )) ;
-                              y_offset = 0;
-
-                              if((x * Factor) < (Size_X - source.x))
-                              {
-            // determine average
-                                    for ( int y1 = 0 ; y1 < blur_factor ; ++y1 )
-                                    {
-                                        pixel = pix0 + (BPP/8 * y_offset ) ;
-                                        for ( int x1 = 0 ; x1 < blur_factor ; ++x1 )
-                                        {
-                                            avgRed   += pixel[0] ;
-                                            avgGreen += pixel[1] ;
-                                            avgBlue  += pixel[2] ;
-
-                                            pixel += BPP/8;
-
-                                            pixel_count++;
-                                        }
-                                        y_offset += source.width ;
-                                    }
-
-                                    if(0 == pixel_count)                // Protect
-                                        pixel_count = 1;
-                                    
-                                    target_data[0] = avgRed / pixel_count;     // >> scounter;
-                                    target_data[1] = avgGreen / pixel_count;   // >> scounter;
-                                    target_data[2] = avgBlue / pixel_count;    // >> scounter;
-                                    target_data += BPP/8;
-                              }
-                              else
-                              {
-                                    target_data[0] = 0;
-                                    target_data[1] = 0;
-                                    target_data[2] = 0;
-                                    target_data += BPP/8;
-                              }
+                        //    Box filter, summing the lines first then averaging along them
+                        RasterSumRows(s_data, line_bytes, blur_factor, line_bytes, col_sum);
+                        RasterBoxFilterRow(col_sum, source.width, pix_bytes, factor, blur_factor,
+                                           n_valid, target_data);
 
-                        }  // for x
+                        unsigned char *pblack = target_data + n_valid * pix_bytes;
+                        for (int x = n_valid; x < target_width; x++)
+                        {
+                              pblack[0] = 0;
+                              pblack[1] = 0;
+                              pblack[2] = 0;
+                              pblack += pix_bytes;
+                        }
 
                   }  // for y
 
+                  free(col_sum);
+
             }           // SCALE_BILINEAR
 
             else if (scale_type == RENDER_LODEF)
@@ -3907,16 +4076,23 @@ bool ChartBaseBSB::GetAndScaleData(unsigned char *ppn, size_t data_size, wxRect&
                         int y = dest.y;                // starting here
                         long ys = dest.y * y_delta;
 
+                        //    Only the source columns sampled by this destination strip need decoding
+                        long x_first = (source.x << scaler) + (dest.x * x_delta);
+                        long x_last = x_first + (dest.width - 1) * x_delta;
+                        int sx0 = wxMax(0, (int)(x_first >> scaler));
+                        int sx1 = wxMin(Size_X, (int)(x_last >> scaler) + 1);
+
                         while ( y < dest.y + dest.height)
                         {
                         //    Read 1 line at the right place from the source
 
                               wxRect s1;
-                              s1.x = 0;
+                              s1.x = sx0;
                               s1.y = source.y + (ys >> scaler);
-                              s1.width = Size_X;
+                              s1.width = sx1 - sx0;
                               s1.height = 1;
-                              GetChartBits(s1, s_data, get_bits_submap);
+                              if(sx1 > sx0)                     // else the strip is off the chart, all black
+                                    GetChartBits(s1, s_data + sx0 * BPP/8, get_bits_submap);
 
                               target_data = data + (y * dest_line_length/*dest_stride * BPP/8*/) + (dest.x * BPP / 8);
 
@@ -4111,13 +4287,13 @@ bool ChartBaseBSB::GetChartBits(wxRect& source, unsigned char *pPix, int sub_sam
                                 else
                                 {
 
-                                        BSBGetScanline( pCP,  iy, source.x, Size_X, sub_samp);
+                                        GetChartRow( pCP,  iy, source.x, Size_X, sub_samp);
                                         memset(pCP + (Size_X - source.x) * BPP/8, FILL_BYTE,
                                                (source.x + source.width - Size_X) * BPP/8);
                                 }
                             }
                             else
-                                BSBGetScanline( pCP, iy, source.x, source.x + source.width, sub_samp);
+                                GetChartRow( pCP, iy, source.x, source.x + source.width, sub_samp);
                     }
                     else
                     {
@@ -4128,7 +4304,7 @@ bool ChartBaseBSB::GetChartBits(wxRect& source, unsigned char *pPix, int sub_sam
 
                                 int xfill_corrected = -source.x + (source.x % sub_samp);    //+ve
                                 memset(pCP, FILL_BYTE, (xfill_corrected * BPP/8));
-                                BSBGetScanline( pCP + (xfill_corrected * BPP/8),  iy, 0,
+                                GetChartRow( pCP + (xfill_corrected * BPP/8),  iy, 0,
                                         source.width + source.x , sub_samp);
 
                             }
@@ -4337,6 +4513,17 @@ inline void memset_short(unsigned char *dst, unsigned char cbyte, int count)
 #define TILE_SIZE 512
 
 //#define USE_OLD_CACHE  // removed this (and simplify code below) once the new method is verified
+
+//    Bytes allocated for a valid line cache row
+size_t ChartBaseBSB::LineCacheRowBytes(int row)
+{
+#ifdef USE_OLD_CACHE
+      return Size_X;
+#else
+      return (pline_table[row + 1] - pline_table[row]) + sizeof(TileOffsetCache) * (Size_X / TILE_SIZE + 1);
+#endif
+}
+
 //#define PRINT_TIMINGS  // enable for profiling
 
 #ifdef PRINT_TIMINGS
@@ -4537,6 +4724,8 @@ int   ChartBaseBSB::BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int
 #endif
 
           pt->bValid = true;
+          if(pt != &cached_line)
+              m_line_cache_bytes += LineCacheRowBytes(y);
       }
 
 //          Line is valid, de-reference thru proper pallete directly to target
@@ -4764,6 +4953,152 @@ nocachestart:
     return 1;
 }
 
+//-----------------------------------------------------------------------
+//    Decode a BSB Scan Line to palette indices, the full chart width,
+//    without the line cache
+//-----------------------------------------------------------------------
+bool ChartBaseBSB::BSBDecodeIndexRow( int y, unsigned char *pIndex )
+{
+      int thisline_size = pline_table[y+1] - pline_table[y] ;
+      if(pline_table[y] == 0 || pline_table[y+1] == 0 || thisline_size <= 0)
+            return false;
+
+      if(thisline_size > ifs_bufsize)
+      {
+            unsigned char * tmp = ifs_buf;
+            if(!(ifs_buf = (unsigned char *)realloc(ifs_buf, thisline_size))) {
+                  ifs_buf = tmp;
+                  return false;
+            }
+            ifs_bufsize = thisline_size;
+      }
+
+      if(ifs_bitmap->TellI() != pline_table[y] &&
+         wxInvalidOffset == ifs_bitmap->SeekI(pline_table[y], wxFromStart))
+            return false;
+
+      ifs_bitmap->Read(ifs_buf, thisline_size);
+      if((int)ifs_bitmap->LastRead() != thisline_size)
+            return false;
+
+      unsigned char *lp = ifs_buf;
+      unsigned char *end = ifs_buf + thisline_size;
+      unsigned char byNext;
+
+      //      skip the line number.
+      do byNext = *lp++; while( (byNext & 0x80) != 0 && lp < end );
+
+      int nValueShift = 7 - nColorSize;
+      unsigned char byValueMask = (((1 << nColorSize)) - 1) << nValueShift;
+      unsigned char byCountMask = (1 << (7 - nColorSize)) - 1;
+
+      //      Read and expand runs.  As BSBGetScanline(), a line ending early,
+      //      or on a zero byte, runs out with index 0.
+      int iPixel = 0;
+      while(iPixel < Size_X && lp < end)
+      {
+            byNext = *lp++;
+            if(byNext == 0)
+                  break;
+
+            unsigned char nPixValue = (byNext & byValueMask) >> nValueShift;
+            unsigned int nRunCount = byNext & byCountMask;
+
+            while( (byNext & 0x80) != 0 && lp < end )
+            {
+                  byNext = *lp++;
+                  nRunCount = nRunCount * 128 + (byNext & 0x7f);
+            }
+
+            nRunCount++;
+
+            if( nRunCount > (unsigned int)(Size_X - iPixel) ) // protection against corrupt data
+                  nRunCount = Size_X - iPixel;
+
+            memset(pIndex + iPixel, nPixValue, nRunCount);
+            iPixel += nRunCount;
+      }
+
+      if(iPixel < Size_X)
+            memset(pIndex + iPixel, 0, Size_X - iPixel);
+
+      return true;
+}
+
+//-----------------------------------------------------------------------
+//    Get a row of palette indices from the band holding it, decoded
+//    once and then kept in g_RasterBandCache
+//-----------------------------------------------------------------------
+unsigned char *ChartBaseBSB::GetBandRow( int y )
+{
+      int band = y / RASTER_BAND_ROWS;
+      int y0 = band * RASTER_BAND_ROWS;
+
+      if(band != m_band_index)
+      {
+            if(!m_band_buf)
+            {
+                  m_band_buf = (unsigned char *)malloc((size_t)RASTER_BAND_ROWS * Size_X);
+                  if(!m_band_buf)
+                        return NULL;
+            }
+
+            m_band_index = -1;
+
+            int nrows = wxMin(RASTER_BAND_ROWS, Size_Y - y0);
+            int size = nrows * Size_X;
+
+            if(!g_RasterBandCache.Fetch(m_band_chart_id, band, m_band_buf, size))
+            {
+                  for(int iy = 0 ; iy < nrows ; iy++)
+                  {
+                        if(!BSBDecodeIndexRow(y0 + iy, m_band_buf + (size_t)iy * Size_X))
+                              return NULL;
+                  }
+                  g_RasterBandCache.Store(m_band_chart_id, band, m_band_buf, size);
+            }
+
+            m_band_index = band;
+      }
+
+      return m_band_buf + (size_t)(y - y0) * Size_X;
+}
+
+//-----------------------------------------------------------------------
+//    Get a BSB Scan Line, as BSBGetScanline(), from the band cache when
+//    it is in use
+//-----------------------------------------------------------------------
+int ChartBaseBSB::GetChartRow( unsigned char *pLineBuf, int y, int xs, int xl, int sub_samp )
+{
+      if(!m_band_chart_id || sub_samp != 1 || BPP != 24 || !g_RasterBandCache.IsEnabled())
+            return BSBGetScanline( pLineBuf, y, xs, xl, sub_samp);
+
+      unsigned char *pIndex = GetBandRow(y);
+      if(!pIndex)
+            return BSBGetScanline( pLineBuf, y, xs, xl, sub_samp);
+
+      if(xl > Size_X)
+            xl = Size_X;
+      if(xs >= xl)
+            return 1;
+
+      //    De-reference thru proper pallete directly to target,
+      //    the last pixel byte by byte, so as not to write past it
+      unsigned char *prgb = pLineBuf;
+      for(int ix = xs ; ix < xl - 1 ; ix++)
+      {
+            *(uint32_t*)prgb = pPalette[pIndex[ix]];
+            prgb += 3;
+      }
+
+      int rgbval = pPalette[pIndex[xl - 1]];
+      *prgb++ = rgbval & 0xff;
+      *prgb++ = (rgbval >> 8) & 0xff;
+      *prgb = (rgbval >> 16) & 0xff;
+
+      return 1;
+}
+
 
 
 int  *ChartBaseBSB::GetPalettePtr(BSB_Color_Capability color_index)
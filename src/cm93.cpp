@@ -56,6 +56,7 @@
 #include "ChartDataInputStream.h"
 #include "DetailSlider.h"
 #include "chcanv.h"
+#include "CM93CellLoader.h"
 
 #include <stdio.h>
 
@@ -1071,130 +1072,84 @@ void CreateDecodeTable ( void )
 }
 
 
-static int   read_and_decode_bytes ( FILE *stream, void *p, int nbytes )
+//    A cell file read whole and decoded, parsed in place
+
+struct cm93_cell_stream
+{
+      const unsigned char *p;
+      const unsigned char *end;
+};
+
+static int read_cell_bytes ( cm93_cell_stream *stream, void *p, int nbytes )
 {
       if ( 0 == nbytes )                  // declare victory if no bytes requested
             return 1;
 
-      //    read into callers buffer
-      if ( fread ( p, nbytes, 1, stream ) != 1)
+      if ( ( nbytes < 0 ) || ( stream->end - stream->p < nbytes ) )
             return 0;
 
-      //    decode inplace
-      unsigned char *q = ( unsigned char * ) p;
+      memcpy ( p, stream->p, nbytes );
+      stream->p += nbytes;
 
-      for ( int i=0 ; i < nbytes ; i++ )
-      {
-            unsigned char a = *q;
-            int b = a;
-            unsigned char c = Decode_table[b];
-            *q = c;
-
-            q++;
-      }
       return 1;
 }
 
-
-static int read_and_decode_double ( FILE *stream, double *p )
+static inline int read_cell_double ( cm93_cell_stream *stream, double *p )
 {
-      double t;
-      //    read into temp buffer
-      if ( fread ( &t, sizeof ( double ), 1, stream ) != 1)
-            return 0;
-
-      //    decode inplace
-      unsigned char *q = ( unsigned char * ) &t;
-
-      for ( unsigned int i=0 ; i < sizeof ( double ) ; i++ )
-      {
-            unsigned char a = *q;
-            int b = a;
-            unsigned char c = Decode_table[b];
-            *q = c;
-
-            q++;
-      }
-
-      //    copy to target
-      *p = t;
+      return read_cell_bytes ( stream, p, sizeof ( double ) );
+}
 
-      return 1;
+static inline int read_cell_int ( cm93_cell_stream *stream, int *p )
+{
+      return read_cell_bytes ( stream, p, sizeof ( int ) );
 }
 
-static int read_and_decode_int ( FILE *stream, int *p )
+static inline int read_cell_ushort ( cm93_cell_stream *stream, unsigned short *p )
 {
-      int t;
-      //    read into temp buffer
-      if ( fread ( &t, sizeof ( int ), 1, stream ) != 1)
-            return 0;
+      return read_cell_bytes ( stream, p, sizeof ( unsigned short ) );
+}
 
-      //    decode inplace
-      unsigned char *q = ( unsigned char * ) &t;
 
-      for ( unsigned int i=0 ; i < sizeof ( int ) ; i++ )
-      {
-            unsigned char a = *q;
-            int b = a;
-            unsigned char c = Decode_table[b];
-            *q = c;
 
-            q++;
-      }
-
-      //    copy to target
-      *p = t;
+//    The cm93 scales Z, A..G, by scale index, with their cell size in 20 minute units
+static const struct { int scale; int dval; } cm93_scale_table[8] =
+{
+      { 20000000, 120 },          // Z
+      {  3000000,  60 },          // A
+      {  1000000,  30 },          // B
+      {   200000,  12 },          // C
+      {   100000,   3 },          // D
+      {    50000,   1 },          // E
+      {    20000,   1 },          // F
+      {     7500,   1 }           // G
+};
 
-      return 1;
+//    The native scale of a cm93 scale index, Z for an unknown index
+int Get_CM93_Scale ( int scale_index )
+{
+      if ( ( scale_index < 0 ) || ( scale_index > 7 ) )
+            return cm93_scale_table[0].scale;
+      return cm93_scale_table[scale_index].scale;
 }
 
-static int read_and_decode_ushort ( FILE *stream, unsigned short *p )
+//    The cell size, in 20 minute units, of cells at a given native scale
+int Get_CM93_CellDval ( int scale )
 {
-      unsigned short t;
-      //    read into temp buffer
-      if ( fread ( &t, sizeof ( unsigned short ), 1, stream ) != 1)
-            return 0;
-
-      //    decode inplace
-      unsigned char *q = ( unsigned char * ) &t;
-
-      for ( unsigned int i=0 ; i < sizeof ( unsigned short ) ; i++ )
+      for ( int i = 0 ; i < 8 ; i++ )
       {
-            unsigned char a = *q;
-            int b = a;
-            unsigned char c = Decode_table[b];
-            *q = c;
-
-            q++;
+            if ( cm93_scale_table[i].scale == scale )
+                  return cm93_scale_table[i].dval;
       }
-
-      //    copy to target
-      *p = t;
-
       return 1;
 }
 
-
-
 //    Calculate the CM93 CellIndex integer for a given Lat/Lon, at a given scale
 
 int Get_CM93_CellIndex ( double lat, double lon, int scale )
 {
       int retval = 0;
 
-      int dval;
-      switch ( scale )
-      {
-            case 20000000: dval = 120; break;         // Z
-            case  3000000: dval =  60; break;         // A
-            case  1000000: dval =  30; break;         // B
-            case   200000: dval =  12; break;         // C
-            case   100000: dval =   3; break;         // D
-            case    50000: dval =   1; break;         // E
-            case    20000: dval =   1; break;         // F
-            case     7500: dval =   1; break;         // G
-            default: dval =   1; break;
-      }
+      int dval = Get_CM93_CellDval ( scale );
 
       //    Longitude
       double lon1 = ( lon + 360. ) * 3.;                    // basic cell size is 20 minutes
@@ -1237,22 +1192,16 @@ void Get_CM93_Cell_Origin ( int cellindex, int scale, double *lat, double *lon )
 //    Answer the query: "Is there a cm93 cell at the specified scale which contains a given lat/lon?"
 bool Is_CM93Cell_Present ( wxString &fileprefix, double lat, double lon, int scale_index )
 {
-      int scale;
-      int dval;
+      int scale = Get_CM93_Scale ( scale_index );
+      int dval = Get_CM93_CellDval ( scale );
       wxChar scale_char;
 
-      switch ( scale_index )
-      {
-            case 0: scale =  20000000; dval = 120; scale_char = 'Z'; break;         // Z
-            case 1: scale =   3000000; dval =  60; scale_char = 'A'; break;         // A
-            case 2: scale =   1000000; dval =  30; scale_char = 'B'; break;         // B
-            case 3: scale =    200000; dval =  12; scale_char = 'C'; break;         // C
-            case 4: scale =    100000; dval =   3; scale_char = 'D'; break;         // D
-            case 5: scale =     50000; dval =   1; scale_char = 'E'; break;         // E
-            case 6: scale =     20000; dval =   1; scale_char = 'F'; break;         // F
-            case 7: scale =      7500; dval =   1; scale_char = 'G'; break;         // G
-            default: scale = 20000000; dval = 120; scale_char = ' '; break;
-      }
+      if ( ( scale_index < 0 ) || ( scale_index > 7 ) )
+            scale_char = ' ';
+      else if ( scale_index == 0 )
+            scale_char = 'Z';
+      else
+            scale_char = ( wxChar ) ( 'A' + scale_index - 1 );
 
       int cellindex = Get_CM93_CellIndex ( lat, lon, scale );
 
@@ -1327,7 +1276,7 @@ bool Is_CM93Cell_Present ( wxString &fileprefix, double lat, double lon, int sca
 }
 
 
-static bool read_header_and_populate_cib ( FILE *stream, Cell_Info_Block *pCIB )
+static bool read_header_and_populate_cib ( cm93_cell_stream *stream, Cell_Info_Block *pCIB )
 {
       //    Read header, populate Cell_Info_Block
 
@@ -1339,40 +1288,40 @@ static bool read_header_and_populate_cib ( FILE *stream, Cell_Info_Block *pCIB )
 
       memset ( ( void * ) &header, 0, sizeof ( header ) );
 
-      read_and_decode_double ( stream,&header.lon_min );
-      read_and_decode_double ( stream,&header.lat_min );
-      read_and_decode_double ( stream,&header.lon_max );
-      read_and_decode_double ( stream,&header.lat_max );
-
-      read_and_decode_double ( stream,&header.easting_min );
-      read_and_decode_double ( stream,&header.northing_min );
-      read_and_decode_double ( stream,&header.easting_max );
-      read_and_decode_double ( stream,&header.northing_max );
-
-      read_and_decode_ushort ( stream,&header.usn_vector_records );
-      read_and_decode_int ( stream,&header.n_vector_record_points );
-      read_and_decode_int ( stream,&header.m_46 );
-      read_and_decode_int ( stream,&header.m_4a );
-      read_and_decode_ushort ( stream,&header.usn_point3d_records );
-      read_and_decode_int ( stream,&header.m_50 );
-      read_and_decode_int ( stream,&header.m_54 );
-      read_and_decode_ushort ( stream,&header.usn_point2d_records );
-      read_and_decode_ushort ( stream,&header.m_5a );
-      read_and_decode_ushort ( stream,&header.m_5c );
-      read_and_decode_ushort ( stream,&header.usn_feature_records );
-
-      read_and_decode_int ( stream,&header.m_60 );
-      read_and_decode_int ( stream,&header.m_64 );
-      read_and_decode_ushort ( stream,&header.m_68 );
-      read_and_decode_ushort ( stream,&header.m_6a );
-      read_and_decode_ushort ( stream,&header.m_6c );
-      read_and_decode_int ( stream,&header.m_nrelated_object_pointers );
-
-      read_and_decode_int ( stream,&header.m_72 );
-      read_and_decode_ushort ( stream,&header.m_76 );
-
-      read_and_decode_int ( stream,&header.m_78 );
-      read_and_decode_int ( stream,&header.m_7c );
+      read_cell_double ( stream,&header.lon_min );
+      read_cell_double ( stream,&header.lat_min );
+      read_cell_double ( stream,&header.lon_max );
+      read_cell_double ( stream,&header.lat_max );
+
+      read_cell_double ( stream,&header.easting_min );
+      read_cell_double ( stream,&header.northing_min );
+      read_cell_double ( stream,&header.easting_max );
+      read_cell_double ( stream,&header.northing_max );
+
+      read_cell_ushort ( stream,&header.usn_vector_records );
+      read_cell_int ( stream,&header.n_vector_record_points );
+      read_cell_int ( stream,&header.m_46 );
+      read_cell_int ( stream,&header.m_4a );
+      read_cell_ushort ( stream,&header.usn_point3d_records );
+      read_cell_int ( stream,&header.m_50 );
+      read_cell_int ( stream,&header.m_54 );
+      read_cell_ushort ( stream,&header.usn_point2d_records );
+      read_cell_ushort ( stream,&header.m_5a );
+      read_cell_ushort ( stream,&header.m_5c );
+      read_cell_ushort ( stream,&header.usn_feature_records );
+
+      read_cell_int ( stream,&header.m_60 );
+      read_cell_int ( stream,&header.m_64 );
+      read_cell_ushort ( stream,&header.m_68 );
+      read_cell_ushort ( stream,&header.m_6a );
+      read_cell_ushort ( stream,&header.m_6c );
+      read_cell_int ( stream,&header.m_nrelated_object_pointers );
+
+      read_cell_int ( stream,&header.m_72 );
+      read_cell_ushort ( stream,&header.m_76 );
+
+      read_cell_int ( stream,&header.m_78 );
+      read_cell_int ( stream,&header.m_7c );
 
 
       //    Calculate and record the cell coordinate transform coefficients
@@ -1421,7 +1370,7 @@ static bool read_header_and_populate_cib ( FILE *stream, Cell_Info_Block *pCIB )
       return true;
 }
 
-static bool read_vector_record_table ( FILE *stream, int count, Cell_Info_Block *pCIB )
+static bool read_vector_record_table ( cm93_cell_stream *stream, int count, Cell_Info_Block *pCIB )
 {
       bool brv;
 
@@ -1434,23 +1383,23 @@ static bool read_vector_record_table ( FILE *stream, int count, Cell_Info_Block
             p->index = iedge;
 
             unsigned short npoints;
-            brv = ! ( read_and_decode_ushort ( stream, &npoints ) == 0 );
+            brv = ! ( read_cell_ushort ( stream, &npoints ) == 0 );
             if ( !brv )
                   return false;
 
             p->n_points = npoints;
             p->p_points = q;
 
-//           brv = read_and_decode_bytes(stream, q, p->n_points * sizeof(cm93_point));
+//           brv = read_cell_bytes(stream, q, p->n_points * sizeof(cm93_point));
 //            if(!brv)
 //                  return false;
 
             unsigned short x, y;
             for ( int index = 0 ; index <  p->n_points ; index++ )
             {
-                  if ( !read_and_decode_ushort ( stream, &x ) )
+                  if ( !read_cell_ushort ( stream, &x ) )
                         return false;
-                  if ( !read_and_decode_ushort ( stream, &y ) )
+                  if ( !read_cell_ushort ( stream, &y ) )
                         return false;
 
                   q[index].x = x;
@@ -1497,7 +1446,7 @@ static bool read_vector_record_table ( FILE *stream, int count, Cell_Info_Block
 }
 
 
-static bool read_3dpoint_table ( FILE *stream, int count, Cell_Info_Block *pCIB )
+static bool read_3dpoint_table ( cm93_cell_stream *stream, int count, Cell_Info_Block *pCIB )
 {
       geometry_descriptor *p = pCIB->point3d_descriptor_block;
       cm93_point_3d *q = pCIB->p3dpoint_array;
@@ -1505,7 +1454,7 @@ static bool read_3dpoint_table ( FILE *stream, int count, Cell_Info_Block *pCIB
       for ( int i = 0 ; i < count ; i++ )
       {
             unsigned short npoints;
-            if ( !read_and_decode_ushort ( stream, &npoints ) )
+            if ( !read_cell_ushort ( stream, &npoints ) )
                   return false;
 
             p->n_points = npoints;
@@ -1513,17 +1462,17 @@ static bool read_3dpoint_table ( FILE *stream, int count, Cell_Info_Block *pCIB
 
 //            unsigned short t = p->n_points;
 
-//            if(!read_and_decode_bytes(stream, q, t*6))
+//            if(!read_cell_bytes(stream, q, t*6))
 //                  return false;
 
             unsigned short x, y, z;
             for ( int index = 0 ; index < p->n_points ; index++ )
             {
-                  if ( !read_and_decode_ushort ( stream, &x ) )
+                  if ( !read_cell_ushort ( stream, &x ) )
                         return false;
-                  if ( !read_and_decode_ushort ( stream, &y ) )
+                  if ( !read_cell_ushort ( stream, &y ) )
                         return false;
-                  if ( !read_and_decode_ushort ( stream, &z ) )
+                  if ( !read_cell_ushort ( stream, &z ) )
                         return false;
 
                   q[index].x = x;
@@ -1540,17 +1489,17 @@ static bool read_3dpoint_table ( FILE *stream, int count, Cell_Info_Block *pCIB
 }
 
 
-static bool read_2dpoint_table ( FILE *stream, int count, Cell_Info_Block *pCIB )
+static bool read_2dpoint_table ( cm93_cell_stream *stream, int count, Cell_Info_Block *pCIB )
 {
 
-//      int rv = read_and_decode_bytes(stream, pCIB->p2dpoint_array, count * 4);
+//      int rv = read_cell_bytes(stream, pCIB->p2dpoint_array, count * 4);
 
       unsigned short x, y;
       for ( int index = 0 ; index < count ; index++ )
       {
-            if ( !read_and_decode_ushort ( stream, &x ) )
+            if ( !read_cell_ushort ( stream, &x ) )
                   return false;
-            if ( !read_and_decode_ushort ( stream, &y ) )
+            if ( !read_cell_ushort ( stream, &y ) )
                   return false;
 
             pCIB->p2dpoint_array[index].x = x;
@@ -1562,7 +1511,7 @@ static bool read_2dpoint_table ( FILE *stream, int count, Cell_Info_Block *pCIB
 }
 
 
-static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_Block *pCIB )
+static bool read_feature_record_table ( cm93_cell_stream *stream, int n_features, Cell_Info_Block *pCIB )
 {
       try
       {
@@ -1589,9 +1538,9 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
             {
 
                   // read the object definition
-                  read_and_decode_bytes ( stream, &object_type, 1 );           // read the object type
-                  read_and_decode_bytes ( stream, &geom_prim, 1 );             // read the object geometry primitive type
-                  read_and_decode_ushort ( stream, &obj_desc_bytes );          // read the object byte count
+                  read_cell_bytes ( stream, &object_type, 1 );           // read the object type
+                  read_cell_bytes ( stream, &geom_prim, 1 );             // read the object geometry primitive type
+                  read_cell_ushort ( stream, &obj_desc_bytes );          // read the object byte count
 
                   pobj->otype = object_type;
                   pobj->geotype = geom_prim;
@@ -1602,7 +1551,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
                         case 4:              // AREA
                         {
 
-                              if ( !read_and_decode_ushort ( stream, &n_elements ) )
+                              if ( !read_cell_ushort ( stream, &n_elements ) )
                                     return false;
 
                               pobj->n_geom_elements = n_elements;
@@ -1613,7 +1562,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
 
                               for ( unsigned short i = 0 ; i < pobj->n_geom_elements ; i++ )
                               {
-                                    if ( !read_and_decode_ushort ( stream, &index ) )
+                                    if ( !read_cell_ushort ( stream, &index ) )
                                           return false;
 
                                     if ( ( index & 0x1fff ) > pCIB->m_nvector_records )
@@ -1635,7 +1584,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
                         case 2:                                         // LINE geometry
                         {
 
-                              if ( !read_and_decode_ushort ( stream, &n_elements ) )      // read geometry element count
+                              if ( !read_cell_ushort ( stream, &n_elements ) )      // read geometry element count
                                     return false;
 
                               pobj->n_geom_elements = n_elements;
@@ -1648,7 +1597,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
                               {
                                     unsigned short geometry_index;
 
-                                    if ( !read_and_decode_ushort ( stream, &geometry_index ) )
+                                    if ( !read_cell_ushort ( stream, &geometry_index ) )
                                           return false;
 
 
@@ -1671,7 +1620,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
 
                         case 1:
                         {
-                              if ( !read_and_decode_ushort ( stream, &index ) )
+                              if ( !read_cell_ushort ( stream, &index ) )
                                     return false;
 
                               obj_desc_bytes -= 2;
@@ -1685,7 +1634,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
 
                         case 8:
                         {
-                              if ( !read_and_decode_ushort ( stream, &index ) )
+                              if ( !read_cell_ushort ( stream, &index ) )
                                     return false;
                               obj_desc_bytes -= 2;
 
@@ -1703,7 +1652,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
                   if ( ( pobj->geotype & 0x10 ) == 0x10 )        // children/related
                   {
                         unsigned char nrelated;
-                        if ( !read_and_decode_bytes ( stream, &nrelated, 1 ) )
+                        if ( !read_cell_bytes ( stream, &nrelated, 1 ) )
                               return false;
 
                         pobj->n_related_objects = nrelated;
@@ -1716,7 +1665,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
                         Object **w = ( Object ** ) pobj->p_related_object_pointer_array;
                         for ( unsigned char j = 0 ; j < pobj->n_related_objects ; j++ )
                         {
-                              if ( !read_and_decode_ushort ( stream, &index ) )
+                              if ( !read_cell_ushort ( stream, &index ) )
                                     return false;
 
                               if ( index > pCIB->m_nfeature_records )
@@ -1734,7 +1683,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
                   if ( ( pobj->geotype & 0x20 ) == 0x20 )
                   {
                         unsigned short nrelated;
-                        if ( !read_and_decode_ushort ( stream, &nrelated ) )
+                        if ( !read_cell_ushort ( stream, &nrelated ) )
                               return false;
 
                         pobj->n_related_objects = ( unsigned char ) ( nrelated & 0xFF );
@@ -1750,7 +1699,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
                   {
 
                         unsigned char nattr;
-                        if ( !read_and_decode_bytes ( stream, &nattr, 1 ) )
+                        if ( !read_cell_bytes ( stream, &nattr, 1 ) )
                               return false;        //m_od
 
                         pobj->n_attributes = nattr;
@@ -1762,7 +1711,7 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
                         puc10count += obj_desc_bytes;
 
 
-                        if ( !read_and_decode_bytes ( stream, pobj->attributes_block, obj_desc_bytes ) )
+                        if ( !read_cell_bytes ( stream, pobj->attributes_block, obj_desc_bytes ) )
                               return false;           // the attributes....
 
                         if ( ( pobj->geotype & 0x0f ) == 1 )
@@ -1792,27 +1741,50 @@ static bool read_feature_record_table ( FILE *stream, int n_features, Cell_Info_
 
 
 
-bool Ingest_CM93_Cell ( const char * cell_file_name, Cell_Info_Block *pCIB )
+//    Read a cell file whole, and decode it in one pass
+bool Read_CM93_Cell ( const char * cell_file_name, std::vector<unsigned char> &image )
 {
+      FILE *stream = fopen ( cell_file_name, "rb" );
+      if ( !stream )
+            return false;
 
-      try
+      fseek ( stream, 0, SEEK_END );
+      long file_length = ftell ( stream );
+      fseek ( stream, 0, SEEK_SET );
+
+      if ( file_length <= 0 )
       {
+            fclose ( stream );
+            return false;
+      }
 
-            int file_length;
+      image.resize ( file_length );
+      bool brv = ( fread ( &image[0], file_length, 1, stream ) == 1 );
+      fclose ( stream );
 
-            //    Get the file length
-            FILE *flstream = fopen ( cell_file_name, "rb" );
-            if ( !flstream )
-                  return false;
+      if ( !brv )
+            return false;
 
-            fseek ( flstream, 0, SEEK_END );
-            file_length = ftell ( flstream );
-            fclose ( flstream );
+      unsigned char *q = &image[0];
+      for ( long i=0 ; i < file_length ; i++ )
+            q[i] = Decode_table[q[i]];
 
-            //    Open the file
-            FILE *stream = fopen ( cell_file_name, "rb" );
-            if ( !stream )
-                  return false;
+      return true;
+}
+
+
+bool Ingest_CM93_Cell ( const std::vector<unsigned char> &image, Cell_Info_Block *pCIB )
+{
+
+      try
+      {
+            int file_length = image.size();
+
+            cm93_cell_stream cell_stream;
+            cell_stream.p = image.size() ? &image[0] : NULL;
+            cell_stream.end = cell_stream.p + image.size();
+
+            cm93_cell_stream *stream = &cell_stream;
 
             //    Validate the integrity of the cell file
 
@@ -1820,57 +1792,31 @@ bool Ingest_CM93_Cell ( const char * cell_file_name, Cell_Info_Block *pCIB )
             int int0 = 0;
             int int1 = 0;;
 
-            read_and_decode_ushort ( stream, &word0 );     // length of prolog + header (10 + 128)
-            read_and_decode_int ( stream, &int0 );         // length of table 1
-            read_and_decode_int ( stream, &int1 );         // length of table 2
+            read_cell_ushort ( stream, &word0 );     // length of prolog + header (10 + 128)
+            read_cell_int ( stream, &int0 );         // length of table 1
+            read_cell_int ( stream, &int1 );         // length of table 2
 
             int test = word0 + int0 + int1;
             if ( test != file_length )
-            {
-                  fclose ( stream );
                   return false;                           // file is corrupt
-            }
 
             //    Cell is OK, proceed to ingest
 
 
             if ( !read_header_and_populate_cib ( stream, pCIB ) )
-            {
-                  fclose ( stream );
                   return false;
-            }
-
 
             if ( !read_vector_record_table ( stream, pCIB->m_nvector_records, pCIB ) )
-            {
-                  fclose ( stream );
                   return false;
-            }
 
             if ( !read_3dpoint_table ( stream, pCIB->m_n_point3d_records, pCIB ) )
-            {
-                  fclose ( stream );
                   return false;
-            }
 
             if ( !read_2dpoint_table ( stream, pCIB->m_n_point2d_records, pCIB ) )
-            {
-                  fclose ( stream );
                   return false;
-            }
 
             if ( !read_feature_record_table ( stream, pCIB->m_nfeature_records, pCIB ) )
-            {
-                  fclose ( stream );
                   return false;
-            }
-
-//      int file_end = ftell(stream);
-
-//      wxASSERT(file_end == file_length);
-
-            fclose ( stream );
-
 
             return true;
       }
@@ -1927,6 +1873,9 @@ cm93chart::cm93chart()
       m_this_chart_context = (chart_context *)calloc( sizeof(chart_context), 1);
       m_this_chart_context->chart = this;
       m_RAZBuilt = true;
+
+      m_bAsyncLoad = false;
+      m_bCellsPending = false;
       
 }
 
@@ -2171,6 +2120,8 @@ void cm93chart::SetVPParms ( const ViewPort &vpt )
       bool bcell_is_in;
       bool recalc_depth = false;
 
+      m_bCellsPending = false;
+
       for ( unsigned int i=0 ; i < vpcells.size() ; i++ )
       {
             bcell_is_in = false;
@@ -2184,6 +2135,24 @@ void cm93chart::SetVPParms ( const ViewPort &vpt )
             }
 
             //    The cell is not in place, so go load it
+            //    Unless its files are not yet read: then have them read meanwhile, and come back
+            //    on the repaint which follows
+            if ( !bcell_is_in && m_bAsyncLoad )
+            {
+                  CM93CellRequest cell;
+                  cell.prefix = m_prefix;
+                  cell.scalechar = m_scalechar;
+                  cell.dval = m_dval;
+                  cell.cellindex = vpcells[i];
+
+                  CM93CellLoader *loader = CM93CellLoader::Get();
+                  if ( !loader->IsCellReady ( cell ) && loader->Request ( cell, false ) )
+                  {
+                        m_bCellsPending = true;
+                        continue;
+                  }
+            }
+
             if ( !bcell_is_in )
             {
 #ifndef __OCPN__ANDROID__
@@ -2254,10 +2223,59 @@ void cm93chart::SetVPParms ( const ViewPort &vpt )
           ClearDepthContourArray();
           BuildDepthContourArray();
       }
+
+      if ( m_bAsyncLoad )
+            PrefetchCells ( vpcells );
+}
+
+//    Have the cells bordering the viewport read ahead of a pan
+void cm93chart::PrefetchCells ( const std::vector<int> &vpcells )
+{
+      CM93CellLoader *loader = CM93CellLoader::Get();
+
+      CM93CellRequest cell;
+      cell.prefix = m_prefix;
+      cell.scalechar = m_scalechar;
+      cell.dval = m_dval;
+
+      int dval = ( int ) m_dval;
+
+      for ( unsigned int i=0 ; i < vpcells.size() ; i++ )
+      {
+            int ilat = vpcells[i] / 10000;
+            int ilon = vpcells[i] % 10000;
+
+            for ( int dlat = -dval ; dlat <= dval ; dlat += dval )
+            {
+                  int jlat = ilat + dlat;
+                  if ( ( jlat < 30 ) || ( jlat >= 510 ) )            // S80 to N80
+                        continue;
+
+                  for ( int dlon = -dval ; dlon <= dval ; dlon += dval )
+                  {
+                        int jlon = ( ilon + dlon + 1080 ) % 1080;
+                        int cell_index = ( jlat * 10000 ) + jlon;
+
+                        if ( std::find ( vpcells.begin(), vpcells.end(), cell_index ) != vpcells.end() )
+                              continue;
+                        if ( std::find ( m_cells_loaded_array.begin(), m_cells_loaded_array.end(), cell_index ) != m_cells_loaded_array.end() )
+                              continue;
+
+                        cell.cellindex = cell_index;
+                        if ( !loader->IsCellReady ( cell ) )
+                              loader->Request ( cell, true );
+                  }
+            }
+      }
 }
 
 
 std::vector<int> cm93chart::GetVPCellArray ( const ViewPort &vpt )
+{
+      return GetVPCellArray ( vpt, GetNativeScale(), m_dval );
+}
+
+std::vector<int> cm93chart::GetVPCellArray ( const ViewPort &vpt, int native_scale, double dval )
 {
       //    Fetch the lat/lon of the screen corner points
       ViewPort vptl = vpt;
@@ -2284,21 +2302,21 @@ std::vector<int> cm93chart::GetVPCellArray ( const ViewPort &vpt )
       //    Create an array of CellIndexes covering the current viewport
       std::vector<int> vpcells;
 
-      int lower_left_cell = Get_CM93_CellIndex ( ll_lat, ll_lon, GetNativeScale() );
+      int lower_left_cell = Get_CM93_CellIndex ( ll_lat, ll_lon, native_scale );
       vpcells.push_back( lower_left_cell );                // always add the lower left cell
 
       if ( g_bDebugCM93 )
             printf ( "cm93chart::GetVPCellArray   Adding %d\n", lower_left_cell );
 
       double rlat, rlon;
-      Get_CM93_Cell_Origin ( lower_left_cell, GetNativeScale(), &rlat, &rlon );
+      Get_CM93_Cell_Origin ( lower_left_cell, native_scale, &rlat, &rlon );
 
 
       // Use exact integer math here
       //    It is more obtuse, but it removes dependency on FP rounding policy
 
       int loni_0 = ( int ) wxRound ( rlon * 3 );
-      int loni_20 = loni_0 + ( int ) m_dval;            // already added the lower left cell
+      int loni_20 = loni_0 + ( int ) dval;            // already added the lower left cell
       int lati_20 = ( int ) wxRound ( rlat * 3 );
 
 
@@ -2318,9 +2336,9 @@ std::vector<int> cm93chart::GetVPCellArray ( const ViewPort &vpt )
                   if ( g_bDebugCM93 )
                         printf ( "cm93chart::GetVPCellArray   Adding %d\n", next_cell );
 
-                  loni_20 += ( int ) m_dval;
+                  loni_20 += ( int ) dval;
             }
-            lati_20 += ( int ) m_dval;
+            lati_20 += ( int ) dval;
             loni_20 = loni_0;
       }
 
@@ -2629,18 +2647,7 @@ InitReturn cm93chart::Init ( const wxString& name, ChartInitFlag flags )
       m_Chart_Scale = scale;
 
 
-      switch ( GetNativeScale() )
-      {
-            case 20000000: m_dval = 120; break;         // Z
-            case  3000000: m_dval =  60; break;         // A
-            case  1000000: m_dval =  30; break;         // B
-            case   200000: m_dval =  12; break;         // C
-            case   100000: m_dval =   3; break;         // D
-            case    50000: m_dval =   1; break;         // E
-            case    20000: m_dval =   1; break;         // F
-            case     7500: m_dval =   1; break;         // G
-            default: m_dval =   1; break;
-      }
+      m_dval = Get_CM93_CellDval ( GetNativeScale() );
 
       //    Set the nice name
       wxString data = _T ( "CM93Chart " );
@@ -4458,178 +4465,134 @@ int cm93chart::loadcell_in_sequence ( int cellindex, char subcell )
 
 
 
-int cm93chart::loadsubcell ( int cellindex, wxChar sub_char )
+//    The name of a subcell file, with the scale character as cm93 writes it
+//    Used as well to key the subcell in the cell cache
+wxString cm93chart::GetSubcellKey ( const wxString &prefix, const wxString &scalechar, double dval,
+                                    int cellindex, wxChar sub_char )
 {
-
-      //    Create the file name
-
       int ilat = cellindex / 10000;
       int ilon = cellindex % 10000;
 
-
-      if ( g_bDebugCM93 )
-      {
-            double dlat = m_dval / 3.;
-            double dlon = m_dval / 3.;
-            double lat, lon;
-            Get_CM93_Cell_Origin ( cellindex, GetNativeScale(), &lat, &lon );
-            printf ( "\n   Attempting loadcell %d scale %lc, sub_char %lc at lat: %g/%g lon:%g/%g\n", cellindex, wxChar ( m_scalechar[0] ), sub_char, lat, lat + dlat, lon, lon+dlon );
-      }
-
-      int jlat = ( int ) ( ( ( ilat - 30 ) / m_dval ) * m_dval ) + 30;     // normalize
-      int jlon = ( int ) ( ( ilon / m_dval ) * m_dval );
+      int jlat = ( int ) ( ( ( ilat - 30 ) / dval ) * dval ) + 30;     // normalize
+      int jlon = ( int ) ( ( ilon / dval ) * dval );
 
       int ilatroot = ( ( ( ilat - 30 ) / 60 ) * 60 ) + 30;
       int ilonroot = ( ilon / 60 ) * 60;
 
       wxString file;
       file.Printf ( _T ( "%04d%04d." ), jlat, jlon );
-      file += m_scalechar;
+      file += scalechar;
       file[0] = sub_char;
-      
 
-      // We prefer to make use of the NoFind array to avoid file system access to cells known not to exist.
-      // However, when the arra becomes "large", then searching the array becomes slower than actually accessing the file system.
-      // So, detect this case, and skip the NoFind array if the array size is larger than nnn items.
-      // "nnn" determined by experimentation/intuition.
-      // Could also be platform dependent.
-      bool b_useNoFind = true;
-      if(m_noFindArray.GetCount() > 500)
-          b_useNoFind = false;
-      
-      
       wxString fileroot;
       fileroot.Printf ( _T ( "%04d%04d" ), ilatroot, ilonroot );
       appendOSDirSep( &fileroot );
-      fileroot.append( m_scalechar );
+      fileroot.append( scalechar );
       appendOSDirSep( &fileroot );
-      wxString key = fileroot;
-      key.append( file );
-      fileroot.Prepend ( m_prefix );
+      fileroot.Prepend ( prefix );
 
       file.Prepend ( fileroot );
 
-      if ( g_bDebugCM93 )
-      {
-            char sfile[200];
-            strncpy ( sfile, file.mb_str(), 199 );
-            sfile[199] = 0;
-            printf ( "    filename: %s\n", sfile );
-      }
+      return file;
+}
+
+//    Find, decompress if needed, read and decode a subcell file
+//    The image has no file name if there is no such subcell
+//    Any thread: touches no chart
+CM93CellImagePtr cm93chart::ReadSubcell ( const wxString &prefix, const wxString &scalechar, double dval,
+                                          int cellindex, wxChar sub_char )
+{
+      std::shared_ptr<CM93CellImage> image = std::make_shared<CM93CellImage>();
 
-      bool bfound = false;
+      wxString file = GetSubcellKey ( prefix, scalechar, dval, cellindex, sub_char );
       wxString compfile;
-      if(b_useNoFind){
-        if(m_noFindArray.Index(key) == wxNOT_FOUND){
-            if ( ::wxFileExists ( file ) ) 
-                bfound = true;
-            else
-                m_noFindArray.Add(key);
-        }
-      }
-      else{
-          if ( ::wxFileExists ( file ) ) 
-              bfound = true;;
-      }          
-      
-      if(!bfound){                     // try compressed version
-        if(b_useNoFind){
-            if(m_noFindArray.Index(key + _T(".xz")) == wxNOT_FOUND){
-                if(::wxFileExists ( file+_T(".xz"))){
-                    compfile = file + _T(".xz");
-                }
-            }
-            else{
-                m_noFindArray.Add(key + _T(".xz"));
-            }
-        }
-        else{
-            if(::wxFileExists ( file+_T(".xz")))
-                compfile = file + _T(".xz");
-        }
-      }
+
+      bool bfound = ::wxFileExists ( file );
+      if ( !bfound && ::wxFileExists ( file + _T ( ".xz" ) ) )        // try compressed version
+            compfile = file + _T ( ".xz" );
 
       // Try again with alternate scale character
-      if(!bfound && !compfile.Length()){
-             //    Try with alternate case of m_scalechar
-            wxString new_scalechar = m_scalechar.Lower();
-
-            wxString file1;
-            file1.Printf ( _T ( "%04d%04d." ), jlat, jlon );
-            file1 += new_scalechar;
-            file1[0] = sub_char;
-
-            fileroot.Printf ( _T ( "%04d%04d" ), ilatroot, ilonroot );
-            appendOSDirSep( &fileroot );
-            fileroot.append( new_scalechar );
-            appendOSDirSep( &fileroot );
-            key = fileroot;
-            key.append( file1 );
-
-            fileroot.Prepend ( m_prefix );
-
-            file1.Prepend ( fileroot );
-         
-            if(b_useNoFind){
-                if(m_noFindArray.Index(key) == wxNOT_FOUND){
-                    if ( ::wxFileExists ( file1 ) ) {
-                        bfound = true;
-                        file = file1;                       // found the file as lowercase, substitute the name
-                    }
-                    else{
-                        m_noFindArray.Add(key);
-                    }
-                }
-            }
-            else{
-                if ( ::wxFileExists ( file1 ) ) {
-                    bfound = true;
-                    file = file1;                       // found the file as lowercase, substitute the name
-                }
+      if ( !bfound && !compfile.Length() )
+      {
+            wxString file1 = GetSubcellKey ( prefix, scalechar.Lower(), dval, cellindex, sub_char );
+
+            if ( ::wxFileExists ( file1 ) )
+            {
+                  bfound = true;
+                  file = file1;                       // found the file as lowercase, substitute the name
             }
-            
-            if(!bfound){                     // try compressed version
-                if(b_useNoFind){
-                    if(m_noFindArray.Index(key + _T(".xz")) == wxNOT_FOUND){
-                        if(::wxFileExists ( file1+_T(".xz")))
-                            compfile = file1 + _T(".xz");
-                        else
-                            m_noFindArray.Add(key + _T(".xz"));
-                    }
-                }
-                else{
-                    if(::wxFileExists ( file1+_T(".xz")))
-                        compfile = file1 + _T(".xz");
-                }
+            else if ( ::wxFileExists ( file1 + _T ( ".xz" ) ) )
+                  compfile = file1 + _T ( ".xz" );
+      }
+
+      if ( !bfound && !compfile.Length() )
+            return image;
+
+      wxString path = file;
+
+      // Decompress if needed
+      if ( compfile.Length() )
+      {
+            file = compfile.BeforeLast ( '.' );
+            path = wxFileName::CreateTempFileName ( wxFileName ( compfile ).GetFullName() );
+            if ( !DecompressXZFile ( compfile, path ) )
+            {
+                  wxRemoveFile ( path );
+                  return image;
             }
       }
 
-      
+      bool brv = Read_CM93_Cell ( ( const char * ) path.mb_str(), image->data );
+
+      if ( compfile.Length() )
+            wxRemoveFile ( path );
+
+      if ( !brv )
+      {
+            wxString msg ( _T ( "   cm93chart  Error reading " ) );
+            msg.Append ( file );
+            wxLogMessage ( msg );
+
+            image->data.clear();
+            return image;
+      }
+
+      image->file = file;
+      return image;
+}
+
+int cm93chart::loadsubcell ( int cellindex, wxChar sub_char )
+{
       if ( g_bDebugCM93 )
       {
-          printf("noFind count: %d\n", (int)m_noFindArray.GetCount());
+            double dlat = m_dval / 3.;
+            double dlon = m_dval / 3.;
+            double lat, lon;
+            Get_CM93_Cell_Origin ( cellindex, GetNativeScale(), &lat, &lon );
+            printf ( "\n   Attempting loadcell %d scale %lc, sub_char %lc at lat: %g/%g lon:%g/%g\n", cellindex, wxChar ( m_scalechar[0] ), sub_char, lat, lat + dlat, lon, lon+dlon );
       }
-                
-      if(!bfound && !compfile.Length())
-          return 0;
-      
+
+      //    The decoded file from the cell cache, which also knows the files that do not exist,
+      //    else read now
+      CM93CellRequest cell;
+      cell.prefix = m_prefix;
+      cell.scalechar = m_scalechar;
+      cell.dval = m_dval;
+      cell.cellindex = cellindex;
+
+      CM93CellImagePtr image = CM93CellLoader::Get()->GetSubcell ( cell, sub_char );
+
+      if ( image->file.IsEmpty() )
+            return 0;
+
       //    File is known to exist
 
       wxString msg ( _T ( "Loading CM93 cell " ) );
-      msg += file;
+      msg += image->file;
       wxLogMessage ( msg );
-      
-      //    Set the member variable to be the actual file name for use in single chart mode info display
-      m_LastFileName = file;
 
-      // Decompress if needed
-      if(compfile.Length()) {
-          file = wxFileName::CreateTempFileName(wxFileName(compfile).GetFullName());
-          if(!DecompressXZFile(compfile, file)) {
-              wxRemoveFile(file);
-              return 0;
-          }
-      }
+      //    Set the member variable to be the actual file name for use in single chart mode info display
+      m_LastFileName = image->file;
 
       if ( g_bDebugCM93 )
       {
@@ -4640,20 +4603,15 @@ int cm93chart::loadsubcell ( int cellindex, wxChar sub_char )
       }
 
       //    Ingest it
-      if ( !Ingest_CM93_Cell ( ( const char * ) file.mb_str(), &m_CIB ) )
+      if ( !Ingest_CM93_Cell ( image->data, &m_CIB ) )
       {
             wxString msg ( _T ( "   cm93chart  Error ingesting " ) );
-            msg.Append ( file );
+            msg.Append ( image->file );
             wxLogMessage ( msg );
 
-            if(compfile.Length())
-                wxRemoveFile(file);
             return 0;
       }
 
-      if(compfile.Length())
-          wxRemoveFile(file);
-
       return 1;
 }
 
@@ -4813,6 +4771,7 @@ cm93compchart::cm93compchart()
       m_pcm93chart_current = NULL;
 
       m_cmscale = -1;
+      m_cmscale_shown = -1;
       m_Chart_Skew = 0.0;
 
       m_pDummyBM = NULL;
@@ -5025,9 +4984,35 @@ void cm93compchart::SetVPParms ( const ViewPort &vpt )
 {
       m_vpt = vpt;                              // save a copy
 
+      CM93CellLoader::Get()->ClearPrefetch();
+
       int cmscale = GetCMScaleFromVP ( vpt );         // First order calculation of cmscale
       m_cmscale = PrepareChartScale ( vpt, cmscale, false );
 
+      //    Keep to the scale on screen until the cells of a new one are read
+      if ( m_pcm93chart_current && m_pcm93chart_current->HasPendingCells() &&
+           ( m_cmscale_shown >= 0 ) && ( m_cmscale_shown != m_cmscale ) &&
+           m_pcm93chart_array[m_cmscale_shown] && m_pcm93chart_array[m_cmscale_shown]->HasLoadedCells() )
+      {
+            if ( g_bDebugCM93 )
+                  printf ( " cells of %c pending, keeping %c\n", ( char ) ( 'A' + m_cmscale -1 ), ( char ) ( 'A' + m_cmscale_shown -1 ) );
+
+            m_cmscale = m_cmscale_shown;
+            m_pcm93chart_current = m_pcm93chart_array[m_cmscale];
+            m_pcm93chart_current->SetVPParms ( vpt );
+      }
+
+      m_cmscale_shown = m_pcm93chart_current ? m_cmscale : -1;
+
+      //    Read ahead the scales a zoom would switch to
+      if ( m_pcm93chart_current )
+      {
+            if ( m_cmscale < 7 )
+                  PrefetchScale ( vpt, m_cmscale + 1 );
+            if ( m_cmscale > 0 )
+                  PrefetchScale ( vpt, m_cmscale - 1 );
+      }
+
       //    Continuoesly update the composite chart edition date to the latest cell decoded
       if ( m_pcm93chart_array[cmscale] )
       {
@@ -5036,6 +5021,52 @@ void cm93compchart::SetVPParms ( const ViewPort &vpt )
       }
 }
 
+//    Have the cells of scale {cmscale} nearest the viewport center read ahead
+void cm93compchart::PrefetchScale ( const ViewPort &vpt, int cmscale )
+{
+      int scale = Get_CM93_Scale ( cmscale );
+
+      CM93CellRequest cell;
+      cell.prefix = m_prefixComposite;
+      cell.scalechar = ( cmscale == 0 ) ? wxString ( _T ( "Z" ) ) : wxString ( ( wxChar ) ( 'A' + cmscale - 1 ) );
+      cell.dval = Get_CM93_CellDval ( scale );
+
+      std::vector<int> vpcells = cm93chart::GetVPCellArray ( vpt, scale, cell.dval );
+
+      //    A larger scale may need many cells to cover the viewport: take those at the center first
+      int center_cell = Get_CM93_CellIndex ( vpt.clat, vpt.clon, scale );
+      int clat = center_cell / 10000;
+      int clon = center_cell % 10000;
+
+      std::vector<std::pair<int, int> > order;
+      for ( unsigned int i=0 ; i < vpcells.size() ; i++ )
+      {
+            int dlat = abs ( ( vpcells[i] / 10000 ) - clat );
+            int dlon = abs ( ( vpcells[i] % 10000 ) - clon );
+            dlon = wxMin ( dlon, 1080 - dlon );
+            order.push_back ( std::make_pair ( wxMax ( dlat, dlon ), vpcells[i] ) );
+      }
+      std::sort ( order.begin(), order.end() );
+
+      CM93CellLoader *loader = CM93CellLoader::Get();
+      for ( unsigned int i=0 ; i < order.size() && i < CM93_CELL_PREFETCH_SCALE ; i++ )
+      {
+            cell.cellindex = order[i].second;
+            if ( !loader->IsCellReady ( cell ) )
+                  loader->Request ( cell, true );
+      }
+}
+
+bool cm93compchart::HasLoadedCells()
+{
+      for ( int i = 0 ; i < 8 ; i++ )
+      {
+            if ( m_pcm93chart_array[i] && m_pcm93chart_array[i]->HasLoadedCells() )
+                  return true;
+      }
+      return false;
+}
+
 int cm93compchart::PrepareChartScale ( const ViewPort &vpt, int cmscale, bool bOZ_protect )
 {
 
@@ -5115,7 +5146,8 @@ int cm93compchart::PrepareChartScale ( const ViewPort &vpt, int cmscale, bool bO
             if ( m_pcm93chart_current )
             {
                   //    Pass the parameters to the proper scale chart
-                  //    Which will also load the needed cell(s)
+                  //    Which will also load the needed cell(s), in the background once something is on screen
+                  m_pcm93chart_current->SetAsyncLoad ( HasLoadedCells() );
                   m_pcm93chart_current->SetVPParms ( vpt );
 
                   //    Check to see if the viewpoint center is actually on the selected chart
@@ -5138,6 +5170,16 @@ int cm93compchart::PrepareChartScale ( const ViewPort &vpt, int cmscale, bool bO
                         break;
                   }
 
+                  //    Cells still being read may yet cover the VP
+                  else if ( m_pcm93chart_current->HasPendingCells() )
+                  {
+                        if ( g_bDebugCM93 )
+                              printf ( " chart %c has cells pending\n", ( char ) ( 'A' + cmscale -1 ) );
+
+                        cellscale_is_useable = true;
+                        break;
+                  }
+
 //    This commented block assumed that scale 0 coverage is available worlwide.....
 //    Might not be so with partial CM93 sets
                   /*
@@ -5268,6 +5310,17 @@ wxString cm93compchart::GetPubDate()
       return data;
 }
 
+size_t cm93compchart::GetMemoryFootprint()
+{
+      size_t bytes = 0;
+      for ( int i = 0 ; i < 8 ; i++ )
+      {
+            if ( m_pcm93chart_array[i] )
+                  bytes += m_pcm93chart_array[i]->GetMemoryFootprint();
+      }
+      return bytes;
+}
+
 int cm93compchart::GetNativeScale()
 {
       if ( m_pcm93chart_current )
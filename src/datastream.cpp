@@ -179,6 +179,8 @@ DataStream::DataStream(wxEvtHandler *input_consumer,
     m_priority(priority),
     m_handshake(handshake_type),
     m_pSecondary_Thread(NULL),
+    m_out_queue(NULL),
+    m_out_thread(NULL),
     m_connection_type(conn_type),
     m_bGarmin_GRMN_mode(bGarmin),
     m_GarminHandler(NULL),
@@ -202,6 +204,8 @@ DataStream::DataStream(wxEvtHandler *input_consumer,
     m_priority(params->Priority),
     m_handshake(DS_HANDSHAKE_NONE),
     m_pSecondary_Thread(NULL),
+    m_out_queue(NULL),
+    m_out_thread(NULL),
     m_connection_type(params->Type),
     m_bGarmin_GRMN_mode(params->Garmin),
     m_GarminHandler(NULL),
@@ -254,6 +258,8 @@ DataStream::~DataStream()
 void DataStream::Close()
 {
     wxLogMessage( wxString::Format(_T("Closing NMEA Datastream %s"), m_portstring.c_str()) );
+
+    StopOutputThread();
     
 //    Kill off the Secondary RX Thread if alive
     if(m_pSecondary_Thread)
@@ -586,3 +592,66 @@ bool DataStream::SendSentence( const wxString &sentence )
 
     return true;
 }
+
+bool DataStream::WriteSentence( const std::string &payload )
+{
+    return SendSentence( wxString(payload.c_str(), wxConvUTF8) );
+}
+
+bool DataStream::QueueSentence( const wxString &sentence )
+{
+    if( !m_out_queue )
+        return SendSentence( sentence );
+
+    wxString payload = sentence;
+    if( !sentence.EndsWith(_T("\r\n")) )
+        payload += _T("\r\n");
+
+    wxCharBuffer buf = payload.ToUTF8();
+    if( !buf.data() )
+        return false;
+
+    m_out_queue->Push( std::string(buf.data()) );
+    return true;
+}
+
+void DataStream::StartOutputThread( size_t depth, OutputOverflowPolicy policy )
+{
+    if( m_out_thread || !SupportsOutputThread() )
+        return;
+
+    m_out_queue = new OutputQueue( depth, policy );
+    m_out_thread = new OCP_DataStreamOutput_Thread( this, m_out_queue );
+    if( m_out_thread->Run() != wxTHREAD_NO_ERROR ) {
+        wxLogMessage( _T("   Output thread could not be started: ") + m_portstring );
+        delete m_out_thread;
+        delete m_out_queue;
+        m_out_thread = NULL;
+        m_out_queue = NULL;
+    }
+}
+
+void DataStream::StopOutputThread()
+{
+    if( !m_out_thread )
+        return;
+
+    m_out_thread->Stop();
+    delete m_out_thread;
+    m_out_thread = NULL;
+
+    OutputQueueStats stats = m_out_queue->GetStats();
+    wxLogMessage( wxString::Format(_T("    Output %s: %lu sent, %lu dropped, %lu failed, max backlog %lu"),
+                                   m_portstring.c_str(), stats.sent, stats.dropped, stats.failed,
+                                   (unsigned long)stats.max_backlog) );
+    delete m_out_queue;
+    m_out_queue = NULL;
+}
+
+bool DataStream::GetOutputStats( OutputQueueStats &stats )
+{
+    if( !m_out_queue )
+        return false;
+    stats = m_out_queue->GetStats();
+    return true;
+}
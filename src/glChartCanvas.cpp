@@ -185,6 +185,8 @@ wxColor                 s_regionColor;
 
 //    For VBO(s)
 bool         g_b_EnableVBO;
+bool         g_b_EnablePBO;     // texture uploads from pixel unpack buffers
+bool         g_bGLBatchS57 = true;  // S57 fills and lines drawn in batches
 bool         g_b_needFinish;  //Need glFinish() call on each frame?
 
 
@@ -207,6 +209,10 @@ PFNGLGENBUFFERSPROC                 s_glGenBuffers;
 PFNGLBINDBUFFERPROC                 s_glBindBuffer;
 PFNGLBUFFERDATAPROC                 s_glBufferData;
 PFNGLDELETEBUFFERSPROC              s_glDeleteBuffers;
+#ifdef ocpnUSE_PBO
+PFNGLMAPBUFFERPROC                  s_glMapBuffer;
+PFNGLUNMAPBUFFERPROC                s_glUnmapBuffer;
+#endif
 
 #ifndef USE_ANDROID_GLES2
 #define glDeleteFramebuffers(a,b) (s_glDeleteFramebuffers)(a,b);
@@ -495,6 +501,12 @@ static void GetglEntryPoints( void )
             ocpnGetProcAddress( "glBufferData", extensions[i]);
         s_glDeleteBuffers = (PFNGLDELETEBUFFERSPROC)
             ocpnGetProcAddress( "glDeleteBuffers", extensions[i]);
+#ifdef ocpnUSE_PBO
+        s_glMapBuffer = (PFNGLMAPBUFFERPROC)
+            ocpnGetProcAddress( "glMapBuffer", extensions[i]);
+        s_glUnmapBuffer = (PFNGLUNMAPBUFFERPROC)
+            ocpnGetProcAddress( "glUnmapBuffer", extensions[i]);
+#endif
             
     }
 
@@ -509,6 +521,10 @@ static void GetglEntryPoints( void )
             s_glBindBuffer = (PFNGLBINDBUFFERPROC) ocpnGetProcAddress( "glBindBuffer", extensions[i]);
             s_glBufferData = (PFNGLBUFFERDATAPROC) ocpnGetProcAddress( "glBufferData", extensions[i]);
             s_glDeleteBuffers = (PFNGLDELETEBUFFERSPROC) ocpnGetProcAddress( "glDeleteBuffers", extensions[i]);
+#ifdef ocpnUSE_PBO
+            s_glMapBuffer = (PFNGLMAPBUFFERPROC) ocpnGetProcAddress( "glMapBuffer", extensions[i]);
+            s_glUnmapBuffer = (PFNGLUNMAPBUFFERPROC) ocpnGetProcAddress( "glUnmapBuffer", extensions[i]);
+#endif
         }
     }
             
@@ -1361,6 +1377,15 @@ void glChartCanvas::SetupOpenGL()
     else
         wxLogMessage( _T("OpenGL-> Vertexbuffer Objects unavailable") );
 
+    g_b_EnablePBO = false;
+#ifdef ocpnUSE_PBO
+    if( s_glBindBuffer && s_glBufferData && s_glGenBuffers && s_glMapBuffer && s_glUnmapBuffer &&
+        QueryExtension( "GL_ARB_pixel_buffer_object" ) ) {
+        g_b_EnablePBO = true;
+        wxLogMessage( _T("OpenGL-> Using Pixelbuffer Objects for texture upload") );
+    }
+#endif
+
 // #if defined(__WXOSX__)
 //     wxLogMessage( _T("OpenGL-> DISABLING VBO for Mac/Intel test.") );
 //     g_b_EnableVBO = false;
@@ -4121,6 +4146,9 @@ void glChartCanvas::Render()
         
     m_last_render_time = wxDateTime::Now().GetTicks();
 
+    if(g_GLOptions.m_bTextureCompression)
+        g_glTextureManager->BeginFrame();
+
     // we don't care about jobs that are now off screen
     // clear out and it will be repopulated during render
     if(g_GLOptions.m_bTextureCompression &&
@@ -4844,6 +4872,8 @@ void glChartCanvas::Render()
 
     g_glTextureManager->TextureCrunch(0.8);
     g_glTextureManager->FactoryCrunch(0.6);
+
+    S57GLBatches::EndFrame(g_bShowFPS, g_gl_ms_per_frame);
     
     m_pParentCanvas->PaintCleanup();
     //OCPNPlatform::HideBusySpinner();
@@ -69,6 +69,14 @@ extern ocpnGLOptions    g_GLOptions;
 extern int              g_tile_size;
 
 extern PFNGLCOMPRESSEDTEXIMAGE2DPROC s_glCompressedTexImage2D;
+#ifdef ocpnUSE_PBO
+extern PFNGLBINDBUFFERPROC                 s_glBindBuffer;
+extern PFNGLBUFFERDATAPROC                 s_glBufferData;
+extern PFNGLGENBUFFERSPROC                 s_glGenBuffers;
+extern PFNGLMAPBUFFERPROC                  s_glMapBuffer;
+extern PFNGLUNMAPBUFFERPROC                s_glUnmapBuffer;
+extern bool                                g_b_EnablePBO;
+#endif
 extern PFNGLGENERATEMIPMAPEXTPROC          s_glGenerateMipmap;
 extern bool GetMemoryStatus( int *mem_total, int *mem_used );
 
@@ -146,6 +154,7 @@ glTexFactory::glTexFactory(ChartBase *chart, int raster_format)
     m_catalogCorrupted = false;
 
     m_fs = 0;
+    m_map_limit = 0;
     m_LRUtime = 0;
     m_ntex = 0;
     m_tiles = NULL;
@@ -177,6 +186,7 @@ glTexFactory::glTexFactory(ChartBase *chart, int raster_format)
 
 glTexFactory::~glTexFactory()
 {
+    m_map.Close();
     delete m_fs;
 
     PurgeBackgroundCompressionPool();
@@ -541,7 +551,15 @@ bool glTexFactory::BuildTexture(glTextureDescriptor *ptd, int base_level, const
         }
     }    
     
-    int status = GetTextureLevel( ptd, rect, base_level, ptd->m_colorscheme );
+    //  Compressed data still LZ4 packed, in ram or in the cache file, is unpacked at upload
+    int status;
+    if( g_GLOptions.m_bTextureCompression && !ptd->comp_array[base_level] &&
+        ( ptd->compcomp_array[base_level] ||
+          ( g_GLOptions.m_bTextureCompressionCaching &&
+            GetCacheEntryValue(base_level, rect.x, rect.y, ptd->m_colorscheme) ) ) )
+        status = COMPRESSED_BUFFER_OK;
+    else
+        status = GetTextureLevel( ptd, rect, base_level, ptd->m_colorscheme );
 
     bool b_use_mipmaps = COMPRESSED_BUFFER_OK == status ?
         b_use_compressed_mipmaps : b_use_uncompressed_mipmaps;
@@ -555,11 +573,14 @@ bool glTexFactory::BuildTexture(glTextureDescriptor *ptd, int base_level, const
         int texture_level = 0;
         for(int level = base_level; level < ptd->level_min; level++ ) {
             int size = TextureTileSize(level, true);
-            int status = GetTextureLevel( ptd, rect, level, ptd->m_colorscheme );
-            int dim = TextureDim(level);
-            s_glCompressedTexImage2D( GL_TEXTURE_2D, texture_level,
-                                      g_raster_format, dim, dim, 0, size,
-                                      ptd->comp_array[level]);
+            if( ptd->comp_array[level] ||
+                !UploadCompressedLevel( ptd, rect, level, ptd->m_colorscheme, texture_level ) ) {
+                GetTextureLevel( ptd, rect, level, ptd->m_colorscheme );
+                int dim = TextureDim(level);
+                s_glCompressedTexImage2D( GL_TEXTURE_2D, texture_level,
+                                          g_raster_format, dim, dim, 0, size,
+                                          ptd->comp_array[level]);
+            }
 
             ptd->tex_mem_used += size;
             g_tex_mem_used += size;
@@ -932,10 +953,15 @@ int glTexFactory::GetTextureLevel( glTextureDescriptor *ptd, const wxRect &rect,
             if( p != 0 ) {
                 int size = TextureTileSize(level, true);
 
-                if(m_fs->IsOpened()){
+                const char *mapped_data = GetMappedCacheData(p);
+                if(mapped_data){
+                    ptd->comp_array[level] = (unsigned char*)malloc(size);
+                    if(LZ4_decompress_safe(mapped_data, (char*)ptd->comp_array[level], p->compressed_size, size) != size)
+                        memset(ptd->comp_array[level], 0, size);
+                }
+                else if(m_fs->IsOpened()){
                     m_fs->Seek(p->texture_offset);
                     ptd->comp_array[level] = (unsigned char*)malloc(size);
-                    int max_compressed_size = LZ4_COMPRESSBOUND(g_tile_size);
                     char *compressed_data = (char*)malloc(p->compressed_size);
                     m_fs->Read(compressed_data, p->compressed_size);
                     LZ4_decompress_fast(compressed_data, (char*)ptd->comp_array[level], size);
@@ -956,6 +982,80 @@ int glTexFactory::GetTextureLevel( glTextureDescriptor *ptd, const wxRect &rect,
 }
 
 
+//  The LZ4 compressed texture data of a catalog entry, read in place from the
+//  mapped cache file.  Data is only ever appended in front of the catalog, so
+//  whatever was mapped stays valid; the file is mapped again to reach newer data.
+const char *glTexFactory::GetMappedCacheData( CatalogEntryValue *p )
+{
+    if( !m_fs || !m_fs->IsOpened() )
+        return NULL;
+
+    int data_end = p->texture_offset + (int)p->compressed_size;
+    if( !m_map.IsOpen() || data_end > m_map_limit ) {
+        m_fs->Flush();
+        m_map_limit = 0;
+        if( !m_map.Open(m_CompressedCacheFilePath) )
+            return NULL;
+        m_map_limit = wxMin( m_catalog_offset, (int)m_map.GetSize() );
+        if( data_end > m_map_limit )
+            return NULL;
+    }
+
+    return m_map.GetData() + p->texture_offset;
+}
+
+//  Upload one level of compressed texture, LZ4 decompressed straight into a
+//  pixel unpack buffer from the in-memory copy or from the mapped cache file.
+//  False if the level must be uploaded from comp_array instead.
+bool glTexFactory::UploadCompressedLevel( glTextureDescriptor *ptd, const wxRect &rect, int level,
+                                          ColorScheme color_scheme, int texture_level )
+{
+#ifdef ocpnUSE_PBO
+    static GLuint s_unpack_buffer;
+
+    if( !g_b_EnablePBO )
+        return false;
+
+    const char *src;
+    int src_size;
+    if( ptd->compcomp_array[level] ) {
+        src = (const char *)ptd->compcomp_array[level];
+        src_size = ptd->compcomp_size[level];
+    } else {
+        if( !g_GLOptions.m_bTextureCompressionCaching )
+            return false;
+        CatalogEntryValue *p = GetCacheEntryValue(level, rect.x, rect.y, color_scheme);
+        if( !p || !(src = GetMappedCacheData(p)) )
+            return false;
+        src_size = p->compressed_size;
+    }
+
+    if( !s_unpack_buffer )
+        s_glGenBuffers( 1, &s_unpack_buffer );
+
+    int size = TextureTileSize(level, true);
+    s_glBindBuffer( GL_PIXEL_UNPACK_BUFFER, s_unpack_buffer );
+    s_glBufferData( GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW );   // orphan the last upload
+    char *dest = (char *)s_glMapBuffer( GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY );
+    bool ok = false;
+    if( dest ) {
+        ok = LZ4_decompress_safe( src, dest, src_size, size ) == size;
+        ok &= s_glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER ) == GL_TRUE;
+    }
+
+    if( ok ) {
+        int dim = TextureDim(level);
+        s_glCompressedTexImage2D( GL_TEXTURE_2D, texture_level,
+                                  g_raster_format, dim, dim, 0, size, 0 );
+    }
+    s_glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+    return ok;
+#else
+    return false;
+#endif
+}
+
 // return not used
 // false? never
 // true 
@@ -197,6 +197,10 @@ JobTicket::JobTicket()
         comp_bits_array[i] = NULL;
         compcomp_bits_array[i] = NULL;
     }
+    pthread = NULL;
+    m_frame = 0;
+    n_tiles = 0;
+    job_ms = 0;
 }
 
 #if 0
@@ -604,6 +608,7 @@ bool JobTicket::DoJob(const wxRect &rect)
         }
     }
 
+    n_tiles++;
     return true;
 }
 
@@ -683,60 +688,61 @@ wxEvent* OCPN_CompressionThreadEvent::Clone() const
 
 
 
-CompressionPoolThread::CompressionPoolThread(JobTicket *ticket, wxEvtHandler *message_target)
+CompressionPoolThread::CompressionPoolThread(glTextureManager *manager)
+    : wxThread(wxTHREAD_JOINABLE)
 {
-    m_pMessageTarget = message_target;
-    m_ticket = ticket;
+    m_manager = manager;
+    m_pMessageTarget = manager;
     
     Create();
 }
 
 void * CompressionPoolThread::Entry()
 {
+    SetPriority( WXTHREAD_MIN_PRIORITY );
+
+    while(JobTicket *ticket = m_manager->TakeWork())
+        RunJob(ticket);
+
+    return 0;
+}
+
+void CompressionPoolThread::RunJob(JobTicket *ticket)
+{
+    ticket->pthread = this;
+    wxStopWatch sw;
 
 #ifdef __MSVC__
     _set_se_translator(my_translate);
 
-    //  On Windows, if anything in this thread produces a SEH exception (like access violation)
-    //  we handle the exception locally, and simply alow the thread to exit smoothly with no results.
+    //  On Windows, if anything in this job produces a SEH exception (like access violation)
+    //  we handle the exception locally, and simply report the job as done with no results.
     //  Upstream will notice that nothing got done, and maybe try again later.
     
     try
 #endif    
     {
-    SetPriority( WXTHREAD_MIN_PRIORITY );
-
-    if(!m_ticket->DoJob())
-        m_ticket->b_isaborted = true;
-
-    if( m_pMessageTarget ) {
-        OCPN_CompressionThreadEvent Nevent(wxEVT_OCPN_COMPRESSIONTHREAD, 0);
-        Nevent.SetTicket(m_ticket);
-        Nevent.type = 0;
-        m_pMessageTarget->QueueEvent(Nevent.Clone());
-        // from here m_ticket is undefined (if deleted in event handler)
-    }
-
-    return 0;
-
+    //  Cancelled while waiting for a worker
+    if(ticket->b_abort || !ticket->DoJob())
+        ticket->b_isaborted = true;
     }           // try
     
 #ifdef __MSVC__    
     catch (SE_Exception e)
     {
-        if( m_pMessageTarget ) {
-            OCPN_CompressionThreadEvent Nevent(wxEVT_OCPN_COMPRESSIONTHREAD, 0);
-            m_ticket->b_isaborted = true;
-            Nevent.SetTicket(m_ticket);
-            Nevent.type = 0;
-            m_pMessageTarget->QueueEvent(Nevent.Clone());
-        }
-        
-        
-        return 0;
+        ticket->b_isaborted = true;
     }
 #endif    
-    
+
+    ticket->job_ms = sw.Time();
+
+    if( m_pMessageTarget ) {
+        OCPN_CompressionThreadEvent Nevent(wxEVT_OCPN_COMPRESSIONTHREAD, 0);
+        Nevent.SetTicket(ticket);
+        Nevent.type = 0;
+        m_pMessageTarget->QueueEvent(Nevent.Clone());
+        // from here ticket is undefined (if deleted in event handler)
+    }
 }
 
 //      ProgressInfoItem Implementation
@@ -760,6 +766,8 @@ glTextureManager::glTextureManager()
 
     m_max_jobs =  wxMax(nCPU, 1);
     m_prevMemUsed = 0;    
+    m_frame = 0;
+    m_bstop_workers = false;
 
     if(bthread_debug)
         printf(" nCPU: %d    m_max_jobs :%d\n", nCPU, m_max_jobs);
@@ -777,6 +785,14 @@ glTextureManager::glTextureManager()
     m_skip = false;
     m_bcompact = false;
     m_skipout = false;
+
+    m_stat_jobs = 0;
+    m_stat_tiles = 0;
+    m_stat_job_ms = 0;
+    m_stat_job_ms_max = 0;
+    m_stat_depth_max = 0;
+    m_stat_dropped = 0;
+    m_stat_watch.Start();
     
     m_timer.Connect(wxEVT_TIMER, wxTimerEventHandler( glTextureManager::OnTimer ), NULL, this);
     m_timer.Start(500);
@@ -786,6 +802,7 @@ glTextureManager::~glTextureManager()
 {
 //    ClearAllRasterTextures();
     ClearJobList();
+    StopWorkers();
 }
 
 #define NBAR_LENGTH 40
@@ -880,6 +897,13 @@ void glTextureManager::OnEvtThread( OCPN_CompressionThreadEvent & event )
         return;
     }
     
+    if(!ticket->b_isaborted && !ticket->b_abort) {
+        m_stat_jobs++;
+        m_stat_tiles += ticket->n_tiles;
+        m_stat_job_ms += ticket->job_ms;
+        m_stat_job_ms_max = wxMax(m_stat_job_ms_max, ticket->job_ms);
+    }
+
     if(ticket->b_isaborted || ticket->b_abort){
         for(int i=0 ; i < g_mipmap_max_level+1 ; i++) {
             free(ticket->comp_bits_array[i]);
@@ -958,6 +982,9 @@ void glTextureManager::OnTimer(wxTimerEvent &event)
         }
     }
 
+    if((m_ticks % GL_JOB_STATS_TICKS) == 0)
+        ReportStats();
+
 #if 0
     if((m_ticks % 4/*120*/) == 0){
     
@@ -985,6 +1012,59 @@ void glTextureManager::OnTimer(wxTimerEvent &event)
 #endif
 }
 
+void glTextureManager::ReportStats()
+{
+    if(!m_stat_jobs && !m_stat_dropped) {
+        m_stat_watch.Start();
+        return;
+    }
+
+    double secs = wxMax(m_stat_watch.Time(), 1) / 1000.;
+    wxLogMessage(_T("Texture compression: %lu jobs, %lu tiles, %.1f tiles/s, job avg %.0f ms max %.0f ms, queue %lu (max %lu), running %d, stale dropped %lu"),
+                 m_stat_jobs, m_stat_tiles, m_stat_tiles / secs,
+                 m_stat_jobs ? m_stat_job_ms / m_stat_jobs : 0., m_stat_job_ms_max,
+                 (unsigned long)todo_list.GetCount(), (unsigned long)m_stat_depth_max,
+                 GetRunningJobCount(), m_stat_dropped);
+
+    m_stat_jobs = 0;
+    m_stat_tiles = 0;
+    m_stat_job_ms = 0;
+    m_stat_job_ms_max = 0;
+    m_stat_depth_max = 0;
+    m_stat_dropped = 0;
+    m_stat_watch.Start();
+}
+
+void glTextureManager::BeginFrame()
+{
+    m_frame++;
+
+    //  Jobs for tiles which have not been on screen for a while
+    wxJobListNode *next, *node = todo_list.GetFirst();
+    while(node){
+        JobTicket *ticket = node->GetData();
+        next = node->GetNext();
+        if(!ticket->b_inCompressAll && m_frame - ticket->m_frame > GL_JOB_STALE_FRAMES){
+            todo_list.DeleteNode(node);
+            delete ticket;
+            m_stat_dropped++;
+        }
+        node = next;
+    }
+}
+
+int glTextureManager::JobPriority( JobTicket *ticket )
+{
+    if(ticket->b_inCompressAll)
+        return GL_JOB_PRIORITY_BULK;
+
+    //  Each canvas renders in turn
+    if(m_frame - ticket->m_frame < (unsigned int)wxMax(g_canvasArray.GetCount(), 1))
+        return GL_JOB_PRIORITY_VISIBLE;
+
+    return GL_JOB_PRIORITY_OFFSCREEN;
+}
+
 
 bool glTextureManager::ScheduleJob(glTexFactory* client, const wxRect &rect, int level,
                                    bool b_throttle_thread, bool b_nolimit, bool b_postZip, bool b_inplace)
@@ -992,10 +1072,18 @@ bool glTextureManager::ScheduleJob(glTexFactory* client, const wxRect &rect, int
     wxString chart_path = client->GetChartPath();
     if(!b_nolimit) {
         if(todo_list.GetCount() >= 50){
-            // remove last job which is least important
-            wxJobListNode *node = todo_list.GetLast();
-            JobTicket *ticket = node->GetData();
-            todo_list.DeleteNode(node);
+            // remove the oldest of the least important jobs
+            wxJobListNode *worst = NULL;
+            int worst_priority = -1;
+            for(wxJobListNode *node = todo_list.GetFirst(); node; node = node->GetNext()){
+                int priority = JobPriority(node->GetData());
+                if(priority >= worst_priority){
+                    worst = node;
+                    worst_priority = priority;
+                }
+            }
+            JobTicket *ticket = worst->GetData();
+            todo_list.DeleteNode(worst);
             delete ticket;
         }
 
@@ -1008,6 +1096,7 @@ bool glTextureManager::ScheduleJob(glTexFactory* client, const wxRect &rect, int
                 todo_list.DeleteNode(node);
                 todo_list.Insert(ticket);
                 ticket->level_min_request = level;
+                ticket->m_frame = m_frame;
                 return false;
             }
         
@@ -1041,6 +1130,7 @@ bool glTextureManager::ScheduleJob(glTexFactory* client, const wxRect &rect, int
     pt->bpost_zip_compress = b_postZip;
     pt->binplace = b_inplace;
     pt->b_inCompressAll = b_inCompressAllCharts;
+    pt->m_frame = m_frame;
     
 
     /* do we compress in ram using builtin libraries, or do we
@@ -1054,7 +1144,8 @@ bool glTextureManager::ScheduleJob(glTexFactory* client, const wxRect &rect, int
     we can use multiple threads to take advantage of multiple cores */
 
     if(g_raster_format != GL_COMPRESSED_RGB_FXT1_3DFX) {
-        todo_list.Insert(pt); // push to front as a stack
+        todo_list.Insert(pt); // push to front, most recent first within a priority
+        m_stat_depth_max = wxMax(m_stat_depth_max, todo_list.GetCount());
         if(bthread_debug){
             int mem_used;
             GetMemoryStatus(0, &mem_used);
@@ -1081,7 +1172,16 @@ bool glTextureManager::ScheduleJob(glTexFactory* client, const wxRect &rect, int
 
 bool glTextureManager::StartTopJob()
 {
-    wxJobListNode *node = todo_list.GetFirst();
+    //  The most recent of the most important jobs
+    wxJobListNode *node = NULL;
+    int top_priority = GL_JOB_PRIORITY_BULK + 1;
+    for(wxJobListNode *tnode = todo_list.GetFirst(); tnode; tnode = tnode->GetNext()){
+        int priority = JobPriority(tnode->GetData());
+        if(priority < top_priority){
+            node = tnode;
+            top_priority = priority;
+        }
+    }
     if(!node)
         return false;
 
@@ -1126,15 +1226,99 @@ bool glTextureManager::DoThreadJob(JobTicket* pticket)
         printf( "  Starting job: %08X  Jobs running: %d Jobs left: %lu\n", pticket->ident, GetRunningJobCount(), (unsigned long)todo_list.GetCount());
     
 ///    qDebug() << "Starting job" << GetRunningJobCount() <<  (unsigned long)todo_list.GetCount() << g_tex_mem_used;
-    CompressionPoolThread *t = new CompressionPoolThread( pticket, this);
-    pticket->pthread = t;
-    
-    t->Run();
+    StartWorkers();
+
+    if(m_workers.empty()) {
+        //  No thread could be started, so do the job here
+        if(!pticket->DoJob())
+            pticket->b_isaborted = true;
+
+        OCPN_CompressionThreadEvent Nevent(wxEVT_OCPN_COMPRESSIONTHREAD, 0);
+        Nevent.type = 0;
+        Nevent.SetTicket(pticket);
+        QueueEvent(Nevent.Clone());
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_work_mutex);
+        m_work.push_back(pticket);
+    }
+    m_work_cond.notify_one();
     
     return true;
     
 }
 
+void glTextureManager::StartWorkers()
+{
+    if(!m_workers.empty() || m_bstop_workers)
+        return;
+
+    for(int i=0 ; i < m_max_jobs ; i++) {
+        CompressionPoolThread *t = new CompressionPoolThread( this );
+        if(t->Run() != wxTHREAD_NO_ERROR) {
+            delete t;
+            break;
+        }
+        m_workers.push_back(t);
+    }
+
+    if(bthread_debug)
+        printf(" Compression pool: %d workers\n", (int)m_workers.size());
+}
+
+void glTextureManager::StopWorkers()
+{
+    //  Running jobs finish early
+    for(wxJobListNode *node = running_list.GetFirst(); node; node = node->GetNext())
+        node->GetData()->b_abort = true;
+
+    {
+        std::lock_guard<std::mutex> lock(m_work_mutex);
+        m_bstop_workers = true;
+    }
+    m_work_cond.notify_all();
+
+    for(size_t i=0 ; i < m_workers.size() ; i++) {
+        m_workers[i]->Wait();
+        delete m_workers[i];
+    }
+    m_workers.clear();
+
+    //  The completions of the jobs run will not be handled now, so free every
+    //  started ticket here: run, aborted, or never taken by a worker
+    DeletePendingEvents();
+    m_work.clear();
+
+    for(wxJobListNode *node = running_list.GetFirst(); node; node = node->GetNext()) {
+        JobTicket *ticket = node->GetData();
+        for(int i=0 ; i < g_mipmap_max_level+1 ; i++) {
+            free(ticket->comp_bits_array[i]);
+            free( ticket->compcomp_bits_array[i] );
+        }
+        if(ticket->b_inCompressAll)
+            delete ticket->pFact;
+        delete ticket;
+    }
+    running_list.Clear();
+}
+
+//  Worker side: the next started job, or NULL once the pool is stopping
+JobTicket *glTextureManager::TakeWork()
+{
+    std::unique_lock<std::mutex> lock(m_work_mutex);
+    while(!m_bstop_workers && m_work.empty())
+        m_work_cond.wait(lock);
+
+    if(m_bstop_workers)
+        return NULL;
+
+    JobTicket *ticket = m_work.front();
+    m_work.pop_front();
+    return ticket;
+}
+
 bool glTextureManager::AsJob( wxString const &chart_path ) const
 {
     if(chart_path.Len()){    
@@ -1253,6 +1437,18 @@ bool glTextureManager::PurgeChartTextures( ChartBase *pc, bool b_purge_factory )
         return false;
 }
 
+//      Host memory held by the texture cache of a chart
+size_t glTextureManager::GetChartTextureBytes( ChartBase *pc )
+{
+    ChartPathHashTexfactType::iterator ittf = m_chart_texfactory_hash.find( pc->GetHashKey() );
+    if( ittf == m_chart_texfactory_hash.end() || !ittf->second )
+        return 0;
+
+    int map_size = 0, comp_size = 0, compcomp_size = 0;
+    ittf->second->AccumulateMemStatistics( map_size, comp_size, compcomp_size );
+    return (size_t)map_size + comp_size + compcomp_size;
+}
+
 bool glTextureManager::TextureCrunch(double factor)
 {
     
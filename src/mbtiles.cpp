@@ -64,6 +64,7 @@
 #include "chart1.h"
 #include "chcanv.h"
 #include "glChartCanvas.h"
+#include "MBTilesLoader.h"
 
 //  Missing from MSW include files
 #ifdef _MSC_VER
@@ -83,8 +84,7 @@ static const long long lNaN = 0xfff8000000000000;
 #endif
 
 #ifdef OCPN_USE_CONFIG
-class MyConfig;
-extern MyConfig        *pConfig;
+extern int             g_MBTilesDebug;         // read with the config, charts may open on worker threads
 #endif
 
 #define LON_UNDEF NAN
@@ -300,20 +300,18 @@ ChartMBTiles::ChartMBTiles()
       m_LatMax = LAT_UNDEF;
       
 #ifdef OCPN_USE_CONFIG
-      wxFileConfig *pfc = (wxFileConfig *)pConfig;
-      pfc->SetPath ( _T ( "/Settings" ) );
-      pfc->Read ( _T ( "DebugMBTiles" ),  &m_b_cdebug, 0 );
+      m_b_cdebug = g_MBTilesDebug;
 #endif
-      m_pDB = NULL;
+      m_prefetch_zoom = -1;
 
 }
 
 ChartMBTiles::~ChartMBTiles()
 {
+    //  Jobs still running for this chart keep the database open until they finish
+    if(m_tileSource)
+        m_tileSource->Close();
     FlushTiles();
-    if(m_pDB){
-        delete m_pDB;
-    }
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -683,9 +681,12 @@ InitReturn ChartMBTiles::PostInit(void)
       if ( utf8CB.data() )
           name_UTF8 = utf8CB.data();
 
-      m_pDB = new SQLite::Database(name_UTF8);
-      m_pDB->exec("PRAGMA locking_mode=EXCLUSIVE");
-      m_pDB->exec("PRAGMA cache_size=-50000");
+      SQLite::Database *db = new SQLite::Database(name_UTF8);
+      db->exec("PRAGMA locking_mode=EXCLUSIVE");
+      db->exec("PRAGMA cache_size=-50000");
+
+      m_tileSource = std::make_shared<MBTilesSource>(db, m_minZoom, m_maxZoom);
+      m_tileSource->SetColorScheme(m_global_color_scheme);
 
       bReadyToRender = true;
       return INIT_OK;
@@ -779,6 +780,8 @@ void ChartMBTiles::SetColorScheme(ColorScheme cs, bool bApplyImmediate)
 {
     if(m_global_color_scheme != cs){
         m_global_color_scheme = cs;
+        if(m_tileSource)
+            m_tileSource->SetColorScheme(cs);
         FlushTextures();
     }
 }
@@ -808,7 +811,7 @@ bool ChartMBTiles::RenderViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint)
 
 bool ChartMBTiles::getTileTexture( mbTileDescriptor *tile)
 {
-    if(!m_pDB)
+    if(!m_tileSource)
         return false;
     
     // Is the texture ready?
@@ -817,106 +820,74 @@ bool ChartMBTiles::getTileTexture( mbTileDescriptor *tile)
         
         return true;
     }
-    else{
-        if(!tile->m_bAvailable)
-            return false;
-        // fetch the tile data from the mbtile database
-        try
-        {
-          
-            char qrs[2100];
-            sprintf(qrs, "select tile_data, length(tile_data) from tiles where zoom_level = %d AND tile_column=%d AND tile_row=%d", tile->m_zoomLevel, tile->tile_x, tile->tile_y);
-            
-            // Compile a SQL query, getting the specific  blob
-            SQLite::Statement query(*m_pDB, qrs);
-            
-            int queryResult = query.tryExecuteStep();
-            if(SQLITE_DONE == queryResult){
-                tile->m_bAvailable = false;
-                return false;                           // requested ROW not found, should never happen
-            }
-            else{
-                SQLite::Column blobColumn = query.getColumn(0);         // Get the blob
-                const void* blob = blobColumn.getBlob();
-                
-                int length = query.getColumn(1);         // Get the length
-                
-                wxMemoryInputStream blobStream(blob, length);
-                wxImage blobImage;
 
-                blobImage = wxImage(blobStream, m_imageType);
-                
-                int blobWidth = blobImage.GetWidth();
-                int blobHeight = blobImage.GetHeight();
-                unsigned char *imgdata = blobImage.GetData();
-                
-                if( (m_global_color_scheme != GLOBAL_COLOR_SCHEME_RGB) && (m_global_color_scheme != GLOBAL_COLOR_SCHEME_DAY) ){
-                    double dimLevel;
-                    switch( m_global_color_scheme ){
-                        case GLOBAL_COLOR_SCHEME_DUSK: {
-                            dimLevel = 0.8;
-                            break;
-                        }
-                        case GLOBAL_COLOR_SCHEME_NIGHT: {
-                            dimLevel = 0.3;
-                            break;
-                        }
-                        default: {
-                            dimLevel = 1.0;
-                            break;
-                        }
-                    }
-
-//                      for( int iy = 0; iy < blobHeight; iy++ ) {
-//                           for( int ix = 0; ix < blobWidth; ix++ ) {
-//                                  wxImage::RGBValue rgb( blobImage.GetRed( ix, iy ), blobImage.GetGreen( ix, iy ), blobImage.GetBlue( ix, iy ) );
-//                                  wxImage::HSVValue hsv = wxImage::RGBtoHSV( rgb );
-//                                  hsv.value = hsv.value * dimLevel;
-//                                  wxImage::RGBValue nrgb = wxImage::HSVtoRGB( hsv );
-//                                  blobImage.SetRGB( ix, iy, nrgb.red, nrgb.green, nrgb.blue );
-//                           }
-//                      }
-                     
-                     for( int j = 0; j < blobHeight*blobWidth; j++ ){
-                         unsigned char *d = &imgdata[3*j];
-                         wxImage::RGBValue rgb( *d, *(d+1), *(d+2) );
-                         wxImage::HSVValue hsv = wxImage::RGBtoHSV( rgb );
-                         hsv.value = hsv.value * dimLevel;
-                         wxImage::RGBValue nrgb = wxImage::HSVtoRGB( hsv );
-                         *d = nrgb.red; *(d+1) = nrgb.green; *(d+2) = nrgb.blue; 
-                     }
- 
-                }
-                    
-                
-                int stride = 4;
-                int tex_w = 256;
-                int tex_h = 256;
-                if( !imgdata )
-                    return false;
-                m_imageType = blobImage.GetType();
-
-                unsigned char *teximage = (unsigned char *) malloc( stride * tex_w * tex_h );
-                bool transparent = blobImage.HasAlpha();
-                
-                for( int j = 0; j < tex_w*tex_h; j++ ){
-                    for( int k = 0; k < 3; k++ )
-                        teximage[j * stride + k] = imgdata[3*j + k];
-                    
-                    // Some NOAA Tilesets do not give transparent tiles, so we detect NOAA's idea of blank
-                    // as RGB(1,0,0) and force  alpha = 0;
-                    if( imgdata[3*j] == 1 && imgdata[3*j + 1] == 0 && imgdata[3*j+2] == 0) {
-                        teximage[j * stride + 3] = 0;
-                    } else {
-                        if( transparent ) {
-                            teximage[j * stride + 3] = blobImage.GetAlpha(j % tex_w, j / tex_w);
-                        } else {
-                            teximage[j * stride + 3] = 255;
-                        }
-                    }
-                }
-                
-                    
+    //  Else have it fetched and decoded in the background, and uploaded by a later render.
+    //  Meanwhile the tiles of the lower zoom levels, rendered first, show through.
+    if(tile->m_bAvailable)
+        MBTilesLoader::Get()->Request(m_tileSource, tile->m_zoomLevel, tile->tile_x, tile->tile_y, false);
+
+    return false;
+}
+
+mbTileDescriptor *ChartMBTiles::FindTile( int zoomFactor, int tile_x, int tile_y )
+{
+    mbTileZoomDescriptor *tzd = m_tileArray[zoomFactor - m_minZoom];
+    unsigned int index = ((tile_y - tzd->tile_y_min) * (tzd->nx_tile + 1)) + tile_x;
+
+    std::unordered_map<unsigned int, mbTileDescriptor *>::iterator it = tzd->tileMap.find(index);
+    if(it != tzd->tileMap.end())
+        return it->second;
+    return NULL;
+}
+
+mbTileDescriptor *ChartMBTiles::GetTile( int zoomFactor, int tile_x, int tile_y )
+{
+    mbTileDescriptor *tile = FindTile(zoomFactor, tile_x, tile_y);
+    if(NULL == tile){
+        mbTileZoomDescriptor *tzd = m_tileArray[zoomFactor - m_minZoom];
+        unsigned int index = ((tile_y - tzd->tile_y_min) * (tzd->nx_tile + 1)) + tile_x;
+
+        tile = new mbTileDescriptor;
+        tile->tile_x = tile_x;
+        tile->tile_y = tile_y;
+        tile->m_zoomLevel = zoomFactor;
+        tile->m_bAvailable = true;
+
+        tzd->tileMap[index] = tile;
+    }
+
+    if(!tile->m_bgeomSet){
+        
+        tile->lonmin = round(tilex2long(tile->tile_x, zoomFactor)/eps)*eps;
+        tile->lonmax = round(tilex2long(tile->tile_x + 1, zoomFactor)/eps)*eps;
+        tile->latmin = round(tiley2lat(tile->tile_y - 1, zoomFactor)/eps)*eps;
+        tile->latmax = round(tiley2lat(tile->tile_y, zoomFactor)/eps)*eps;
+        
+        tile->box.Set(tile->latmin, tile->lonmin, tile->latmax, tile->lonmax);
+        tile->m_bgeomSet = true;
+    }
+
+    return tile;
+}
+
+//  Make textures of the tiles decoded since the last render
+void ChartMBTiles::UploadReadyTiles()
+{
+    if(!m_tileSource)
+        return;
+
+    std::vector<MBTileImage *> ready;
+    m_tileSource->TakeReady(ready);
+
+    for(size_t i = 0 ; i < ready.size() ; i++){
+        MBTileImage *image = ready[i];
+
+        if(image->zoom >= m_minZoom && image->zoom <= m_maxZoom){
+            mbTileDescriptor *tile = GetTile(image->zoom, image->x, image->y);
+
+            if(!image->found)
+                tile->m_bAvailable = false;                 // requested ROW not found, should never happen
+            else if(image->scheme == m_global_color_scheme && tile->glTextureName == 0){
                 glGenTextures( 1, &tile->glTextureName );
                 glBindTexture( GL_TEXTURE_2D, tile->glTextureName );
                 
@@ -925,24 +896,59 @@ bool ChartMBTiles::getTileTexture( mbTileDescriptor *tile)
                 glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
                 glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
 
-                glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, tex_w, tex_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, teximage );
-                
-                free(teximage);
-                
-                return true;
+                glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, MBTILES_TILE_SIZE, MBTILES_TILE_SIZE, 0,
+                              GL_RGBA, GL_UNSIGNED_BYTE, &image->rgba[0] );
+            }
+            //  else decoded for a color scheme no longer in use, it will be requested again
+        }
+
+        delete image;
+    }
+}
+
+//  Queue the tiles likely wanted next: the ring around the view at the view zoom level,
+//  then the view at the next zoom level in
+void ChartMBTiles::PrefetchTiles( const LLBBox &box, int viewZoom )
+{
+    if( viewZoom == m_prefetch_zoom && m_prefetch_box.GetValid() &&
+        box.GetMinLat() == m_prefetch_box.GetMinLat() && box.GetMaxLat() == m_prefetch_box.GetMaxLat() &&
+        box.GetMinLon() == m_prefetch_box.GetMinLon() && box.GetMaxLon() == m_prefetch_box.GetMaxLon() )
+        return;
+
+    m_prefetch_box = box;
+    m_prefetch_zoom = viewZoom;
+
+    MBTilesLoader *loader = MBTilesLoader::Get();
+    loader->ClearPrefetch(m_tileSource);
+
+    int count = 0;
+    for(int zoomFactor = viewZoom ; zoomFactor <= wxMin(viewZoom + 1, m_maxZoom) ; zoomFactor++){
+        mbTileZoomDescriptor *tzd = m_tileArray[zoomFactor - m_minZoom];
+        if(tzd->tile_x_max < tzd->tile_x_min)
+            continue;                                   // spans the IDL
+
+        int topTile =   lat2tiley(box.GetMaxLat(), zoomFactor);
+        int botTile =   lat2tiley(box.GetMinLat(), zoomFactor);
+        int leftTile =  long2tilex(box.GetMinLon(), zoomFactor);
+        int rightTile = long2tilex(box.GetMaxLon(), zoomFactor);
+
+        int ring = (zoomFactor == viewZoom) ? 1 : 0;
+
+        for(int i = wxMax(botTile - ring, tzd->tile_y_min) ; i <= wxMin(topTile + ring, tzd->tile_y_max) ; i++){
+            for(int j = wxMax(leftTile - ring, tzd->tile_x_min) ; j <= wxMin(rightTile + ring, tzd->tile_x_max) ; j++){
+                if(ring && i >= botTile && i <= topTile && j >= leftTile && j <= rightTile)
+                    continue;                           // on screen, requested as rendered
+
+                mbTileDescriptor *tile = FindTile(zoomFactor, j, i);
+                if(tile && (tile->glTextureName > 0 || !tile->m_bAvailable))
+                    continue;
+
+                if(count++ >= MBTILES_PREFETCH_MAX)
+                    return;
+                loader->Request(m_tileSource, zoomFactor, j, i, true);
             }
-            
         }
-        catch (std::exception& e)
-        {
-            const char *t = e.what();
-            wxLogMessage("mbtiles exception: %s", e.what());
-        }     
     }
-        
-        
-    
-    return false;
 }
 
 class wxPoint2DDouble;
@@ -1050,6 +1056,9 @@ bool ChartMBTiles::RenderRegionViewOnGL(const wxGLContext &glc, const ViewPort&
         glChartCanvas::SetClipRegion(vp, m_minZoomRegion);
         
     
+    //  Tiles decoded in the background since the last render
+    UploadReadyTiles();
+
     /* setup opengl parameters */
     glEnable( GL_TEXTURE_2D );
     
@@ -1125,32 +1134,8 @@ bool ChartMBTiles::RenderRegionViewOnGL(const wxGLContext &glc, const ViewPort&
                 if( (tzd->tile_x_max >= tzd->tile_x_min) && ((j > tzd->tile_x_max) || (j < tzd->tile_x_min)) )
                     continue;
                 
-                unsigned int index = ((i- tzd->tile_y_min) * (tzd->nx_tile + 1)) + j;
                 //printf("pass 1:  %d  %d  %d\n", zoomFactor, i, j);
-                mbTileDescriptor *tile = NULL;
-
-                if(tzd->tileMap.find(index) != tzd->tileMap.end())
-                    tile = tzd->tileMap[index];
-                if(NULL == tile){
-                    tile = new mbTileDescriptor;
-                    tile->tile_x = j;
-                    tile->tile_y = i;
-                    tile->m_zoomLevel = zoomFactor;
-                    tile->m_bAvailable = true;
-           
-                    tzd->tileMap[index] = tile;
-                }
-                
-                if(!tile->m_bgeomSet){
-                    
-                    tile->lonmin = round(tilex2long(tile->tile_x, zoomFactor)/eps)*eps;
-                    tile->lonmax = round(tilex2long(tile->tile_x + 1, zoomFactor)/eps)*eps;
-                    tile->latmin = round(tiley2lat(tile->tile_y - 1, zoomFactor)/eps)*eps;
-                    tile->latmax = round(tiley2lat(tile->tile_y, zoomFactor)/eps)*eps;
-                    
-                    tile->box.Set(tile->latmin, tile->lonmin, tile->latmax, tile->lonmax);
-                    tile->m_bgeomSet = true;
-                }
+                mbTileDescriptor *tile = GetTile(zoomFactor, j, i);
                 
                 if(!Region.IntersectOut(tile->box))
                 {
@@ -1179,35 +1164,8 @@ bool ChartMBTiles::RenderRegionViewOnGL(const wxGLContext &glc, const ViewPort&
 
             for(int i=botTile ; i < topTile ; i++){
                 for(int j = leftTile ; j < rightTile+1 ; j++){
-                    unsigned int index = ((i- tzd->tile_y_min) * (tzd->nx_tile + 1)) + j;
-                    
-                    mbTileDescriptor *tile = NULL;
-
                     //printf("pass 2:  %d  %d  %d\n", zoomFactor, i, j);
-
-                    if(tzd->tileMap.find(index) != tzd->tileMap.end())
-                        tile = tzd->tileMap[index];
-                    if(NULL == tile){
-                        tile = new mbTileDescriptor;
-                        tile->tile_x = j;
-                        tile->tile_y = i;
-                        tile->m_zoomLevel = zoomFactor;
-                        tile->m_bAvailable = true;
-            
-                        tzd->tileMap[index] = tile;
-                    }
-                    
-                    if(!tile->m_bgeomSet){
-                        
-                        tile->lonmin = round(tilex2long(tile->tile_x, zoomFactor)/eps)*eps;
-                        tile->lonmax = round(tilex2long(tile->tile_x + 1, zoomFactor)/eps)*eps;
-                        tile->latmin = round(tiley2lat(tile->tile_y - 1, zoomFactor)/eps)*eps;
-                        tile->latmax = round(tiley2lat(tile->tile_y, zoomFactor)/eps)*eps;
-                        
-                        tile->box.Set(tile->latmin, tile->lonmin, tile->latmax, tile->lonmax);
-                        tile->m_bgeomSet = true;
-                    }
-                    
+                    mbTileDescriptor *tile = GetTile(zoomFactor, j, i);
                     
                     if(!Region.IntersectOut(tile->box))
                         RenderTile(tile, zoomFactor, vp);
@@ -1219,6 +1177,9 @@ bool ChartMBTiles::RenderRegionViewOnGL(const wxGLContext &glc, const ViewPort&
     }
     
     glDisable(GL_TEXTURE_2D);
+
+    if(!btwoPass)
+        PrefetchTiles(screenBox, viewZoom);
     
     m_zoomScaleFactor = 2.0 * OSM_zoomMPP[maxrenZoom] * VPoint.view_scale_ppm;
  
@@ -38,6 +38,7 @@
 #include "OCPN_SignalKEvent.h"
 #include "datastream.h"
 #include "SerialDataStream.h"
+#include "StreamCapture.h"
 #include "wx/jsonval.h"
 #include "wx/jsonwriter.h"
 #include "wx/jsonreader.h"
@@ -52,10 +53,12 @@ extern bool             g_bserial_access_checked;
 extern bool             g_b_legacy_input_filter_behaviour;
 extern int              g_maxWPNameLength;
 extern wxString         g_TalkerIdText;
+extern int              g_OutputQueueDepth;
+extern int              g_OutputQueuePolicy;
 
 extern "C" bool CheckSerialAccess( void );
 
-Multiplexer::Multiplexer() : params_save(NULL)
+Multiplexer::Multiplexer() : m_capture(NULL), params_save(NULL)
 {
     m_aisconsumer = NULL;
     m_gpsconsumer = NULL;
@@ -72,11 +75,35 @@ Multiplexer::~Multiplexer()
     Disconnect(wxEVT_OCPN_DATASTREAM, (wxObjectEventFunction)(wxEventFunction)&Multiplexer::OnEvtStream);
     ClearStreams();
     delete m_pdatastreams;
+    StopCapture();
+}
+
+bool Multiplexer::StartCapture(const wxString &path)
+{
+    StopCapture();
+
+    m_capture = new StreamCaptureWriter();
+    if( !m_capture->Open(std::string(path.mb_str())) ) {
+        delete m_capture;
+        m_capture = NULL;
+        return false;
+    }
+    return true;
+}
+
+void Multiplexer::StopCapture()
+{
+    delete m_capture;           // Implicit Close(), writes the block index
+    m_capture = NULL;
 }
 
 void Multiplexer::AddStream(DataStream *stream)
 {
     m_pdatastreams->Add(stream);
+
+    //  Writes to slow peers must not block the GUI thread
+    if( stream->GetIoSelect() == DS_TYPE_INPUT_OUTPUT || stream->GetIoSelect() == DS_TYPE_OUTPUT )
+        stream->StartOutputThread( g_OutputQueueDepth, (OutputOverflowPolicy)g_OutputQueuePolicy );
 }
 
 void Multiplexer::StopAllStreams()
@@ -91,7 +118,7 @@ void Multiplexer::ClearStreams()
 {
     for (size_t i = 0; i < m_pdatastreams->Count(); i++)
     {
-        delete m_pdatastreams->Item(i);         // Implicit Close(), see datastream dtor
+        delete m_pdatastreams->Item(i);         // Each dtor stops its output thread, then closes the stream
     }
     m_pdatastreams->Clear();
 }
@@ -216,7 +243,7 @@ void Multiplexer::SendNMEAMessage(const wxString &msg)
 
             bool bxmit_ok = true;
             if(s->SentencePassesFilter( msg, FILTER_OUTPUT ) ) {
-                bxmit_ok = s->SendSentence(msg);
+                bxmit_ok = s->QueueSentence(msg);
                 bout_filter = false;
             }
             //Send to the Debug Window, if open
@@ -254,6 +281,10 @@ void Multiplexer::OnEvtStream(OCPN_DataStreamEvent& event)
     if( stream )
         port = wxString(stream->GetPort());
 
+    //  Record the raw sentence, before any filtering
+    if( m_capture )
+        m_capture->Append( CAPTURE_NMEA0183, std::string(port.ToUTF8()), event.GetNMEAString() );
+
     if( !message.IsEmpty() )
     {
         //Send to core consumers
@@ -330,7 +361,7 @@ void Multiplexer::OnEvtStream(OCPN_DataStreamEvent& event)
 
                             bool bxmit_ok = true;
                             if(s->SentencePassesFilter( message, FILTER_OUTPUT ) ) {
-                                bxmit_ok = s->SendSentence(message);
+                                bxmit_ok = s->QueueSentence(message);
                                 bout_filter = false;
                             }
 
@@ -353,6 +384,9 @@ void Multiplexer::OnEvtStream(OCPN_DataStreamEvent& event)
 
 void Multiplexer::OnEvtSignalK(OCPN_SignalKEvent &event)
 {
+    if( m_capture )
+        m_capture->Append( CAPTURE_SIGNALK, "SignalK", event.GetString() );
+
     if( m_aisconsumer )
         m_aisconsumer->AddPendingEvent(event);
     if( m_gpsconsumer )
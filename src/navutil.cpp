@@ -267,6 +267,9 @@ extern int              gps_watchdog_timeout_ticks;
 
 extern int              g_nCacheLimit;
 extern int              g_memCacheLimit;
+extern int              g_chartCacheBudgetMB;
+extern bool             g_bAsyncChartOpen;
+extern int              g_rasterBandCacheMB;
 
 extern bool             g_bGDAL_Debug;
 extern bool             g_bDebugCM93;
@@ -321,6 +324,7 @@ extern int              g_nCOMPortCheck;
 extern wxString         g_AW1GUID;
 extern wxString         g_AW2GUID;
 extern int              g_BSBImgDebug;
+extern int              g_MBTilesDebug;
 
 extern int             n_NavMessageShown;
 extern wxString        g_config_version_string;
@@ -428,6 +432,8 @@ extern bool             g_bShowTide;
 extern bool             g_bShowCurrent;
 
 extern bool             g_benableUDPNullHeader;
+extern int              g_OutputQueueDepth;
+extern int              g_OutputQueuePolicy;
 
 extern wxString         g_uiStyle;
 extern bool             g_btrackContinuous;
@@ -456,6 +462,7 @@ wxString                g_catalog_channel;
 
 #ifdef ocpnUSE_GL
 extern ocpnGLOptions g_GLOptions;
+extern bool          g_bGLBatchS57;
 #endif
 
 #if !defined(NAN)
@@ -789,6 +796,10 @@ int MyConfig::LoadMyConfigRaw( bool bAsTemplate )
     if(mem_limit > 0)
         g_memCacheLimit = mem_limit * 1024;       // convert from MBytes to kBytes
 
+    Read( _T ( "ChartCacheBudgetMB" ), &g_chartCacheBudgetMB );
+    Read( _T ( "AsyncChartOpen" ), &g_bAsyncChartOpen );
+    Read( _T ( "RasterBandCacheMB" ), &g_rasterBandCacheMB );
+
     Read( _T ( "UseModernUI5" ), &g_useMUI );
     
     Read( _T( "NCPUCount" ), &g_nCPUCount);    
@@ -801,6 +812,7 @@ int MyConfig::LoadMyConfigRaw( bool bAsTemplate )
     Read( _T ( "DebugCM93" ), &g_bDebugCM93 );
     Read( _T ( "DebugS57" ), &g_bDebugS57 );         // Show LUP and Feature info in object query
     Read( _T ( "DebugBSBImg" ), &g_BSBImgDebug );
+    Read( _T ( "DebugMBTiles" ), &g_MBTilesDebug );
     Read( _T ( "DebugGPSD" ), &g_bDebugGPSD );
 
     Read( _T ( "DefaultFontSize"), &g_default_font_size );
@@ -894,6 +906,7 @@ int MyConfig::LoadMyConfigRaw( bool bAsTemplate )
         Read( _T ( "GPUTextureDimension" ), &g_GLOptions.m_iTextureDimension );
         Read( _T ( "GPUTextureMemSize" ), &g_GLOptions.m_iTextureMemorySize );
         Read( _T ( "DebugOpenGL" ), &g_bDebugOGL );
+        Read( _T ( "S57GLBatching" ), &g_bGLBatchS57 );
         Read( _T ( "OpenGL" ), &g_bopengl );
         Read( _T ( "SoftwareGL" ), &g_bSoftwareGL );
     }
@@ -1027,6 +1040,10 @@ int MyConfig::LoadMyConfigRaw( bool bAsTemplate )
     Read( _T ( "EnableAISNameCache" ),  &g_benableAISNameCache );
     
     Read( _T ( "EnableUDPNullHeader" ),  &g_benableUDPNullHeader );
+
+    //  Per-connection output queue, policy 0: drop oldest, 1: drop AIS first
+    Read( _T ( "OutputQueueDepth" ),  &g_OutputQueueDepth );
+    Read( _T ( "OutputQueueOverflowPolicy" ),  &g_OutputQueuePolicy );
     
     SetPath( _T ( "/Settings/GlobalState" ) );
 
@@ -132,6 +132,8 @@ typedef __LA_INT64_T la_int64_t;      //  "older" libarchive versions support
 #include "catalog_handler.h"
 #include "semantic_vers.h"
 #include "update_mgr.h"
+#include "OwnShipState.h"
+#include "DepthHazards.h"
 
 #ifdef __OCPN__ANDROID__
 #include "androidUTIL.h"
@@ -180,6 +182,7 @@ extern ocpnFloatingToolbarDialog *g_MainToolbar;
 
 extern int              g_chart_zoom_modifier;
 extern int              g_chart_zoom_modifier_vector;
+extern OwnShipState     g_OwnShipState;
 extern double           g_display_size_mm;
 extern bool             g_bopengl;
 
@@ -8921,3 +8924,62 @@ void ZeroXTE() {
     g_pRouteMan->ZeroCurrentXTEToActivePoint();
   }
 }
+
+bool GetOwnShipFix_Plugin( PlugIn_Position_Fix_Ex *pfix )
+{
+    OwnShipFix fix = g_OwnShipState.Get();
+
+    pfix->Lat = fix.lat;
+    pfix->Lon = fix.lon;
+    pfix->Cog = fix.cog;
+    pfix->Sog = fix.sog;
+    pfix->Var = fix.var;
+    pfix->Hdm = fix.hdm;
+    pfix->Hdt = fix.hdt;
+    pfix->FixTime = fix.fix_time;
+    pfix->nSats = fix.n_sats;
+
+    return fix.IsPosValid();
+}
+
+static void HazardsToPlugin( const std::vector<DepthHazardHit> &hits, std::vector<PlugIn_DepthHazard> *hazards )
+{
+    hazards->clear();
+    for( size_t i = 0; i < hits.size(); i++ ) {
+        PlugIn_DepthHazard hazard;
+        hazard.ObjectClass = wxString( hits[i].obj->FeatureName, wxConvUTF8 );
+        hazard.Depth = hits[i].depth;
+        hazard.Lat = hits[i].lat;
+        hazard.Lon = hits[i].lon;
+        hazard.Distance = hits[i].distance;
+        hazard.Offset = hits[i].offset;
+        hazard.ChartScale = hits[i].chart_scale;
+        hazards->push_back( hazard );
+    }
+}
+
+bool CheckSegmentHazards_Plugin( double lat0, double lon0, double lat1, double lon1,
+                                 double depth, double half_width,
+                                 std::vector<PlugIn_DepthHazard> *hazards )
+{
+    if( !hazards )
+        return DepthHazards::CheckSegment( lat0, lon0, lat1, lon1, depth, half_width );
+
+    std::vector<DepthHazardHit> hits;
+    bool ret = DepthHazards::CheckSegment( lat0, lon0, lat1, lon1, depth, half_width, &hits );
+    HazardsToPlugin( hits, hazards );
+    return ret;
+}
+
+bool CheckTrackHazards_Plugin( double lat, double lon, double cog, double sog, double minutes,
+                               double depth, double half_width,
+                               std::vector<PlugIn_DepthHazard> *hazards )
+{
+    if( !hazards )
+        return DepthHazards::CheckTrack( lat, lon, cog, sog, minutes, depth, half_width );
+
+    std::vector<DepthHazardHit> hits;
+    bool ret = DepthHazards::CheckTrack( lat, lon, cog, sog, minutes, depth, half_width, &hits );
+    HazardsToPlugin( hits, hazards );
+    return ret;
+}
@@ -118,7 +118,6 @@ GLint S52AP_shader_program;
 
 //    Implement all lists
 #include <wx/listimpl.cpp>
-WX_DEFINE_LIST( TextObjList );
 
 
 //    Implement all arrays
@@ -133,6 +132,8 @@ S52_TextC::S52_TextC()
     texobj = 0;
     bnat = false;
     bspecial_char = false;
+    layout_font = NULL;
+    layout_txf = false;
 }
 
 S52_TextC::~S52_TextC()
@@ -382,6 +383,7 @@ s52plib::s52plib( const wxString& PLib, bool b_forceLegacy )
 
     m_txf_ready = false;
     m_txf = NULL;
+    m_bTextBatch = false;
 
     ChartSymbols::InitializeGlobals();
 
@@ -540,10 +542,40 @@ void s52plib::DestroyLUP( LUPrec *pLUP )
     
     for(unsigned int i = 0 ; i < pLUP->ATTArray.size() ; i++)
         free (pLUP->ATTArray[i]);
+    std::vector<S52AttMatch>().swap( pLUP->ATTMatch );
     
     delete pLUP->INST;
 }
 
+//  Parse the LUP attributes once, for FindBestLUP()
+void s52plib::CompileLUPAttributes( LUPrec *pLUP )
+{
+    pLUP->ATTMatch.resize( pLUP->ATTArray.size() );
+
+    for( unsigned int i = 0; i < pLUP->ATTArray.size(); i++ ) {
+        const char *slatc = pLUP->ATTArray[i];
+        S52AttMatch &m = pLUP->ATTMatch[i];
+        memset( &m, 0, sizeof(m) );
+
+        if( !slatc || strlen( slatc ) < 6 )
+            continue;                   // LUP attribute value not UTF8 convertible (never seen in PLIB 3.x)
+
+        const char *slatv = slatc + 6;
+        m.code = S57AttCode( slatc );
+
+        if( slatv[0] == ' ' )           // any object value will match wild card (S52 para 8.3.3.4)
+            m.kind = ' ';
+        else if( slatv[0] == '?' )      // LUP attribute value is "undefined"
+            m.kind = '?';
+        else {
+            m.kind = 'v';
+            m.ival = atoi( slatv );
+            m.fval = atof( slatv );
+            m.sval = slatv;
+        }
+    }
+}
+
 void s52plib::DestroyRulesChain( Rules *top )
 {
     while( top != NULL ) {
@@ -782,127 +814,72 @@ LUPrec *s52plib::FindBestLUP( wxArrayOfLUPrec *LUPArray, unsigned int startIndex
 
     if( pObj->att_array == NULL )
         goto check_LUP;       // object has no attributes to compare, so return "best" LUP
-        
+
+    //  The object acronyms as integers, once for all candidates
+    m_att_codes.resize( pObj->n_attr );
+    for( int iatt = 0; iatt < pObj->n_attr; iatt++ )
+        m_att_codes[iatt] = S57AttCode( pObj->att_array + 6 * iatt );
+
     for( unsigned int i = 0; i < count; ++i ) {
         LUPrec *LUPCandidate = LUPArray->Item( startIndex + i );
         
         if( !LUPCandidate->ATTArray.size() )
             continue;        // this LUP has no attributes coded
 
+        if( LUPCandidate->ATTMatch.size() != LUPCandidate->ATTArray.size() )
+            CompileLUPAttributes( LUPCandidate );
+
         countATT = 0;
-        char *currATT = pObj->att_array;
-        int attIdx = 0;
 
-        for( unsigned int iLUPAtt = 0; iLUPAtt < LUPCandidate->ATTArray.size(); iLUPAtt++ ) {
+        for( unsigned int iLUPAtt = 0; iLUPAtt < LUPCandidate->ATTMatch.size(); iLUPAtt++ ) {
+            const S52AttMatch &m = LUPCandidate->ATTMatch[iLUPAtt];
+            if( !m.kind )
+                continue;
 
-            // Get the LUP attribute name
-            char *slatc = LUPCandidate->ATTArray[iLUPAtt];
+            //  The first object attribute of the same name
+            int attIdx = 0;
+            while( attIdx < pObj->n_attr && m_att_codes[attIdx] != m.code )
+                ++attIdx;
+            if( attIdx == pObj->n_attr )
+                continue;
 
-            if( slatc && (strlen(slatc) < 6) )
-                goto next_LUP_Attr;         // LUP attribute value not UTF8 convertible (never seen in PLIB 3.x)
+            // special case (i)
+            if( m.kind == ' ' ) {
+                ++countATT;
+                continue;
+            }
 
-            if( slatc ){
-                char *slatv = slatc + 6;
-                while( attIdx < pObj->n_attr ) {
-                    if( 0 == strncmp( slatc, currATT, 6 ) ) {
-                        //OK we have an attribute name match
-                        
-                        
-                        bool attValMatch = false;
-                        
-                        // special case (i)
-                        if( !strncmp( slatv, " ", 1 ) ) {        // any object value will match wild card (S52 para 8.3.3.4)
-                            ++countATT;
-                            goto next_LUP_Attr;
-                        }
-                        
-                        // special case (ii)
-                        //TODO  Find an ENC with "UNKNOWN" DRVAL1 or DRVAL2 and debug this code
-                        if( !strncmp( slatv, "?", 1) ){          // if LUP attribute value is "undefined"
+            // special case (ii)
+            //TODO  Find an ENC with "UNKNOWN" DRVAL1 or DRVAL2 and debug this code
+            if( m.kind == '?' )                 //  Match if the object does NOT contain this attribute
+                continue;
 
-                        //  Match if the object does NOT contain this attribute
-                            goto next_LUP_Attr;
-                        }
-                        
-                        
-                        //checking against object attribute value
-                        S57attVal *v = ( pObj->attVal->Item( attIdx ) );
-                        
-                        switch( v->valType ){
-                            case OGR_INT: // S57 attribute type 'E' enumerated, 'I' integer
-                            {
-                                int LUP_att_val = atoi( slatv );
-                                if( LUP_att_val == *(int*) ( v->value ) )
-                                    attValMatch = true;
-                                break;
-                            }
-                            
-                            case OGR_INT_LST: // S57 attribute type 'L' list: comma separated integer
-                            {
-                                int a;
-                                char ss[41];
-                                strncpy( ss, slatv, 39 );
-                                ss[40] = '\0';
-                                char *s = &ss[0];
-                                
-                                int *b = (int*) v->value;
-                                sscanf( s, "%d", &a );
-                                
-                                while( *s != '\0' ) {
-                                    if( a == *b ) {
-                                        sscanf( ++s, "%d", &a );
-                                        b++;
-                                        attValMatch = true;
-                                        
-                                    } else
-                                        attValMatch = false;
-                                }
-                                break;
-                            }
-                            case OGR_REAL: // S57 attribute type'F' float
-                            {
-                                double obj_val = *(double*) ( v->value );
-                                float att_val = atof( slatv );
-                                if( fabs( obj_val - att_val ) < 1e-6 )
-                                    if( obj_val == att_val  )
-                                        attValMatch = true;
-                                break;
-                            }
-                            
-                            case OGR_STR: // S57 attribute type'A' code string, 'S' free text
-                            {
-                                //    Strings must be exact match
-                                //    n.b. OGR_STR is used for S-57 attribute type 'L', comma-separated list
-                                
-                                //wxString cs( (char *) v->value, wxConvUTF8 ); // Attribute from object
-                                //if( LATTC.Mid( 6 ) == cs )
-                                if( !strcmp((char *) v->value, slatv))
-                                    attValMatch = true;
-                                break;
-                            }
-                            
-                            default:
-                                break;
-                        } //switch
-                        
-                        // value match
-                        if( attValMatch )
-                            ++countATT;
-                                                
-                        goto next_LUP_Attr;
-                    } // if attribute name match
-                    
-                    //  Advance to the next S57obj attribute
-                    currATT += 6;
-                    ++attIdx;
-                    
-                } //while
-            } //if
-            
-next_LUP_Attr:
-         
-            currATT = pObj->att_array; // restart the object attribute list
-            attIdx = 0;
+            //checking against object attribute value
+            S57attVal *v = ( pObj->attVal->Item( attIdx ) );
+            bool attValMatch = false;
+
+            switch( v->valType ){
+                case OGR_INT: // S57 attribute type 'E' enumerated, 'I' integer
+                    attValMatch = ( m.ival == *(int*) ( v->value ) );
+                    break;
+
+                case OGR_REAL: // S57 attribute type'F' float
+                    attValMatch = ( *(double*) ( v->value ) == m.fval );
+                    break;
+
+                case OGR_STR: // S57 attribute type'A' code string, 'S' free text
+                    //    Strings must be exact match
+                    //    n.b. OGR_STR is used for S-57 attribute type 'L', comma-separated list
+                    attValMatch = !strcmp( (char *) v->value, m.sval );
+                    break;
+
+                default:
+                    break;
+            } //switch
+
+            // value match
+            if( attValMatch )
+                ++countATT;
         } // for iLUPAtt
         
         //      Create a "match score", defined as fraction of candidate LUP attributes
@@ -1383,6 +1360,8 @@ void s52plib::ClearCNSYLUPArray( void )
 
         condSymbolLUPArray->Clear();
     }
+    m_cs_lup_index.clear();
+    m_cs_memo.clear();
 }
 
 bool s52plib::S52_flush_Plib()
@@ -1411,6 +1390,8 @@ bool s52plib::S52_flush_Plib()
 #endif
     
     DestroyLUPArray( condSymbolLUPArray );
+    m_cs_lup_index.clear();
+    m_cs_memo.clear();
 
 //      Destroy Rules
     DestroyRules( _line_sym );
@@ -2204,13 +2185,23 @@ extern GLenum       g_texture_rectangle_format;
                 i = rand() & (TXF_CACHE -1);
             }
             if (f_cache == 0) {
+                //  Draw what is queued in the font before it is replaced
+                if( s_txf[i].cache.HasBatch() )
+                    FlushTexFontBatch( &s_txf[i].cache );
                 s_txf[i].key = ptext->pFont;
                 f_cache = &s_txf[i].cache;
                 f_cache->Build(*ptext->pFont);
             }
 
-            int w, h;
-            f_cache->GetTextExtent(ptext->frmtd, &w, &h);
+            //  The extent is that of the font glyphs, so holds while the font does
+            if( !ptext->layout_txf || ptext->layout_font != ptext->pFont ) {
+                f_cache->GetTextExtent(ptext->frmtd, &ptext->layout_width, &ptext->layout_height);
+                ptext->layout_utf8 = (const char *)ptext->frmtd.ToUTF8();
+                ptext->layout_font = ptext->pFont;
+                ptext->layout_txf = true;
+            }
+            int w = ptext->layout_width;
+            int h = ptext->layout_height;
             
             // We don't store descent/ascent info for font texture cache
             // So we have to estimate based on conventional Arial metrics
@@ -2282,7 +2273,17 @@ extern GLenum       g_texture_rectangle_format;
                 if( CheckTextRectList( *pRectDrawn, ptext ) ) bdraw = false;
             }
             
-            if( bdraw ) {
+            if( bdraw && m_bTextBatch ) {
+#ifndef USE_ANDROID_GLES2
+                wxColour wcolor = GetFontColour_PlugIn(_("ChartTexts"));
+                if( wcolor == *wxBLACK )
+                    wcolor = wxColour( ptext->pcol->R, ptext->pcol->G, ptext->pcol->B );
+
+                /* undo previous rotation to make text level */
+                f_cache->AddString( ptext->layout_utf8.c_str(), xp, yp, -vp->rotation, wcolor );
+#endif
+            }
+            else if( bdraw ) {
 #ifndef USE_ANDROID_GLES2
                 wxColour wcolor = GetFontColour_PlugIn(_("ChartTexts"));
                 if( wcolor == *wxBLACK )
@@ -2300,7 +2301,7 @@ extern GLenum       g_texture_rectangle_format;
                 /* undo previous rotation to make text level */
                 glRotatef(vp->rotation*180/PI, 0, 0, -1);
                 
-                f_cache->RenderString(ptext->frmtd);
+                f_cache->RenderString(ptext->layout_utf8.c_str());
                 glPopMatrix();
                 
                 glDisable( GL_TEXTURE_2D );
@@ -2315,7 +2316,7 @@ extern GLenum       g_texture_rectangle_format;
                 /* undo previous rotation to make text level */
                 //glRotatef(vp->rotation*180/PI, 0, 0, -1);
 
-                f_cache->RenderString(ptext->frmtd, xp, yp);
+                f_cache->RenderString(ptext->layout_utf8.c_str(), xp, yp);
 
                 glDisable( GL_TEXTURE_2D );
                 glDisable( GL_BLEND );
@@ -2328,25 +2329,31 @@ extern GLenum       g_texture_rectangle_format;
             wxFont oldfont = pdc->GetFont(); // save current font
             
             
+            wxFont *dc_font = ptext->pFont;
             if(scale_factor > 1){
                 wxFont *pf = ptext->pFont;
                 int old_size = pf->GetPointSize();
                 int new_size = old_size * scale_factor;
-                wxFont *scaled_font = FindOrCreateFont_PlugIn( new_size, pf->GetFamily(),
-                                                                       pf->GetStyle(), pf->GetWeight(), false,
-                                                                       pf->GetFaceName() );
-                pdc->SetFont( *scaled_font);
-            }
-            else{
-                pdc->SetFont( *( ptext->pFont ) );
+                dc_font = FindOrCreateFont_PlugIn( new_size, pf->GetFamily(),
+                                                           pf->GetStyle(), pf->GetWeight(), false,
+                                                           pf->GetFaceName() );
             }
+            pdc->SetFont( *dc_font );
             
-            wxCoord w, h, descent, exlead;
-            pdc->GetTextExtent( ptext->frmtd, &w, &h, &descent, &exlead ); // measure the text
+            //  Measure the text only when the font changes, as it does with the scale
+            if( ptext->layout_txf || ptext->layout_font != dc_font ) {
+                wxCoord exlead;
+                pdc->GetTextExtent( ptext->frmtd, &ptext->layout_width, &ptext->layout_height,
+                                    &ptext->layout_descent, &exlead ); // measure the text
+                ptext->layout_font = dc_font;
+                ptext->layout_txf = false;
+            }
+            wxCoord w = ptext->layout_width;
+            wxCoord h = ptext->layout_height;
             
             // We cannot get the font ascent value to remove the interline spacing.
             // So we have to estimate based on conventional Arial metrics
-            int rendered_text_height = (h - descent) * 8 / 10;
+            int rendered_text_height = (h - ptext->layout_descent) * 8 / 10;
             
             //  Adjust the y position to account for the convention that S52 text is drawn
             //  with the lower left corner at the specified point, instead of the wx convention
@@ -2445,18 +2452,7 @@ extern GLenum       g_texture_rectangle_format;
 //    Return true if test_rect overlaps any rect in the current text rectangle list, except itself
 bool s52plib::CheckTextRectList( const wxRect &test_rect, S52_TextC *ptext )
 {
-    //    Iterate over the current object list, looking at rText
-
-    for( TextObjList::Node *node = m_textObjList.GetFirst(); node; node = node->GetNext() ) {
-        wxRect *pcurrent_rect = &( node->GetData()->rText );
-
-        if( pcurrent_rect->Intersects( test_rect ) ) {
-            if( node->GetData() != ptext )
-                return true;
-
-        }
-    }
-    return false;
+    return m_textGrid.Intersects( test_rect, ptext );
 }
 
 bool s52plib::TextRenderCheck( ObjRazRules *rzRules )
@@ -2652,18 +2648,8 @@ int s52plib::RenderT_All( ObjRazRules *rzRules, Rules *rules, ViewPort *vp, bool
         //      If this text was actually drawn, add a pointer to its rect to the de-clutter list if it doesn't already exist
         if( m_bDeClutterText ) {
             if( bwas_drawn ) {
-                bool b_found = false;
-                for( TextObjList::Node *node = m_textObjList.GetFirst(); node; node =  node->GetNext() ) {
-                    S52_TextC *oc = node->GetData();
-
-                    if( oc == text ) {
-                        if(!b_dupok)
-                            b_found = true;
-                        break;
-                    }
-                }
-                if( !b_found )
-                    m_textObjList.Append( text );
+                if( b_dupok || !m_textGrid.Contains( text ) )
+                    m_textGrid.Add( text, text->rText );
             }
         }
 
@@ -3846,80 +3832,35 @@ bool s52plib::RenderSoundingSymbol( ObjRazRules *rzRules, Rule *prule, wxPoint &
 
 
 // Line Simple Style, OpenGL
-int s52plib::RenderGLLS( ObjRazRules *rzRules, Rules *rules, ViewPort *vp )
+//  Whether simple lines are drawn from the chart line VBO in this view
+bool s52plib::CanRenderGLLS( ViewPort *vp )
 {
     // for now don't use vbo model in non-mercator
     if(vp->m_projection_type != PROJECTION_MERCATOR)
-        return RenderLS(rzRules, rules, vp);
+        return false;
 
     if( !m_benableGLLS )                        // root chart cannot support VBO model, for whatever reason
-        return RenderLS(rzRules, rules, vp);
+        return false;
 
 #ifndef USE_ANDROID_GLES2    
     double scale_factor = vp->ref_scale/vp->chart_scale;
     if(scale_factor > 10.0)
-        return RenderLS(rzRules, rules, vp);
+        return false;
 #endif     
 
-    if( !rzRules->obj->m_chart_context->chart )
-        return RenderLS(rzRules, rules, vp);    // this is where S63 PlugIn gets caught
-    
     if(( vp->GetBBox().GetMaxLon() >= 180.) || (vp->GetBBox().GetMinLon() <= -180.))
-        return RenderLS(rzRules, rules, vp);    // cm03 has trouble at IDL        
-    
-    bool b_useVBO = false;
-    float *vertex_buffer = 0;
-    
-    if(rzRules->obj->auxParm2 > 0)             // Has VBO been defined and uploaded? 
-        b_useVBO = true;
-
-    if( !b_useVBO ){
-#if 0        
-        if( rzRules->obj->m_chart_context->chart ){
-            vertex_buffer = rzRules->obj->m_chart_context->chart->GetLineVertexBuffer(); 
-        }
-        else {
-            vertex_buffer = rzRules->obj->m_chart_context->vertex_buffer; 
-        }
-        
-        
-        if(!vertex_buffer)
-            return RenderLS(rzRules, rules, vp);    // this is where cm93 gets caught
-#else
-        vertex_buffer = rzRules->obj->m_chart_context->vertex_buffer; 
-            
-#endif            
-    }
+        return false;                           // cm03 has trouble at IDL        
 
-    
-#ifdef ocpnUSE_GL
-
-    char *str = (char*) rules->INSTstr;
-
-#ifdef USE_ANDROID_GLES2
-    if( (!strncmp( str, "DASH", 4 ) ) || ( !strncmp( str, "DOTT", 4 ) ) )
-        return RenderLS_Dash_GLSL(rzRules, rules, vp);
-#endif
-
-
-    LLBBox BBView = vp->GetBBox();
-
-    //  Allow a little slop in calculating whether a segment
-    //  is within the requested Viewport
-    double margin = BBView.GetLonRange() * .05;
-    BBView.EnLarge( margin );
+    return true;
+}
 
-    //  Get the current display priority
-    //  Default comes from the LUP, unless overridden
-    int priority_current = rzRules->LUP->DPRI - '0';
-    if(rzRules->obj->m_DPRI >= 0)
-        priority_current = rzRules->obj->m_DPRI;
-    
-    line_segment_element *ls_list = rzRules->obj->m_ls_list;
-    
+//  Set up the width and dash pattern of an LS rule {str}, and return its color
+S52color *s52plib::SetGLLineStyle( const char *str )
+{
     S52color *c = getColor( str + 7 ); // Colour
     int w = atoi( str + 5 ); // Width
     
+#ifdef ocpnUSE_GL
 #ifndef ocpnUSE_GLES // linestipple is emulated poorly
     glColor3ub( c->R, c->G, c->B );
 #endif
@@ -3975,6 +3916,133 @@ int s52plib::RenderGLLS( ObjRazRules *rzRules, Rules *rules, ViewPort *vp )
         glDisable( GL_LINE_STIPPLE );
 #endif    
 
+#endif
+
+    return c;
+}
+
+void s52plib::ResetGLLineStyle()
+{
+#ifdef ocpnUSE_GL
+    glDisable( GL_LINE_STIPPLE );
+    glDisable( GL_LINE_SMOOTH );
+    glDisable( GL_BLEND );
+#endif
+}
+
+//  The one rule of {rule_type} an object draws in the area (AC, AP) or the object
+//  (all other types) render pass, or NULL if it draws anything else in that pass.
+//  Conditional rules are evaluated as the renderers do.
+Rules *s52plib::GetSoleRule( ObjRazRules *rzRules, int rule_type, bool b_area )
+{
+    Rules *sole = NULL;
+    int n_sole = 0;
+    bool b_cs = false;
+
+    Rules *rules = rzRules->LUP->ruleList;
+    while( rules ) {
+        int type = rules->ruleType;
+
+        if( type == RUL_CND_SY ) {
+            if( !b_cs ) {
+                if( !rzRules->obj->bCS_Added ) {
+                    rzRules->obj->CSrules = NULL;
+                    GetAndAddCSRules( rzRules, rules );
+                    if( b_area || strncmp(rzRules->obj->FeatureName, "SOUNDG", 6) )
+                        rzRules->obj->bCS_Added = 1; // mark the object
+                }
+
+                //  The renderers go on with the CS rules only
+                rules = rzRules->obj->CSrules;
+                b_cs = true;
+                continue;
+            }
+        }
+        else if( type == rule_type ) {
+            sole = rules;
+            n_sole++;
+        }
+        else if( type != RUL_NONE ) {
+            bool b_area_type = ( type == RUL_ARE_CO ) || ( type == RUL_ARE_PA );
+            if( b_area_type == b_area )
+                return NULL;
+        }
+
+        rules = rules->next;
+    }
+
+    return ( n_sole == 1 ) ? sole : NULL;
+}
+
+Rules *s52plib::GetGLBatchAreaRule( ObjRazRules *rzRules )
+{
+    return GetSoleRule( rzRules, RUL_ARE_CO, true );
+}
+
+Rules *s52plib::GetGLBatchLineRule( ObjRazRules *rzRules )
+{
+    return GetSoleRule( rzRules, RUL_SIM_LN, false );
+}
+
+int s52plib::RenderGLLS( ObjRazRules *rzRules, Rules *rules, ViewPort *vp )
+{
+    if( !CanRenderGLLS( vp ) )
+        return RenderLS(rzRules, rules, vp);
+
+    if( !rzRules->obj->m_chart_context->chart )
+        return RenderLS(rzRules, rules, vp);    // this is where S63 PlugIn gets caught
+    
+    bool b_useVBO = false;
+    float *vertex_buffer = 0;
+    
+    if(rzRules->obj->auxParm2 > 0)             // Has VBO been defined and uploaded? 
+        b_useVBO = true;
+
+    if( !b_useVBO ){
+#if 0        
+        if( rzRules->obj->m_chart_context->chart ){
+            vertex_buffer = rzRules->obj->m_chart_context->chart->GetLineVertexBuffer(); 
+        }
+        else {
+            vertex_buffer = rzRules->obj->m_chart_context->vertex_buffer; 
+        }
+        
+        
+        if(!vertex_buffer)
+            return RenderLS(rzRules, rules, vp);    // this is where cm93 gets caught
+#else
+        vertex_buffer = rzRules->obj->m_chart_context->vertex_buffer; 
+            
+#endif            
+    }
+
+    
+#ifdef ocpnUSE_GL
+
+    char *str = (char*) rules->INSTstr;
+
+#ifdef USE_ANDROID_GLES2
+    if( (!strncmp( str, "DASH", 4 ) ) || ( !strncmp( str, "DOTT", 4 ) ) )
+        return RenderLS_Dash_GLSL(rzRules, rules, vp);
+#endif
+
+
+    LLBBox BBView = vp->GetBBox();
+
+    //  Allow a little slop in calculating whether a segment
+    //  is within the requested Viewport
+    double margin = BBView.GetLonRange() * .05;
+    BBView.EnLarge( margin );
+
+    //  Get the current display priority
+    //  Default comes from the LUP, unless overridden
+    int priority_current = rzRules->LUP->DPRI - '0';
+    if(rzRules->obj->m_DPRI >= 0)
+        priority_current = rzRules->obj->m_DPRI;
+    
+    line_segment_element *ls_list = rzRules->obj->m_ls_list;
+    
+    S52color *c = SetGLLineStyle( str );
 
 #ifndef USE_ANDROID_GLES2
     glColor3ub( c->R, c->G, c->B );
@@ -4169,9 +4237,7 @@ int s52plib::RenderGLLS( ObjRazRules *rzRules, Rules *rules, ViewPort *vp )
 #endif
 
 
-    glDisable( GL_LINE_STIPPLE );
-    glDisable( GL_LINE_SMOOTH );
-    glDisable( GL_BLEND );
+    ResetGLLineStyle();
     
 #endif                  // OpenGL
     
@@ -8630,6 +8696,11 @@ void s52plib::RenderToBufferFilledPolygon( ObjRazRules *rzRules, S57Obj *obj, S5
 
         PolyTriGroup *ppg = obj->pPolyTessGeo->Get_PolyTriGroup_head();
 
+        //  Solid fills by merged spans, patterns triangle by triangle
+        bool b_spans = ( NULL == pPatt_spec ) && ( NULL != c );
+        if( b_spans )
+            m_span_raster.Begin( pb_spec );
+
         TriPrim *p_tp = ppg->tri_prim_head;
         while( p_tp ) {
             LLBBox box;
@@ -8679,7 +8750,10 @@ void s52plib::RenderToBufferFilledPolygon( ObjRazRules *rzRules, S57Obj *obj, S5
                             pp3[2].x = ptp[it + 2].x;
                             pp3[2].y = ptp[it + 2].y;
 
-                            dda_tri( pp3, &cp, pb_spec, pPatt_spec );
+                            if( b_spans )
+                                m_span_raster.AddTriangle( pp3 );
+                            else
+                                dda_tri( pp3, &cp, pb_spec, pPatt_spec );
                         }
                         break;
                     }
@@ -8694,7 +8768,10 @@ void s52plib::RenderToBufferFilledPolygon( ObjRazRules *rzRules, S57Obj *obj, S5
                             pp3[2].x = ptp[it + 2].x;
                             pp3[2].y = ptp[it + 2].y;
 
-                            dda_tri( pp3, &cp, pb_spec, pPatt_spec );
+                            if( b_spans )
+                                m_span_raster.AddTriangle( pp3 );
+                            else
+                                dda_tri( pp3, &cp, pb_spec, pPatt_spec );
                         }
                         break;
                     }
@@ -8710,7 +8787,10 @@ void s52plib::RenderToBufferFilledPolygon( ObjRazRules *rzRules, S57Obj *obj, S5
                             pp3[2].x = ptp[it + 2].x;
                             pp3[2].y = ptp[it + 2].y;
 
-                            dda_tri( pp3, &cp, pb_spec, pPatt_spec );
+                            if( b_spans )
+                                m_span_raster.AddTriangle( pp3 );
+                            else
+                                dda_tri( pp3, &cp, pb_spec, pPatt_spec );
                         }
                         break;
 
@@ -8727,6 +8807,9 @@ void s52plib::RenderToBufferFilledPolygon( ObjRazRules *rzRules, S57Obj *obj, S5
                 p_tp = p_tp->p_next; 
                 
         } // while
+
+        if( b_spans )
+            m_span_raster.Fill( &cp );
         
         free( ptp );
         free( pp3 );
@@ -10632,12 +10715,100 @@ int s52plib::RenderAreaToDC( wxDC *pdcin, ObjRazRules *rzRules, ViewPort *vp,
 
 }
 
+//  The CS procedures whose result depends only on these attributes of the
+//  object, its class, primitive and display category, and the mariner
+//  parameters below
+static const struct
+{
+    const char  *proc;
+    const char  *attrs[5];
+} s_cs_memo_procs[] = {
+    { "DEPARE01", { "DRVAL1", "DRVAL2", NULL } },
+    { "DEPARE02", { "DRVAL1", "DRVAL2", NULL } },
+    { "QUAPNT01", { "QUAPOS", NULL } },
+    { "RESARE02", { "RESTRN", "CATREA", NULL } },
+    { "RESTRN01", { "RESTRN", NULL } },
+    { "SLCONS03", { "QUAPOS", "CONDTN", "CATSLC", "WATLEV", NULL } },
+};
+
+static const S52_MAR_param_t s_cs_memo_params[] = {
+    S52_MAR_TWO_SHADES, S52_MAR_SHALLOW_CONTOUR, S52_MAR_SAFETY_CONTOUR,
+    S52_MAR_DEEP_CONTOUR, S52_MAR_SYMBOLIZED_BND
+};
+
+#define CS_MEMO_MAX     100000          // entries, before the memo starts over
+
+//  The key of the CS result of {rzRules}, if its procedure is one of the above
+bool s52plib::GetCSMemoKey( ObjRazRules *rzRules, Rules *rules, std::string &key )
+{
+    if( !rules->INSTstr )
+        return false;
+
+    size_t iproc;
+    size_t nproc = sizeof(s_cs_memo_procs) / sizeof(s_cs_memo_procs[0]);
+    for( iproc = 0; iproc < nproc; iproc++ ) {
+        if( !strncmp( rules->INSTstr, s_cs_memo_procs[iproc].proc, 8 ) )
+            break;
+    }
+    if( iproc == nproc )
+        return false;
+
+    S57Obj *obj = rzRules->obj;
+
+    key.assign( s_cs_memo_procs[iproc].proc, 8 );
+    key.append( rzRules->LUP->OBCL, 6 );
+    key += (char) rzRules->LUP->DISC;
+    key += (char) obj->Primitive_type;
+
+    for( const char * const *attr = s_cs_memo_procs[iproc].attrs; *attr; attr++ ) {
+        int idx = obj->GetAttributeIndex( *attr );
+        if( idx < 0 ) {
+            key += '\0';
+            continue;
+        }
+
+        S57attVal *v = obj->attVal->Item( idx );
+        key += (char) ( 1 + v->valType );
+        switch( v->valType ) {
+            case OGR_INT:
+                key.append( (const char *) v->value, sizeof(int) );
+                break;
+            case OGR_REAL:
+                key.append( (const char *) v->value, sizeof(double) );
+                break;
+            case OGR_STR:
+                key.append( (const char *) v->value );
+                key += '\0';
+                break;
+            default:
+                return false;
+        }
+    }
+
+    for( size_t i = 0; i < sizeof(s_cs_memo_params) / sizeof(s_cs_memo_params[0]); i++ ) {
+        double param = S52_getMarinerParam( s_cs_memo_params[i] );
+        key.append( (const char *) &param, sizeof(double) );
+    }
+
+    return true;
+}
+
 void s52plib::GetAndAddCSRules( ObjRazRules *rzRules, Rules *rules )
 {
 
     LUPrec *NewLUP;
     LUPrec *LUP;
-    LUPrec *LUPCandidate;
+
+//  Has an alike object been through this procedure, with the same settings?
+    std::string memo_key;
+    bool b_memo = GetCSMemoKey( rzRules, rules, memo_key );
+    if( b_memo ) {
+        std::unordered_map<std::string, LUPrec *>::iterator it = m_cs_memo.find( memo_key );
+        if( it != m_cs_memo.end() ) {
+            rzRules->obj->CSrules = it->second->ruleList;
+            return;
+        }
+    }
 
     char *rule_str1 = RenderCS( rzRules, rules );
     wxString cs_string( rule_str1, wxConvUTF8 );
@@ -10645,28 +10816,17 @@ void s52plib::GetAndAddCSRules( ObjRazRules *rzRules, Rules *rules )
 
 //  Try to find a match for this object/attribute set in dynamic CS LUP Table
 
-//  Do this by checking each LUP in the CS LUPARRAY and checking....
-//  a) is Object Name the same? and
-//  b) was LUP created earlier by exactly the same INSTruction string?
-//  c) does LUP have same Display Category and Priority?
+//  Do this by looking up the LUP in the CS LUPARRAY index, by....
+//  a) Object Name and
+//  b) the INSTruction string it was created from and
+//  c) Display Category
 
-    wxArrayOfLUPrec *la = condSymbolLUPArray;
-    int index = 0;
-    int index_max = la->GetCount();
-    LUP = NULL;
-
-    while( ( index < index_max ) ) {
-        LUPCandidate = la->Item( index );
-        if( !strcmp( rzRules->LUP->OBCL, LUPCandidate->OBCL ) ) {
-            if( LUPCandidate->INST->IsSameAs( cs_string ) ) {
-                if( LUPCandidate->DISC == rzRules->LUP->DISC ) {
-                    LUP = LUPCandidate;
-                    break;
-                }
-            }
-        }
-        index++;
-    }
+    std::string lup_key( rzRules->LUP->OBCL, 6 );
+    lup_key += (char) rzRules->LUP->DISC;
+    lup_key += (const char *) cs_string.utf8_str();
+
+    std::unordered_map<std::string, LUPrec *>::iterator itl = m_cs_lup_index.find( lup_key );
+    LUP = ( itl != m_cs_lup_index.end() ) ? itl->second : NULL;
 
 //  If not found, need to create a dynamic LUP and add to CS LUP Table
 
@@ -10692,11 +10852,18 @@ void s52plib::GetAndAddCSRules( ObjRazRules *rzRules, Rules *rules )
         wxArrayOfLUPrec *pLUPARRAYtyped = condSymbolLUPArray;
 
         pLUPARRAYtyped->Add( NewLUP );
+        m_cs_lup_index[lup_key] = NewLUP;
 
         LUP = NewLUP;
 
     } // if (LUP = NULL)
 
+    if( b_memo ) {
+        if( m_cs_memo.size() >= CS_MEMO_MAX )
+            m_cs_memo.clear();
+        m_cs_memo[memo_key] = LUP;
+    }
+
     Rules *top = LUP->ruleList;
 
     rzRules->obj->CSrules = top; // patch in a new rule set
@@ -11247,10 +11414,45 @@ void s52plib::SetQualityOfData(bool val)
 void s52plib::ClearTextList( void )
 {
     //      Clear the current text rectangle list
-    m_textObjList.Clear();
+    m_textGrid.Clear();
 
 }
 
+//      GL state for the texture font glyphs, as in RenderText
+void s52plib::FlushTexFontBatch( TexFont *txf )
+{
+#if defined(ocpnUSE_GL) && !defined(USE_ANDROID_GLES2)
+    glEnable( GL_BLEND );
+    glEnable( GL_TEXTURE_2D );
+    glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+
+    txf->FlushBatch();
+
+    glDisable( GL_TEXTURE_2D );
+    glDisable( GL_BLEND );
+#else
+    txf->FlushBatch();
+#endif
+}
+
+void s52plib::BeginTextBatch( void )
+{
+#if defined(ocpnUSE_GL) && !defined(USE_ANDROID_GLES2)
+    m_bTextBatch = true;
+#endif
+}
+
+void s52plib::EndTextBatch( void )
+{
+#ifdef ocpnUSE_GL
+    for( unsigned int i = 0; i < TXF_CACHE; i++ ) {
+        if( s_txf[i].key && s_txf[i].cache.HasBatch() )
+            FlushTexFontBatch( &s_txf[i].cache );
+    }
+#endif
+    m_bTextBatch = false;
+}
+
 bool s52plib::EnableGLLS(bool b_enable)
 {
     bool return_val = m_benableGLLS;
@@ -11260,23 +11462,9 @@ bool s52plib::EnableGLLS(bool b_enable)
     
 void s52plib::AdjustTextList( int dx, int dy, int screenw, int screenh )
 {
+    //    The declutter grid holds the labels of one frame, and is cleared
+    //    for the next rather than offset by a pan
     return;
-    wxRect rScreen( 0, 0, screenw, screenh );
-    //    Iterate over the text rectangle list
-    //        1.  Apply the specified offset to the list elements
-    //        2.. Remove any list elements that are off screen after applied offset
-
-    TextObjList::Node *node = m_textObjList.GetFirst();
-    TextObjList::Node *next;
-    while( node ) {
-        next = node->GetNext();
-        wxRect *pcurrent = &( node->GetData()->rText );
-        pcurrent->Offset( dx, dy );
-        if( !pcurrent->Intersects( rScreen ) ) {
-            m_textObjList.DeleteNode( node );
-        }
-        node = next;
-    }
 }
 
 bool s52plib::GetPointPixArray( ObjRazRules *rzRules, wxPoint2DDouble* pd, wxPoint *pp, int nv, ViewPort *vp )
@@ -80,6 +80,10 @@
 #include <algorithm>          // for std::sort
 #include <map>
 
+#if !defined(__WXMSW__) && !defined(__OCPN__ANDROID__)
+#include <sys/resource.h>
+#endif
+
 #include "ssl/sha1.h"
 
 #ifdef __MSVC__
@@ -88,6 +92,9 @@
 
 
 extern bool GetDoubleAttr(S57Obj *obj, const char *AttrName, double &val);      // found in s52cnsy
+extern bool GetMemoryStatus(int *mem_total, int *mem_used);
+
+#define S57_LOAD_LOG_BYTES      (8 * 1024 * 1024)       // SENC size from which loads are logged
 
 void OpenCPN_OGRErrorHandler( CPLErr eErrClass, int nError,
                               const char * pszErrorMsg );               // installed GDAL OGR library error handler
@@ -119,6 +126,7 @@ extern MyFrame*          gFrame;
 extern PlugInManager     *g_pi_manager;
 extern bool              g_b_overzoom_x;
 extern bool              g_b_EnableVBO;
+extern bool              g_bGLBatchS57;
 extern OCPNPlatform     *g_Platform;
 extern SENCThreadManager *g_SencThreadManager;
 
@@ -266,9 +274,12 @@ s57chart::s57chart()
     m_next_safe_cnt = 1e6;
     m_LineVBO_name = -1;
     m_line_vertex_buffer = 0;
+    m_ingest_senc = NULL;
+    m_blog_first_frame = false;
     m_this_chart_context =  0;
     m_Chart_Skew = 0;
     m_vbo_byte_length = 0;
+    m_object_bytes = 0;
     m_SENCthreadStatus = THREAD_INACTIVE;
     bReadyToRender = false;
     m_RAZBuilt = false;
@@ -481,6 +492,10 @@ void s57chart::FreeObjectsAndRules()
 //      The LUPs of base elements are deleted elsewhere ( void s52plib::DestroyLUPArray ( wxArrayOfLUPrec *pLUPArray ))
 //      But we need to manually destroy any LUPS related to children
 
+    m_spatial_index.Clear();
+    m_gl_batches.Invalidate();
+    m_hazard_index.Clear();
+
     ObjRazRules *top;
     ObjRazRules *nxx;
     for( int i = 0; i < PRIO_NUM; ++i ) {
@@ -771,6 +786,8 @@ void s57chart::SetLinePriorities( void )
         ObjRazRules *top;
         ObjRazRules *crnt;
 
+        m_gl_batches.Invalidate();              // line batches hold the segments of each priority
+
         for( int i = 0; i < PRIO_NUM; ++i ) {
 
             top = razRules[i][2];           //LINES
@@ -1392,7 +1409,8 @@ void s57chart::AssembleLineGeometry( void )
         VE_Element *pedge = it->second;
         if(pedge){
             m_pve_vector.push_back(pedge);
-            free(pedge->pPoints);
+            if(!m_ingest_senc || !m_ingest_senc->IsMapped(pedge->pPoints))
+                free(pedge->pPoints);
         }
     }
     m_ve_hash.clear();
@@ -1403,7 +1421,7 @@ void s57chart::AssembleLineGeometry( void )
     // are now in the VBO buffer
     for( VC_Hash::iterator itc = m_vc_hash.begin(); itc != m_vc_hash.end(); ++itc ) {
         VC_Element *pcs = itc->second;
-        if(pcs)
+        if(pcs && (!m_ingest_senc || !m_ingest_senc->IsMapped(pcs->pPoint)))
             free(pcs->pPoint);
         delete pcs;
     }
@@ -1544,6 +1562,8 @@ bool s57chart::DoRenderRegionViewOnGL( const wxGLContext &glc, const ViewPort& V
 
     if( g_bDebugS57 ) printf( "\n" );
 
+    wxStopWatch sw;
+
     SetVPParms( VPoint );
 
     ps52plib->PrepareForRender((ViewPort *)&VPoint);
@@ -1567,6 +1587,13 @@ bool s57chart::DoRenderRegionViewOnGL( const wxGLContext &glc, const ViewPort& V
     BuildLineVBO();
     SetLinePriorities();
 
+    //  Merge the fills and simple lines.  cm93 loads its cells piecemeal, and draws them one by one.
+    if( g_bGLBatchS57 && g_b_EnableVBO && CHART_TYPE_CM93 != GetChartType() ) {
+        int area_type = ( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) ? 4 : 3;
+        if( !m_gl_batches.IsValid( area_type ) )
+            m_gl_batches.Build( razRules, area_type, m_LineVBO_name );
+    }
+
     //        Clear the text declutter list
     ps52plib->ClearTextList();
 
@@ -1656,6 +1683,9 @@ bool s57chart::DoRenderRegionViewOnGL( const wxGLContext &glc, const ViewPort& V
 //      Update last_vp to reflect current state
     m_last_vp = VPoint;
 
+    S57GLBatches::CountRenderTime( sw.TimeInMicro().ToLong() );
+
+    LogFirstFrame();
 
 //      CALLGRIND_STOP_INSTRUMENTATION
 
@@ -1672,19 +1702,37 @@ bool s57chart::DoRenderOnGL( const wxGLContext &glc, const ViewPort& VPoint )
     ObjRazRules *crnt;
     ViewPort tvp = VPoint;                    // undo const  TODO fix this in PLIB
 
+    //  Only the objects near the view
+    LLBBox box = S57SpatialIndex::GetQueryBox( tvp.GetBBox(), tvp );
+    std::vector<ObjRazRules *> rules;
+
+    int area_type = ( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) ? 4 : 3;
+    int point_type = ( ps52plib->m_nSymbolStyle == SIMPLIFIED ) ? 0 : 1;
+
+    //  Fills and solid lines in batches where they can be,
+    //  drawn at each priority ahead of the objects drawn on their own
+    bool b_batch_areas = m_gl_batches.IsValid( area_type ) && tvp.m_projection_type == PROJECTION_MERCATOR;
+    bool b_batch_lines = b_batch_areas && ps52plib->CanRenderGLLS( &tvp );
+    std::vector<ObjRazRules *> singles;
+
 #if 1    
     //      Render the areas quickly
     for( i = 0; i < PRIO_NUM; ++i ) {
-        if( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) 
-            top = razRules[i][4]; // Area Symbolized Boundaries
-        else
-            top = razRules[i][3]; // Area Plain Boundaries
-
-        while( top != NULL ) {
-            crnt = top;
-            top = top->next;               // next object
+        GetRulesInBox( i, area_type, box, rules );
+        singles.clear();
+        for( size_t k = 0; k < rules.size(); k++ ) {
+            crnt = rules[k];
             crnt->sm_transform_parms = &vp_transform;
-            ps52plib->RenderAreaToGL( glc, crnt, &tvp );
+            if( !b_batch_areas || !m_gl_batches.AddArea( crnt, &tvp ) )
+                singles.push_back( crnt );
+        }
+
+        if( b_batch_areas )
+            m_gl_batches.DrawAreas( i, &tvp, vp_transform );
+
+        for( size_t k = 0; k < singles.size(); k++ ) {
+            ps52plib->RenderAreaToGL( glc, singles[k], &tvp );
+            S57GLBatches::CountSingle();
         }
     }
 
@@ -1717,40 +1765,20 @@ bool s57chart::DoRenderOnGL( const wxGLContext &glc, const ViewPort& VPoint )
     
     //    Render the lines and points
     for( i = 0; i < PRIO_NUM; ++i ) {
-        if( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) 
-            top = razRules[i][4]; // Area Symbolized Boundaries
-        else
-            top = razRules[i][3]; // Area Plain Boundaries
-        while( top != NULL ) {
-            crnt = top;
-            top = top->next;               // next object
-            crnt->sm_transform_parms = &vp_transform;
-            ps52plib->RenderObjectToGL( glc, crnt, &tvp );
-        }
+        RenderLinesOnGL( glc, i, area_type, box, tvp, b_batch_lines, rules, singles );
     }
     //qDebug() << "Done Boundaries" << sw.GetTime();
 
     for( i = 0; i < PRIO_NUM; ++i ) {
-        top = razRules[i][2];           //LINES
-        while( top != NULL ) {
-            crnt = top;
-            top = top->next;
-            crnt->sm_transform_parms = &vp_transform;
-            ps52plib->RenderObjectToGL( glc, crnt, &tvp );
-        }
+        RenderLinesOnGL( glc, i, 2, box, tvp, b_batch_lines, rules, singles );    //LINES
     }
  
  //qDebug() << "Done Lines" << sw.GetTime();
 
     for( i = 0; i < PRIO_NUM; ++i ) {
-        if( ps52plib->m_nSymbolStyle == SIMPLIFIED ) 
-            top = razRules[i][0];       //SIMPLIFIED Points
-        else
-            top = razRules[i][1];           //Paper Chart Points Points
-
-        while( top != NULL ) {
-            crnt = top;
-            top = top->next;
+        GetRulesInBox( i, point_type, box, rules );
+        for( size_t k = 0; k < rules.size(); k++ ) {
+            crnt = rules[k];
             crnt->sm_transform_parms = &vp_transform;
             ps52plib->RenderObjectToGL( glc, crnt, &tvp );
         }
@@ -1763,6 +1791,29 @@ bool s57chart::DoRenderOnGL( const wxGLContext &glc, const ViewPort& VPoint )
     return true;
 }
 
+void s57chart::RenderLinesOnGL( const wxGLContext &glc, int prio, int type, const LLBBox &box, ViewPort &tvp,
+                                bool b_batch, std::vector<ObjRazRules *> &rules, std::vector<ObjRazRules *> &singles )
+{
+#ifdef ocpnUSE_GL
+    GetRulesInBox( prio, type, box, rules );
+    singles.clear();
+    for( size_t k = 0; k < rules.size(); k++ ) {
+        ObjRazRules *crnt = rules[k];
+        crnt->sm_transform_parms = &vp_transform;
+        if( !b_batch || !m_gl_batches.AddLine( crnt, &tvp ) )
+            singles.push_back( crnt );
+    }
+
+    if( b_batch )
+        m_gl_batches.DrawLines( prio, type, &tvp, vp_transform );
+
+    for( size_t k = 0; k < singles.size(); k++ ) {
+        ps52plib->RenderObjectToGL( glc, singles[k], &tvp );
+        S57GLBatches::CountSingle();
+    }
+#endif
+}
+
 bool s57chart::DoRenderOnGLText( const wxGLContext &glc, const ViewPort& VPoint )
 {
 #ifdef ocpnUSE_GL
@@ -1772,6 +1823,12 @@ bool s57chart::DoRenderOnGLText( const wxGLContext &glc, const ViewPort& VPoint
     ObjRazRules *crnt;
     ViewPort tvp = VPoint;                    // undo const  TODO fix this in PLIB
 
+    LLBBox box = S57SpatialIndex::GetQueryBox( tvp.GetBBox(), tvp );
+    std::vector<ObjRazRules *> rules;
+
+    int area_type = ( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) ? 4 : 3;
+    int point_type = ( ps52plib->m_nSymbolStyle == SIMPLIFIED ) ? 0 : 1;
+
 #if 0    
     //      Render the areas quickly
     for( i = 0; i < PRIO_NUM; ++i ) {
@@ -1789,41 +1846,35 @@ bool s57chart::DoRenderOnGLText( const wxGLContext &glc, const ViewPort& VPoint
     }
 #endif
     
+    //  Labels in the texture fonts are queued, and drawn font by font at the end
+    ps52plib->BeginTextBatch();
+
     //    Render the lines and points
     for( i = 0; i < PRIO_NUM; ++i ) {
-        if( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) 
-            top = razRules[i][4]; // Area Symbolized Boundaries
-        else
-            top = razRules[i][3]; // Area Plain Boundaries
-
-        while( top != NULL ) {
-                crnt = top;
-                top = top->next;               // next object
+        GetRulesInBox( i, area_type, box, rules );
+        for( size_t k = 0; k < rules.size(); k++ ) {
+                crnt = rules[k];
                 crnt->sm_transform_parms = &vp_transform;
                 ps52plib->RenderObjectToGLText( glc, crnt, &tvp );
         }
             
-        top = razRules[i][2];           //LINES
-        while( top != NULL ) {
-                crnt = top;
-                top = top->next;
+        GetRulesInBox( i, 2, box, rules );           //LINES
+        for( size_t k = 0; k < rules.size(); k++ ) {
+                crnt = rules[k];
                 crnt->sm_transform_parms = &vp_transform;
                 ps52plib->RenderObjectToGLText( glc, crnt, &tvp );
         }
             
-        if( ps52plib->m_nSymbolStyle == SIMPLIFIED ) 
-            top = razRules[i][0];       //SIMPLIFIED Points
-        else
-            top = razRules[i][1];           //Paper Chart Points Points
-            
-        while( top != NULL ) {
-                crnt = top;
-                top = top->next;
+        GetRulesInBox( i, point_type, box, rules );
+        for( size_t k = 0; k < rules.size(); k++ ) {
+                crnt = rules[k];
                 crnt->sm_transform_parms = &vp_transform;
                 ps52plib->RenderObjectToGLText( glc, crnt, &tvp );
         }
             
     }
+
+    ps52plib->EndTextBatch();
     
 #endif          //#ifdef ocpnUSE_GL
     
@@ -1990,10 +2041,22 @@ bool s57chart::DoRenderRegionViewOnDC( wxMemoryDC& dc, const ViewPort& VPoint,
 
     m_last_Region = Region;
 
+    LogFirstFrame();
+
     return true;
 
 }
 
+//    For the charts whose load was logged, log the time from Init() to the end of their first render
+void s57chart::LogFirstFrame( void )
+{
+    if( !m_blog_first_frame )
+        return;
+
+    m_blog_first_frame = false;
+    wxLogMessage( _T("   First frame of %s drawn %ld ms after open"), m_FullPath.c_str(), m_sw_open.Time() );
+}
+
 bool s57chart::RenderViewOnDC( wxMemoryDC& dc, const ViewPort& VPoint )
 {
 //    CALLGRIND_START_INSTRUMENTATION
@@ -2236,7 +2299,6 @@ int s57chart::DCRenderRect( wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rec
 {
 
     int i;
-    ObjRazRules *top;
     ObjRazRules *crnt;
 
     wxASSERT(rect);
@@ -2273,41 +2335,36 @@ int s57chart::DCRenderRect( wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rec
     } else
         r = g = b = 0;
 
-    if( pb_spec.depth == 24 ) {
-        for( int i = 0; i < pb_spec.height; i++ ) {
-            unsigned char *p = pb_spec.pix_buff + ( i * pb_spec.pb_pitch );
-            for( int j = 0; j < pb_spec.width; j++ ) {
-                *p++ = r;
-                *p++ = g;
-                *p++ = b;
-            }
-        }
-    } else {
-        int color_int = ( ( r ) << 16 ) + ( ( g ) << 8 ) + ( b );
+    wxStopWatch sw;
 
-        for( int i = 0; i < pb_spec.height; i++ ) {
-            int *p = (int *) ( pb_spec.pix_buff + ( i * pb_spec.pb_pitch ) );
-            for( int j = 0; j < pb_spec.width; j++ ) {
-                *p++ = color_int;
-            }
-        }
-    }
+    //  Packed as a 32 bit pixel, whose first three bytes are those of a 24 bit one
+    unsigned int color_int;
+    if( pb_spec.depth == 24 )
+        color_int = ( ( b ) << 16 ) + ( ( g ) << 8 ) + ( r );
+    else
+        color_int = ( ( r ) << 16 ) + ( ( g ) << 8 ) + ( b );
+
+    for( int i = 0; i < pb_spec.height; i++ )
+        S52SpanRaster::FillSpan( pb_spec.pix_buff + ( i * pb_spec.pb_pitch ), pb_spec.depth,
+                                 color_int, pb_spec.width );
 
 //      Render the areas quickly
-    for( i = 0; i < PRIO_NUM; ++i ) {
-        if( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) 
-            top = razRules[i][4]; // Area Symbolized Boundaries
-        else
-            top = razRules[i][3]; // Area Plain Boundaries
+    LLBBox box = S57SpatialIndex::GetQueryBox( tvp.GetBBox(), tvp );
+    std::vector<ObjRazRules *> rules;
+    int area_type = ( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) ? 4 : 3;
 
-        while( top != NULL ) {
-            crnt = top;
-            top = top->next;               // next object
+    for( i = 0; i < PRIO_NUM; ++i ) {
+        GetRulesInBox( i, area_type, box, rules );
+        for( size_t k = 0; k < rules.size(); k++ ) {
+            crnt = rules[k];
             crnt->sm_transform_parms = &vp_transform;
             ps52plib->RenderAreaToDC( &dcinput, crnt, &tvp, &pb_spec );
         }
     }
 
+    if( g_bDebugS57 )
+        S52SpanRaster::LogStats( *rect, sw.Time() );
+
 //      Convert the Private render canvas into a bitmap
 #ifdef ocpnUSE_ocpnBitmap
     ocpnBitmap *pREN = new ocpnBitmap( pb_spec.pix_buff, pb_spec.width, pb_spec.height,
@@ -2347,10 +2404,15 @@ int s57chart::DCRenderRect( wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rec
 bool s57chart::DCRenderLPB( wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect )
 {
     int i;
-    ObjRazRules *top;
     ObjRazRules *crnt;
     ViewPort tvp = vp;                    // undo const  TODO fix this in PLIB
 
+    LLBBox box = S57SpatialIndex::GetQueryBox( tvp.GetBBox(), tvp );
+    std::vector<ObjRazRules *> rules;
+
+    int area_type = ( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) ? 4 : 3;
+    int point_type = ( ps52plib->m_nSymbolStyle == SIMPLIFIED ) ? 0 : 1;
+
     for( i = 0; i < PRIO_NUM; ++i ) {
 //      Set up a Clipper for Lines
         wxDCClipper *pdcc = NULL;
@@ -2359,33 +2421,23 @@ bool s57chart::DCRenderLPB( wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rec
 //         pdcc = new wxDCClipper(dcinput, nr);
 //      }
 
-        if( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) 
-            top = razRules[i][4]; // Area Symbolized Boundaries
-        else
-            top = razRules[i][3];           // Area Plain Boundaries
-        while( top != NULL ) {
-            crnt = top;
-            top = top->next;               // next object
+        GetRulesInBox( i, area_type, box, rules );
+        for( size_t k = 0; k < rules.size(); k++ ) {
+            crnt = rules[k];
             crnt->sm_transform_parms = &vp_transform;
             ps52plib->RenderObjectToDC( &dcinput, crnt, &tvp );
         }
 
-        top = razRules[i][2];           //LINES
-        while( top != NULL ) {
-            crnt = top;
-            top = top->next;
+        GetRulesInBox( i, 2, box, rules );           //LINES
+        for( size_t k = 0; k < rules.size(); k++ ) {
+            crnt = rules[k];
             crnt->sm_transform_parms = &vp_transform;
             ps52plib->RenderObjectToDC( &dcinput, crnt, &tvp );
         }
 
-        if( ps52plib->m_nSymbolStyle == SIMPLIFIED ) 
-            top = razRules[i][0];       //SIMPLIFIED Points
-        else
-            top = razRules[i][1];           //Paper Chart Points Points
-
-        while( top != NULL ) {
-            crnt = top;
-            top = top->next;
+        GetRulesInBox( i, point_type, box, rules );
+        for( size_t k = 0; k < rules.size(); k++ ) {
+            crnt = rules[k];
             crnt->sm_transform_parms = &vp_transform;
             ps52plib->RenderObjectToDC( &dcinput, crnt, &tvp );
         }
@@ -2407,40 +2459,33 @@ bool s57chart::DCRenderLPB( wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rec
 bool s57chart::DCRenderText( wxMemoryDC& dcinput, const ViewPort& vp )
 {
     int i;
-    ObjRazRules *top;
     ObjRazRules *crnt;
     ViewPort tvp = vp;                    // undo const  TODO fix this in PLIB
+
+    LLBBox box = S57SpatialIndex::GetQueryBox( tvp.GetBBox(), tvp );
+    std::vector<ObjRazRules *> rules;
+
+    int area_type = ( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) ? 4 : 3;
+    int point_type = ( ps52plib->m_nSymbolStyle == SIMPLIFIED ) ? 0 : 1;
     
     for( i = 0; i < PRIO_NUM; ++i ) {
-        
-        if( ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES ) 
-            top = razRules[i][4]; // Area Symbolized Boundaries
-        else
-            top = razRules[i][3]; // Area Plain Boundaries
-
-        while( top != NULL ) {
-                crnt = top;
-                top = top->next;               // next object
+        GetRulesInBox( i, area_type, box, rules );
+        for( size_t k = 0; k < rules.size(); k++ ) {
+                crnt = rules[k];
                 crnt->sm_transform_parms = &vp_transform;
                 ps52plib->RenderObjectToDCText( &dcinput, crnt, &tvp );
         }
             
-        top = razRules[i][2];           //LINES
-        while( top != NULL ) {
-                crnt = top;
-                top = top->next;
+        GetRulesInBox( i, 2, box, rules );           //LINES
+        for( size_t k = 0; k < rules.size(); k++ ) {
+                crnt = rules[k];
                 crnt->sm_transform_parms = &vp_transform;
                 ps52plib->RenderObjectToDCText( &dcinput, crnt, &tvp );
         }
             
-        if( ps52plib->m_nSymbolStyle == SIMPLIFIED ) 
-            top = razRules[i][0];       //SIMPLIFIED Points
-        else
-            top = razRules[i][1];           //Paper Chart Points Points
-            
-        while( top != NULL ) {
-                crnt = top;
-                top = top->next;
+        GetRulesInBox( i, point_type, box, rules );
+        for( size_t k = 0; k < rules.size(); k++ ) {
+                crnt = rules[k];
                 crnt->sm_transform_parms = &vp_transform;
                 ps52plib->RenderObjectToDCText( &dcinput, crnt, &tvp );
         }
@@ -2465,6 +2510,8 @@ bool s57chart::IsCellOverlayType( const wxString &FullPath )
 
 InitReturn s57chart::Init( const wxString& name, ChartInitFlag flags )
 {
+    m_sw_open.Start();
+
     // Really can only Init and use S57 chart if the S52 Presentation Library is present and OK
     if( (NULL ==ps52plib) || !(ps52plib->m_bOK) )
         return INIT_FAIL_REMOVE;
@@ -4014,10 +4061,32 @@ int s57chart::BuildSENCFile( const wxString& FullPath000, const wxString& SENCFi
 
 
 
+//  Peak resident size of the process, in kilobytes; the current one where
+//  the peak is not known
+static int GetPeakMemoryUsed()
+{
+#if defined(__WXMSW__) || defined(__OCPN__ANDROID__)
+    int mem_used = 0;
+    GetMemoryStatus( 0, &mem_used );
+    return mem_used;
+#else
+    struct rusage usage;
+    if( getrusage( RUSAGE_SELF, &usage ) )
+        return 0;
+#ifdef __WXOSX__
+    return usage.ru_maxrss / 1024;              // in bytes
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
 int s57chart::BuildRAZFromSENCFile( const wxString& FullPath )
 {
     int ret_val = 0;                    // default is OK
 
+    wxStopWatch sw;
+
     Osenc sencfile;
 
     // Set up the containers for ingestion results.
@@ -4027,6 +4096,7 @@ int s57chart::BuildRAZFromSENCFile( const wxString& FullPath )
     VC_ElementVector VCs;
 
     sencfile.setRefLocn(ref_lat, ref_lon);
+    sencfile.setAttrArena(&m_attr_arena);
 
     int srv = sencfile.ingest200(FullPath, &Objects, &VEs, &VCs);
 
@@ -4099,6 +4169,9 @@ int s57chart::BuildRAZFromSENCFile( const wxString& FullPath )
     
     //Walk the vector of S57Objs, associating LUPS, instructions, etc...
 
+    wxStopWatch sw_lup;
+    size_t n_objects = Objects.size();
+
     for(unsigned int i=0 ; i < Objects.size() ; i++){
 
         S57Obj *obj = Objects[i];
@@ -4208,6 +4281,8 @@ int s57chart::BuildRAZFromSENCFile( const wxString& FullPath )
 
     }   // Objects iterator
 
+    long lup_ms = sw_lup.Time();
+
 
     //   Decide on pub date to show
 
@@ -4251,7 +4326,9 @@ int s57chart::BuildRAZFromSENCFile( const wxString& FullPath )
 
     ObjRazRules *top;
 
+    m_ingest_senc = &sencfile;
     AssembleLineGeometry();
+    m_ingest_senc = NULL;
 
     //  Set up the chart context
     m_this_chart_context = (chart_context *)calloc( sizeof(chart_context), 1);
@@ -4270,11 +4347,60 @@ int s57chart::BuildRAZFromSENCFile( const wxString& FullPath )
         }
     }
 
+    //  Index the objects now, while the chart may still be loading in the background.
+    //  The trees follow the lists, which depend on the symbol and boundary styles
+    //  of the plib, so they are built here rather than stored in the SENC.
+    wxStopWatch sw_index;
+    m_spatial_index.Build( razRules );
+    long index_ms = sw_index.Time();
+
+    if( sencfile.GetMappedSize() >= S57_LOAD_LOG_BYTES || g_bDebugS57 ){
+        wxLogMessage( _T("   Loaded SENC %s, %.1f MB in %ld ms, peak memory %d MB"),
+                      FullPath.c_str(), sencfile.GetMappedSize() / (1024. * 1024.),
+                      sw.Time(), GetPeakMemoryUsed() / 1024 );
+
+        double attr_mb = m_attr_arena.GetBytes() / (1024. * 1024.);
+        wxLogMessage( _T("      %lu objects, symbolized in %ld ms, indexed in %ld ms; attributes %.1f MB, %.1f MB per million objects, %lu values in %lu records"),
+                      (unsigned long)n_objects, lup_ms, index_ms, attr_mb,
+                      n_objects ? attr_mb * 1e6 / n_objects : 0.,
+                      m_attr_arena.GetValueCount(), (unsigned long)m_attr_arena.GetRecordCount() );
+
+        m_blog_first_frame = true;
+    }
 
     return ret_val;
 }
 
+void s57chart::GetRulesInBox( int prio, int type, const LLBBox &box, std::vector<ObjRazRules *> &rules )
+{
+    if( !m_spatial_index.IsValid( prio, type ) )
+        m_spatial_index.Build( prio, type, razRules[prio][type] );
+
+    m_spatial_index.Query( prio, type, box, rules );
+}
+
+const S57HazardIndex &s57chart::GetHazardIndex()
+{
+    if( !m_hazard_index.IsValid() ) {
+        wxStopWatch sw;
+        m_hazard_index.Build( razRules, m_line_vertex_buffer );
+        DepthHazards::CountBuild( sw.TimeInMicro().ToLong() );
+    }
+
+    return m_hazard_index;
+}
+
+
 
+size_t s57chart::GetMemoryFootprint()
+{
+    size_t bytes = m_object_bytes + m_vbo_byte_length + m_hazard_index.GetBytes();
+
+    if( pDIB )
+        bytes += (size_t)pDIB->GetLinePitch() * pDIB->GetHeight();
+
+    return bytes;
+}
 
 int s57chart::_insertRules( S57Obj *obj, LUPrec *LUP, s57chart *pOwner )
 {
@@ -4348,10 +4474,18 @@ int s57chart::_insertRules( S57Obj *obj, LUPrec *LUP, s57chart *pOwner )
     rzRules = (ObjRazRules *) malloc( sizeof(ObjRazRules) );
     rzRules->obj = obj;
     obj->nRef++;                         // Increment reference counter for delete check;
+
+    m_object_bytes += sizeof(ObjRazRules);
+    if(obj->nRef == 1)
+        m_object_bytes += sizeof(S57Obj) + obj->npt * 3 * sizeof(double);
     rzRules->LUP = LUP;
     rzRules->child = NULL;
     rzRules->mps = NULL;
 
+    m_spatial_index.Invalidate( disPrioIdx, LUPtypeIdx );
+    m_gl_batches.Invalidate();
+    m_hazard_index.Invalidate();
+
 #if 0    
     rzRules->next = razRules[disPrioIdx][LUPtypeIdx];
     razRules[disPrioIdx][LUPtypeIdx] = rzRules;
@@ -4572,19 +4706,26 @@ ListOfObjRazRules *s57chart::GetObjRuleListAtLatLon( float lat, float lon, float
 
     ListOfObjRazRules *ret_ptr = new ListOfObjRazRules;
 
-//    Iterate thru the razRules array, by object/rule type
+//    Iterate thru the razRules array, by object/rule type,
+//    visiting only the objects near the selection point
 
     ObjRazRules *top;
 
+    LLBBox pick_box;
+    pick_box.Set( lat - select_radius, lon - select_radius, lat + select_radius, lon + select_radius );
+    LLBBox box = S57SpatialIndex::GetQueryBox( pick_box, *VPoint );
+    std::vector<ObjRazRules *> rules;
+
     for( int i = 0; i < PRIO_NUM; ++i ) {
 
         if(selection_mask & MASK_POINT){
             // Points by type, array indices [0..1]
 
             int point_type = ( ps52plib->m_nSymbolStyle == SIMPLIFIED ) ? 0 : 1;
-            top = razRules[i][point_type];
+            GetRulesInBox( i, point_type, box, rules );
 
-            while( top != NULL ) {
+            for( size_t k = 0; k < rules.size(); k++ ) {
+                top = rules[k];
                 if( top->obj->npt == 1 )       // Do not select Multipoint objects (SOUNDG) yet.
                         {
                     if( ps52plib->ObjectRenderCheck( top, VPoint ) ) {
@@ -4606,8 +4747,6 @@ ListOfObjRazRules *s57chart::GetObjRuleListAtLatLon( float lat, float lon, float
                         child_item = child_item->next;
                     }
                 }
-
-                top = top->next;
             }
         }
 
@@ -4615,28 +4754,26 @@ ListOfObjRazRules *s57chart::GetObjRuleListAtLatLon( float lat, float lon, float
                 // Areas by boundary type, array indices [3..4]
 
             int area_boundary_type = ( ps52plib->m_nBoundaryStyle == PLAIN_BOUNDARIES ) ? 3 : 4;
-            top = razRules[i][area_boundary_type];           // Area nnn Boundaries
-            while( top != NULL ) {
+            GetRulesInBox( i, area_boundary_type, box, rules );           // Area nnn Boundaries
+            for( size_t k = 0; k < rules.size(); k++ ) {
+                top = rules[k];
                 if( ps52plib->ObjectRenderCheck( top, VPoint ) ) {
                     if( DoesLatLonSelectObject( lat, lon, select_radius, top->obj ) ) ret_ptr->Append(
                             top );
                 }
-
-                top = top->next;
-            }         // while
+            }
         }
 
         if(selection_mask & MASK_LINE){
                 // Finally, lines
-            top = razRules[i][2];           // Lines
+            GetRulesInBox( i, 2, box, rules );           // Lines
 
-            while( top != NULL ) {
+            for( size_t k = 0; k < rules.size(); k++ ) {
+                top = rules[k];
                 if( ps52plib->ObjectRenderCheck( top, VPoint ) ) {
                     if( DoesLatLonSelectObject( lat, lon, select_radius, top->obj ) ) ret_ptr->Append(
                             top );
                 }
-
-                top = top->next;
             }
         }
     }
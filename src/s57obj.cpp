@@ -41,6 +41,7 @@
 #include "s52plib.h"
 
 #include "s57chart.h"
+#include "S57AttrArena.h"
 
 #include "mygeom.h"
 #include "cutil.h"
@@ -103,16 +104,20 @@ S57Obj::~S57Obj()
 {
     //  Don't delete any allocated records of simple copy clones
     if( !bIsClone ) {
+        //  Values and acronyms built on the chart arena are freed with it
         if( attVal ) {
-            for( unsigned int iv = 0; iv < attVal->GetCount(); iv++ ) {
-                S57attVal *vv = attVal->Item( iv );
-                void *v2 = vv->value;
-                free( v2 );
-                delete vv;
+            if( !m_attr_arena ) {
+                for( unsigned int iv = 0; iv < attVal->GetCount(); iv++ ) {
+                    S57attVal *vv = attVal->Item( iv );
+                    void *v2 = vv->value;
+                    free( v2 );
+                    delete vv;
+                }
             }
             delete attVal;
         }
-        free( att_array );
+        if( !m_attr_arena )
+            free( att_array );
 
         if( pPolyTessGeo ) {
 #ifdef ocpnUSE_GL
@@ -151,6 +156,7 @@ void S57Obj::Init()
     att_array = NULL;
     attVal = NULL;
     n_attr = 0;
+    m_attr_arena = NULL;
 
     pPolyTessGeo = NULL;
 
@@ -207,19 +213,33 @@ S57Obj::S57Obj( const char* featureName )
 }
 
 
+void S57Obj::AddAttributeAcronym( const char *acronym )
+{
+    if( m_attr_arena )
+        att_array = m_attr_arena->AddAcronym( att_array, n_attr, acronym );
+    else {
+        att_array = (char *)realloc(att_array, 6*(n_attr + 1));
+        strncpy(att_array + (6 * sizeof(char) * n_attr), acronym, 6);
+    }
+    n_attr++;
+}
+
 bool S57Obj::AddIntegerAttribute( const char *acronym, int val ){
 
-    S57attVal *pattValTmp = new S57attVal;
+    S57attVal *pattValTmp;
+    if( m_attr_arena )
+        pattValTmp = m_attr_arena->GetInteger( val );
+    else {
+        pattValTmp = new S57attVal;
 
-    int *pAVI = (int *) malloc( sizeof(int) );         //new int;
-    *pAVI = val;
+        int *pAVI = (int *) malloc( sizeof(int) );         //new int;
+        *pAVI = val;
 
-    pattValTmp->valType = OGR_INT;
-    pattValTmp->value = pAVI;
+        pattValTmp->valType = OGR_INT;
+        pattValTmp->value = pAVI;
+    }
 
-    att_array = (char *)realloc(att_array, 6*(n_attr + 1));
-    strncpy(att_array + (6 * sizeof(char) * n_attr), acronym, 6);
-    n_attr++;
+    AddAttributeAcronym( acronym );
 
     attVal->Add( pattValTmp );
 
@@ -236,17 +256,20 @@ bool S57Obj::AddIntegerListAttribute( const char *acronym, int *pval, int nValue
 
 bool S57Obj::AddDoubleAttribute( const char *acronym, double val ){
 
-    S57attVal *pattValTmp = new S57attVal;
+    S57attVal *pattValTmp;
+    if( m_attr_arena )
+        pattValTmp = m_attr_arena->GetDouble( val );
+    else {
+        pattValTmp = new S57attVal;
 
-    double *pAVI = (double *) malloc( sizeof(double) );         //new double;
-    *pAVI = val;
+        double *pAVI = (double *) malloc( sizeof(double) );         //new double;
+        *pAVI = val;
 
-    pattValTmp->valType = OGR_REAL;
-    pattValTmp->value = pAVI;
+        pattValTmp->valType = OGR_REAL;
+        pattValTmp->value = pAVI;
+    }
 
-    att_array = (char *)realloc(att_array, 6*(n_attr + 1));
-    strncpy(att_array + (6 * sizeof(char) * n_attr), acronym, 6);
-    n_attr++;
+    AddAttributeAcronym( acronym );
 
     attVal->Add( pattValTmp );
 
@@ -260,17 +283,20 @@ bool S57Obj::AddDoubleListAttribute( const char *acronym, double *pval, int nVal
 
 bool S57Obj::AddStringAttribute( const char *acronym, char *val ){
 
-    S57attVal *pattValTmp = new S57attVal;
+    S57attVal *pattValTmp;
+    if( m_attr_arena )
+        pattValTmp = m_attr_arena->GetString( val );
+    else {
+        pattValTmp = new S57attVal;
 
-    char *pAVS = (char *)malloc(strlen(val) + 1);   //new string
-    strcpy(pAVS, val);
+        char *pAVS = (char *)malloc(strlen(val) + 1);   //new string
+        strcpy(pAVS, val);
 
-    pattValTmp->valType = OGR_STR;
-    pattValTmp->value = pAVS;
+        pattValTmp->valType = OGR_STR;
+        pattValTmp->value = pAVS;
+    }
 
-    att_array = (char *)realloc(att_array, 6*(n_attr + 1));
-    strncpy(att_array + (6 * sizeof(char) * n_attr), acronym, 6);
-    n_attr++;
+    AddAttributeAcronym( acronym );
 
     attVal->Add( pattValTmp );
 